@@ -0,0 +1,272 @@
+/**
+ * @brief Placement of threads on CPUs, and of memory on NUMA nodes
+ *
+ * @file Affinity.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#include "Affinity.h"
+
+// System headers
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Standard headers
+#include <cstdlib>
+#include <fstream>
+#include <climits>
+#include <stdint.h>
+
+
+namespace
+{
+    constexpr const char* NODE_DIRECTORY = "/sys/devices/system/node/";
+
+    /// The most nodes a memory policy can name here
+    constexpr int MAX_NODES = sizeof(unsigned long) * CHAR_BIT;
+
+    /**
+     * @brief The machine's NUMA layout, read once
+     */
+    struct Topology
+    {
+        std::vector<int>                nodeOfCpu;      ///< Indexed by CPU; -1 for CPUs not found
+        std::vector<std::vector<int>>   cpusOfNode;     ///< Indexed by node; empty for nodes without CPUs
+
+        Topology()
+        {
+            std::string possible;
+            std::ifstream(std::string(NODE_DIRECTORY) + "possible") >> possible;
+
+            auto nodes = Common::Affinity::parseCpuList(possible);
+            if (nodes)
+            {
+                for (auto node : nodes.value())
+                {
+                    std::string list;
+                    std::ifstream(std::string(NODE_DIRECTORY) + "node" + std::to_string(node) + "/cpulist") >> list;
+
+                    auto cpus = Common::Affinity::parseCpuList(list);
+                    if (!cpus)
+                    {
+                        // Memory only, or gone.
+                        continue;
+                    }
+
+                    if (cpusOfNode.size() <= static_cast<size_t>(node))
+                    {
+                        cpusOfNode.resize(node + 1);
+                    }
+                    cpusOfNode[node] = cpus.value();
+
+                    for (auto cpu : cpus.value())
+                    {
+                        if (nodeOfCpu.size() <= static_cast<size_t>(cpu))
+                        {
+                            nodeOfCpu.resize(cpu + 1, -1);
+                        }
+                        nodeOfCpu[cpu] = node;
+                    }
+                }
+            }
+
+            if (cpusOfNode.empty())
+            {
+                // Not NUMA, or sysfs is not mounted: one node holding every CPU.
+                cpusOfNode.emplace_back();
+                const auto count = sysconf(_SC_NPROCESSORS_CONF);
+                for (int cpu = 0; cpu < count; ++cpu)
+                {
+                    cpusOfNode[0].push_back(cpu);
+                    nodeOfCpu.push_back(0);
+                }
+            }
+        }
+    };
+
+    const Topology& topology()
+    {
+        static const Topology sTopology;
+        return sTopology;
+    }
+}
+
+
+namespace Common
+{
+    //-----------------------------------------------------------------------------
+    std::optional<std::vector<int>> Affinity::parseCpuList(const std::string& list)
+    {
+        std::vector<int> cpus;
+
+        const char* position = list.c_str();
+        while (*position != '\0')
+        {
+            char* end = nullptr;
+            auto first = std::strtol(position, &end, 10);
+            if (end == position || first < 0 || first >= CPU_SETSIZE)
+            {
+                return std::nullopt;
+            }
+
+            auto last = first;
+            if (*end == '-')
+            {
+                position = end + 1;
+                last = std::strtol(position, &end, 10);
+                if (end == position || last < first || last >= CPU_SETSIZE)
+                {
+                    return std::nullopt;
+                }
+            }
+
+            for (auto cpu = first; cpu <= last; ++cpu)
+            {
+                cpus.push_back(static_cast<int>(cpu));
+            }
+
+            if (*end == ',')
+            {
+                ++end;
+            }
+            else if (*end != '\0' && *end != '\n')
+            {
+                return std::nullopt;
+            }
+            else
+            {
+                break;
+            }
+
+            position = end;
+        }
+
+        if (cpus.empty())
+        {
+            return std::nullopt;
+        }
+
+        return cpus;
+    }
+
+    //-----------------------------------------------------------------------------
+    bool Affinity::pin(const std::vector<int>& cpus) noexcept
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+
+        if (cpus.empty())
+        {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            {
+                CPU_SET(cpu, &set);
+            }
+        }
+        else
+        {
+            for (auto cpu : cpus)
+            {
+                if (cpu >= 0 && cpu < CPU_SETSIZE)
+                {
+                    CPU_SET(cpu, &set);
+                }
+            }
+        }
+
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+
+    //-----------------------------------------------------------------------------
+    bool Affinity::pin(int cpu) noexcept
+    {
+        if (cpu < 0 || cpu >= CPU_SETSIZE)
+        {
+            return false;
+        }
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+
+    //-----------------------------------------------------------------------------
+    bool Affinity::setRealtime(int priority) noexcept
+    {
+        sched_param param{};
+        param.sched_priority = priority;
+
+        return pthread_setschedparam(pthread_self(), priority > 0 ? SCHED_FIFO : SCHED_OTHER, &param) == 0;
+    }
+
+    //-----------------------------------------------------------------------------
+    int Affinity::currentCpu() noexcept
+    {
+        return sched_getcpu();
+    }
+
+    //-----------------------------------------------------------------------------
+    int Affinity::nodeOf(int cpu) noexcept
+    {
+        const auto& nodes = topology().nodeOfCpu;
+        if (cpu < 0 || static_cast<size_t>(cpu) >= nodes.size() || nodes[cpu] < 0)
+        {
+            return 0;
+        }
+
+        return nodes[cpu];
+    }
+
+    //-----------------------------------------------------------------------------
+    std::vector<int> Affinity::cpusOf(int node)
+    {
+        const auto& cpus = topology().cpusOfNode;
+        if (node < 0 || static_cast<size_t>(node) >= cpus.size())
+        {
+            return {};
+        }
+
+        return cpus[node];
+    }
+
+    //-----------------------------------------------------------------------------
+    int Affinity::nodeCount() noexcept
+    {
+        int count = 0;
+        for (const auto& cpus : topology().cpusOfNode)
+        {
+            count += cpus.empty() ? 0 : 1;
+        }
+
+        return count;
+    }
+
+    //-----------------------------------------------------------------------------
+    bool Affinity::bindMemory(void* address, size_t len, int node) noexcept
+    {
+        if (node < 0 || node >= MAX_NODES)
+        {
+            return false;
+        }
+
+        // mbind() takes whole pages only.
+        const auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        const auto start = (reinterpret_cast<uintptr_t>(address) + page - 1) & ~(page - 1);
+        const auto end = (reinterpret_cast<uintptr_t>(address) + len) & ~(page - 1);
+        if (end <= start)
+        {
+            return true;
+        }
+
+        // The kernel reads one bit fewer than it is told.
+        unsigned long mask = 1ul << node;
+        return syscall(SYS_mbind, start, end - start, MPOL_PREFERRED, &mask, MAX_NODES + 1, MPOL_MF_MOVE) == 0;
+    }
+
+} // namespace Common
@@ -0,0 +1,83 @@
+/**
+ * @brief Placement of threads on CPUs, and of memory on NUMA nodes
+ *
+ * @file Affinity.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <stddef.h>
+
+
+namespace Common
+{
+    /**
+     * @brief Pins threads to CPUs and binds memory to NUMA nodes.
+     * @details The node topology is read from sysfs once, on first use. Where it cannot be read
+     *          (or the machine is not NUMA), every CPU is taken to be on node 0.
+     *
+     *          Placement is advice for performance, never needed for correctness, so nothing here
+     *          throws: a request the kernel refuses is reported by the return value and otherwise
+     *          ignored.
+     */
+    class Affinity
+    {
+    public: // Methods
+        /**
+         * @brief Parse a CPU list as the kernel writes them, e.g. "0-3,8,10-11"
+         * @return The CPUs in the order given, or unset if the list is malformed or empty.
+         */
+        static std::optional<std::vector<int>> parseCpuList(const std::string& list);
+
+        /**
+         * @brief Restrict the calling thread to the given CPUs
+         * @param[in] cpus  - The CPUs to run on; empty to run on any CPU again
+         * @return Whether the kernel accepted the placement
+         */
+        static bool pin(const std::vector<int>& cpus) noexcept;
+
+        /// @brief Restrict the calling thread to a single CPU
+        static bool pin(int cpu) noexcept;
+
+        /**
+         * @brief Run the calling thread under the real-time FIFO scheduling policy
+         * @details A SCHED_FIFO thread runs until it blocks or yields, ahead of every ordinary
+         *          thread on its CPU. Needs CAP_SYS_NICE (or an RLIMIT_RTPRIO allowance).
+         * @param[in] priority  - 1 (lowest) to 99; 0 to return to the ordinary policy
+         * @return Whether the kernel accepted the policy
+         */
+        static bool setRealtime(int priority) noexcept;
+
+        /// @brief The CPU the calling thread is running on at this moment (-1 if unknown)
+        static int currentCpu() noexcept;
+
+        /// @brief The NUMA node that a CPU belongs to (0 if unknown)
+        static int nodeOf(int cpu) noexcept;
+
+        /// @brief The CPUs of a NUMA node, in ascending order
+        static std::vector<int> cpusOf(int node);
+
+        /// @brief The number of NUMA nodes with CPUs (at least 1)
+        static int nodeCount() noexcept;
+
+        /**
+         * @brief Keep a region of memory on a NUMA node, moving what is already there
+         * @details The region is narrowed to the whole pages within it. Pages not yet touched
+         *          are allocated on the node when they are; the node is preferred rather than
+         *          required, so memory is still found elsewhere if the node runs out.
+         * @param[in] address   - The start of the region
+         * @param[in] len       - The length of the region, in bytes
+         * @param[in] node      - The node to keep it on
+         * @return Whether the kernel accepted the policy
+         */
+        static bool bindMemory(void* address, size_t len, int node) noexcept;
+
+    }; // class Affinity
+
+} // namespace Common
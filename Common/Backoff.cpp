@@ -0,0 +1,45 @@
+/**
+ * @brief Exponential backoff with jitter for retry loops
+ *
+ * @file Backoff.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#include "Backoff.h"
+
+#include <algorithm>
+
+
+namespace Common
+{
+
+//-----------------------------------------------------------------------------
+Backoff::Backoff(std::chrono::microseconds base, std::chrono::microseconds cap)
+    : mBase(base)
+    , mCap(std::max(base, cap))
+    , mCeiling(base)
+    , mRandom(std::random_device{}())
+{
+}
+
+//-----------------------------------------------------------------------------
+std::chrono::microseconds Backoff::next()
+{
+    std::uniform_int_distribution<std::chrono::microseconds::rep> dist(0, mCeiling.count());
+    std::chrono::microseconds delay(dist(mRandom));
+
+    // Double the ceiling for the next round, saturating at the cap.
+    mCeiling = std::min(mCeiling * 2, mCap);
+
+    return delay;
+}
+
+//-----------------------------------------------------------------------------
+void Backoff::reset() noexcept
+{
+    mCeiling = mBase;
+}
+
+} // namespace Common
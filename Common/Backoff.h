@@ -0,0 +1,50 @@
+/**
+ * @brief Exponential backoff with jitter for retry loops
+ *
+ * @file Backoff.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <random>
+
+
+namespace Common
+{
+    /**
+     * @brief Computes retry delays that grow exponentially up to a cap, with "full jitter"
+     *          (a uniformly random delay between zero and the current ceiling) so that many
+     *          clients retrying against the same peer do not synchronize.
+     */
+    class Backoff
+    {
+    public: // Methods
+        /**
+         * @brief Construct a Backoff
+         * @param[in] base  - The ceiling for the first delay
+         * @param[in] cap   - The maximum ceiling for any delay
+         */
+        Backoff(std::chrono::microseconds base, std::chrono::microseconds cap);
+
+        /**
+         * @brief Get the next delay and advance the ceiling
+         * @return A random delay in the range [0, ceiling]
+         */
+        std::chrono::microseconds next();
+
+        /// @brief Return the ceiling to the base delay (e.g. after a success)
+        void reset() noexcept;
+
+    private: // Members
+        std::chrono::microseconds   mBase;
+        std::chrono::microseconds   mCap;
+        std::chrono::microseconds   mCeiling;
+        std::minstd_rand            mRandom;
+
+    }; // class Backoff
+
+} // namespace Common
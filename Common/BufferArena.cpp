@@ -0,0 +1,267 @@
+/**
+ * @brief A region of huge pages, prefaulted at startup, that large transfer buffers are carved from
+ *
+ * @file BufferArena.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#include "BufferArena.h"
+
+// System headers
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Standard headers
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <utility>
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
+
+namespace
+{
+    /// Buffers are taken in whole pages, so that each is page aligned.
+    constexpr size_t PAGE_SIZE = 4096;
+
+    size_t roundUp(size_t value, size_t multiple)
+    {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+}
+
+
+namespace Common
+{
+    //-----------------------------------------------------------------------------
+    BufferArena::BufferArena(size_t size, bool prefault)
+        : mSize(roundUp(std::max<size_t>(size, 1), HUGE_PAGE_SIZE))
+        , mAvailable(mSize)
+    {
+        // Explicit huge pages are reserved when mapped, so they cannot run out later; populating
+        // them as well zeroes them now rather than on first touch.
+        auto memory = mmap(nullptr, mSize, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (prefault ? MAP_POPULATE : 0), -1, 0);
+
+        if (memory == MAP_FAILED)
+        {
+            // None reserved (or too few): map more than needed, and keep the huge-page-aligned
+            // part, so that the kernel can back all of it with transparent huge pages.
+            mBacking = Backing::Transparent;
+
+            const auto mapped = mSize + HUGE_PAGE_SIZE;
+            auto raw = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (raw == MAP_FAILED)
+            {
+                throw Exception(std::string("Cannot map a buffer arena: ") + std::strerror(errno));
+            }
+
+            const auto start = reinterpret_cast<uintptr_t>(raw);
+            const auto aligned = roundUp(start, HUGE_PAGE_SIZE);
+            if (aligned > start)
+            {
+                munmap(raw, aligned - start);
+            }
+            if (aligned + mSize < start + mapped)
+            {
+                munmap(reinterpret_cast<void*>(aligned + mSize), start + mapped - aligned - mSize);
+            }
+
+            memory = reinterpret_cast<void*>(aligned);
+
+            // Advice only: without THP support the region is ordinary memory, which still works.
+            madvise(memory, mSize, MADV_HUGEPAGE);
+
+            // After the advice, so that each fault takes a whole huge page.
+            if (prefault && madvise(memory, mSize, MADV_POPULATE_WRITE) != 0)
+            {
+                // Older kernels: touch every page instead.
+                auto bytes = static_cast<volatile char*>(memory);
+                for (size_t offset = 0; offset < mSize; offset += PAGE_SIZE)
+                {
+                    bytes[offset] = 0;
+                }
+            }
+        }
+
+        mMemory = static_cast<char*>(memory);
+        mFree.emplace(0, mSize);
+    }
+
+    //-----------------------------------------------------------------------------
+    BufferArena::~BufferArena()
+    {
+        munmap(mMemory, mSize);
+    }
+
+    //-----------------------------------------------------------------------------
+    BufferArena::Backing BufferArena::backing() const noexcept
+    {
+        return mBacking;
+    }
+
+    //-----------------------------------------------------------------------------
+    size_t BufferArena::size() const noexcept
+    {
+        return mSize;
+    }
+
+    //-----------------------------------------------------------------------------
+    size_t BufferArena::available() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mAvailable;
+    }
+
+    //-----------------------------------------------------------------------------
+    uint64_t BufferArena::fallbacks() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mFallbacks;
+    }
+
+    //-----------------------------------------------------------------------------
+    std::string BufferArena::describe() const
+    {
+        return std::to_string(mSize / (1024 * 1024)) + " MiB of "
+            + (mBacking == Backing::HugeTlb ? "explicit" : "transparent") + " huge pages";
+    }
+
+    //-----------------------------------------------------------------------------
+    // Private Methods
+    //-----------------------------------------------------------------------------
+
+    /// @internal
+    /// @brief Take 'len' bytes (a whole number of pages) from the first free extent large enough
+    /// @return The memory, or null if no extent is large enough
+    char* BufferArena::_take(size_t len)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        for (auto extent = mFree.begin(); extent != mFree.end(); ++extent)
+        {
+            if (extent->second >= len)
+            {
+                const auto offset = extent->first;
+                const auto remaining = extent->second - len;
+
+                mFree.erase(extent);
+                if (remaining > 0)
+                {
+                    mFree.emplace(offset + len, remaining);
+                }
+
+                mAvailable -= len;
+                return mMemory + offset;
+            }
+        }
+
+        ++mFallbacks;
+        return nullptr;
+    }
+
+    /// @internal
+    /// @brief Return memory from _take(), merging it with the free extents on either side
+    void BufferArena::_give(char* memory, size_t len)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto offset = static_cast<size_t>(memory - mMemory);
+        mAvailable += len;
+
+        auto next = mFree.lower_bound(offset);
+        if (next != mFree.end() && offset + len == next->first)
+        {
+            len += next->second;
+            next = mFree.erase(next);
+        }
+
+        if (next != mFree.begin())
+        {
+            auto previous = std::prev(next);
+            if (previous->first + previous->second == offset)
+            {
+                previous->second += len;
+                return;
+            }
+        }
+
+        mFree.emplace_hint(next, offset, len);
+    }
+
+
+    //-----------------------------------------------------------------------------
+    BufferArena::Buffer::Buffer(BufferArena* arena, size_t len)
+        : mSize(roundUp(std::max<size_t>(len, 1), PAGE_SIZE))
+    {
+        if (arena)
+        {
+            mData = arena->_take(mSize);
+            if (mData)
+            {
+                mArena = arena;
+                return;
+            }
+        }
+
+        mData = static_cast<char*>(std::aligned_alloc(PAGE_SIZE, mSize));
+        if (!mData)
+        {
+            throw std::bad_alloc();
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+    BufferArena::Buffer::Buffer(Buffer&& other) noexcept
+        : mArena(std::exchange(other.mArena, nullptr))
+        , mData(std::exchange(other.mData, nullptr))
+        , mSize(std::exchange(other.mSize, 0))
+    {
+    }
+
+    //-----------------------------------------------------------------------------
+    BufferArena::Buffer& BufferArena::Buffer::operator =(Buffer&& other) noexcept
+    {
+        if (this != &other)
+        {
+            _release();
+            mArena = std::exchange(other.mArena, nullptr);
+            mData = std::exchange(other.mData, nullptr);
+            mSize = std::exchange(other.mSize, 0);
+        }
+
+        return *this;
+    }
+
+    //-----------------------------------------------------------------------------
+    BufferArena::Buffer::~Buffer()
+    {
+        _release();
+    }
+
+    //-----------------------------------------------------------------------------
+    void BufferArena::Buffer::_release() noexcept
+    {
+        if (mArena)
+        {
+            mArena->_give(mData, mSize);
+        }
+        else
+        {
+            std::free(mData);
+        }
+
+        mArena = nullptr;
+        mData = nullptr;
+        mSize = 0;
+    }
+
+} // namespace Common
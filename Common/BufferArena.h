@@ -0,0 +1,178 @@
+/**
+ * @brief A region of huge pages, prefaulted at startup, that large transfer buffers are carved from
+ *
+ * @file BufferArena.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <exception>
+#include <stdint.h>
+#include <stddef.h>
+
+
+namespace Common
+{
+    /**
+     * @brief Backs large buffers with huge pages, so that sweeping through them costs few TLB
+     *          misses, and faults their pages in up front, so that none land on the hot path.
+     * @details The region is mapped once, at construction:
+     *          - with explicit huge pages (MAP_HUGETLB) if the system has enough reserved
+     *            (vm.nr_hugepages);
+     *          - otherwise with ordinary pages, aligned and advised as transparent huge pages
+     *            (MADV_HUGEPAGE), which the kernel backs with huge pages where it can.
+     *
+     *          Buffers are taken from the region first fit, in whole pages, and returned to it
+     *          when released. Taking and releasing lock a mutex and may allocate, so they belong
+     *          where a stream or a pool is set up, not in a transfer loop.
+     *
+     *          The arena must outlive every Buffer taken from it.
+     */
+    class BufferArena
+    {
+        BufferArena(const BufferArena&) = delete;
+        BufferArena& operator =(const BufferArena&) = delete;
+
+    public: // Definitions
+        class Exception;
+        class Buffer;
+
+        /// How the region is backed
+        enum class Backing
+        {
+            HugeTlb,        ///< Explicit huge pages
+            Transparent,    ///< Transparent huge pages, as the kernel allows
+        };
+
+        /// The huge page size the region is aligned and sized to
+        static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    public: // Methods
+        /**
+         * @brief Map the region
+         * @param[in] size      - Its size, in bytes (rounded up to whole huge pages)
+         * @param[in] prefault  - Fault every page in now, rather than on first use
+         * @throws Exception if no memory can be mapped at all
+         */
+        BufferArena(size_t size, bool prefault = true);
+
+        virtual ~BufferArena();
+
+        /// @brief How the region is backed
+        Backing backing() const noexcept;
+
+        /// @brief The size of the region, in bytes
+        size_t size() const noexcept;
+
+        /// @brief The bytes not taken by buffers
+        size_t available() const;
+
+        /// @brief The number of buffers that would not fit, and came from the heap instead
+        uint64_t fallbacks() const;
+
+        /// @brief A description of the region, for the log (e.g. "64 MiB of explicit huge pages")
+        std::string describe() const;
+
+    private: // Methods
+        char* _take(size_t len);
+        void _give(char* memory, size_t len);
+
+    private: // Members
+        char*                       mMemory{nullptr};
+        size_t                      mSize;
+        Backing                     mBacking{Backing::HugeTlb};
+        mutable std::mutex          mMutex;
+        std::map<size_t, size_t>    mFree;          ///< Free extents of the region, by offset
+        size_t                      mAvailable;
+        uint64_t                    mFallbacks{0};
+
+    }; // class BufferArena
+
+
+    /**
+     * @brief A buffer taken from a BufferArena (or from the heap, if there is no arena or it is
+     *          full), page aligned, and returned to where it came from when destroyed
+     */
+    class BufferArena::Buffer
+    {
+        Buffer(const Buffer&) = delete;
+        Buffer& operator =(const Buffer&) = delete;
+
+    public: // Methods
+        Buffer() = default;
+
+        /**
+         * @brief Take a buffer
+         * @param[in] arena     - The arena to take it from; null to take it from the heap
+         * @param[in] len       - Its size, in bytes
+         * @throws std::bad_alloc if the heap has no room either
+         */
+        Buffer(BufferArena* arena, size_t len);
+
+        Buffer(Buffer&& other) noexcept;
+        Buffer& operator =(Buffer&& other) noexcept;
+
+        virtual ~Buffer();
+
+        char* get() const noexcept
+        {
+            return mData;
+        }
+
+        size_t size() const noexcept
+        {
+            return mSize;
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return mData != nullptr;
+        }
+
+        /// @brief Whether the buffer came from an arena rather than the heap
+        bool isFromArena() const noexcept
+        {
+            return mArena != nullptr;
+        }
+
+    private: // Methods
+        void _release() noexcept;
+
+    private: // Members
+        BufferArena*    mArena{nullptr};    ///< Where it came from; null for the heap
+        char*           mData{nullptr};
+        size_t          mSize{0};
+
+    }; // class BufferArena::Buffer
+
+
+    /**
+     * @brief Exceptions on the BufferArena class
+     */
+    class BufferArena::Exception : public std::exception
+    {
+    public:
+        Exception(const std::string& message)
+            : mMessage(message)
+        {
+        }
+
+        virtual ~Exception() = default;
+
+        virtual const char* what() const noexcept override
+        {
+            return mMessage.c_str();
+        }
+
+    private:
+        std::string     mMessage;
+
+    }; // class BufferArena::Exception
+
+} // namespace Common
@@ -13,3 +13,6 @@
 
 static constexpr uint16_t SERVER_PORT = 56743;
 static constexpr const char* const SERVER_ADDR = "127.0.0.1";
+
+/// Where a sender daemon listens for local senders by default
+static constexpr const char* const DAEMON_SOCKET_PATH = "/tmp/networksender.sock";
@@ -0,0 +1,281 @@
+/**
+ * @brief CRC-32C (Castagnoli) checksums, hardware accelerated where the CPU allows
+ *
+ * @file Crc32c.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#include "Crc32c.h"
+
+// Standard headers
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+
+namespace
+{
+    /// The Castagnoli polynomial, bit-reversed
+    constexpr uint32_t POLY = 0x82f63b78;
+
+    /// Lane lengths for the hardware path. Long lanes amortize the merge; short ones keep
+    /// medium-sized buffers (e.g. one frame) on three lanes too.
+    constexpr size_t LONG_LANE = 8192;
+    constexpr size_t SHORT_LANE = 256;
+
+    /**
+     * @brief Tables, built once on first use
+     * @details 'bytes' drives the portable slicing-by-8 loop. 'longShift' and 'shortShift' apply
+     *          LONG_LANE or SHORT_LANE zero bytes to a CRC, which is what moving one lane's CRC
+     *          past the next lane amounts to.
+     */
+    struct Tables
+    {
+        uint32_t    bytes[8][256];
+        uint32_t    longShift[4][256];
+        uint32_t    shortShift[4][256];
+
+        Tables()
+        {
+            for (uint32_t n = 0; n < 256; ++n)
+            {
+                uint32_t crc = n;
+                for (int bit = 0; bit < 8; ++bit)
+                {
+                    crc = (crc & 1) ? (crc >> 1) ^ POLY : crc >> 1;
+                }
+                bytes[0][n] = crc;
+            }
+
+            for (uint32_t n = 0; n < 256; ++n)
+            {
+                for (int slice = 1; slice < 8; ++slice)
+                {
+                    auto previous = bytes[slice - 1][n];
+                    bytes[slice][n] = (previous >> 8) ^ bytes[0][previous & 0xff];
+                }
+            }
+
+            makeShift(longShift, LONG_LANE);
+            makeShift(shortShift, SHORT_LANE);
+        }
+
+        /// Multiply a vector by a matrix over GF(2)
+        static uint32_t times(const uint32_t* matrix, uint32_t vector) noexcept
+        {
+            uint32_t sum = 0;
+            for (; vector; vector >>= 1, ++matrix)
+            {
+                if (vector & 1)
+                {
+                    sum ^= *matrix;
+                }
+            }
+            return sum;
+        }
+
+        static void square(uint32_t* result, const uint32_t* matrix) noexcept
+        {
+            for (int n = 0; n < 32; ++n)
+            {
+                result[n] = times(matrix, matrix[n]);
+            }
+        }
+
+        /// Build the table form of the operator that feeds 'len' zero bytes (a power of two) to a CRC.
+        static void makeShift(uint32_t table[4][256], size_t len) noexcept
+        {
+            // The operator for one zero bit, then repeated squaring up to 'len' bytes
+            uint32_t odd[32];
+            uint32_t even[32];
+
+            odd[0] = POLY;
+            for (int n = 1; n < 32; ++n)
+            {
+                odd[n] = 1u << (n - 1);
+            }
+
+            square(even, odd);      // 2 bits
+            square(odd, even);      // 4 bits
+
+            const uint32_t* op = nullptr;
+            for (;;)
+            {
+                square(even, odd);  // 8, 32, 128... bits
+                len >>= 1;
+                if (len == 0)
+                {
+                    op = even;
+                    break;
+                }
+
+                square(odd, even);  // 16, 64, 256... bits
+                len >>= 1;
+                if (len == 0)
+                {
+                    op = odd;
+                    break;
+                }
+            }
+
+            for (uint32_t n = 0; n < 256; ++n)
+            {
+                table[0][n] = times(op, n);
+                table[1][n] = times(op, n << 8);
+                table[2][n] = times(op, n << 16);
+                table[3][n] = times(op, n << 24);
+            }
+        }
+    };
+
+    const Tables& tables()
+    {
+        static const Tables instance;
+        return instance;
+    }
+
+    inline uint32_t shift(const uint32_t table[4][256], uint32_t crc) noexcept
+    {
+        return table[0][crc & 0xff] ^ table[1][(crc >> 8) & 0xff]
+             ^ table[2][(crc >> 16) & 0xff] ^ table[3][crc >> 24];
+    }
+
+    inline uint64_t load64(const uint8_t* in) noexcept
+    {
+        uint64_t value;
+        std::memcpy(&value, in, sizeof(value));
+        return value;
+    }
+
+#if defined(__x86_64__)
+    /// Run three lanes of 'lane' bytes each through the crc32 instruction, then merge them.
+    __attribute__((target("sse4.2")))
+    inline uint64_t threeLanes(uint64_t crc0, const uint8_t*& next, size_t& len, size_t lane,
+                               const uint32_t table[4][256]) noexcept
+    {
+        while (len >= lane * 3)
+        {
+            uint64_t crc1 = 0;
+            uint64_t crc2 = 0;
+            const auto end = next + lane;
+
+            do
+            {
+                crc0 = _mm_crc32_u64(crc0, load64(next));
+                crc1 = _mm_crc32_u64(crc1, load64(next + lane));
+                crc2 = _mm_crc32_u64(crc2, load64(next + 2 * lane));
+                next += 8;
+            } while (next < end);
+
+            crc0 = shift(table, static_cast<uint32_t>(crc0)) ^ crc1;
+            crc0 = shift(table, static_cast<uint32_t>(crc0)) ^ crc2;
+
+            next += 2 * lane;
+            len -= 3 * lane;
+        }
+
+        return crc0;
+    }
+
+    __attribute__((target("sse4.2")))
+    uint32_t extendHardware(uint32_t crc, const void* data, size_t len) noexcept
+    {
+        const auto& table = tables();
+        auto next = static_cast<const uint8_t*>(data);
+        uint64_t crc0 = crc ^ 0xffffffffu;
+
+        while (len && (reinterpret_cast<uintptr_t>(next) & 7) != 0)
+        {
+            crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *next++);
+            --len;
+        }
+
+        crc0 = threeLanes(crc0, next, len, LONG_LANE, table.longShift);
+        crc0 = threeLanes(crc0, next, len, SHORT_LANE, table.shortShift);
+
+        for (; len >= 8; len -= 8, next += 8)
+        {
+            crc0 = _mm_crc32_u64(crc0, load64(next));
+        }
+
+        for (; len; --len)
+        {
+            crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *next++);
+        }
+
+        return static_cast<uint32_t>(crc0) ^ 0xffffffffu;
+    }
+#endif
+
+    bool detectHardware() noexcept
+    {
+#if defined(__x86_64__)
+        return __builtin_cpu_supports("sse4.2");
+#else
+        return false;
+#endif
+    }
+}
+
+
+namespace Common
+{
+
+//-----------------------------------------------------------------------------
+uint32_t Crc32c::extend(uint32_t crc, const void* data, size_t len) noexcept
+{
+#if defined(__x86_64__)
+    if (isAccelerated())
+    {
+        return extendHardware(crc, data, len);
+    }
+#endif
+
+    return extendPortable(crc, data, len);
+}
+
+//-----------------------------------------------------------------------------
+uint32_t Crc32c::extendPortable(uint32_t crc, const void* data, size_t len) noexcept
+{
+    const auto& table = tables().bytes;
+    auto next = static_cast<const uint8_t*>(data);
+    crc ^= 0xffffffffu;
+
+    while (len && (reinterpret_cast<uintptr_t>(next) & 7) != 0)
+    {
+        crc = (crc >> 8) ^ table[0][(crc ^ *next++) & 0xff];
+        --len;
+    }
+
+    // Slicing-by-8: eight table lookups per eight bytes, independent of each other
+    for (; len >= 8; len -= 8, next += 8)
+    {
+        auto low = static_cast<uint32_t>(next[0]) | static_cast<uint32_t>(next[1]) << 8
+                 | static_cast<uint32_t>(next[2]) << 16 | static_cast<uint32_t>(next[3]) << 24;
+        low ^= crc;
+
+        crc = table[7][low & 0xff] ^ table[6][(low >> 8) & 0xff]
+            ^ table[5][(low >> 16) & 0xff] ^ table[4][low >> 24]
+            ^ table[3][next[4]] ^ table[2][next[5]] ^ table[1][next[6]] ^ table[0][next[7]];
+    }
+
+    for (; len; --len)
+    {
+        crc = (crc >> 8) ^ table[0][(crc ^ *next++) & 0xff];
+    }
+
+    return crc ^ 0xffffffffu;
+}
+
+//-----------------------------------------------------------------------------
+bool Crc32c::isAccelerated() noexcept
+{
+    static const bool accelerated = detectHardware();
+    return accelerated;
+}
+
+} // namespace Common
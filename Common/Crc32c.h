@@ -0,0 +1,72 @@
+/**
+ * @brief CRC-32C (Castagnoli) checksums, hardware accelerated where the CPU allows
+ *
+ * @file Crc32c.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+// Using .h version of the include here because cstdint requires std:: prefixes
+// on all of the types, which is cumbersome.
+#include <stdint.h>
+#include <stddef.h>
+
+
+namespace Common
+{
+    /**
+     * @brief Computes CRC-32C incrementally, as data arrives.
+     * @details On x86-64 CPUs with SSE4.2 the crc32 instruction is used, on three independent
+     *          lanes at once to cover its latency; the lanes are then merged with precomputed
+     *          tables. Elsewhere a portable slicing-by-8 table implementation is used. Both
+     *          give identical results, and the choice is made once, at run time.
+     *
+     *          extend(extend(0, a), b) equals extend(0, a followed by b).
+     */
+    class Crc32c
+    {
+    public: // Methods
+        Crc32c() = default;
+
+        /// @brief Add bytes to the checksum
+        void update(const void* data, size_t len) noexcept
+        {
+            mCrc = extend(mCrc, data, len);
+        }
+
+        /// @brief The checksum of everything added so far
+        uint32_t value() const noexcept
+        {
+            return mCrc;
+        }
+
+        /// @brief Start over
+        void reset() noexcept
+        {
+            mCrc = 0;
+        }
+
+        /**
+         * @brief Extend a checksum with more bytes
+         * @param[in] crc   - The checksum of the bytes before these (0 to start)
+         * @param[in] data  - The bytes
+         * @param[in] len   - The number of bytes
+         * @return The checksum of all of the bytes
+         */
+        static uint32_t extend(uint32_t crc, const void* data, size_t len) noexcept;
+
+        /// @brief extend(), always without hardware help (for tests and benchmarks)
+        static uint32_t extendPortable(uint32_t crc, const void* data, size_t len) noexcept;
+
+        /// @brief Whether extend() uses the CPU's crc32 instruction
+        static bool isAccelerated() noexcept;
+
+    private: // Members
+        uint32_t    mCrc{0};
+
+    }; // class Crc32c
+
+} // namespace Common
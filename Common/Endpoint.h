@@ -0,0 +1,69 @@
+/**
+ * @brief A network endpoint (IPv4 address and port)
+ *
+ * @file Endpoint.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+// Using .h version of the include here because cstdint requires std:: prefixes
+// on all of the types, which is cumbersome.
+#include <stdint.h>
+
+#include <string>
+#include <optional>
+#include <charconv>
+
+
+namespace Common
+{
+    /**
+     * @brief An address/port pair identifying a socket endpoint
+     */
+    struct Endpoint
+    {
+        std::string     addr;
+        uint16_t        port{0};
+
+        /**
+         * @brief Parse an endpoint from its text form
+         * @param[in] text          - The endpoint in the form "addr" or "addr:port"
+         * @param[in] defaultPort   - The port to use if 'text' does not specify one
+         * @return The parsed endpoint, or unset if the port is not a valid number.
+         * @details Note: The address is not validated here; Socket construction does that.
+         */
+        static std::optional<Endpoint> parse(const std::string& text, uint16_t defaultPort)
+        {
+            std::optional<Endpoint> result;
+
+            auto colon = text.rfind(':');
+            if (colon == std::string::npos)
+            {
+                result = Endpoint{text, defaultPort};
+            }
+            else
+            {
+                uint16_t port = 0;
+                const char* first = text.data() + colon + 1;
+                const char* last = text.data() + text.size();
+                auto [ptr, ec] = std::from_chars(first, last, port);
+                if (ec == std::errc() && ptr == last && first != last && port != 0)
+                {
+                    result = Endpoint{text.substr(0, colon), port};
+                }
+            }
+
+            return result;
+        }
+
+        /// @brief Render the endpoint as "addr:port"
+        std::string toString() const
+        {
+            return addr + ":" + std::to_string(port);
+        }
+    };
+
+} // namespace Common
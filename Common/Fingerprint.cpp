@@ -0,0 +1,186 @@
+/**
+ * @brief 128-bit content fingerprints, for recognizing chunks a peer already holds
+ *
+ * @file Fingerprint.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#include "Fingerprint.h"
+
+// Standard headers
+#include <array>
+#include <cstring>
+#include <cstdio>
+
+
+namespace
+{
+    constexpr size_t LANES = 8;
+    constexpr size_t STRIPE = LANES * sizeof(uint64_t);
+    constexpr size_t STRIPES_PER_BLOCK = 16;
+
+    constexpr uint64_t PRIME32_1 = 0x9e3779b1u;
+    constexpr uint64_t PRIME64_1 = 0x9e3779b185ebca87ull;
+    constexpr uint64_t PRIME64_2 = 0xc2b2ae3d27d4eb4full;
+
+    /// splitmix64, to derive the keys from a fixed seed
+    constexpr uint64_t splitmix(uint64_t& state) noexcept
+    {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    /// One key per lane per stripe of a block, then keys for scrambling and for each half's merge
+    constexpr size_t KEY_COUNT = LANES + STRIPES_PER_BLOCK + 3 * LANES;
+
+    constexpr std::array<uint64_t, KEY_COUNT> makeKeys() noexcept
+    {
+        std::array<uint64_t, KEY_COUNT> keys{};
+        uint64_t state = 0x4e6574536e640000ull;
+        for (auto& key : keys)
+        {
+            key = splitmix(state);
+        }
+        return keys;
+    }
+
+    constexpr auto KEYS = makeKeys();
+    constexpr const uint64_t* SCRAMBLE_KEYS = KEYS.data() + LANES + STRIPES_PER_BLOCK;
+    constexpr const uint64_t* LOW_KEYS = SCRAMBLE_KEYS + LANES;
+    constexpr const uint64_t* HIGH_KEYS = LOW_KEYS + LANES;
+
+    inline uint64_t load64(const uint8_t* in) noexcept
+    {
+        uint64_t value;
+        std::memcpy(&value, in, sizeof(value));
+        return value;
+    }
+
+    /// Mix one stripe into the lanes. Each stripe of a block uses the keys at its own offset.
+    inline void accumulate(uint64_t* acc, const uint8_t* stripe, const uint64_t* keys) noexcept
+    {
+        for (size_t lane = 0; lane < LANES; ++lane)
+        {
+            const auto value = load64(stripe + lane * sizeof(uint64_t));
+            const auto keyed = value ^ keys[lane];
+
+            acc[lane ^ 1] += value;
+            acc[lane] += (keyed & 0xffffffffu) * (keyed >> 32);
+        }
+    }
+
+    inline void scramble(uint64_t* acc) noexcept
+    {
+        for (size_t lane = 0; lane < LANES; ++lane)
+        {
+            auto value = acc[lane];
+            value ^= value >> 47;
+            value ^= SCRAMBLE_KEYS[lane];
+            acc[lane] = value * PRIME32_1;
+        }
+    }
+
+    inline uint64_t fold(uint64_t left, uint64_t right) noexcept
+    {
+        auto product = static_cast<unsigned __int128>(left) * right;
+        return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+    }
+
+    inline uint64_t avalanche(uint64_t value) noexcept
+    {
+        value ^= value >> 37;
+        value *= 0x165667919e3779f9ull;
+        return value ^ (value >> 32);
+    }
+
+    /// Combine the lanes into 64 bits, with keys that make each half independent of the other
+    inline uint64_t merge(const uint64_t* acc, const uint64_t* keys, uint64_t start) noexcept
+    {
+        auto result = start;
+        for (size_t pair = 0; pair < LANES; pair += 2)
+        {
+            result += fold(acc[pair] ^ keys[pair], acc[pair + 1] ^ keys[pair + 1]);
+        }
+        return avalanche(result);
+    }
+}
+
+
+namespace Common
+{
+
+//-----------------------------------------------------------------------------
+Fingerprint Fingerprint::of(const void* data, size_t len) noexcept
+{
+    auto bytes = static_cast<const uint8_t*>(data);
+
+    uint64_t acc[LANES] = {PRIME32_1, PRIME64_1, PRIME64_2, 0x165667b19e3779f9ull,
+                           0x85ebca77c2b2ae63ull, 0x27d4eb2f165667c5ull, 0x9fb21c651e98df25ull, len};
+
+    // Every whole stripe but the last, in blocks
+    const size_t stripes = (len > 0) ? (len - 1) / STRIPE : 0;
+    for (size_t stripe = 0; stripe < stripes; ++stripe)
+    {
+        accumulate(acc, bytes + stripe * STRIPE, KEYS.data() + stripe % STRIPES_PER_BLOCK);
+
+        if (stripe % STRIPES_PER_BLOCK == STRIPES_PER_BLOCK - 1)
+        {
+            scramble(acc);
+        }
+    }
+
+    // The last stripe is the final STRIPE bytes, overlapping the one before if need be; shorter
+    // input is padded with zeros (the length, mixed in above, keeps the padding unambiguous).
+    uint8_t last[STRIPE] = {};
+    if (len >= STRIPE)
+    {
+        std::memcpy(last, bytes + len - STRIPE, STRIPE);
+    }
+    else if (len > 0)
+    {
+        std::memcpy(last, bytes, len);
+    }
+    accumulate(acc, last, KEYS.data() + STRIPES_PER_BLOCK);
+
+    Fingerprint result;
+    result.low = merge(acc, LOW_KEYS, len * PRIME64_1);
+    result.high = merge(acc, HIGH_KEYS, ~(len * PRIME64_2));
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+void Fingerprint::encode(uint8_t* out) const noexcept
+{
+    for (size_t index = 0; index < sizeof(uint64_t); ++index)
+    {
+        out[index] = static_cast<uint8_t>(high >> (56 - 8 * index));
+        out[sizeof(uint64_t) + index] = static_cast<uint8_t>(low >> (56 - 8 * index));
+    }
+}
+
+//-----------------------------------------------------------------------------
+Fingerprint Fingerprint::decode(const uint8_t* in) noexcept
+{
+    Fingerprint result;
+    for (size_t index = 0; index < sizeof(uint64_t); ++index)
+    {
+        result.high = (result.high << 8) | in[index];
+        result.low = (result.low << 8) | in[sizeof(uint64_t) + index];
+    }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+std::string Fingerprint::toString() const
+{
+    char text[2 * SIZE + 1];
+    std::snprintf(text, sizeof(text), "%016llx%016llx",
+                  static_cast<unsigned long long>(high), static_cast<unsigned long long>(low));
+    return text;
+}
+
+} // namespace Common
@@ -0,0 +1,76 @@
+/**
+ * @brief 128-bit content fingerprints, for recognizing chunks a peer already holds
+ *
+ * @file Fingerprint.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+// Using .h version of the include here because cstdint requires std:: prefixes
+// on all of the types, which is cumbersome.
+#include <stdint.h>
+#include <stddef.h>
+
+#include <string>
+
+
+namespace Common
+{
+    /**
+     * @brief Identifies a run of bytes by a 128-bit hash of its contents.
+     * @details The hash follows the shape of XXH3's long-input loop: eight 64-bit lanes, each
+     *          fed one word of a 64-byte stripe through a 32x32->64 bit multiply, with the lanes
+     *          scrambled every kilobyte. The lanes are independent, and the multiplies are of a
+     *          kind SIMD units have, so the compiler vectorizes the loop.
+     *
+     *          It is not a cryptographic hash: it tells apart the data of cooperating peers, and
+     *          is not meant to withstand anyone crafting collisions.
+     */
+    struct Fingerprint
+    {
+        /// The size of the encoded form
+        static constexpr size_t SIZE = 16;
+
+        uint64_t    high{0};
+        uint64_t    low{0};
+
+        /**
+         * @brief Compute the fingerprint of some bytes
+         * @param[in] data  - The bytes
+         * @param[in] len   - The number of bytes
+         */
+        static Fingerprint of(const void* data, size_t len) noexcept;
+
+        /// @brief Store the fingerprint in its SIZE byte, big-endian form
+        void encode(uint8_t* out) const noexcept;
+
+        /// @brief Load a fingerprint from its encoded form
+        static Fingerprint decode(const uint8_t* in) noexcept;
+
+        /// @brief 32 hex digits
+        std::string toString() const;
+
+        bool operator ==(const Fingerprint& other) const noexcept
+        {
+            return high == other.high && low == other.low;
+        }
+
+        bool operator !=(const Fingerprint& other) const noexcept
+        {
+            return !(*this == other);
+        }
+
+        /// For unordered containers; the bits are already well mixed.
+        struct Hash
+        {
+            size_t operator ()(const Fingerprint& fingerprint) const noexcept
+            {
+                return static_cast<size_t>(fingerprint.low);
+            }
+        };
+    };
+
+} // namespace Common
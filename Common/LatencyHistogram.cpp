@@ -0,0 +1,194 @@
+/**
+ * @brief A histogram of latencies with bounded relative error, for percentiles to the tail
+ *
+ * @file LatencyHistogram.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#include "LatencyHistogram.h"
+
+// Standard headers
+#include <algorithm>
+#include <iomanip>
+
+
+namespace
+{
+    /// Buckets per power of two above the exact range
+    constexpr uint64_t HALF_BUCKETS = Common::LatencyHistogram::SUB_BUCKETS / 2;
+
+    constexpr size_t BUCKET_COUNT = Common::LatencyHistogram::SUB_BUCKETS
+        + (Common::LatencyHistogram::MAX_VALUE_BITS - Common::LatencyHistogram::SUB_BUCKET_BITS) * HALF_BUCKETS;
+}
+
+
+namespace Common
+{
+    //-----------------------------------------------------------------------------
+    LatencyHistogram::LatencyHistogram()
+        : mCounts(BUCKET_COUNT, 0)
+    {
+    }
+
+    //-----------------------------------------------------------------------------
+    void LatencyHistogram::record(uint64_t value) noexcept
+    {
+        value = std::min(value, MAX_VALUE);
+
+        ++mCounts[_index(value)];
+        ++mCount;
+        mMin = std::min(mMin, value);
+        mMax = std::max(mMax, value);
+        mSum += static_cast<double>(value);
+    }
+
+    //-----------------------------------------------------------------------------
+    void LatencyHistogram::merge(const LatencyHistogram& other) noexcept
+    {
+        for (size_t index = 0; index < mCounts.size(); ++index)
+        {
+            mCounts[index] += other.mCounts[index];
+        }
+
+        mCount += other.mCount;
+        mMin = std::min(mMin, other.mMin);
+        mMax = std::max(mMax, other.mMax);
+        mSum += other.mSum;
+    }
+
+    //-----------------------------------------------------------------------------
+    void LatencyHistogram::reset() noexcept
+    {
+        std::fill(mCounts.begin(), mCounts.end(), 0);
+        mCount = 0;
+        mMin = UINT64_MAX;
+        mMax = 0;
+        mSum = 0;
+    }
+
+    //-----------------------------------------------------------------------------
+    uint64_t LatencyHistogram::count() const noexcept
+    {
+        return mCount;
+    }
+
+    //-----------------------------------------------------------------------------
+    uint64_t LatencyHistogram::min() const noexcept
+    {
+        return mCount ? mMin : 0;
+    }
+
+    //-----------------------------------------------------------------------------
+    uint64_t LatencyHistogram::max() const noexcept
+    {
+        return mMax;
+    }
+
+    //-----------------------------------------------------------------------------
+    double LatencyHistogram::mean() const noexcept
+    {
+        return mCount ? mSum / static_cast<double>(mCount) : 0.0;
+    }
+
+    //-----------------------------------------------------------------------------
+    uint64_t LatencyHistogram::percentile(double percentile) const noexcept
+    {
+        if (mCount == 0)
+        {
+            return 0;
+        }
+
+        // The rank of the value wanted, counting from 1; at least the first value.
+        const auto fraction = std::clamp(percentile, 0.0, 100.0) / 100.0;
+        const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * static_cast<double>(mCount) + 0.5));
+
+        uint64_t seen = 0;
+        for (size_t index = 0; index < mCounts.size(); ++index)
+        {
+            seen += mCounts[index];
+            if (seen >= rank)
+            {
+                return std::min(_highest(index), mMax);
+            }
+        }
+
+        return mMax;
+    }
+
+    //-----------------------------------------------------------------------------
+    void LatencyHistogram::writeDistribution(std::ostream& out, double unitScale) const
+    {
+        out << std::setw(12) << "Value" << " " << std::setw(14) << "Percentile" << " "
+            << std::setw(10) << "TotalCount" << " " << std::setw(14) << "1/(1-Percentile)" << "\n\n";
+
+        out << std::fixed;
+
+        uint64_t seen = 0;
+        for (size_t index = 0; index < mCounts.size() && seen < mCount; ++index)
+        {
+            if (mCounts[index] == 0)
+            {
+                continue;
+            }
+
+            seen += mCounts[index];
+            const auto fraction = static_cast<double>(seen) / static_cast<double>(mCount);
+            const auto value = static_cast<double>(std::min(_highest(index), mMax)) / unitScale;
+
+            out << std::setw(12) << std::setprecision(3) << value << " "
+                << std::setw(14) << std::setprecision(12) << fraction << " "
+                << std::setw(10) << seen;
+
+            if (seen < mCount)
+            {
+                out << " " << std::setw(14) << std::setprecision(2) << 1.0 / (1.0 - fraction);
+            }
+            out << "\n";
+        }
+
+        out << std::setprecision(3)
+            << "#[Mean    = " << std::setw(12) << mean() / unitScale << "]\n"
+            << "#[Max     = " << std::setw(12) << static_cast<double>(mMax) / unitScale
+            << ", Total count = " << std::setw(12) << mCount << "]\n";
+    }
+
+    //-----------------------------------------------------------------------------
+    // Private Methods
+    //-----------------------------------------------------------------------------
+
+    /// @internal
+    /// @brief The bucket a value (no more than MAX_VALUE) is counted in
+    size_t LatencyHistogram::_index(uint64_t value) noexcept
+    {
+        if (value < SUB_BUCKETS)
+        {
+            return static_cast<size_t>(value);
+        }
+
+        // The top SUB_BUCKET_BITS - 1 bits after the highest set bit pick the bucket in its power of two.
+        const unsigned highBit = 63 - static_cast<unsigned>(__builtin_clzll(value));
+        const unsigned shift = highBit - (SUB_BUCKET_BITS - 1);
+
+        return static_cast<size_t>(SUB_BUCKETS + (highBit - SUB_BUCKET_BITS) * HALF_BUCKETS
+                                   + ((value >> shift) - HALF_BUCKETS));
+    }
+
+    /// @internal
+    /// @brief The highest value counted in a bucket
+    uint64_t LatencyHistogram::_highest(size_t index) noexcept
+    {
+        if (index < SUB_BUCKETS)
+        {
+            return index;
+        }
+
+        const auto offset = index - SUB_BUCKETS;
+        const unsigned shift = static_cast<unsigned>(offset / HALF_BUCKETS) + 1;
+        const auto sub = HALF_BUCKETS + offset % HALF_BUCKETS;
+
+        return ((sub + 1) << shift) - 1;
+    }
+
+} // namespace Common
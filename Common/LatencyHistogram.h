@@ -0,0 +1,96 @@
+/**
+ * @brief A histogram of latencies with bounded relative error, for percentiles to the tail
+ *
+ * @file LatencyHistogram.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+#include <ostream>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+
+namespace Common
+{
+    /**
+     * @brief Counts latencies, in nanoseconds, in buckets whose width grows with their value.
+     * @details Values below SUB_BUCKETS are counted exactly. Above that, each power of two is split
+     *          into SUB_BUCKETS / 2 buckets, so a value is reported to within 1/64 (1.6%) of itself,
+     *          from nanoseconds to MAX_VALUE, in a fixed ~22 KiB of counts. Larger values are counted
+     *          as MAX_VALUE.
+     *
+     *          Recording is a few instructions and never allocates, so it is cheap enough to do for
+     *          every message on a hot path. A histogram is not thread safe; give each thread its
+     *          own and merge() them afterwards.
+     */
+    class LatencyHistogram
+    {
+    public: // Definitions
+        static constexpr unsigned SUB_BUCKET_BITS = 7;
+        static constexpr uint64_t SUB_BUCKETS = 1ull << SUB_BUCKET_BITS;
+
+        /// The largest value told apart from larger ones (about 39 hours in nanoseconds)
+        static constexpr unsigned MAX_VALUE_BITS = 47;
+        static constexpr uint64_t MAX_VALUE = (1ull << MAX_VALUE_BITS) - 1;
+
+        /// The percentiles summarized by default, as in most latency reports
+        static constexpr double SUMMARY_PERCENTILES[] = {50.0, 90.0, 99.0, 99.9, 99.99};
+
+    public: // Methods
+        LatencyHistogram();
+
+        /// @brief Count a value
+        void record(uint64_t value) noexcept;
+
+        /// @brief Add another histogram's counts to this one's
+        void merge(const LatencyHistogram& other) noexcept;
+
+        /// @brief Forget every value counted
+        void reset() noexcept;
+
+        /// @brief The number of values counted
+        uint64_t count() const noexcept;
+
+        /// @brief The smallest and largest values counted, exactly (0 if none)
+        uint64_t min() const noexcept;
+        uint64_t max() const noexcept;
+
+        /// @brief The mean of the values counted (0 if none)
+        double mean() const noexcept;
+
+        /**
+         * @brief The value that the given percentage of values are at or below
+         * @param[in] percentile    - 0 to 100
+         * @return The highest value the bucket holding that value could contain, but no more
+         *          than max() (0 if nothing has been counted)
+         */
+        uint64_t percentile(double percentile) const noexcept;
+
+        /**
+         * @brief Write the distribution as a table of value against percentile, in the text
+         *          format HdrHistogram's plotting tools read ("Value Percentile TotalCount
+         *          1/(1-Percentile)")
+         * @param[out] out          - Where to write it
+         * @param[in]  unitScale    - Divide values by this on output (e.g. 1000 for microseconds)
+         */
+        void writeDistribution(std::ostream& out, double unitScale = 1.0) const;
+
+    private: // Methods
+        static size_t _index(uint64_t value) noexcept;
+        static uint64_t _highest(size_t index) noexcept;
+
+    private: // Members
+        std::vector<uint64_t>   mCounts;
+        uint64_t                mCount{0};
+        uint64_t                mMin{UINT64_MAX};
+        uint64_t                mMax{0};
+        double                  mSum{0};
+
+    }; // class LatencyHistogram
+
+} // namespace Common
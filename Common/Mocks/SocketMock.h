@@ -21,13 +21,33 @@ namespace Common
 class SocketMock
 {
 public:
+    MOCK_METHOD(std::vector<std::string>, setOptions, (const SocketOptions& options));
     MOCK_METHOD(void, bind, ());
     MOCK_METHOD(void, listen, (int backlog));
     MOCK_METHOD(std::optional<Socket>, accept, ());
+    MOCK_METHOD(bool, waitAcceptable, (int wakeFd));
+    MOCK_METHOD(int, descriptor, (), (const));
+    MOCK_METHOD(std::optional<int>, incomingCpu, (), (const));
     MOCK_METHOD(void, connect, ());
+    MOCK_METHOD(bool, connectAsync, ());
+    MOCK_METHOD(bool, waitConnected, (std::chrono::milliseconds timeout));
     MOCK_METHOD(bool, isConnected, (), (const));
+    MOCK_METHOD(bool, isConnecting, (), (const));
     MOCK_METHOD(void, send, (const void* buffer, size_t len));
+    MOCK_METHOD(std::optional<uint32_t>, sendZeroCopy, (const void* buffer, size_t len));
+    MOCK_METHOD(bool, isSendComplete, (uint32_t ticket));
+    MOCK_METHOD(void, waitSendCompletions, (std::chrono::milliseconds timeout));
+    MOCK_METHOD(bool, isZeroCopyDeferred, (), (const));
+    MOCK_METHOD(size_t, sendFile, (int fd, off_t offset, size_t count));
     MOCK_METHOD(std::optional<size_t>, recv, (void* buffer, size_t len));
+    MOCK_METHOD(std::optional<size_t>, tryRecv, (void* buffer, size_t len));
+    MOCK_METHOD(bool, waitReadable, (std::chrono::milliseconds timeout));
+    MOCK_METHOD(bool, waitReadable, (std::chrono::milliseconds timeout, int wakeFd));
+    MOCK_METHOD(std::optional<size_t>, spliceTo, (int pipe, size_t len));
+    MOCK_METHOD(size_t, spliceFrom, (int pipe, size_t count));
+    MOCK_METHOD(void, setNonBlocking, ());
+    MOCK_METHOD(void, shutdown, ());
+    MOCK_METHOD(void, shutdownRead, ());
 };
 
 using SocketMockVendor = MockVendor<SocketMock, Socket>;
@@ -53,6 +73,11 @@ Socket::~Socket()
     SocketMockVendor::destroy(this);
 }
 
+std::vector<std::string> Socket::setOptions(const SocketOptions& options)
+{
+    return SocketMockVendor::mock(this)->setOptions(options);
+}
+
 void Socket::bind()
 {
     return SocketMockVendor::mock(this)->bind();
@@ -68,24 +93,135 @@ std::optional<Socket> Socket::accept()
     return SocketMockVendor::mock(this)->accept();
 }
 
+bool Socket::waitAcceptable(int wakeFd)
+{
+    return SocketMockVendor::mock(this)->waitAcceptable(wakeFd);
+}
+
+int Socket::descriptor() const noexcept
+{
+    return SocketMockVendor::mock(this)->descriptor();
+}
+
+std::optional<int> Socket::incomingCpu() const noexcept
+{
+    return SocketMockVendor::mock(this)->incomingCpu();
+}
+
+// Vends the next queued mock, as construction does.
+Socket Socket::adopt(int socketFd)
+{
+    return Socket(std::string(), 0);
+}
+
 void Socket::connect()
 {
     return SocketMockVendor::mock(this)->connect();
 }
 
+bool Socket::connectAsync()
+{
+    return SocketMockVendor::mock(this)->connectAsync();
+}
+
+// Each candidate's mock decides (via waitConnected) whether it wins.
+std::optional<size_t> Socket::waitAnyConnected(std::span<Socket* const> sockets,
+                                               std::chrono::milliseconds timeout)
+{
+    for (size_t index = 0; index < sockets.size(); ++index)
+    {
+        if (SocketMockVendor::mock(sockets[index])->waitConnected(timeout))
+        {
+            return index;
+        }
+    }
+
+    return std::nullopt;
+}
+
 bool Socket::isConnected() const noexcept
 {
     return SocketMockVendor::mock(this)->isConnected();
 }
 
+bool Socket::isConnecting() const noexcept
+{
+    return SocketMockVendor::mock(this)->isConnecting();
+}
+
 void Socket::send(const void* buffer, size_t len)
 {
     return SocketMockVendor::mock(this)->send(buffer, len);
 }
 
+std::optional<uint32_t> Socket::sendZeroCopy(const void* buffer, size_t len)
+{
+    return SocketMockVendor::mock(this)->sendZeroCopy(buffer, len);
+}
+
+bool Socket::isSendComplete(uint32_t ticket)
+{
+    return SocketMockVendor::mock(this)->isSendComplete(ticket);
+}
+
+void Socket::waitSendCompletions(std::chrono::milliseconds timeout)
+{
+    return SocketMockVendor::mock(this)->waitSendCompletions(timeout);
+}
+
+bool Socket::isZeroCopyDeferred() const noexcept
+{
+    return SocketMockVendor::mock(this)->isZeroCopyDeferred();
+}
+
+size_t Socket::sendFile(int fd, off_t offset, size_t count)
+{
+    return SocketMockVendor::mock(this)->sendFile(fd, offset, count);
+}
+
 std::optional<size_t> Socket::recv(void* buffer, size_t len)
 {
     return SocketMockVendor::mock(this)->recv(buffer, len);
 }
 
+std::optional<size_t> Socket::tryRecv(void* buffer, size_t len)
+{
+    return SocketMockVendor::mock(this)->tryRecv(buffer, len);
+}
+
+bool Socket::waitReadable(std::chrono::milliseconds timeout)
+{
+    return SocketMockVendor::mock(this)->waitReadable(timeout);
+}
+
+bool Socket::waitReadable(std::chrono::milliseconds timeout, int wakeFd)
+{
+    return SocketMockVendor::mock(this)->waitReadable(timeout, wakeFd);
+}
+
+std::optional<size_t> Socket::spliceTo(int pipe, size_t len)
+{
+    return SocketMockVendor::mock(this)->spliceTo(pipe, len);
+}
+
+size_t Socket::spliceFrom(int pipe, size_t count)
+{
+    return SocketMockVendor::mock(this)->spliceFrom(pipe, count);
+}
+
+void Socket::setNonBlocking()
+{
+    SocketMockVendor::mock(this)->setNonBlocking();
+}
+
+void Socket::shutdown()
+{
+    SocketMockVendor::mock(this)->shutdown();
+}
+
+void Socket::shutdownRead()
+{
+    SocketMockVendor::mock(this)->shutdownRead();
+}
+
 } // namespace Common
@@ -0,0 +1,52 @@
+/**
+ * @brief Static tracepoints (USDT) on the transfer paths, for bpftrace, perf and SystemTap
+ *
+ * @file Probes.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+/**
+ * Each probe compiles to a single nop, with a note in the binary telling tracers where it is and
+ * where its arguments live. Nothing else runs unless a tracer attaches, which patches the nop with
+ * a breakpoint, so they cost nothing measurable when unused. The arguments are values the code
+ * already holds; none are computed for the probe's sake.
+ *
+ * Probes are compiled in wherever <sys/sdt.h> is installed (systemtap-sdt-dev, systemtap-sdt-devel),
+ * and left out otherwise or when built with -DNETWORKSENDER_NO_PROBES. List them with
+ * "bpftrace -l 'usdt:./receiver:*'"; see scripts/ for examples.
+ *
+ * The probes, all under the "networksender" provider:
+ *
+ *  connect_start(fd, port)             Socket::connect() or connectAsync() is about to connect
+ *  connect_done(fd, error)             The connection was made (error 0) or failed (an errno)
+ *  accept_start(fd)                    Socket::accept() on listening socket 'fd'
+ *  accept_done(fd, connFd)             accept() returned connection 'connFd' (-1: none)
+ *  send_start(fd, len)                 Socket::send(), sendZeroCopy() or sendFile() of 'len' bytes
+ *  send_done(fd, len)                  'len' bytes were sent
+ *  recv_start(fd, len)                 Socket::recv() into a buffer of 'len' bytes
+ *  recv_done(fd, result)               recv() returned 'result' bytes (0: disconnected, -1: failed),
+ *                                      or tryRecv() returned data
+ *  handler_entry(buffer, len)          The receiver passes 'len' bytes to a handler
+ *  handler_return(buffer, len)         The handler returned
+ *  bufferpool_exhausted(inFlight)      The sender's block buffers are all held, 'inFlight' of them
+ *                                      by zero-copy sends the kernel has not finished
+ */
+
+#if !defined(NETWORKSENDER_NO_PROBES) && __has_include(<sys/sdt.h>)
+
+#include <sys/sdt.h>
+
+#define NS_PROBE1(name, a)          DTRACE_PROBE1(networksender, name, a)
+#define NS_PROBE2(name, a, b)       DTRACE_PROBE2(networksender, name, a, b)
+
+#else
+
+// The arguments are still named, so that values kept only for a probe are not unused.
+#define NS_PROBE1(name, a)          ((void)(a))
+#define NS_PROBE2(name, a, b)       ((void)(a), (void)(b))
+
+#endif
@@ -0,0 +1,257 @@
+/**
+ * @brief The framed protocol spoken between Sender and Receiver
+ *
+ * @file Protocol.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#include "Protocol.h"
+
+#include "SocketException.h"
+
+#include <endian.h>
+#include <cstring>
+#include <algorithm>
+
+
+namespace Common::Protocol
+{
+
+namespace
+{
+    constexpr size_t READ_BUFFER_SIZE = 64 * 1024;
+}
+
+//-----------------------------------------------------------------------------
+HelloMatch matchHello(const void* data, size_t len) noexcept
+{
+    FrameHeader hello;
+    hello.type = FrameType::Hello;
+    hello.flags = VERSION;
+    hello.length = sizeof(uint32_t);
+    hello.offset = MAGIC;
+
+    uint8_t expected[HEADER_SIZE];
+    encode(hello, expected);
+
+    const auto compared = std::min(len, HEADER_SIZE);
+    if (std::memcmp(data, expected, compared) != 0)
+    {
+        return HelloMatch::Mismatch;
+    }
+
+    return (compared == HEADER_SIZE) ? HelloMatch::Match : HelloMatch::Partial;
+}
+
+//-----------------------------------------------------------------------------
+void encode(const FrameHeader& header, uint8_t* out) noexcept
+{
+    out[0] = static_cast<uint8_t>(header.type);
+    out[1] = header.flags;
+
+    uint16_t stream = htobe16(header.stream);
+    uint32_t length = htobe32(header.length);
+    std::memcpy(out + 2, &stream, sizeof(stream));
+    std::memcpy(out + 4, &length, sizeof(length));
+    putU64(out + 8, header.offset);
+}
+
+//-----------------------------------------------------------------------------
+FrameHeader decode(const uint8_t* in) noexcept
+{
+    FrameHeader header;
+    header.type = static_cast<FrameType>(in[0]);
+    header.flags = in[1];
+
+    uint16_t stream;
+    uint32_t length;
+    std::memcpy(&stream, in + 2, sizeof(stream));
+    std::memcpy(&length, in + 4, sizeof(length));
+    header.stream = be16toh(stream);
+    header.length = be32toh(length);
+    header.offset = getU64(in + 8);
+
+    return header;
+}
+
+//-----------------------------------------------------------------------------
+void putU32(uint8_t* out, uint32_t value) noexcept
+{
+    value = htobe32(value);
+    std::memcpy(out, &value, sizeof(value));
+}
+
+//-----------------------------------------------------------------------------
+uint32_t getU32(const uint8_t* in) noexcept
+{
+    uint32_t value;
+    std::memcpy(&value, in, sizeof(value));
+    return be32toh(value);
+}
+
+//-----------------------------------------------------------------------------
+void putU64(uint8_t* out, uint64_t value) noexcept
+{
+    value = htobe64(value);
+    std::memcpy(out, &value, sizeof(value));
+}
+
+//-----------------------------------------------------------------------------
+uint64_t getU64(const uint8_t* in) noexcept
+{
+    uint64_t value;
+    std::memcpy(&value, in, sizeof(value));
+    return be64toh(value);
+}
+
+//-----------------------------------------------------------------------------
+void sendFrame(Socket& socket, const FrameHeader& header, const void* payload)
+{
+    uint8_t encoded[HEADER_SIZE];
+    encode(header, encoded);
+
+    if (payload == nullptr || header.length == 0)
+    {
+        socket.send(encoded, sizeof(encoded));
+    }
+    else if (header.length <= 4096)
+    {
+        // Small frames go out in one segment.
+        uint8_t frame[HEADER_SIZE + 4096];
+        std::memcpy(frame, encoded, HEADER_SIZE);
+        std::memcpy(frame + HEADER_SIZE, payload, header.length);
+        socket.send(frame, HEADER_SIZE + header.length);
+    }
+    else
+    {
+        socket.send(encoded, sizeof(encoded));
+        socket.send(payload, header.length);
+    }
+}
+
+//-----------------------------------------------------------------------------
+uint64_t fileId(const std::string& name, uint64_t size, uint64_t mtime) noexcept
+{
+    // FNV-1a, 64 bit
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&hash](const void* data, size_t len)
+    {
+        auto bytes = static_cast<const uint8_t*>(data);
+        for (size_t index = 0; index < len; ++index)
+        {
+            hash ^= bytes[index];
+            hash *= 0x100000001b3ull;
+        }
+    };
+
+    mix(name.data(), name.size());
+    mix(&size, sizeof(size));
+    mix(&mtime, sizeof(mtime));
+
+    return hash;
+}
+
+
+//-----------------------------------------------------------------------------
+// FrameReader
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+FrameReader::FrameReader(Socket& socket)
+    : mSocket(socket)
+    , mBuffer(READ_BUFFER_SIZE)
+{
+}
+
+//-----------------------------------------------------------------------------
+void FrameReader::prime(const void* data, size_t len)
+{
+    if (mEnd + len > mBuffer.size())
+    {
+        mBuffer.resize(mEnd + len);
+    }
+
+    std::memcpy(mBuffer.data() + mEnd, data, len);
+    mEnd += len;
+}
+
+//-----------------------------------------------------------------------------
+std::optional<FrameHeader> FrameReader::next(std::vector<char>& payload)
+{
+    if (!_fill(HEADER_SIZE))
+    {
+        return std::nullopt;
+    }
+
+    auto header = decode(reinterpret_cast<const uint8_t*>(mBuffer.data() + mStart));
+    mStart += HEADER_SIZE;
+
+    if (header.length > MAX_PAYLOAD)
+    {
+        throw Socket::Exception("peer", "Frame payload too large");
+    }
+
+    payload.resize(header.length);
+
+    // Take what is buffered, then read the rest of a large payload directly.
+    auto buffered = std::min<size_t>(header.length, mEnd - mStart);
+    std::memcpy(payload.data(), mBuffer.data() + mStart, buffered);
+    mStart += buffered;
+
+    size_t have = buffered;
+    while (have < header.length)
+    {
+        auto received = mSocket.recv(payload.data() + have, header.length - have);
+        if (!received)
+        {
+            return std::nullopt;
+        }
+
+        have += received.value();
+    }
+
+    return header;
+}
+
+//-----------------------------------------------------------------------------
+bool FrameReader::hasBufferedFrame() const noexcept
+{
+    return mEnd - mStart >= HEADER_SIZE;
+}
+
+//-----------------------------------------------------------------------------
+// Private Methods
+//-----------------------------------------------------------------------------
+
+/// @internal
+/// @brief Make at least 'needed' unconsumed bytes available in the buffer
+/// @return False if the peer disconnected first
+bool FrameReader::_fill(size_t needed)
+{
+    if (mEnd - mStart >= needed)
+    {
+        return true;
+    }
+
+    // Slide the remainder to the front so the read has room.
+    std::memmove(mBuffer.data(), mBuffer.data() + mStart, mEnd - mStart);
+    mEnd -= mStart;
+    mStart = 0;
+
+    while (mEnd < needed)
+    {
+        auto received = mSocket.recv(mBuffer.data() + mEnd, mBuffer.size() - mEnd);
+        if (!received)
+        {
+            return false;
+        }
+
+        mEnd += received.value();
+    }
+
+    return true;
+}
+
+} // namespace Common::Protocol
@@ -0,0 +1,203 @@
+/**
+ * @brief The framed protocol spoken between Sender and Receiver
+ *
+ * @file Protocol.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+#include "Socket.h"
+
+// Using .h version of the include here because cstdint requires std:: prefixes
+// on all of the types, which is cumbersome.
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <optional>
+
+
+/**
+ * @brief By default a sender writes raw bytes and the receiver hands them to its handler as they
+ *          arrive. A sender that needs more (e.g. resumable transfers) opens with a Hello frame,
+ *          after which both directions carry frames: a fixed header followed by 'length' bytes of
+ *          payload. All integers are big-endian on the wire.
+ *
+ *          A receiver tells the two apart by the whole of the Hello header (see matchHello()):
+ *          its type, VERSION, a 4-byte payload and MAGIC. Raw data that happens to start with
+ *          the same byte as a Hello frame is still raw data.
+ */
+namespace Common::Protocol
+{
+    /// Carried in the offset field of Hello frames
+    static constexpr uint64_t MAGIC = 0x4E6574536E640000;       // "NetSnd\0\0"
+
+    /// Carried in the flags field of Hello frames
+    static constexpr uint8_t VERSION = 1;
+
+    /// The size of an encoded FrameHeader
+    static constexpr size_t HEADER_SIZE = 16;
+
+    /// The largest payload a peer will accept
+    static constexpr uint32_t MAX_PAYLOAD = 16 * 1024 * 1024;
+
+    enum class FrameType : uint8_t
+    {
+        Hello   = 1,    ///< Both ways, first: offset = MAGIC, flags = VERSION, payload = u32 feature bits
+        Open    = 2,    ///< Sender: begin a file on 'stream'; offset = file size, payload = u64 file id + name
+        Resume  = 3,    ///< Receiver: reply to Open; offset = durable bytes already held for that file
+        Data    = 4,    ///< Sender: payload is the bytes at 'offset' of the stream (see DataFlags)
+        Close   = 5,    ///< Sender: the stream is complete; offset = its total size
+        Ack     = 6,    ///< Receiver: bytes of 'stream' before 'offset' are durable (or delivered)
+        Credit  = 7,    ///< Receiver: the sender may send bytes of 'stream' up to (not including) 'offset'
+        Recipe  = 8,    ///< Sender: the chunks that follow on 'stream' from 'offset'; payload = entries (see RECIPE_ENTRY_SIZE)
+        Want    = 9,    ///< Receiver: reply to Recipe, same offset; payload = ascending u32 indexes of the entries to send
+        Filter  = 10,   ///< Receiver: before Resume of an OPEN_STREAM stream; payload = a Common::RecordFilter its records must pass to be sent (a sender sending it whole, e.g. deduplicated, may not apply it)
+    };
+
+    /// Bits in the Hello payload advertising optional capabilities
+    enum Feature : uint32_t
+    {
+        FEATURE_RESUME = 1u << 0,       ///< Durable offsets are kept, so Resume may be non-zero
+        FEATURE_CREDIT = 1u << 1,       ///< Data is flow controlled; wait for Credit before sending
+        FEATURE_CRC = 1u << 2,          ///< Data frames may carry a CRC, and it is checked
+        FEATURE_DEDUP = 1u << 3,        ///< Recipe is understood: chunks already held need not be sent
+        FEATURE_FILTER = 1u << 4,       ///< Filter is understood: a stream's records may be filtered where they are sent
+    };
+
+    /// Bits in the flags field of Data frames
+    enum DataFlags : uint8_t
+    {
+        DATA_CRC = 1u << 0,             ///< The last CRC_SIZE bytes of the payload are a u32 CRC-32C of the rest
+    };
+
+    /// The size of the CRC that ends a Data frame flagged DATA_CRC
+    static constexpr size_t CRC_SIZE = sizeof(uint32_t);
+
+    /// Each entry of a Recipe is a u32 chunk length and the chunk's Common::Fingerprint. The
+    /// chunks follow one another in the stream; the sender then sends, as Data at their stream
+    /// offsets, only the ones the receiver asks for with Want. A chunk is offered only once it
+    /// starts within credit, and is then sent whole.
+    static constexpr size_t RECIPE_ENTRY_SIZE = sizeof(uint32_t) + 16;
+
+    /// Bits in the flags field of Open frames
+    enum OpenFlags : uint8_t
+    {
+        OPEN_STREAM = 1u << 0,          ///< Not a file: the size is unknown (offset = 0) and nothing is kept
+    };
+
+    struct FrameHeader
+    {
+        FrameType   type{FrameType::Data};
+        uint8_t     flags{0};
+        uint16_t    stream{0};      ///< The logical stream within the connection
+        uint32_t    length{0};      ///< Payload length, in bytes
+        uint64_t    offset{0};      ///< Type-specific position (see FrameType)
+    };
+
+    /// How the first bytes of a connection compare with a Hello header
+    enum class HelloMatch
+    {
+        Partial,        ///< Fewer than HEADER_SIZE bytes, all as a Hello header has them
+        Match,          ///< A Hello header
+        Mismatch,       ///< Not a Hello header: the connection is raw data
+    };
+
+    /**
+     * @brief Determine whether a connection opens with the Hello frame of this VERSION
+     * @param[in] data  - The first bytes received
+     * @param[in] len   - How many there are (those past HEADER_SIZE are not looked at)
+     */
+    HelloMatch matchHello(const void* data, size_t len) noexcept;
+
+    /**
+     * @brief Encode a header into its wire form
+     * @param[in]  header   - The header to encode
+     * @param[out] out      - Receives HEADER_SIZE bytes
+     */
+    void encode(const FrameHeader& header, uint8_t* out) noexcept;
+
+    /**
+     * @brief Decode a header from its wire form
+     * @param[in] in        - HEADER_SIZE bytes
+     */
+    FrameHeader decode(const uint8_t* in) noexcept;
+
+    /// @brief Store a big-endian u32 (for payload fields)
+    void putU32(uint8_t* out, uint32_t value) noexcept;
+
+    /// @brief Load a big-endian u32 (for payload fields)
+    uint32_t getU32(const uint8_t* in) noexcept;
+
+    /// @brief Store a big-endian u64 (for payload fields)
+    void putU64(uint8_t* out, uint64_t value) noexcept;
+
+    /// @brief Load a big-endian u64 (for payload fields)
+    uint64_t getU64(const uint8_t* in) noexcept;
+
+    /**
+     * @brief Send a frame
+     * @param[in] socket    - The connected socket
+     * @param[in] header    - The header; 'length' bytes of 'payload' follow it
+     * @param[in] payload   - The payload, or null to send only the header (the caller then sends
+     *                         the payload itself, e.g. with Socket::sendFile)
+     * @throws Socket::Exception on failure
+     */
+    void sendFrame(Socket& socket, const FrameHeader& header, const void* payload = nullptr);
+
+    /**
+     * @brief Compute a stable identifier for a version of a file, so that a receiver can match
+     *          a resumed transfer to the partial copy it already holds.
+     * @param[in] name      - The file name
+     * @param[in] size      - The file size, in bytes
+     * @param[in] mtime     - The modification time, in nanoseconds
+     */
+    uint64_t fileId(const std::string& name, uint64_t size, uint64_t mtime) noexcept;
+
+    /**
+     * @brief Reads frames from a socket through a buffer, so that small frames do not each
+     *          cost a system call.
+     */
+    class FrameReader
+    {
+    public: // Methods
+        /**
+         * @brief Construct a FrameReader
+         * @param[in] socket    - The connected socket to read (must outlive the reader)
+         */
+        explicit FrameReader(Socket& socket);
+
+        /**
+         * @brief Supply bytes already read from the socket, to be parsed before anything else
+         * @param[in] data      - The bytes
+         * @param[in] len       - The number of bytes
+         */
+        void prime(const void* data, size_t len);
+
+        /**
+         * @brief Read the next frame
+         * @param[out] payload  - Receives the payload
+         * @return The header, or unset if the peer disconnected.
+         * @throws Socket::Exception on failure or on a malformed frame
+         */
+        std::optional<FrameHeader> next(std::vector<char>& payload);
+
+        /// @brief Determine whether a whole frame header is already buffered, so next() can
+        ///         start without waiting on the socket
+        bool hasBufferedFrame() const noexcept;
+
+    private: // Methods
+        bool _fill(size_t needed);
+
+    private: // Members
+        Socket&             mSocket;
+        std::vector<char>   mBuffer;
+        size_t              mStart{0};          ///< First unconsumed byte in mBuffer
+        size_t              mEnd{0};            ///< One past the last valid byte in mBuffer
+
+    }; // class FrameReader
+
+} // namespace Common::Protocol
@@ -0,0 +1,894 @@
+/**
+ * @brief A compiled test of whether a record (a line) is wanted, so that unwanted records need
+ *          never be sent
+ *
+ * @file RecordFilter.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#include "RecordFilter.h"
+
+// Standard headers
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+
+namespace
+{
+    /// The bytes of runs of whitespace, as field: and \s see them
+    inline bool isSpace(char byte) noexcept
+    {
+        return byte == ' ' || byte == '\t' || byte == '\r' || byte == '\f' || byte == '\v';
+    }
+
+    /// Parse the whole of 'text' as a number
+    bool toNumber(std::string_view text, double& number) noexcept
+    {
+        if (!text.empty() && text.front() == '+')
+        {
+            text.remove_prefix(1);
+        }
+
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), number);
+        return error == std::errc() && end == text.data() + text.size() && !text.empty();
+    }
+
+#if defined(__x86_64__)
+    /// Compare 32 positions at once on the first and last bytes of the literal, and check the
+    /// rest only where both agree.
+    __attribute__((target("avx2")))
+    size_t findVector(const char* data, size_t len, const char* literal, size_t literalLen) noexcept
+    {
+        const auto first = _mm256_set1_epi8(literal[0]);
+        const auto last = _mm256_set1_epi8(literal[literalLen - 1]);
+
+        size_t at = 0;
+        for (; at + literalLen - 1 + 32 <= len; at += 32)
+        {
+            const auto front = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + at));
+            const auto back = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + at + literalLen - 1));
+            auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(front, first), _mm256_cmpeq_epi8(back, last))));
+
+            while (mask)
+            {
+                const auto bit = static_cast<size_t>(__builtin_ctz(mask));
+                if (std::memcmp(data + at + bit + 1, literal + 1, literalLen - 2) == 0)
+                {
+                    return at + bit;
+                }
+                mask &= mask - 1;
+            }
+        }
+
+        auto rest = Common::RecordFilter::findPortable(data + at, len - at, literal, literalLen);
+        return (rest == Common::RecordFilter::NOT_FOUND) ? rest : at + rest;
+    }
+
+    /// The most literals findAnyVector() takes; more are searched for one at a time
+    constexpr size_t MAX_VECTOR_LITERALS = 8;
+
+    /// findVector() for several literals: the positions where any literal's first and last bytes
+    /// agree are gathered first, so a block where none do costs one test, however many literals.
+    __attribute__((target("avx2")))
+    size_t findAnyVector(const char* data, size_t len, const std::vector<std::string>& literals,
+                         size_t longest) noexcept
+    {
+        const auto count = literals.size();
+
+        __m256i firsts[MAX_VECTOR_LITERALS];
+        __m256i lasts[MAX_VECTOR_LITERALS];
+        for (size_t index = 0; index < count; ++index)
+        {
+            firsts[index] = _mm256_set1_epi8(literals[index].front());
+            lasts[index] = _mm256_set1_epi8(literals[index].back());
+        }
+
+        size_t at = 0;
+        for (; at + longest - 1 + 32 <= len; at += 32)
+        {
+            const auto front = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + at));
+
+            uint32_t masks[MAX_VECTOR_LITERALS];
+            uint32_t any = 0;
+            for (size_t index = 0; index < count; ++index)
+            {
+                const auto back = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(data + at + literals[index].size() - 1));
+                masks[index] = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(
+                    _mm256_cmpeq_epi8(front, firsts[index]), _mm256_cmpeq_epi8(back, lasts[index]))));
+                any |= masks[index];
+            }
+
+            // Earliest position first, so the first literal confirmed is the earliest occurrence.
+            while (any)
+            {
+                const auto bit = static_cast<size_t>(__builtin_ctz(any));
+                for (size_t index = 0; index < count; ++index)
+                {
+                    const auto& literal = literals[index];
+                    if ((masks[index] >> bit) & 1u
+                        && (literal.size() < 3
+                            || std::memcmp(data + at + bit + 1, literal.data() + 1, literal.size() - 2) == 0))
+                    {
+                        return at + bit;
+                    }
+                }
+                any &= any - 1;
+            }
+        }
+
+        auto rest = Common::RecordFilter::findAnyPortable(data + at, len - at, literals);
+        return (rest == Common::RecordFilter::NOT_FOUND) ? rest : at + rest;
+    }
+#endif
+
+    bool detectVector() noexcept
+    {
+#if defined(__x86_64__)
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    }
+}
+
+
+namespace Common
+{
+
+//-----------------------------------------------------------------------------
+RecordFilter::RecordFilter(const std::string& spec)
+    : mSpec(spec)
+{
+    size_t start = 0;
+    while (start < spec.size())
+    {
+        auto end = spec.find('\n', start);
+        if (end == std::string::npos)
+        {
+            end = spec.size();
+        }
+
+        auto line = spec.substr(start, end - start);
+        start = end + 1;
+
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+
+        if (line.empty())
+        {
+            continue;
+        }
+
+        if (line.compare(0, 7, "sample:") == 0)
+        {
+            char* last = nullptr;
+            auto rate = std::strtod(line.c_str() + 7, &last);
+            if (last == line.c_str() + 7 || *last != '\0' || !(rate > 0) || rate > 1)
+            {
+                throw Exception("A sample rate must be more than 0 and at most 1: " + line);
+            }
+
+            mSampleRate *= rate;
+            continue;
+        }
+
+        mClauses.push_back(_parse(line));
+    }
+
+    std::stable_sort(mClauses.begin(), mClauses.end(), [](const Clause& left, const Clause& right)
+    {
+        return left.kind < right.kind;
+    });
+
+    // Seek with the longest literal some clause cannot pass without; several literals (any:) only
+    // if there is nothing better, since each can match.
+    size_t best = 0;
+    for (size_t index = 0; index < mClauses.size(); ++index)
+    {
+        const auto& clause = mClauses[index];
+        if (clause.negated || clause.literals.empty())
+        {
+            continue;
+        }
+
+        const auto score = (clause.kind == Kind::Any) ? 1 : clause.literals.front().size() + 1;
+        if (score > best)
+        {
+            best = score;
+            mSeek = index;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+const std::string& RecordFilter::spec() const noexcept
+{
+    return mSpec;
+}
+
+//-----------------------------------------------------------------------------
+bool RecordFilter::passesAll() const noexcept
+{
+    return mClauses.empty();
+}
+
+//-----------------------------------------------------------------------------
+double RecordFilter::sampleRate() const noexcept
+{
+    return mSampleRate;
+}
+
+//-----------------------------------------------------------------------------
+bool RecordFilter::seekDecides() const noexcept
+{
+    // Only a lone clause that passes whatever contains its literal(s)
+    return mClauses.size() == 1 && mSeek == 0 && !mClauses.front().negated
+        && (mClauses.front().kind == Kind::Contains || mClauses.front().kind == Kind::Any);
+}
+
+//-----------------------------------------------------------------------------
+bool RecordFilter::matches(const char* record, size_t len) const noexcept
+{
+    for (const auto& clause : mClauses)
+    {
+        if (!_test(clause, record, len))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+size_t RecordFilter::seek(const char* data, size_t len) const noexcept
+{
+    if (mSeek == NOT_FOUND)
+    {
+        return 0;
+    }
+
+    const auto& clause = mClauses[mSeek];
+    if (clause.kind == Kind::Any)
+    {
+        return findAny(data, len, clause.literals);
+    }
+
+    const auto& literal = clause.literals.front();
+    return find(data, len, literal.data(), literal.size());
+}
+
+//-----------------------------------------------------------------------------
+size_t RecordFilter::find(const char* data, size_t len, const char* literal, size_t literalLen) noexcept
+{
+#if defined(__x86_64__)
+    if (literalLen > 1 && isAccelerated())
+    {
+        return (literalLen > len) ? NOT_FOUND : findVector(data, len, literal, literalLen);
+    }
+#endif
+
+    return findPortable(data, len, literal, literalLen);
+}
+
+//-----------------------------------------------------------------------------
+size_t RecordFilter::findPortable(const char* data, size_t len, const char* literal, size_t literalLen) noexcept
+{
+    if (literalLen == 0)
+    {
+        return 0;
+    }
+
+    if (literalLen > len)
+    {
+        return NOT_FOUND;
+    }
+
+    // memchr is itself vectorized by the C library, so this is no slouch where it applies.
+    const auto end = data + len - literalLen + 1;
+    for (auto next = data; next < end; ++next)
+    {
+        next = static_cast<const char*>(std::memchr(next, literal[0], static_cast<size_t>(end - next)));
+        if (!next)
+        {
+            break;
+        }
+
+        if (std::memcmp(next + 1, literal + 1, literalLen - 1) == 0)
+        {
+            return static_cast<size_t>(next - data);
+        }
+    }
+
+    return NOT_FOUND;
+}
+
+//-----------------------------------------------------------------------------
+size_t RecordFilter::findAny(const char* data, size_t len, const std::vector<std::string>& literals) noexcept
+{
+#if defined(__x86_64__)
+    if (isAccelerated() && !literals.empty() && literals.size() <= MAX_VECTOR_LITERALS)
+    {
+        size_t longest = 0;
+        for (const auto& literal : literals)
+        {
+            longest = std::max(longest, literal.size());
+        }
+
+        return findAnyVector(data, len, literals, longest);
+    }
+#endif
+
+    return findAnyPortable(data, len, literals);
+}
+
+//-----------------------------------------------------------------------------
+size_t RecordFilter::findAnyPortable(const char* data, size_t len, const std::vector<std::string>& literals) noexcept
+{
+    // Each literal need only be looked for ahead of the earliest found so far.
+    auto found = NOT_FOUND;
+    for (const auto& literal : literals)
+    {
+        const auto within = (found == NOT_FOUND) ? len : std::min(len, found + literal.size() - 1);
+        const auto at = findPortable(data, within, literal.data(), literal.size());
+        if (at < found)
+        {
+            found = at;
+        }
+    }
+
+    return found;
+}
+
+//-----------------------------------------------------------------------------
+bool RecordFilter::isAccelerated() noexcept
+{
+    static const bool accelerated = detectVector();
+    return accelerated;
+}
+
+//-----------------------------------------------------------------------------
+// Private Methods
+//-----------------------------------------------------------------------------
+
+/// @internal
+/// @brief Compile one clause (other than sample:)
+RecordFilter::Clause RecordFilter::_parse(const std::string& line)
+{
+    Clause clause;
+
+    std::string_view text = line;
+    if (text.front() == '!')
+    {
+        clause.negated = true;
+        text.remove_prefix(1);
+    }
+
+    auto colon = text.find(':');
+    if (colon == std::string_view::npos)
+    {
+        throw Exception("A filter clause is <kind>:<argument>: " + line);
+    }
+
+    const auto kind = text.substr(0, colon);
+    const std::string argument(text.substr(colon + 1));
+
+    if (kind == "contains")
+    {
+        if (argument.empty())
+        {
+            throw Exception("contains: requires text: " + line);
+        }
+
+        clause.kind = Kind::Contains;
+        clause.literals.push_back(argument);
+    }
+    else if (kind == "any")
+    {
+        clause.kind = Kind::Any;
+
+        size_t start = 0;
+        for (;;)
+        {
+            auto bar = argument.find('|', start);
+            auto literal = argument.substr(start, (bar == std::string::npos) ? std::string::npos : bar - start);
+            if (literal.empty())
+            {
+                throw Exception("any: requires texts separated by '|', none empty: " + line);
+            }
+
+            clause.literals.push_back(literal);
+            if (bar == std::string::npos)
+            {
+                break;
+            }
+            start = bar + 1;
+        }
+    }
+    else if (kind == "regex")
+    {
+        clause.kind = Kind::Pattern;
+        _compilePattern(clause, argument);
+    }
+    else if (kind == "field" || kind == "csv")
+    {
+        clause.kind = Kind::Field;
+        _compileField(clause, argument, (kind == "csv") ? ',' : 0);
+    }
+    else if (kind == "sample")
+    {
+        throw Exception("sample: cannot be negated: " + line);
+    }
+    else
+    {
+        throw Exception("Unknown kind of filter clause: " + line);
+    }
+
+    return clause;
+}
+
+/// @internal
+/// @brief Compile a pattern into tokens, and the states each token's state leads to without input
+void RecordFilter::_compilePattern(Clause& clause, const std::string& pattern)
+{
+    using Repeat = Token::Repeat;
+
+    auto fail = [&pattern](const std::string& why)
+    {
+        throw Exception("Invalid pattern (" + why + "): " + pattern);
+    };
+
+    // The bytes of an escape (\d, \w, \s, or the next byte itself)
+    auto escaped = [](char next)
+    {
+        std::bitset<256> bytes;
+        switch (next)
+        {
+        case 'd':
+            for (int byte = '0'; byte <= '9'; ++byte) bytes.set(static_cast<size_t>(byte));
+            break;
+        case 'w':
+            for (int byte = '0'; byte <= '9'; ++byte) bytes.set(static_cast<size_t>(byte));
+            for (int byte = 'a'; byte <= 'z'; ++byte) bytes.set(static_cast<size_t>(byte));
+            for (int byte = 'A'; byte <= 'Z'; ++byte) bytes.set(static_cast<size_t>(byte));
+            bytes.set('_');
+            break;
+        case 's':
+            for (char byte : {' ', '\t', '\r', '\f', '\v'}) bytes.set(static_cast<uint8_t>(byte));
+            break;
+        default:
+            bytes.set(static_cast<uint8_t>(next));
+            break;
+        }
+        return bytes;
+    };
+
+    size_t at = 0;
+    if (at < pattern.size() && pattern[at] == '^')
+    {
+        clause.anchoredStart = true;
+        ++at;
+    }
+
+    while (at < pattern.size())
+    {
+        const char next = pattern[at++];
+        Token token;
+
+        switch (next)
+        {
+        case '$':
+            if (at != pattern.size())
+            {
+                fail("'$' only ends a pattern");
+            }
+            clause.anchoredEnd = true;
+            continue;
+
+        case '.':
+            token.bytes.set();
+            break;
+
+        case '\\':
+            if (at == pattern.size())
+            {
+                fail("it ends in '\\'");
+            }
+            token.bytes = escaped(pattern[at++]);
+            break;
+
+        case '[':
+        {
+            bool negated = (at < pattern.size() && pattern[at] == '^');
+            at += negated ? 1 : 0;
+
+            // A ']' first is a member, not the end.
+            bool first = true;
+            while (at < pattern.size() && (pattern[at] != ']' || first))
+            {
+                first = false;
+                if (pattern[at] == '\\' && at + 1 < pattern.size())
+                {
+                    token.bytes |= escaped(pattern[at + 1]);
+                    at += 2;
+                }
+                else if (at + 2 < pattern.size() && pattern[at + 1] == '-' && pattern[at + 2] != ']')
+                {
+                    auto low = static_cast<uint8_t>(pattern[at]);
+                    auto high = static_cast<uint8_t>(pattern[at + 2]);
+                    if (low > high)
+                    {
+                        fail("a range runs backwards");
+                    }
+                    for (unsigned byte = low; byte <= high; ++byte)
+                    {
+                        token.bytes.set(byte);
+                    }
+                    at += 3;
+                }
+                else
+                {
+                    token.bytes.set(static_cast<uint8_t>(pattern[at++]));
+                }
+            }
+
+            if (at == pattern.size())
+            {
+                fail("a class is not closed");
+            }
+            ++at;
+
+            if (negated)
+            {
+                token.bytes.flip();
+            }
+            break;
+        }
+
+        case '*':
+        case '+':
+        case '?':
+            fail("nothing to repeat");
+            break;
+
+        case '(':
+        case ')':
+        case '|':
+            fail("groups and alternation are not supported; any: covers alternatives");
+            break;
+
+        default:
+            token.bytes.set(static_cast<uint8_t>(next));
+            break;
+        }
+
+        if (at < pattern.size())
+        {
+            switch (pattern[at])
+            {
+            case '*': token.repeat = Repeat::Star; ++at; break;
+            case '+': token.repeat = Repeat::Plus; ++at; break;
+            case '?': token.repeat = Repeat::Optional; ++at; break;
+            default: break;
+            }
+        }
+
+        clause.tokens.push_back(token);
+        if (clause.tokens.size() > MAX_PATTERN_TOKENS)
+        {
+            fail("it is too long");
+        }
+    }
+
+    // State i is "token i comes next"; the last state is a match. Tokens that may be skipped lead
+    // on to the next state at once.
+    const auto count = clause.tokens.size();
+    clause.closures.resize(count + 1);
+    clause.closures[count] = 1ull << count;
+    for (size_t index = count; index-- > 0; )
+    {
+        const auto repeat = clause.tokens[index].repeat;
+        clause.closures[index] = (1ull << index)
+            | ((repeat == Repeat::Optional || repeat == Repeat::Star) ? clause.closures[index + 1] : 0);
+    }
+
+    clause.takes.assign(256, 0);
+    for (size_t index = 0; index < count; ++index)
+    {
+        const auto& token = clause.tokens[index];
+        for (size_t byte = 0; byte < 256; ++byte)
+        {
+            if (token.bytes.test(byte))
+            {
+                clause.takes[byte] |= 1ull << index;
+            }
+        }
+
+        if (token.repeat == Repeat::Star || token.repeat == Repeat::Plus)
+        {
+            clause.loops |= 1ull << index;
+        }
+    }
+
+    // The longest run of single bytes that must appear, so most records are turned away by a
+    // literal search before any state is stepped; and the run every match starts with, which
+    // is searched for rather than stepped over while no match is under way.
+    std::string run;
+    std::string longest;
+    bool leading = true;
+    for (const auto& token : clause.tokens)
+    {
+        if (token.repeat == Repeat::Once && token.bytes.count() == 1)
+        {
+            for (size_t byte = 0; byte < 256; ++byte)
+            {
+                if (token.bytes.test(byte))
+                {
+                    run.push_back(static_cast<char>(byte));
+                    break;
+                }
+            }
+        }
+        else
+        {
+            if (leading)
+            {
+                clause.lead = run;
+                leading = false;
+            }
+            run.clear();
+        }
+
+        if (run.size() > longest.size())
+        {
+            longest = run;
+        }
+    }
+
+    if (leading)
+    {
+        clause.lead = run;
+    }
+
+    if (!longest.empty())
+    {
+        clause.literals.push_back(longest);
+    }
+}
+
+/// @internal
+/// @brief Compile "<n><op><value>"
+void RecordFilter::_compileField(Clause& clause, const std::string& text, char separator)
+{
+    clause.separator = separator;
+
+    size_t at = 0;
+    while (at < text.size() && text[at] >= '0' && text[at] <= '9')
+    {
+        ++at;
+    }
+
+    const auto field = std::strtoul(text.substr(0, at).c_str(), nullptr, 10);
+    if (at == 0 || field == 0)
+    {
+        throw Exception("A field is numbered from 1: " + text);
+    }
+    clause.field = field - 1;
+
+    static const std::pair<const char*, Compare> OPERATORS[] = {
+        {"!=", Compare::NotEqual}, {"<=", Compare::LessEqual}, {">=", Compare::GreaterEqual},
+        {"=", Compare::Equal}, {"<", Compare::Less}, {">", Compare::Greater},
+    };
+
+    bool known = false;
+    for (const auto& [name, compare] : OPERATORS)
+    {
+        if (text.compare(at, std::strlen(name), name) == 0)
+        {
+            clause.compare = compare;
+            at += std::strlen(name);
+            known = true;
+            break;
+        }
+    }
+
+    if (!known)
+    {
+        throw Exception("A field is compared with =, !=, <, <=, > or >=: " + text);
+    }
+
+    clause.text = text.substr(at);
+
+    if (clause.compare != Compare::Equal && clause.compare != Compare::NotEqual
+        && !toNumber(clause.text, clause.number))
+    {
+        throw Exception("A field is ordered only against a number: " + text);
+    }
+
+    // A field equal to some text means the record contains it.
+    if (clause.compare == Compare::Equal && !clause.text.empty())
+    {
+        clause.literals.push_back(clause.text);
+    }
+}
+
+/// @internal
+/// @brief Step a pattern's states over a record
+bool RecordFilter::_matchPattern(const Clause& clause, const char* record, size_t len) noexcept
+{
+    if (!clause.literals.empty())
+    {
+        const auto& literal = clause.literals.front();
+        if (find(record, len, literal.data(), literal.size()) == NOT_FOUND)
+        {
+            return false;
+        }
+    }
+
+    const auto accept = 1ull << clause.tokens.size();
+    const auto& closures = clause.closures;
+    const auto idle = clause.anchoredStart ? 0 : closures[0];
+    const bool skips = !clause.anchoredStart && clause.lead.size() > 1;
+    auto states = closures[0];
+
+    for (size_t at = 0; ; ++at)
+    {
+        if ((states & accept) && (!clause.anchoredEnd || at == len))
+        {
+            return true;
+        }
+
+        if (states == idle && skips)
+        {
+            // No match is under way, and none can start short of the lead.
+            auto next = find(record + at, len - at, clause.lead.data(), clause.lead.size());
+            if (next == NOT_FOUND)
+            {
+                return false;
+            }
+            at += next;
+        }
+
+        if (at == len)
+        {
+            return false;
+        }
+
+        // Every state whose token takes the byte moves on; one that may repeat also stays.
+        auto taken = states & clause.takes[static_cast<uint8_t>(record[at])];
+        // Unanchored, a match may start at any byte.
+        auto next = idle;
+        for (auto moved = taken; moved; moved &= moved - 1)
+        {
+            next |= closures[static_cast<size_t>(__builtin_ctzll(moved)) + 1];
+        }
+        for (auto stayed = taken & clause.loops; stayed; stayed &= stayed - 1)
+        {
+            next |= closures[static_cast<size_t>(__builtin_ctzll(stayed))];
+        }
+
+        if (!next)
+        {
+            return false;
+        }
+
+        states = next;
+    }
+}
+
+/// @internal
+/// @brief Find a record's field and compare it
+bool RecordFilter::_matchField(const Clause& clause, const char* record, size_t len) noexcept
+{
+    size_t start = 0;
+    size_t end = 0;
+    size_t index = 0;
+
+    if (clause.separator == 0)
+    {
+        for (;; ++index)
+        {
+            start = end;
+            while (start < len && isSpace(record[start]))
+            {
+                ++start;
+            }
+
+            if (start == len)
+            {
+                return false;
+            }
+
+            end = start;
+            while (end < len && !isSpace(record[end]))
+            {
+                ++end;
+            }
+
+            if (index == clause.field)
+            {
+                break;
+            }
+        }
+    }
+    else
+    {
+        for (;; ++index)
+        {
+            auto separator = static_cast<const char*>(std::memchr(record + start, clause.separator, len - start));
+            end = separator ? static_cast<size_t>(separator - record) : len;
+
+            if (index == clause.field)
+            {
+                break;
+            }
+
+            if (!separator)
+            {
+                return false;
+            }
+            start = end + 1;
+        }
+    }
+
+    const std::string_view value(record + start, end - start);
+
+    double number = 0;
+    switch (clause.compare)
+    {
+    case Compare::Equal:
+        return value == clause.text;
+    case Compare::NotEqual:
+        return value != clause.text;
+    case Compare::Less:
+        return toNumber(value, number) && number < clause.number;
+    case Compare::LessEqual:
+        return toNumber(value, number) && number <= clause.number;
+    case Compare::Greater:
+        return toNumber(value, number) && number > clause.number;
+    case Compare::GreaterEqual:
+        return toNumber(value, number) && number >= clause.number;
+    }
+
+    return false;
+}
+
+/// @internal
+/// @brief Determine whether a record passes one clause
+bool RecordFilter::_test(const Clause& clause, const char* record, size_t len) noexcept
+{
+    bool passed = false;
+
+    switch (clause.kind)
+    {
+    case Kind::Contains:
+        passed = find(record, len, clause.literals.front().data(), clause.literals.front().size()) != NOT_FOUND;
+        break;
+    case Kind::Any:
+        passed = findAny(record, len, clause.literals) != NOT_FOUND;
+        break;
+    case Kind::Field:
+        passed = _matchField(clause, record, len);
+        break;
+    case Kind::Pattern:
+        passed = _matchPattern(clause, record, len);
+        break;
+    }
+
+    return passed != clause.negated;
+}
+
+} // namespace Common
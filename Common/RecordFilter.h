@@ -0,0 +1,221 @@
+/**
+ * @brief A compiled test of whether a record (a line) is wanted, so that unwanted records need
+ *          never be sent
+ *
+ * @file RecordFilter.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+// Standard headers
+#include <bitset>
+#include <exception>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+
+namespace Common
+{
+    /**
+     * @brief Decides, record by record, what a receiver's consumers want. The sender applies it,
+     *          so that records nobody wants never cross the network.
+     * @details A filter is written as clauses, one per line, every one of which a record must
+     *          pass:
+     *              contains:<text>         the record contains 'text'
+     *              any:<text>|<text>...    it contains at least one of the texts
+     *              regex:<pattern>         it matches 'pattern' anywhere (see below)
+     *              field:<n><op><value>    its n-th whitespace-separated field (from 1) compares
+     *              csv:<n><op><value>      as field:, but fields are separated by commas
+     *              sample:<rate>           only this fraction of the records that pass the rest
+     *                                      are wanted (0 < rate <= 1)
+     *          A clause other than sample: may be negated with a leading '!'. For field: and
+     *          csv:, <op> is = or != (comparing text), or <, <=, > or >= (comparing numbers; a
+     *          field that is not a number does not pass).
+     *
+     *          Patterns are literal characters, '.', classes ([a-z], [^,]), the escapes \d, \w and
+     *          \s, and the quantifiers *, + and ?, optionally anchored by ^ and $. There are no
+     *          groups or alternation (any: covers the common case). They compile to a set of
+     *          states stepped once per byte, so matching is linear in the record whatever the
+     *          pattern.
+     *
+     *          Literal search is vectorized (AVX2) on x86-64 CPUs that have it, chosen once at
+     *          run time. Where a clause can only pass records containing some literal, seek()
+     *          searches a whole buffer of records for it at once, so records that cannot pass
+     *          are skipped over without being looked at one by one.
+     *
+     *          A compiled filter is not changed by use, so threads may share it. Sampling needs
+     *          state of its own, and is left to the user of the filter (see sampleRate()).
+     */
+    class RecordFilter
+    {
+        RecordFilter(const RecordFilter&) = delete;
+        RecordFilter& operator =(const RecordFilter&) = delete;
+
+    public: // Definitions
+        class Exception;
+
+        /// The most characters, classes and the like in one pattern
+        static constexpr size_t MAX_PATTERN_TOKENS = 63;
+
+        static constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+
+    public: // Methods
+        /**
+         * @brief Compile a filter
+         * @param[in] spec  - Clauses, one per line; empty wants every record
+         * @throws Exception if a clause cannot be understood
+         */
+        explicit RecordFilter(const std::string& spec);
+
+        virtual ~RecordFilter() = default;
+
+        /// @brief The text the filter was compiled from
+        const std::string& spec() const noexcept;
+
+        /// @brief Determine whether every record passes (sampling aside)
+        bool passesAll() const noexcept;
+
+        /// @brief The fraction of passing records wanted (1: all of them)
+        double sampleRate() const noexcept;
+
+        /// @brief Determine whether every record seek() lands in passes, so need not be tested
+        bool seekDecides() const noexcept;
+
+        /**
+         * @brief Determine whether a record passes every clause, sampling aside
+         * @param[in] record    - The record, without its newline
+         * @param[in] len       - Its length, in bytes
+         */
+        bool matches(const char* record, size_t len) const noexcept;
+
+        /**
+         * @brief Skip ahead through newline-separated records to the first that might pass
+         * @param[in] data  - Records
+         * @param[in] len   - Their length, in bytes
+         * @return An offset within the first record that might pass (0 if any might), or
+         *          NOT_FOUND if none can
+         */
+        size_t seek(const char* data, size_t len) const noexcept;
+
+        /**
+         * @brief Find a literal
+         * @param[in] data          - Where to look
+         * @param[in] len           - Its length, in bytes
+         * @param[in] literal       - What to look for
+         * @param[in] literalLen    - Its length, in bytes
+         * @return The offset of its first occurrence, or NOT_FOUND
+         */
+        static size_t find(const char* data, size_t len, const char* literal, size_t literalLen) noexcept;
+
+        /// @brief find(), always without vector instructions (for tests and benchmarks)
+        static size_t findPortable(const char* data, size_t len, const char* literal, size_t literalLen) noexcept;
+
+        /**
+         * @brief Find whichever of several literals occurs first
+         * @param[in] data      - Where to look
+         * @param[in] len       - Its length, in bytes
+         * @param[in] literals  - What to look for (none empty)
+         * @return The offset of the first occurrence of any of them, or NOT_FOUND
+         */
+        static size_t findAny(const char* data, size_t len, const std::vector<std::string>& literals) noexcept;
+
+        /// @brief findAny(), always without vector instructions (for tests and benchmarks)
+        static size_t findAnyPortable(const char* data, size_t len, const std::vector<std::string>& literals) noexcept;
+
+        /// @brief Whether find() and findAny() use vector instructions
+        static bool isAccelerated() noexcept;
+
+    private: // Definitions
+        /// In order of cost, cheapest first
+        enum class Kind
+        {
+            Contains,
+            Any,
+            Field,
+            Pattern,
+        };
+
+        enum class Compare
+        {
+            Equal,
+            NotEqual,
+            Less,
+            LessEqual,
+            Greater,
+            GreaterEqual,
+        };
+
+        /// One position of a pattern: the bytes it takes, and how many times
+        struct Token
+        {
+            enum class Repeat { Once, Optional, Star, Plus };
+
+            std::bitset<256>    bytes;
+            Repeat              repeat{Repeat::Once};
+        };
+
+        struct Clause
+        {
+            Kind                        kind{Kind::Contains};
+            bool                        negated{false};
+            std::vector<std::string>    literals;       ///< Contains: one; Any: several; Pattern: one it requires, if any
+            std::vector<Token>          tokens;         ///< Pattern
+            std::vector<uint64_t>       closures;       ///< Pattern: the states each state also puts us in, without input
+            std::vector<uint64_t>       takes;          ///< Pattern: by byte, the states whose token takes it
+            uint64_t                    loops{0};       ///< Pattern: the states whose token may repeat
+            std::string                 lead;           ///< Pattern: the bytes every match starts with
+            bool                        anchoredStart{false};
+            bool                        anchoredEnd{false};
+            size_t                      field{0};       ///< Field: from 0
+            char                        separator{0};   ///< Field: 0 for runs of whitespace
+            Compare                     compare{Compare::Equal};
+            std::string                 text;           ///< Field: the value compared with
+            double                      number{0};      ///< Field: the same, as a number (ordering comparisons)
+        };
+
+    private: // Methods
+        static Clause _parse(const std::string& line);
+        static void _compilePattern(Clause& clause, const std::string& pattern);
+        static void _compileField(Clause& clause, const std::string& text, char separator);
+        static bool _matchPattern(const Clause& clause, const char* record, size_t len) noexcept;
+        static bool _matchField(const Clause& clause, const char* record, size_t len) noexcept;
+        static bool _test(const Clause& clause, const char* record, size_t len) noexcept;
+
+    private: // Members
+        std::string             mSpec;
+        std::vector<Clause>     mClauses;       ///< Cheapest first
+        double                  mSampleRate{1.0};
+        size_t                  mSeek{NOT_FOUND};   ///< The clause seek() searches with, if any can
+
+    }; // class RecordFilter
+
+
+    /**
+     * @brief Exceptions on the RecordFilter class
+     */
+    class RecordFilter::Exception : public std::exception
+    {
+    public:
+        Exception(const std::string& message)
+            : mMessage(message)
+        {
+        }
+
+        virtual ~Exception() = default;
+
+        virtual const char* what() const noexcept override
+        {
+            return mMessage.c_str();
+        }
+
+    private:
+        std::string     mMessage;
+
+    }; // class RecordFilter::Exception
+
+} // namespace Common
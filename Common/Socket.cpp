@@ -10,10 +10,17 @@
 #include "Socket.h"
 
 #include "SocketException.h"
+#include "Probes.h"
 
 #include <arpa/inet.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/sendfile.h>
+#include <linux/errqueue.h>
 #include <sstream>
+#include <vector>
 #include <cstring>
 #include <cassert>
 
@@ -61,6 +68,17 @@ Socket::Socket(Socket&& rhs) noexcept
 //-----------------------------------------------------------------------------
 Socket& Socket::operator =(Socket&& rhs) noexcept
 {
+    if (this == &rhs)
+    {
+        return *this;
+    }
+
+    if (mSocket != -1)
+    {
+        // Release the handle we are replacing
+        close(mSocket);
+    }
+
     mSocket = rhs.mSocket;
 
     // This line is the reason for spelling this method out (i.e. not 'default').
@@ -72,6 +90,11 @@ Socket& Socket::operator =(Socket&& rhs) noexcept
     mPort = std::move(rhs.mPort);
     mState = std::move(rhs.mState);
     mSockAddrIn = std::move(rhs.mSockAddrIn);
+    mOptions = std::move(rhs.mOptions);
+    mZeroCopyNext = rhs.mZeroCopyNext;
+    mZeroCopyDone = rhs.mZeroCopyDone;
+    mZeroCopyAhead = std::move(rhs.mZeroCopyAhead);
+    mZeroCopyDeferred = rhs.mZeroCopyDeferred;
 
     return *this;
 }
@@ -92,6 +115,80 @@ Socket::~Socket()
     mState = State::Destroyed;
 }
 
+//-----------------------------------------------------------------------------
+std::vector<std::string> Socket::setOptions(const SocketOptions& options)
+{
+    if (options.noDelay.value_or(false) && options.cork.value_or(false))
+    {
+        throw Exception(mAddr, mPort, "TCP_NODELAY and TCP_CORK are mutually exclusive.");
+    }
+
+    std::vector<std::string> refused;
+
+    if (options.sendBuffer)
+    {
+        _setOption(SOL_SOCKET, SO_SNDBUF, options.sendBuffer.value(), "SO_SNDBUF", refused);
+    }
+
+    if (options.receiveBuffer)
+    {
+        _setOption(SOL_SOCKET, SO_RCVBUF, options.receiveBuffer.value(), "SO_RCVBUF", refused);
+    }
+
+    if (options.noDelay)
+    {
+        _setOption(IPPROTO_TCP, TCP_NODELAY, options.noDelay.value(), "TCP_NODELAY", refused);
+    }
+
+    if (options.cork)
+    {
+        _setOption(IPPROTO_TCP, TCP_CORK, options.cork.value(), "TCP_CORK", refused);
+    }
+
+    if (options.notSentLowat)
+    {
+        _setOption(IPPROTO_TCP, TCP_NOTSENT_LOWAT, options.notSentLowat.value(), "TCP_NOTSENT_LOWAT", refused);
+    }
+
+    if (options.busyPoll)
+    {
+        _setOption(SOL_SOCKET, SO_BUSY_POLL, options.busyPoll.value(), "SO_BUSY_POLL", refused);
+    }
+
+    if (options.preferBusyPoll)
+    {
+        _setOption(SOL_SOCKET, SO_PREFER_BUSY_POLL, options.preferBusyPoll.value(), "SO_PREFER_BUSY_POLL", refused);
+    }
+
+    if (options.quickAck)
+    {
+        _setOption(IPPROTO_TCP, TCP_QUICKACK, options.quickAck.value(), "TCP_QUICKACK", refused);
+    }
+
+    if (options.zeroCopy)
+    {
+        _setOption(SOL_SOCKET, SO_ZEROCOPY, options.zeroCopy.value(), "SO_ZEROCOPY", refused);
+    }
+
+    // The kernel only accepts these before the handshake.
+    if (mState == State::Created || mState == State::Bound)
+    {
+        if (options.fastOpen)
+        {
+            _setOption(IPPROTO_TCP, TCP_FASTOPEN, options.fastOpen.value(), "TCP_FASTOPEN", refused);
+        }
+
+        if (options.fastOpenConnect)
+        {
+            _setOption(IPPROTO_TCP, TCP_FASTOPEN_CONNECT, options.fastOpenConnect.value(), "TCP_FASTOPEN_CONNECT", refused);
+        }
+    }
+
+    mOptions = options;
+
+    return refused;
+}
+
 //-----------------------------------------------------------------------------
 void Socket::bind()
 {
@@ -143,13 +240,16 @@ std::optional<Socket> Socket::accept()
     // Create a new address instance to receive the connection.
     struct sockaddr_in addr;
     socklen_t len = sizeof(addr);
+    NS_PROBE1(accept_start, mSocket);
     auto acceptResult = ::accept(mSocket, reinterpret_cast<sockaddr*>(&addr), &len);
+    NS_PROBE2(accept_done, mSocket, acceptResult);
     if (acceptResult < 0)
     {
         // On error...
 
-        // If the connection was aborted, we are shutting down. This is not an error state.
-        if (errno != ECONNABORTED)
+        // If the connection was aborted, we are shutting down; if it was taken by another
+        // process sharing the socket, there is nothing to accept. Neither is an error state.
+        if (errno != ECONNABORTED && errno != EAGAIN && errno != EWOULDBLOCK)
         {
             std::ostringstream str;
             str <<  "Error while attempting to connect the socket: " << std::strerror(errno);
@@ -170,6 +270,82 @@ std::optional<Socket> Socket::accept()
     return result;
 }
 
+//-----------------------------------------------------------------------------
+bool Socket::waitAcceptable(int wakeFd)
+{
+    if (mState != State::Listening)
+    {
+        throw Exception(mAddr, mPort, "The Socket must be in a listening state to accept connections");
+    }
+
+    _setBlocking(false);
+
+    for (;;)
+    {
+        pollfd fds[2] = {{mSocket, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+        if (::poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            std::ostringstream str;
+            str << "Failure while waiting for connections: " << std::strerror(errno);
+            throw Exception(mAddr, mPort, str.str());
+        }
+
+        // Being woken takes precedence over connections still waiting.
+        if (fds[1].revents != 0 || (fds[0].revents & (POLLHUP | POLLERR | POLLNVAL)))
+        {
+            return false;
+        }
+
+        return (fds[0].revents & POLLIN) != 0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+int Socket::descriptor() const noexcept
+{
+    return mSocket;
+}
+
+//-----------------------------------------------------------------------------
+std::optional<int> Socket::incomingCpu() const noexcept
+{
+    int cpu = -1;
+    socklen_t len = sizeof(cpu);
+    if (getsockopt(mSocket, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) < 0 || cpu < 0)
+    {
+        return std::nullopt;
+    }
+
+    return cpu;
+}
+
+//-----------------------------------------------------------------------------
+Socket Socket::adopt(int socketFd)
+{
+    int listening = 0;
+    socklen_t len = sizeof(listening);
+    struct sockaddr_in addr{};
+    socklen_t addrLen = sizeof(addr);
+
+    if (getsockopt(socketFd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &len) < 0 || !listening
+        || getsockname(socketFd, reinterpret_cast<sockaddr*>(&addr), &addrLen) < 0
+        || addr.sin_family != AF_INET)
+    {
+        throw Exception("adopted socket", "The descriptor is not a listening IPv4 socket");
+    }
+
+    // (calling the private constructor)
+    Socket result(addr, socketFd);
+    result.mState = State::Listening;
+    result.mPort = ntohs(addr.sin_port);
+    return result;
+}
+
 //-----------------------------------------------------------------------------
 void Socket::connect()
 {
@@ -178,9 +354,11 @@ void Socket::connect()
         throw Exception(mAddr, mPort, "The Socket must be in a Created state in order to form a connection.");
     }
 
+    NS_PROBE2(connect_start, mSocket, mPort);
     if (::connect(mSocket, reinterpret_cast<sockaddr*>(&mSockAddrIn), sizeof(mSockAddrIn)) < 0)
     {
         // On error...
+        NS_PROBE2(connect_done, mSocket, errno);
         
         if (errno == ECONNREFUSED)
         {
@@ -199,16 +377,133 @@ void Socket::connect()
         // On success...
         
         // Set the state to connected
+        NS_PROBE2(connect_done, mSocket, 0);
         mState = State::Connected;
     }
 }
 
+//-----------------------------------------------------------------------------
+bool Socket::connectAsync()
+{
+    if (mState != State::Created)
+    {
+        throw Exception(mAddr, mPort, "The Socket must be in a Created state in order to form a connection.");
+    }
+
+    _setBlocking(false);
+
+    NS_PROBE2(connect_start, mSocket, mPort);
+    if (::connect(mSocket, reinterpret_cast<sockaddr*>(&mSockAddrIn), sizeof(mSockAddrIn)) == 0)
+    {
+        // Connected immediately (typical for loopback)
+        NS_PROBE2(connect_done, mSocket, 0);
+        _setBlocking(true);
+        mState = State::Connected;
+        return true;
+    }
+
+    if (errno == EINPROGRESS)
+    {
+        // The handshake proceeds in the background until waitAnyConnected() collects it.
+        mState = State::Connecting;
+        return false;
+    }
+
+    auto error = errno;
+    NS_PROBE2(connect_done, mSocket, error);
+    _recreate();
+
+    if (error == ECONNREFUSED)
+    {
+        throw ConnectionRefusalException(mAddr, mPort);
+    }
+
+    std::ostringstream str;
+    str << "Failure to connect: " << std::strerror(error);
+    throw Exception(mAddr, mPort, str.str());
+}
+
+//-----------------------------------------------------------------------------
+std::optional<size_t> Socket::waitAnyConnected(std::span<Socket* const> sockets,
+                                               std::chrono::milliseconds timeout)
+{
+    // Map poll entries back to the candidate they came from.
+    std::vector<pollfd> fds;
+    std::vector<size_t> indices;
+    for (size_t index = 0; index < sockets.size(); ++index)
+    {
+        if (sockets[index]->mState == State::Connecting)
+        {
+            fds.push_back(pollfd{sockets[index]->mSocket, POLLOUT, 0});
+            indices.push_back(index);
+        }
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    while (!fds.empty())
+    {
+        auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now());
+        if (remaining.count() < 0)
+        {
+            break;
+        }
+
+        auto ready = ::poll(fds.data(), fds.size(), static_cast<int>(remaining.count()));
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            std::ostringstream str;
+            str << "Failure while waiting for connection: " << std::strerror(errno);
+            throw Exception(sockets[indices.front()]->mAddr, str.str());
+        }
+
+        if (ready == 0)
+        {
+            // Timed out
+            break;
+        }
+
+        for (size_t entry = 0; entry < fds.size(); )
+        {
+            if (fds[entry].revents == 0)
+            {
+                ++entry;
+                continue;
+            }
+
+            if (sockets[indices[entry]]->_finishConnect())
+            {
+                // First one in wins
+                return indices[entry];
+            }
+
+            // This candidate failed; stop watching it.
+            fds.erase(fds.begin() + entry);
+            indices.erase(indices.begin() + entry);
+        }
+    }
+
+    return std::nullopt;
+}
+
 //-----------------------------------------------------------------------------
 bool Socket::isConnected() const noexcept
 {
     return mState == State::Connected;
 }
 
+//-----------------------------------------------------------------------------
+bool Socket::isConnecting() const noexcept
+{
+    return mState == State::Connecting;
+}
+
 //-----------------------------------------------------------------------------
 void Socket::send(const void* buffer, size_t len)
 {
@@ -217,13 +512,206 @@ void Socket::send(const void* buffer, size_t len)
         throw Exception(mAddr, mPort, "The Socket must be in a connected state to write.");
     }
 
-    if (::send(mSocket, buffer, len, 0) < 0)
+    NS_PROBE2(send_start, mSocket, len);
+    const auto total = len;
+
+    auto data = static_cast<const char*>(buffer);
+    while (len > 0)
+    {
+        // A peer that has gone away is an error to handle, not a SIGPIPE that ends the process.
+        auto sent = ::send(mSocket, data, len, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                // Interrupted before anything was written; try again.
+                continue;
+            }
+
+            // On failure...
+            std::ostringstream str;
+            str << "Error while writing: " << std::strerror(errno);
+            throw Exception(mAddr, mPort, str.str());
+        }
+
+        // A blocking send may still be cut short by a signal; finish the rest.
+        data += sent;
+        len -= static_cast<size_t>(sent);
+    }
+
+    NS_PROBE2(send_done, mSocket, total);
+}
+
+//-----------------------------------------------------------------------------
+std::optional<uint32_t> Socket::sendZeroCopy(const void* buffer, size_t len)
+{
+    if (mState != State::Connected)
+    {
+        throw Exception(mAddr, mPort, "The Socket must be in a connected state to write.");
+    }
+
+    std::optional<uint32_t> ticket;
+
+    NS_PROBE2(send_start, mSocket, len);
+    const auto total = len;
+
+    auto data = static_cast<const char*>(buffer);
+    while (len > 0)
+    {
+        auto sent = ::send(mSocket, data, len, MSG_ZEROCOPY | MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            if (errno == ENOBUFS)
+            {
+                // Too many pages are pinned already; copy the rest instead (a send of its own
+                // to tracers, inside this one).
+                send(data, len);
+                break;
+            }
+
+            std::ostringstream str;
+            str << "Error while writing: " << std::strerror(errno);
+            throw Exception(mAddr, mPort, str.str());
+        }
+
+        // Every successful zero-copy call produces one completion, numbered in order.
+        ticket = mZeroCopyNext++;
+
+        data += sent;
+        len -= static_cast<size_t>(sent);
+    }
+
+    NS_PROBE2(send_done, mSocket, total);
+    return ticket;
+}
+
+//-----------------------------------------------------------------------------
+bool Socket::isSendComplete(uint32_t ticket)
+{
+    // Wrap-safe "ticket < mZeroCopyDone"
+    auto complete = [this, ticket]{ return static_cast<int32_t>(ticket - mZeroCopyDone) < 0; };
+
+    if (!complete())
+    {
+        _reapCompletions();
+    }
+
+    return complete();
+}
+
+//-----------------------------------------------------------------------------
+void Socket::waitSendCompletions(std::chrono::milliseconds timeout)
+{
+    // Pending error queue entries are reported as POLLERR, whatever the requested events.
+    pollfd fd{mSocket, 0, 0};
+    if (::poll(&fd, 1, static_cast<int>(timeout.count())) < 0 && errno != EINTR)
+    {
+        std::ostringstream str;
+        str << "Failure while waiting for send completion: " << std::strerror(errno);
+        throw Exception(mAddr, mPort, str.str());
+    }
+
+    _reapCompletions();
+}
+
+//-----------------------------------------------------------------------------
+bool Socket::isZeroCopyDeferred() const noexcept
+{
+    return mZeroCopyDeferred;
+}
+
+//-----------------------------------------------------------------------------
+size_t Socket::sendFile(int fd, off_t offset, size_t count)
+{
+    if (mState != State::Connected)
+    {
+        throw Exception(mAddr, mPort, "The Socket must be in a connected state to write.");
+    }
+
+    NS_PROBE2(send_start, mSocket, count);
+
+    size_t total = 0;
+    while (total < count)
+    {
+        auto sent = ::sendfile(mSocket, fd, &offset, count - total);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            std::ostringstream str;
+            str << "Error while writing file: " << std::strerror(errno);
+            throw Exception(mAddr, mPort, str.str());
+        }
+
+        if (sent == 0)
+        {
+            // The file ended early
+            break;
+        }
+
+        total += static_cast<size_t>(sent);
+    }
+
+    NS_PROBE2(send_done, mSocket, total);
+    return total;
+}
+
+//-----------------------------------------------------------------------------
+bool Socket::waitReadable(std::chrono::milliseconds timeout)
+{
+    if (mState != State::Connected)
+    {
+        throw Exception(mAddr, mPort, "The Socket must be in a connected state in order to receive data.");
+    }
+
+    pollfd fd{mSocket, POLLIN, 0};
+    auto result = ::poll(&fd, 1, timeout.count() < 0 ? -1 : static_cast<int>(timeout.count()));
+    if (result < 0 && errno != EINTR)
     {
-        // On failure...
         std::ostringstream str;
-        str << "Error while writing: " << std::strerror(errno);
+        str << "Failure while waiting to receive: " << std::strerror(errno);
         throw Exception(mAddr, mPort, str.str());
     }
+
+    return result > 0;
+}
+
+//-----------------------------------------------------------------------------
+bool Socket::waitReadable(std::chrono::milliseconds timeout, int wakeFd)
+{
+    if (mState != State::Connected)
+    {
+        throw Exception(mAddr, mPort, "The Socket must be in a connected state in order to receive data.");
+    }
+
+    pollfd fds[2] = {{mSocket, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+    auto result = ::poll(fds, 2, timeout.count() < 0 ? -1 : static_cast<int>(timeout.count()));
+    if (result < 0)
+    {
+        if (errno == EINTR)
+        {
+            return false;
+        }
+
+        std::ostringstream str;
+        str << "Failure while waiting to receive: " << std::strerror(errno);
+        throw Exception(mAddr, mPort, str.str());
+    }
+
+    if (fds[1].revents != 0)
+    {
+        return false;
+    }
+
+    return fds[0].revents != 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -236,7 +724,17 @@ std::optional<size_t> Socket::recv(void* buffer, size_t len)
 
     std::optional<size_t> result;
 
-    auto readResult = ::recv(mSocket, buffer, len, 0);
+    NS_PROBE2(recv_start, mSocket, len);
+
+    ssize_t readResult;
+    do
+    {
+        // Interrupted before anything was read; try again.
+        readResult = ::recv(mSocket, buffer, len, 0);
+    } while (readResult < 0 && errno == EINTR);
+
+    NS_PROBE2(recv_done, mSocket, readResult);
+
     if (readResult <= 0)
     {
         // On failure...
@@ -262,6 +760,140 @@ std::optional<size_t> Socket::recv(void* buffer, size_t len)
     return result;
 }
 
+//-----------------------------------------------------------------------------
+std::optional<size_t> Socket::tryRecv(void* buffer, size_t len)
+{
+    if (mState != State::Connected)
+    {
+        throw Exception(mAddr, mPort, "The Socket must be in a connected state in order to receive data.");
+    }
+
+    ssize_t readResult;
+    do
+    {
+        readResult = ::recv(mSocket, buffer, len, MSG_DONTWAIT);
+    } while (readResult < 0 && errno == EINTR);
+
+    // Only when something arrives; a tracer on every empty poll would slow the spin it watches.
+    if (readResult > 0)
+    {
+        NS_PROBE2(recv_done, mSocket, readResult);
+        return static_cast<size_t>(readResult);
+    }
+
+    if (readResult < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+        // Nothing yet.
+        return 0;
+    }
+
+    if (readResult == 0 || errno == ECONNABORTED)
+    {
+        return std::nullopt;
+    }
+
+    std::ostringstream str;
+    str << "Failure while reading: " << std::strerror(errno);
+    throw Exception(mAddr, mPort, str.str());
+}
+
+//-----------------------------------------------------------------------------
+std::optional<size_t> Socket::spliceTo(int pipe, size_t len)
+{
+    if (mState != State::Connected)
+    {
+        throw Exception(mAddr, mPort, "The Socket must be in a connected state in order to receive data.");
+    }
+
+    std::optional<size_t> result;
+
+    ssize_t moved;
+    do
+    {
+        moved = ::splice(mSocket, nullptr, pipe, nullptr, len, SPLICE_F_MOVE);
+    } while (moved < 0 && errno == EINTR);
+
+    if (moved < 0 && errno != ECONNRESET && errno != ECONNABORTED)
+    {
+        std::ostringstream str;
+        str << "Failure while reading: " << std::strerror(errno);
+        throw Exception(mAddr, mPort, str.str());
+    }
+
+    if (moved > 0)
+    {
+        result = static_cast<size_t>(moved);
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+size_t Socket::spliceFrom(int pipe, size_t count)
+{
+    if (mState != State::Connected)
+    {
+        throw Exception(mAddr, mPort, "The Socket must be in a connected state to write.");
+    }
+
+    // splice() holds the pipe's lock for as long as it blocks on the socket, which would block
+    // writers to the pipe however they opened it. So wait with poll(), and splice only what the
+    // socket takes without blocking (it is non-blocking already, so no mode switch is needed).
+    for (;;)
+    {
+        pollfd ready{pipe, POLLIN, 0};
+        if (::poll(&ready, 1, -1) < 0 && errno != EINTR)
+        {
+            break;
+        }
+
+        ready = pollfd{mSocket, POLLOUT, 0};
+        if (::poll(&ready, 1, -1) < 0 && errno != EINTR)
+        {
+            break;
+        }
+
+        auto moved = ::splice(pipe, nullptr, mSocket, nullptr, count, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (moved >= 0)
+        {
+            return static_cast<size_t>(moved);
+        }
+
+        if (errno != EAGAIN && errno != EINTR)
+        {
+            break;
+        }
+    }
+
+    std::ostringstream str;
+    str << "Error while writing: " << std::strerror(errno);
+    throw Exception(mAddr, mPort, str.str());
+}
+
+//-----------------------------------------------------------------------------
+void Socket::setNonBlocking()
+{
+    _setBlocking(false);
+}
+
+//-----------------------------------------------------------------------------
+void Socket::shutdown()
+{
+    if (mSocket >= 0)
+    {
+        ::shutdown(mSocket, SHUT_RDWR);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void Socket::shutdownRead()
+{
+    if (mSocket >= 0)
+    {
+        ::shutdown(mSocket, SHUT_RD);
+    }
+}
+
 //-----------------------------------------------------------------------------
 // Private Methods
 //-----------------------------------------------------------------------------
@@ -283,5 +915,171 @@ Socket::Socket(const sockaddr_in& addr, int socketFd)
     mAddr = inet_ntoa(mSockAddrIn.sin_addr);
 }
 
+/// @internal
+/// @brief Switch the socket between blocking and non-blocking modes
+/// @param[in] blocking - True for blocking operation
+void Socket::_setBlocking(bool blocking)
+{
+    auto flags = fcntl(mSocket, F_GETFL, 0);
+    if (flags < 0)
+    {
+        throw Exception(mAddr, mPort, std::strerror(errno));
+    }
+
+    flags = blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+    if (fcntl(mSocket, F_SETFL, flags) < 0)
+    {
+        throw Exception(mAddr, mPort, std::strerror(errno));
+    }
+}
+
+/// @internal
+/// @brief Collect the result of a non-blocking connect that poll() reported as ready
+/// @return True if connected. On failure the socket returns to the Created state.
+bool Socket::_finishConnect()
+{
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if (getsockopt(mSocket, SOL_SOCKET, SO_ERROR, &error, &len) < 0)
+    {
+        error = errno;
+    }
+
+    NS_PROBE2(connect_done, mSocket, error);
+    if (error != 0)
+    {
+        _recreate();
+        return false;
+    }
+
+    _setBlocking(true);
+    mState = State::Connected;
+    return true;
+}
+
+/// @internal
+/// @brief Replace the socket handle with a fresh one after a failed connection attempt
+/// @details A TCP socket whose connection attempt failed cannot portably be reused.
+void Socket::_recreate()
+{
+    close(mSocket);
+
+    mSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (mSocket < 0)
+    {
+        std::ostringstream str;
+        str << "Failure to create the socket object: " << std::strerror(errno);
+        throw Exception(mAddr, str.str());
+    }
+
+    mState = State::Created;
+
+    // The new handle starts with system defaults.
+    setOptions(mOptions);
+}
+
+/// @internal
+/// @brief Collect zero-copy completion notifications from the socket error queue
+void Socket::_reapCompletions()
+{
+    for (;;)
+    {
+        union
+        {
+            char        buf[CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_in))];
+            cmsghdr     align;
+        } control;
+
+        msghdr msg{};
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+
+        if (::recvmsg(mSocket, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                // Nothing more queued
+                break;
+            }
+
+            std::ostringstream str;
+            str << "Failure while reading send completions: " << std::strerror(errno);
+            throw Exception(mAddr, mPort, str.str());
+        }
+
+        for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (cmsg->cmsg_level != SOL_IP || cmsg->cmsg_type != IP_RECVERR)
+            {
+                continue;
+            }
+
+            sock_extended_err error;
+            std::memcpy(&error, CMSG_DATA(cmsg), sizeof(error));
+            if (error.ee_origin != SO_EE_ORIGIN_ZEROCOPY || error.ee_errno != 0)
+            {
+                continue;
+            }
+
+            if (error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+                mZeroCopyDeferred = true;
+            }
+
+            // The notification covers the inclusive range [ee_info, ee_data].
+            mZeroCopyAhead.emplace_back(error.ee_info, error.ee_data);
+        }
+    }
+
+    // Advance past every range that now touches the completed prefix.
+    bool advanced = true;
+    while (advanced)
+    {
+        advanced = false;
+        for (auto range = mZeroCopyAhead.begin(); range != mZeroCopyAhead.end(); ++range)
+        {
+            if (static_cast<int32_t>(range->first - mZeroCopyDone) <= 0)
+            {
+                if (static_cast<int32_t>(range->second + 1 - mZeroCopyDone) > 0)
+                {
+                    mZeroCopyDone = range->second + 1;
+                }
+
+                mZeroCopyAhead.erase(range);
+                advanced = true;
+                break;
+            }
+        }
+    }
+}
+
+/// @internal
+/// @brief Set one integer socket option
+/// @param[in]  level   - The protocol level (SOL_SOCKET, IPPROTO_TCP)
+/// @param[in]  name    - The option
+/// @param[in]  value   - The value to set
+/// @param[in]  label   - The option's name, for reporting
+/// @param[out] refused - Receives 'label' if the option is unsupported or unprivileged
+void Socket::_setOption(int level, int name, int value, const char* label, std::vector<std::string>& refused)
+{
+    if (setsockopt(mSocket, level, name, &value, sizeof(value)) < 0)
+    {
+        if (errno == EPERM || errno == EACCES || errno == ENOPROTOOPT || errno == EOPNOTSUPP)
+        {
+            refused.emplace_back(label);
+            return;
+        }
+
+        std::ostringstream str;
+        str << "Failure to set " << label << ": " << std::strerror(errno);
+        throw Exception(mAddr, mPort, str.str());
+    }
+}
+
 } // namespace Common
 
@@ -9,6 +9,8 @@
 
 #pragma once
 
+#include "SocketOptions.h"
+
 #include <sys/socket.h>
 #include <netinet/in.h>
 
@@ -19,6 +21,8 @@
 #include <string>
 #include <chrono>
 #include <optional>
+#include <span>
+#include <vector>
 
 
 namespace Common
@@ -55,6 +59,17 @@ namespace Common
 
         virtual ~Socket();
 
+        /**
+         * @brief Apply tuning options to the socket
+         * @param[in] options   - The options to apply. They are remembered, and re-applied if the
+         *                         socket has to be recreated after a failed connection attempt.
+         * @return The names of options the kernel does not support or that require privileges we
+         *           lack. Those are skipped rather than treated as failures.
+         * @throws Socket::Exception on failure, or if both noDelay and cork are requested
+         * @details Fast open options are only applied before the socket is connected or listening.
+         */
+        std::vector<std::string> setOptions(const SocketOptions& options);
+
         /**
          * @brief Bind the socket to the address and port
          * @throws Socket::Exception on failure
@@ -71,11 +86,44 @@ namespace Common
         /**
          * @brief Accept a connection from the listening queue
          * @return A connected Socket object if successful, or an empty result if
-         *           the socket was terminated.
+         *           the socket was terminated, or (once waitAcceptable() has been used) if
+         *           another process sharing the socket took the connection first.
          * @throws Socket::Exception on failure
          */
         std::optional<Socket> accept();
 
+        /**
+         * @brief Wait until a connection is waiting to be accepted
+         * @param[in] wakeFd    - A descriptor (e.g. the read end of a pipe) that ends the wait
+         *                        once it is readable
+         * @return True if a connection is waiting; false if woken by 'wakeFd' or if the socket
+         *           was shut down
+         * @throws Socket::Exception on failure
+         * @details The socket is made non-blocking, so that accept() cannot block should another
+         *          process sharing the socket accept the connection first.
+         */
+        bool waitAcceptable(int wakeFd);
+
+        /**
+         * @brief Get the socket's descriptor, e.g. to pass it to another process
+         */
+        int descriptor() const noexcept;
+
+        /**
+         * @brief Get the CPU that last processed the connection's incoming packets (SO_INCOMING_CPU),
+         *          i.e. the CPU of its NIC receive queue under RSS
+         * @return The CPU, or unset if the kernel does not say
+         */
+        std::optional<int> incomingCpu() const noexcept;
+
+        /**
+         * @brief Take ownership of a listening socket, e.g. one passed over from another process
+         * @param[in] socketFd  - The descriptor of a bound, listening socket
+         * @return The Socket, ready to accept()
+         * @throws Socket::Exception if the descriptor is not a listening socket
+         */
+        static Socket adopt(int socketFd);
+
         /**
          * @brief Connect to a listening socket
          * @throws Socket::ConnectionException on refusal
@@ -83,12 +131,39 @@ namespace Common
          */
         void connect();
 
+        /**
+         * @brief Begin a non-blocking connection to a listening socket
+         * @return True if the connection completed immediately; false if it is in progress,
+         *           in which case waitAnyConnected() completes it.
+         * @throws Socket::ConnectionRefusalException on refusal
+         * @throws Socket::Exception on failure
+         */
+        bool connectAsync();
+
+        /**
+         * @brief Wait for the first of several in-progress connections to complete
+         * @param[in] sockets   - The candidate sockets. Those not in progress are ignored.
+         * @param[in] timeout   - The maximum time to wait
+         * @return The index of the first socket to connect, or unset if none connected within
+         *           'timeout'. Candidates whose attempt failed are returned to the created state
+         *           so that connectAsync() may be called on them again.
+         * @throws Socket::Exception on failure
+         */
+        static std::optional<size_t> waitAnyConnected(std::span<Socket* const> sockets,
+                                                      std::chrono::milliseconds timeout);
+
         /**
          * @brief Determine whether the socket is connected
          * @return True if the socket is in the connected state; otherwise false.
          */
         bool isConnected() const noexcept;
 
+        /**
+         * @brief Determine whether a non-blocking connection attempt is in progress
+         * @return True if connectAsync() has started a connection that has not yet completed.
+         */
+        bool isConnecting() const noexcept;
+
         /**
          * @brief Write some bytes to the socket
          * @param[in] buffer    - A pointer to the buffer to write, should be at least 'len' bytes.
@@ -98,6 +173,51 @@ namespace Common
          */
         void send(const void* buffer, size_t len);
 
+        /**
+         * @brief Write some bytes to the socket without copying them into the kernel (MSG_ZEROCOPY)
+         * @param[in] buffer    - A pointer to the buffer to write, should be at least 'len' bytes.
+         *                         It must not be modified until isSendComplete() reports the
+         *                         returned ticket complete.
+         * @param[in] len       - The length of the buffer pointed to by 'buffer', in bytes.
+         * @return A completion ticket, or unset if the kernel copied the data and the buffer is
+         *           free immediately (e.g. its zero-copy memory limit was reached).
+         * @throws Socket::Exception on failure
+         * @details The SO_ZEROCOPY option must be set. Pinning pages costs more than copying small
+         *          buffers, so this only pays off for large sends.
+         */
+        std::optional<uint32_t> sendZeroCopy(const void* buffer, size_t len);
+
+        /**
+         * @brief Determine whether the kernel is done with a zero-copy send
+         * @param[in] ticket    - A ticket from sendZeroCopy()
+         * @return True if the buffer of that send may be reused
+         * @throws Socket::Exception on failure
+         */
+        bool isSendComplete(uint32_t ticket);
+
+        /**
+         * @brief Wait for the kernel to report progress on zero-copy sends
+         * @param[in] timeout   - The maximum time to wait
+         * @throws Socket::Exception on failure
+         */
+        void waitSendCompletions(std::chrono::milliseconds timeout);
+
+        /**
+         * @brief Determine whether the kernel has had to copy zero-copy sends anyway (e.g. over
+         *          loopback), in which case zero-copy only adds overhead.
+         */
+        bool isZeroCopyDeferred() const noexcept;
+
+        /**
+         * @brief Write part of a file to the socket without copying it through user space
+         * @param[in] fd        - The file descriptor to read from (must support mmap, e.g. a regular file)
+         * @param[in] offset    - The file offset at which to start
+         * @param[in] count     - The number of bytes to send
+         * @return The number of bytes sent, which is less than 'count' only if the file ended first.
+         * @throws Socket::Exception on failure
+         */
+        size_t sendFile(int fd, off_t offset, size_t count);
+
         /**
          * @brief Read data from the socket and place it in a buffer
          * @param[out] buffer   - A pointer to the buffer to receive the data, should be at
@@ -109,12 +229,84 @@ namespace Common
          */
         std::optional<size_t> recv(void* buffer, size_t len);
 
+        /**
+         * @brief Read whatever data has already arrived, without waiting
+         * @param[out] buffer   - A pointer to the buffer to receive the data
+         * @param[in]  len      - The length of the buffer pointed to by 'buffer', in bytes.
+         * @return The number of bytes read (0 if none had arrived), or unset if disconnected.
+         * @throws Socket::Exception on failure
+         */
+        std::optional<size_t> tryRecv(void* buffer, size_t len);
+
+        /**
+         * @brief Move received data into a pipe without copying it through user space
+         * @param[in] pipe      - The write end of a pipe
+         * @param[in] len       - The most bytes to move
+         * @return The number of bytes moved, or unset if disconnected.
+         * @throws Socket::Exception on failure
+         * @details Like recv(), this blocks until some data arrives.
+         */
+        std::optional<size_t> spliceTo(int pipe, size_t len);
+
+        /**
+         * @brief Send data from a pipe without copying it through user space
+         * @param[in] pipe      - The read end of a pipe
+         * @param[in] count     - The most bytes to send
+         * @return The number of bytes sent, or 0 once the pipe's write end is closed and the
+         *          pipe is empty. Blocks until the pipe has some data.
+         * @throws Socket::Exception on failure
+         * @details The socket must have been made non-blocking (see setNonBlocking()); the
+         *          waiting is done with poll().
+         */
+        size_t spliceFrom(int pipe, size_t count);
+
+        /**
+         * @brief Make the connection non-blocking, for as long as it lasts
+         * @details For a connection written only with spliceFrom(), which then need not switch
+         *          modes around every splice. Other calls may fail rather than wait.
+         * @throws Socket::Exception on failure
+         */
+        void setNonBlocking();
+
+        /**
+         * @brief End the connection in both directions, waking any thread blocked on it
+         * @details The socket stays open (and is closed on destruction).
+         */
+        void shutdown();
+
+        /**
+         * @brief End the receiving direction only, waking any thread blocked reading it
+         * @details What the kernel already holds can still be read; recv() then reports the end
+         *          of the connection. Sending is unaffected.
+         */
+        void shutdownRead();
+
+        /**
+         * @brief Wait until there is data to read (or the peer has disconnected)
+         * @param[in] timeout   - The longest to wait; negative waits indefinitely
+         * @return True if recv() would not block
+         * @throws Socket::Exception on failure
+         */
+        bool waitReadable(std::chrono::milliseconds timeout);
+
+        /**
+         * @brief Wait until there is data to read, or until woken
+         * @param[in] timeout   - The longest to wait; negative waits indefinitely
+         * @param[in] wakeFd    - A descriptor (e.g. an eventfd) that ends the wait once it is
+         *                        readable
+         * @return True if recv() would not block; false if woken by 'wakeFd' or timed out.
+         *           Being woken takes precedence, so a busy connection cannot starve the waker.
+         * @throws Socket::Exception on failure
+         */
+        bool waitReadable(std::chrono::milliseconds timeout, int wakeFd);
+
     private: // Definitions
         enum class State
         {
             Created,
             Bound,
             Listening,
+            Connecting,
             Connected,
             Destroyed,
         };
@@ -122,12 +314,26 @@ namespace Common
     private: // Methods
         Socket(const sockaddr_in& addr, int socketFd);
 
+        void _setBlocking(bool blocking);
+        bool _finishConnect();
+        void _recreate();
+        void _setOption(int level, int name, int value, const char* label, std::vector<std::string>& refused);
+        void _reapCompletions();
+
     private: // Members
         int                 mSocket{-1};
         std::string         mAddr;
         uint16_t            mPort{0};
         State               mState{State::Created};
         struct sockaddr_in  mSockAddrIn;
+        SocketOptions       mOptions;
+
+        // Zero-copy bookkeeping. Tickets are assigned in send order; every ticket before
+        // mZeroCopyDone has completed. Completions reported ahead of that wait in mZeroCopyAhead.
+        uint32_t                                    mZeroCopyNext{0};
+        uint32_t                                    mZeroCopyDone{0};
+        std::vector<std::pair<uint32_t, uint32_t>>  mZeroCopyAhead;
+        bool                                        mZeroCopyDeferred{false};
 
     }; // class Socket
 
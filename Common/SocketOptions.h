@@ -0,0 +1,82 @@
+/**
+ * @brief Tuning options for a Socket
+ *
+ * @file SocketOptions.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+#include <string>
+#include <optional>
+
+
+namespace Common
+{
+    /**
+     * @brief Kernel tuning to apply to a Socket. Unset options are left at the system default.
+     * @details Options should be applied before connect() or listen(): buffer sizes in
+     *          particular determine the TCP window scale, which is fixed at the handshake.
+     */
+    struct SocketOptions
+    {
+        std::optional<int>  sendBuffer;         ///< SO_SNDBUF, in bytes (the kernel doubles it)
+        std::optional<int>  receiveBuffer;      ///< SO_RCVBUF, in bytes (the kernel doubles it)
+        std::optional<bool> noDelay;            ///< TCP_NODELAY: send small segments immediately
+        std::optional<bool> cork;               ///< TCP_CORK: hold partial segments (mutually exclusive with noDelay)
+        std::optional<int>  notSentLowat;       ///< TCP_NOTSENT_LOWAT: limit unsent data queued in the kernel
+        std::optional<int>  busyPoll;           ///< SO_BUSY_POLL: microseconds to spin on the device queue when receiving
+        std::optional<bool> preferBusyPoll;     ///< SO_PREFER_BUSY_POLL: leave the device queue to busy polling under load
+        std::optional<bool> quickAck;           ///< TCP_QUICKACK: acknowledge immediately (the kernel may clear it again)
+        std::optional<bool> zeroCopy;           ///< SO_ZEROCOPY: permit MSG_ZEROCOPY sends
+        std::optional<int>  fastOpen;           ///< TCP_FASTOPEN: queue length for data-carrying SYNs (listening sockets)
+        std::optional<bool> fastOpenConnect;    ///< TCP_FASTOPEN_CONNECT: send data with the SYN (connecting sockets).
+                                                ///<   Note: connect() then succeeds at once and a refusal surfaces on the first send.
+
+        /// The names profile() knows
+        static constexpr const char* PROFILE_NAMES[] = {"default", "bulk", "low-latency"};
+
+        /**
+         * @brief Look up a named tuning profile
+         * @param[in] name  - "default", "bulk" or "low-latency"
+         * @return The profile, or unset if the name is not known.
+         */
+        static std::optional<SocketOptions> profile(const std::string& name)
+        {
+            std::optional<SocketOptions> result;
+
+            if (name == "default")
+            {
+                result = SocketOptions{};
+            }
+            else if (name == "bulk")
+            {
+                // Large windows, and full segments even when records are small.
+                SocketOptions options;
+                options.sendBuffer = 4 * 1024 * 1024;
+                options.receiveBuffer = 4 * 1024 * 1024;
+                options.cork = true;
+                options.zeroCopy = true;
+                result = options;
+            }
+            else if (name == "low-latency")
+            {
+                // Nothing waits: no Nagle, no delayed ACKs, little queued behind each write,
+                // and receivers spin briefly rather than sleep.
+                SocketOptions options;
+                options.noDelay = true;
+                options.quickAck = true;
+                options.notSentLowat = 16 * 1024;
+                options.busyPoll = 50;
+                options.preferBusyPoll = true;
+                options.fastOpen = 16;
+                result = options;
+            }
+
+            return result;
+        }
+    };
+
+} // namespace Common
@@ -0,0 +1,361 @@
+/**
+ * @brief A compact file of received data, with when and on which connection it arrived
+ *
+ * @file TrafficCapture.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#include "TrafficCapture.h"
+
+// Project headers
+#include "Protocol.h"
+
+// System headers
+#include <fcntl.h>
+#include <unistd.h>
+
+// Standard headers
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+
+namespace
+{
+    std::string errorText(const std::string& what)
+    {
+        return what + ": " + std::strerror(errno);
+    }
+}
+
+
+namespace Common
+{
+    //-----------------------------------------------------------------------------
+    TrafficCapture::TrafficCapture(const std::string& path)
+        : mPath(path)
+        , mStart(std::chrono::steady_clock::now())
+        , mBuffer(BUFFER_SIZE)
+    {
+        mFd = ::open(mPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (mFd < 0)
+        {
+            throw Exception(errorText("Cannot create " + mPath));
+        }
+
+        const auto started = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+
+        auto header = reinterpret_cast<uint8_t*>(mBuffer.data());
+        Protocol::putU64(header, MAGIC);
+        Protocol::putU64(header + 8, static_cast<uint64_t>(started));
+        mUsed = HEADER_SIZE;
+    }
+
+    //-----------------------------------------------------------------------------
+    TrafficCapture::~TrafficCapture()
+    {
+        try
+        {
+            flush();
+        }
+        catch (...)
+        {
+            // Nothing more can be done; what was written is still readable.
+        }
+
+        ::close(mFd);
+    }
+
+    //-----------------------------------------------------------------------------
+    uint32_t TrafficCapture::open() noexcept
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        ++mStats.connections;
+        return mNextConnection++;
+    }
+
+    //-----------------------------------------------------------------------------
+    void TrafficCapture::append(uint32_t connection, const void* data, size_t len)
+    {
+        if (len == 0)
+        {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        // A disk that cannot keep up holds the connections back, rather than memory growing.
+        mWritten.wait(lock, [this]() { return mPending.size() < MAX_PENDING; });
+
+        _record(connection, data, len);
+        ++mStats.records;
+        mStats.bytes += len;
+
+        _drain(lock);
+    }
+
+    //-----------------------------------------------------------------------------
+    void TrafficCapture::close(uint32_t connection)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        mWritten.wait(lock, [this]() { return mPending.size() < MAX_PENDING; });
+
+        _record(connection, nullptr, 0);
+        _drain(lock);
+    }
+
+    //-----------------------------------------------------------------------------
+    void TrafficCapture::flush()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        _retire();
+        _drain(lock);
+
+        // Another thread may still be writing what was pending.
+        mWritten.wait(lock, [this]() { return !mWriting && mPending.empty(); });
+    }
+
+    //-----------------------------------------------------------------------------
+    TrafficCapture::Stats TrafficCapture::stats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        return mStats;
+    }
+
+    //-----------------------------------------------------------------------------
+    // Private Methods
+    //-----------------------------------------------------------------------------
+
+    /// @internal
+    /// @brief Add a record to the buffer. Called with mMutex held.
+    void TrafficCapture::_record(uint32_t connection, const void* data, size_t len)
+    {
+        // Timed under the lock, so that times never go backwards through the file.
+        const auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - mStart).count();
+
+        uint8_t header[RECORD_HEADER_SIZE];
+        Protocol::putU64(header, static_cast<uint64_t>(time));
+        Protocol::putU32(header + 8, connection);
+        Protocol::putU32(header + 12, static_cast<uint32_t>(len));
+
+        _write(header, sizeof(header));
+        _write(data, len);
+    }
+
+    /// @internal
+    /// @brief Copy into the buffer, setting it aside to be written as it fills. Called with mMutex
+    ///         held, which is not let go of, so that each record lies whole in the file.
+    void TrafficCapture::_write(const void* data, size_t len)
+    {
+        auto bytes = static_cast<const char*>(data);
+
+        while (len > 0)
+        {
+            if (mUsed == mBuffer.size())
+            {
+                _retire();
+            }
+
+            const auto part = std::min(len, mBuffer.size() - mUsed);
+            std::memcpy(mBuffer.data() + mUsed, bytes, part);
+
+            mUsed += part;
+            bytes += part;
+            len -= part;
+        }
+    }
+
+    /// @internal
+    /// @brief Set what the buffer holds aside to be written, and start on a spare one. Called
+    ///         with mMutex held.
+    void TrafficCapture::_retire()
+    {
+        if (mUsed == 0)
+        {
+            return;
+        }
+
+        mBuffer.resize(mUsed);
+        mPending.push_back(std::move(mBuffer));
+
+        if (mSpare.empty())
+        {
+            mBuffer = std::vector<char>(BUFFER_SIZE);
+        }
+        else
+        {
+            mBuffer = std::move(mSpare.back());
+            mSpare.pop_back();
+            mBuffer.resize(BUFFER_SIZE);
+        }
+        mUsed = 0;
+    }
+
+    /// @internal
+    /// @brief Write out the pending buffers, oldest first, unless another thread already is.
+    ///         Called with mMutex held; it is let go of while each buffer is written.
+    void TrafficCapture::_drain(std::unique_lock<std::mutex>& lock)
+    {
+        if (mWriting)
+        {
+            return;
+        }
+
+        mWriting = true;
+        while (!mPending.empty())
+        {
+            auto buffer = std::move(mPending.front());
+            mPending.pop_front();
+            mWritten.notify_all();
+
+            lock.unlock();
+
+            size_t written = 0;
+            while (written < buffer.size())
+            {
+                auto result = ::write(mFd, buffer.data() + written, buffer.size() - written);
+                if (result < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+
+                    // What is pending cannot follow a gap, so it is given up too; nobody waits on it.
+                    const auto error = errorText("Cannot write " + mPath);
+                    lock.lock();
+                    mPending.clear();
+                    mWriting = false;
+                    mWritten.notify_all();
+                    throw Exception(error);
+                }
+
+                written += static_cast<size_t>(result);
+            }
+
+            lock.lock();
+            mSpare.push_back(std::move(buffer));
+        }
+
+        mWriting = false;
+        mWritten.notify_all();
+    }
+
+
+    //-----------------------------------------------------------------------------
+    TrafficCapture::Reader::Reader(const std::string& path)
+        : mPath(path)
+        , mBuffer(BUFFER_SIZE)
+    {
+        mFd = ::open(mPath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (mFd < 0)
+        {
+            throw Exception(errorText("Cannot open " + mPath));
+        }
+
+        if (!_fill(HEADER_SIZE)
+            || Protocol::getU64(reinterpret_cast<const uint8_t*>(mBuffer.data())) != MAGIC)
+        {
+            ::close(mFd);
+            throw Exception(mPath + " is not a traffic capture.");
+        }
+
+        const auto started = Protocol::getU64(reinterpret_cast<const uint8_t*>(mBuffer.data()) + 8);
+        mStarted = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(started)));
+        mBegin = HEADER_SIZE;
+    }
+
+    //-----------------------------------------------------------------------------
+    TrafficCapture::Reader::~Reader()
+    {
+        ::close(mFd);
+    }
+
+    //-----------------------------------------------------------------------------
+    std::chrono::system_clock::time_point TrafficCapture::Reader::started() const noexcept
+    {
+        return mStarted;
+    }
+
+    //-----------------------------------------------------------------------------
+    std::optional<TrafficCapture::Record> TrafficCapture::Reader::next()
+    {
+        if (!_fill(RECORD_HEADER_SIZE))
+        {
+            return std::nullopt;
+        }
+
+        auto header = reinterpret_cast<const uint8_t*>(mBuffer.data() + mBegin);
+        const auto time = Protocol::getU64(header);
+        const auto connection = Protocol::getU32(header + 8);
+        const size_t len = Protocol::getU32(header + 12);
+
+        if (!_fill(RECORD_HEADER_SIZE + len))
+        {
+            return std::nullopt;
+        }
+
+        Record record{std::chrono::nanoseconds(time), connection, mBuffer.data() + mBegin + RECORD_HEADER_SIZE, len};
+        mBegin += RECORD_HEADER_SIZE + len;
+
+        return record;
+    }
+
+    //-----------------------------------------------------------------------------
+    // Private Methods
+    //-----------------------------------------------------------------------------
+
+    /// @internal
+    /// @brief Make sure the next 'len' bytes are in the buffer, from mBegin
+    /// @return False if the file ends first
+    bool TrafficCapture::Reader::_fill(size_t len)
+    {
+        if (mEnd - mBegin >= len)
+        {
+            return true;
+        }
+
+        // Keep what is left at the front, and make room for the rest.
+        std::memmove(mBuffer.data(), mBuffer.data() + mBegin, mEnd - mBegin);
+        mEnd -= mBegin;
+        mBegin = 0;
+
+        if (mBuffer.size() < len)
+        {
+            mBuffer.resize(len);
+        }
+
+        while (mEnd < len)
+        {
+            auto result = ::read(mFd, mBuffer.data() + mEnd, mBuffer.size() - mEnd);
+            if (result < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                throw Exception(errorText("Cannot read " + mPath));
+            }
+
+            if (result == 0)
+            {
+                return false;
+            }
+
+            mEnd += static_cast<size_t>(result);
+        }
+
+        return true;
+    }
+
+} // namespace Common
@@ -0,0 +1,204 @@
+/**
+ * @brief A compact file of received data, with when and on which connection it arrived
+ *
+ * @file TrafficCapture.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+// Standard headers
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+
+namespace Common
+{
+    /**
+     * @brief Records the data a receiver's connections deliver, so that the traffic can be
+     *          replayed later with its original timing (see Sender --replay).
+     * @details The file is a header, then one record per piece of data, in the order they were
+     *          appended:
+     *              header: u64 MAGIC, u64 start (nanoseconds since the Unix epoch)
+     *              record: u64 time (nanoseconds since the start), u32 connection, u32 length,
+     *                      then 'length' bytes of data
+     *          Numbers are in network byte order, as in Common::Protocol. A record of length 0
+     *          marks the end of its connection; a connection starts with its first record.
+     *          Connections are numbered from 0 in the order they were opened.
+     *
+     *          Records are gathered in a buffer and written a buffer at a time, so capturing costs
+     *          a copy and a lock per piece rather than a write() each. A full buffer is written
+     *          without the lock held, while the next one fills, so connections are not held up
+     *          by the disk; they wait only if the writes fall MAX_PENDING buffers behind. All
+     *          methods are thread-safe.
+     */
+    class TrafficCapture
+    {
+        TrafficCapture(const TrafficCapture&) = delete;
+        TrafficCapture& operator =(const TrafficCapture&) = delete;
+
+    public: // Definitions
+        class Exception;
+        class Reader;
+
+        static constexpr uint64_t MAGIC = 0x4e53434150303031;   // "NSCAP001"
+        static constexpr size_t HEADER_SIZE = 16;
+        static constexpr size_t RECORD_HEADER_SIZE = 16;
+
+        /// How much is gathered before it is written
+        static constexpr size_t BUFFER_SIZE = 1024 * 1024;
+
+        /// The full buffers that may wait to be written before appending waits for them
+        static constexpr size_t MAX_PENDING = 2;
+
+        /// A record read back by a Reader
+        struct Record
+        {
+            std::chrono::nanoseconds    time;       ///< Since the capture started
+            uint32_t                    connection;
+            const char*                 data;       ///< Valid until the Reader's next call
+            size_t                      len;        ///< 0: the connection ended
+        };
+
+        struct Stats
+        {
+            uint64_t    connections{0};
+            uint64_t    records{0};     ///< Pieces of data, not counting connection ends
+            uint64_t    bytes{0};
+        };
+
+    public: // Methods
+        /**
+         * @brief Start a capture, replacing any file already at the path
+         * @param[in] path  - Where to write the capture
+         * @throws Exception if the file cannot be written
+         */
+        explicit TrafficCapture(const std::string& path);
+
+        /// Writes whatever is still buffered.
+        virtual ~TrafficCapture();
+
+        /// @brief Number a new connection, for the records that follow
+        uint32_t open() noexcept;
+
+        /**
+         * @brief Record a piece of data, timed now
+         * @param[in] connection    - From open()
+         * @param[in] data          - The data
+         * @param[in] len           - Its size, in bytes (nothing is recorded for 0)
+         * @throws Exception if the capture cannot be written
+         */
+        void append(uint32_t connection, const void* data, size_t len);
+
+        /**
+         * @brief Record the end of a connection
+         * @param[in] connection    - From open()
+         * @throws Exception if the capture cannot be written
+         */
+        void close(uint32_t connection);
+
+        /// @brief Write whatever is buffered
+        void flush();
+
+        Stats stats() const;
+
+    private: // Methods
+        void _record(uint32_t connection, const void* data, size_t len);
+        void _write(const void* data, size_t len);
+        void _retire();
+        void _drain(std::unique_lock<std::mutex>& lock);
+
+    private: // Members
+        std::string                             mPath;
+        int                                     mFd{-1};
+        std::chrono::steady_clock::time_point   mStart;
+        mutable std::mutex                      mMutex;         ///< Guards the members below
+        std::condition_variable                 mWritten;       ///< A pending buffer was taken to be written, or writing stopped
+        bool                                    mWriting{false};    ///< A thread is writing out mPending; only it does
+        std::vector<char>                       mBuffer;        ///< Being filled
+        size_t                                  mUsed{0};
+        std::deque<std::vector<char>>           mPending;       ///< Full buffers, oldest first, not yet being written
+        std::vector<std::vector<char>>          mSpare;         ///< Written buffers, kept for reuse
+        uint32_t                                mNextConnection{0};
+        Stats                                   mStats;
+
+    }; // class TrafficCapture
+
+
+    /**
+     * @brief Reads a capture back, a record at a time
+     */
+    class TrafficCapture::Reader
+    {
+        Reader(const Reader&) = delete;
+        Reader& operator =(const Reader&) = delete;
+
+    public: // Methods
+        /**
+         * @brief Open a capture
+         * @param[in] path  - The capture file
+         * @throws Exception if it cannot be read, or is not a capture
+         */
+        explicit Reader(const std::string& path);
+
+        virtual ~Reader();
+
+        /// @brief When the capture started
+        std::chrono::system_clock::time_point started() const noexcept;
+
+        /**
+         * @brief Read the next record
+         * @return The record, or unset at the end of the capture (including a last record cut
+         *          short, as by a receiver that was killed)
+         * @throws Exception if the file cannot be read
+         */
+        std::optional<Record> next();
+
+    private: // Methods
+        bool _fill(size_t len);
+
+    private: // Members
+        std::string                             mPath;
+        int                                     mFd{-1};
+        std::chrono::system_clock::time_point   mStarted;
+        std::vector<char>                       mBuffer;
+        size_t                                  mBegin{0};      ///< Of what has been read but not returned
+        size_t                                  mEnd{0};
+
+    }; // class TrafficCapture::Reader
+
+
+    /**
+     * @brief Exceptions on the TrafficCapture class
+     */
+    class TrafficCapture::Exception : public std::exception
+    {
+    public:
+        Exception(const std::string& message)
+            : mMessage(message)
+        {
+        }
+
+        virtual ~Exception() = default;
+
+        virtual const char* what() const noexcept override
+        {
+            return mMessage.c_str();
+        }
+
+    private:
+        std::string     mMessage;
+
+    }; // class TrafficCapture::Exception
+
+} // namespace Common
@@ -0,0 +1,320 @@
+/**
+ * @brief Unix domain socket for local communication between processes
+ *
+ * @file UnixSocket.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#include "UnixSocket.h"
+
+#include "SocketException.h"
+
+#include <unistd.h>
+#include <sstream>
+#include <cstring>
+
+
+namespace Common
+{
+
+//-----------------------------------------------------------------------------
+UnixSocket::UnixSocket(const std::string& path)
+    : mPath(path)
+{
+    std::memset(&mSockAddrUn, 0, sizeof(mSockAddrUn));
+
+    // Check the path for validity here, for early failure.
+    if (mPath.empty() || mPath.size() >= sizeof(mSockAddrUn.sun_path))
+    {
+        throw Exception(mPath, "Invalid Unix socket path");
+    }
+
+    mSockAddrUn.sun_family = AF_UNIX;
+    std::memcpy(mSockAddrUn.sun_path, mPath.c_str(), mPath.size());
+
+    mSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (mSocket < 0)
+    {
+        std::ostringstream str;
+        str << "Failure to create the socket object: " << std::strerror(errno);
+        throw Exception(mPath, str.str());
+    }
+}
+
+//-----------------------------------------------------------------------------
+UnixSocket::UnixSocket(UnixSocket&& rhs) noexcept
+{
+    // Call the move assignment operator so we only have to
+    // list individual members once.
+    *this = std::move(rhs);
+}
+
+//-----------------------------------------------------------------------------
+UnixSocket& UnixSocket::operator =(UnixSocket&& rhs) noexcept
+{
+    if (this == &rhs)
+    {
+        return *this;
+    }
+
+    if (mSocket != -1)
+    {
+        close(mSocket);
+    }
+
+    mSocket = rhs.mSocket;
+    rhs.mSocket = -1;       // The resource is moved
+
+    mOwnsPath = rhs.mOwnsPath;
+    rhs.mOwnsPath = false;  // So is the responsibility for the path
+
+    mPath = std::move(rhs.mPath);
+    mState = rhs.mState;
+    mSockAddrUn = rhs.mSockAddrUn;
+
+    return *this;
+}
+
+//-----------------------------------------------------------------------------
+UnixSocket::~UnixSocket()
+{
+    if (mSocket != -1)
+    {
+        close(mSocket);
+    }
+
+    if (mOwnsPath)
+    {
+        // Don't leave the socket file behind
+        unlink(mPath.c_str());
+    }
+
+    mSocket = -1;
+    mState = State::Destroyed;
+}
+
+//-----------------------------------------------------------------------------
+void UnixSocket::bind()
+{
+    if (mState != State::Created)
+    {
+        throw Exception(mPath, "The Socket must be in a created state to bind.");
+    }
+
+    // A socket file left by a previous process would make bind fail with EADDRINUSE.
+    unlink(mPath.c_str());
+
+    if (::bind(mSocket, reinterpret_cast<struct sockaddr*>(&mSockAddrUn), sizeof(mSockAddrUn)) < 0)
+    {
+        std::ostringstream str;
+        str << "Failure to bind: " << std::strerror(errno);
+        throw Exception(mPath, str.str());
+    }
+
+    mOwnsPath = true;
+    mState = State::Bound;
+}
+
+//-----------------------------------------------------------------------------
+void UnixSocket::listen(int backlog)
+{
+    if (mState != State::Bound)
+    {
+        throw Exception(mPath, "The Socket must be in a bound state to enter listen mode.");
+    }
+
+    if (::listen(mSocket, backlog) < 0)
+    {
+        throw Exception(mPath, std::strerror(errno));
+    }
+
+    mState = State::Listening;
+}
+
+//-----------------------------------------------------------------------------
+std::optional<UnixSocket> UnixSocket::accept()
+{
+    if (mState != State::Listening)
+    {
+        throw Exception(mPath, "The Socket must be in a listening state to accept connections");
+    }
+
+    std::optional<UnixSocket> result;
+
+    auto acceptResult = ::accept(mSocket, nullptr, nullptr);
+    if (acceptResult < 0)
+    {
+        // A shut down listening socket reports EINVAL; neither that nor an aborted
+        // connection is an error state.
+        if (errno != ECONNABORTED && errno != EINVAL)
+        {
+            std::ostringstream str;
+            str <<  "Error while attempting to connect the socket: " << std::strerror(errno);
+            throw Exception(mPath, str.str());
+        }
+    }
+    else
+    {
+        result = UnixSocket(mPath, acceptResult);
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+void UnixSocket::connect()
+{
+    if (mState != State::Created)
+    {
+        throw Exception(mPath, "The Socket must be in a Created state in order to form a connection.");
+    }
+
+    if (::connect(mSocket, reinterpret_cast<sockaddr*>(&mSockAddrUn), sizeof(mSockAddrUn)) < 0)
+    {
+        std::ostringstream str;
+        str << "Failure to connect: " << std::strerror(errno);
+        throw Exception(mPath, str.str());
+    }
+
+    mState = State::Connected;
+}
+
+//-----------------------------------------------------------------------------
+void UnixSocket::shutdown() noexcept
+{
+    ::shutdown(mSocket, SHUT_RDWR);
+}
+
+//-----------------------------------------------------------------------------
+void UnixSocket::send(const void* buffer, size_t len, int fd)
+{
+    if (mState != State::Connected)
+    {
+        throw Exception(mPath, "The Socket must be in a connected state to write.");
+    }
+
+    iovec iov{const_cast<void*>(buffer), len};
+
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    // Control buffer, aligned for a cmsghdr, with room for one descriptor
+    union
+    {
+        char        buf[CMSG_SPACE(sizeof(int))];
+        cmsghdr     align;
+    } control;
+
+    if (fd >= 0)
+    {
+        std::memset(&control, 0, sizeof(control));
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+
+        auto cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    // The descriptor rides along with the first byte, so only the first sendmsg carries it.
+    while (iov.iov_len > 0)
+    {
+        auto sent = ::sendmsg(mSocket, &msg, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            std::ostringstream str;
+            str << "Error while writing: " << std::strerror(errno);
+            throw Exception(mPath, str.str());
+        }
+
+        iov.iov_base = static_cast<char*>(iov.iov_base) + sent;
+        iov.iov_len -= static_cast<size_t>(sent);
+        msg.msg_control = nullptr;
+        msg.msg_controllen = 0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+std::optional<size_t> UnixSocket::recv(void* buffer, size_t len, int& fd)
+{
+    if (mState != State::Connected)
+    {
+        throw Exception(mPath, "The Socket must be in a connected state in order to receive data.");
+    }
+
+    fd = -1;
+
+    iovec iov{buffer, len};
+
+    union
+    {
+        char        buf[CMSG_SPACE(sizeof(int))];
+        cmsghdr     align;
+    } control;
+
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    std::optional<size_t> result;
+
+    ssize_t readResult;
+    do
+    {
+        readResult = ::recvmsg(mSocket, &msg, MSG_CMSG_CLOEXEC);
+    } while (readResult < 0 && errno == EINTR);
+
+    if (readResult < 0)
+    {
+        if (errno != ECONNABORTED && errno != ECONNRESET)
+        {
+            std::ostringstream str;
+            str << "Failure while reading: " << std::strerror(errno);
+            throw Exception(mPath, str.str());
+        }
+    }
+    else if (readResult > 0)
+    {
+        for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+            {
+                std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+            }
+        }
+
+        result = static_cast<size_t>(readResult);
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// Private Methods
+//-----------------------------------------------------------------------------
+
+/// @internal
+/// @brief Construct a UnixSocket for an accepted connection
+/// @param[in] path     - The path of the listening socket
+/// @param[in] socketFd - The file descriptor of the connected socket
+UnixSocket::UnixSocket(const std::string& path, int socketFd)
+    : mSocket(socketFd)
+    , mPath(path)
+    , mState(State::Connected)
+{
+    std::memset(&mSockAddrUn, 0, sizeof(mSockAddrUn));
+}
+
+} // namespace Common
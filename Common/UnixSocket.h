@@ -0,0 +1,126 @@
+/**
+ * @brief Unix domain socket for local communication between processes
+ *
+ * @file UnixSocket.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+#include "Socket.h"
+
+#include <sys/un.h>
+
+#include <string>
+#include <optional>
+
+
+namespace Common
+{
+    /**
+     * @brief A stream-oriented Unix domain socket. In addition to data, it can pass open file
+     *          descriptors between processes (SCM_RIGHTS), so that a peer can read a file
+     *          directly rather than having its contents copied through the socket.
+     */
+    class UnixSocket
+    {
+        UnixSocket(const UnixSocket&) = delete;
+        UnixSocket& operator =(const UnixSocket&) = delete;
+
+    public: // Definitions
+        /// Errors are reported with the same exception type as Socket, carrying the path as the address.
+        using Exception = Socket::Exception;
+
+    public: // Methods
+        /**
+         * @brief Construct a UnixSocket
+         * @param[in] path      - The filesystem path of the socket
+         * @throws UnixSocket::Exception on failure
+         */
+        explicit UnixSocket(const std::string& path);
+
+        /// @brief Move construction is supported
+        UnixSocket(UnixSocket&& rhs) noexcept;
+
+        /// @brief Move assignment is supported
+        UnixSocket& operator =(UnixSocket&& rhs) noexcept;
+
+        virtual ~UnixSocket();
+
+        /**
+         * @brief Bind the socket to its path, replacing any stale socket file left there
+         * @throws UnixSocket::Exception on failure
+         */
+        void bind();
+
+        /**
+         * @brief Set the socket to listen mode
+         * @param[in] backlog   - The maximum number of connections to queue on the socket
+         * @throws UnixSocket::Exception on failure
+         */
+        void listen(int backlog = Socket::DEFAULT_BACKLOG);
+
+        /**
+         * @brief Accept a connection from the listening queue
+         * @return A connected UnixSocket if successful, or an empty result if the socket was
+         *           shut down.
+         * @throws UnixSocket::Exception on failure
+         */
+        std::optional<UnixSocket> accept();
+
+        /**
+         * @brief Connect to a listening socket
+         * @throws UnixSocket::Exception on failure
+         */
+        void connect();
+
+        /**
+         * @brief Stop a listening socket; a blocked accept() returns an empty result.
+         */
+        void shutdown() noexcept;
+
+        /**
+         * @brief Write a message to the socket, optionally passing a file descriptor with it
+         * @param[in] buffer    - A pointer to the buffer to write, should be at least 'len' bytes
+         * @param[in] len       - The length of the buffer pointed to by 'buffer', in bytes (at least 1)
+         * @param[in] fd        - A file descriptor to pass to the peer, or -1 for none. The
+         *                         caller keeps ownership of its copy.
+         * @throws UnixSocket::Exception on failure
+         */
+        void send(const void* buffer, size_t len, int fd = -1);
+
+        /**
+         * @brief Read a message from the socket, collecting any passed file descriptor
+         * @param[out] buffer   - A pointer to the buffer to receive the data
+         * @param[in]  len      - The length of the buffer pointed to by 'buffer', in bytes
+         * @param[out] fd       - Receives a passed file descriptor (owned by the caller), or -1
+         * @return The number of bytes read, or unset if disconnected.
+         * @throws UnixSocket::Exception on failure
+         */
+        std::optional<size_t> recv(void* buffer, size_t len, int& fd);
+
+    private: // Definitions
+        enum class State
+        {
+            Created,
+            Bound,
+            Listening,
+            Connected,
+            Destroyed,
+        };
+
+    private: // Methods
+        UnixSocket(const std::string& path, int socketFd);
+
+    private: // Members
+        int                 mSocket{-1};
+        std::string         mPath;
+        State               mState{State::Created};
+        bool                mOwnsPath{false};       ///< True if we bound the path and must remove it
+        struct sockaddr_un  mSockAddrUn;
+
+    }; // class UnixSocket
+
+} // namespace Common
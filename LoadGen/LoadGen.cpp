@@ -0,0 +1,732 @@
+/**
+ * @brief Simulates many concurrent senders, to find where a receiver stops keeping up
+ *
+ * @file LoadGen.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Source header
+#include "LoadGen.h"
+
+// Project headers
+#include "Common/CommonData.h"
+
+// System headers
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Standard headers
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+
+namespace
+{
+    /// The most records sent on one connection per turn, so that a fast one cannot starve the rest
+    constexpr size_t TURN_RECORDS = 64;
+
+    /// How often each thread looks for records due, connections to retry and connections to churn
+    constexpr auto TICK = std::chrono::milliseconds(1);
+
+    /// Room for echoes, and for the events of one wait
+    constexpr size_t READ_SIZE = 64 * 1024;
+    constexpr int MAX_EVENTS = 256;
+
+    constexpr char NEWLINE = '\n';
+
+    std::string errorText(const std::string& what)
+    {
+        return what + ": " + std::strerror(errno);
+    }
+
+    /// Every connection holds a descriptor; lift the soft limit to make room.
+    void reserveDescriptors(size_t connections)
+    {
+        struct rlimit limit;
+        if (getrlimit(RLIMIT_NOFILE, &limit) < 0)
+        {
+            return;
+        }
+
+        const auto wanted = static_cast<rlim_t>(connections + 64);
+        if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < wanted)
+        {
+            limit.rlim_cur = (limit.rlim_max == RLIM_INFINITY) ? wanted : std::min(wanted, limit.rlim_max);
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+    }
+
+    /// Parse a whole decimal number, throwing the option's error if it is not one
+    uint64_t parseNumber(const char* option, const char* text)
+    {
+        char* end = nullptr;
+        errno = 0;
+        auto value = std::strtoull(text, &end, 10);
+        if (end == text || *end != '\0' || errno != 0)
+        {
+            throw LoadGen::Exception(std::string("Invalid number for ") + option + ": " + text);
+        }
+
+        return value;
+    }
+
+    /// Parse a size for RecordSizes::parse(), from 1 to MAX_RECORD_SIZE
+    std::optional<size_t> parseSize(const std::string& text)
+    {
+        char* end = nullptr;
+        auto value = std::strtoull(text.c_str(), &end, 10);
+        if (text.empty() || *end != '\0' || value == 0 || value > LoadGen::MAX_RECORD_SIZE)
+        {
+            return std::nullopt;
+        }
+
+        return static_cast<size_t>(value);
+    }
+}
+
+
+/// One simulated sender
+struct LoadGen::Connection
+{
+    enum class State
+    {
+        Idle,           ///< Not connected; to connect at 'next'
+        Connecting,     ///< Handshake in progress since 'started'
+        Open,           ///< Sending; the next record is due at 'next'
+    };
+
+    int                 fd{-1};
+    State               state{State::Idle};
+    Clock::time_point   started;
+    Clock::time_point   next;
+    size_t              remaining{0};       ///< Left to send of the record in progress (0: none)
+    bool                writable{false};    ///< The socket took all it was given last time
+    bool                served{false};      ///< Counted as connected (with echo: its first echo came back)
+};
+
+
+/**
+ * @brief One thread's share of the connections, and the epoll loop that serves them
+ */
+class LoadGen::Worker
+{
+    Worker(const Worker&) = delete;
+    Worker& operator =(const Worker&) = delete;
+
+public: // Methods
+    Worker(LoadGen& owner, size_t index, Report& report)
+        : mOwner(owner)
+        , mConfig(owner.mConfig)
+        , mReport(report)
+        , mRandom(index + 1)
+        , mConnections(mConfig.connections * (index + 1) / mConfig.threads
+                       - mConfig.connections * index / mConfig.threads)
+        , mBuffer(READ_SIZE)
+    {
+        mEpoll = epoll_create1(EPOLL_CLOEXEC);
+        if (mEpoll < 0)
+        {
+            throw Exception(errorText("Cannot create epoll instance"));
+        }
+
+        if (mConfig.rate > 0)
+        {
+            mInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / mConfig.rate));
+        }
+
+        if (mConfig.churnRate > 0)
+        {
+            // This thread's share of the churn, a burst at a time.
+            const auto perThread = mConfig.churnRate * static_cast<double>(mConnections.size())
+                                 / static_cast<double>(mConfig.connections);
+            mChurnInterval = std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(static_cast<double>(mConfig.churnBurst) / perThread));
+        }
+    }
+
+    ~Worker()
+    {
+        for (auto& connection : mConnections)
+        {
+            if (connection.fd >= 0)
+            {
+                close(connection.fd);
+            }
+        }
+
+        close(mEpoll);
+    }
+
+    void run()
+    {
+        const auto start = Clock::now();
+        const auto end = start + mConfig.duration;
+        auto nextTick = start;
+        auto nextChurn = start + mChurnInterval;
+
+        // Spread the first records over one interval, so that connections do not send in step.
+        std::uniform_int_distribution<Clock::rep> offset(0, mInterval.count());
+        for (auto& connection : mConnections)
+        {
+            connection.next = start + Clock::duration(offset(mRandom));
+        }
+
+        std::array<epoll_event, MAX_EVENTS> events;
+
+        for (auto now = start; now < end && !mOwner.mStopping.load(std::memory_order_relaxed); now = Clock::now())
+        {
+            // As fast as possible means never waiting while a connection can take more.
+            const int timeout = (mConfig.rate == 0 && mBusy) ? 0 : static_cast<int>(TICK.count());
+
+            auto count = epoll_wait(mEpoll, events.data(), MAX_EVENTS, timeout);
+            if (count < 0 && errno != EINTR)
+            {
+                throw Exception(errorText("Cannot wait on epoll instance"));
+            }
+
+            now = Clock::now();
+            for (int event = 0; event < count; ++event)
+            {
+                _handle(mConnections[events[event].data.u64], events[event].events, now);
+            }
+
+            if (now >= nextTick || mBusy)
+            {
+                nextTick = now + TICK;
+                _sweep(now);
+            }
+
+            if (mChurnInterval.count() > 0 && now >= nextChurn)
+            {
+                nextChurn += mChurnInterval;
+                _churn(now);
+            }
+        }
+    }
+
+private: // Methods
+    /// Open connections that are due, time out slow handshakes, and send records that are due
+    void _sweep(Clock::time_point now)
+    {
+        mBusy = false;
+
+        for (size_t index = 0; index < mConnections.size(); ++index)
+        {
+            auto& connection = mConnections[index];
+
+            switch (connection.state)
+            {
+            case Connection::State::Idle:
+                if (connection.next <= now)
+                {
+                    _connect(index, now);
+                }
+                break;
+
+            case Connection::State::Connecting:
+                if (now - connection.started >= mConfig.connectTimeout)
+                {
+                    ++mReport.connectTimeouts;
+                    _close(connection, now + RETRY_DELAY);
+                }
+                break;
+
+            case Connection::State::Open:
+                _send(connection, now);
+                mBusy = mBusy || connection.writable;
+                break;
+            }
+        }
+    }
+
+    void _connect(size_t index, Clock::time_point now)
+    {
+        auto& connection = mConnections[index];
+
+        connection.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (connection.fd < 0)
+        {
+            // Out of descriptors, most likely; as much a failure to connect as a refusal.
+            ++mReport.connectFailures;
+            connection.next = now + RETRY_DELAY;
+            return;
+        }
+
+        connection.started = now;
+        connection.state = Connection::State::Connecting;
+
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.u64 = index;
+        if (epoll_ctl(mEpoll, EPOLL_CTL_ADD, connection.fd, &event) < 0)
+        {
+            ++mReport.connectFailures;
+            _close(connection, now + RETRY_DELAY);
+            return;
+        }
+
+        if (::connect(connection.fd, reinterpret_cast<const sockaddr*>(&mOwner.mAddress), sizeof(mOwner.mAddress)) < 0
+            && errno != EINPROGRESS)
+        {
+            ++mReport.connectFailures;
+            _close(connection, now + RETRY_DELAY);
+        }
+
+        // Otherwise EPOLLOUT reports the handshake's end, whether it has already come or not.
+    }
+
+    void _close(Connection& connection, Clock::time_point retry)
+    {
+        close(connection.fd);
+
+        connection.fd = -1;
+        connection.state = Connection::State::Idle;
+        connection.next = retry;
+        connection.remaining = 0;
+        connection.writable = false;
+        connection.served = false;
+    }
+
+    void _served(Connection& connection, Clock::time_point now)
+    {
+        connection.served = true;
+        ++mReport.connects;
+        mReport.acceptLatency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - connection.started).count());
+    }
+
+    void _handle(Connection& connection, uint32_t events, Clock::time_point now)
+    {
+        if (connection.state == Connection::State::Connecting)
+        {
+            int error = 0;
+            socklen_t len = sizeof(error);
+            if ((events & (EPOLLERR | EPOLLHUP))
+                || getsockopt(connection.fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0)
+            {
+                ++mReport.connectFailures;
+                _close(connection, now + RETRY_DELAY);
+                return;
+            }
+
+            if (!(events & EPOLLOUT))
+            {
+                return;
+            }
+
+            connection.state = Connection::State::Open;
+            connection.next = std::max(connection.next, now);
+            connection.writable = true;
+
+            if (!mConfig.echo)
+            {
+                _served(connection, now);
+            }
+        }
+
+        if (connection.state != Connection::State::Open)
+        {
+            return;
+        }
+
+        if (events & EPOLLIN)
+        {
+            if (!_drain(connection, now))
+            {
+                return;
+            }
+        }
+
+        if (events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+        {
+            ++mReport.disconnects;
+            _close(connection, now + RETRY_DELAY);
+            return;
+        }
+
+        if (events & EPOLLOUT)
+        {
+            connection.writable = true;
+            _send(connection, now);
+        }
+    }
+
+    /// Read what has come back; false if the connection ended
+    bool _drain(Connection& connection, Clock::time_point now)
+    {
+        for (;;)
+        {
+            auto received = ::recv(connection.fd, mBuffer.data(), mBuffer.size(), MSG_DONTWAIT);
+            if (received > 0)
+            {
+                mReport.bytesEchoed += static_cast<uint64_t>(received);
+                if (mConfig.echo && !connection.served)
+                {
+                    _served(connection, now);
+                }
+                continue;
+            }
+
+            if (received < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                return true;
+            }
+
+            ++mReport.disconnects;
+            _close(connection, now + RETRY_DELAY);
+            return false;
+        }
+    }
+
+    /// Send records that are due, until the socket is full or the turn is over
+    void _send(Connection& connection, Clock::time_point now)
+    {
+        for (size_t turn = 0; turn < TURN_RECORDS && connection.writable; )
+        {
+            if (connection.remaining == 0)
+            {
+                if (mConfig.rate > 0)
+                {
+                    if (connection.next > now)
+                    {
+                        return;
+                    }
+                    connection.next += mInterval;
+                }
+
+                connection.remaining = mConfig.sizes.draw(mRandom);
+            }
+
+            // The record's body, then its newline, in one send.
+            const auto body = connection.remaining - 1;
+            iovec parts[2] =
+            {
+                {const_cast<char*>(mOwner.mRecord.data()), body},
+                {const_cast<char*>(&NEWLINE), 1},
+            };
+
+            msghdr message{};
+            message.msg_iov = body ? parts : parts + 1;
+            message.msg_iovlen = body ? 2 : 1;
+
+            auto sent = sendmsg(connection.fd, &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (sent < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    connection.writable = false;
+                    return;
+                }
+
+                ++mReport.disconnects;
+                _close(connection, now + RETRY_DELAY);
+                return;
+            }
+
+            // A partial send leaves the rest of the record (and its newline) for next time.
+            const auto length = static_cast<size_t>(sent);
+            mReport.bytesSent += length;
+            connection.remaining -= std::min(length, connection.remaining);
+
+            if (connection.remaining == 0)
+            {
+                ++mReport.records;
+                ++turn;
+            }
+        }
+    }
+
+    /// Drop a burst of open connections, and open them again at once
+    void _churn(Clock::time_point now)
+    {
+        size_t dropped = 0;
+        for (size_t step = 0; step < mConnections.size() && dropped < mConfig.churnBurst; ++step)
+        {
+            auto& connection = mConnections[mChurnCursor];
+            mChurnCursor = (mChurnCursor + 1) % mConnections.size();
+
+            if (connection.state == Connection::State::Open)
+            {
+                _close(connection, now);
+                ++mReport.churned;
+                ++dropped;
+            }
+        }
+    }
+
+private: // Members
+    LoadGen&                    mOwner;
+    const Config&               mConfig;
+    Report&                     mReport;
+    std::mt19937_64             mRandom;
+    std::vector<Connection>     mConnections;
+    std::vector<char>           mBuffer;            ///< Where echoes are read to, and dropped
+    int                         mEpoll{-1};
+    Clock::duration             mInterval{0};       ///< Between records on a connection (0: no rate)
+    Clock::duration             mChurnInterval{0};  ///< Between bursts of churn (0: no churn)
+    size_t                      mChurnCursor{0};    ///< The next connection to consider dropping
+    bool                        mBusy{false};       ///< Some connection could take more at the last sweep
+
+}; // class LoadGen::Worker
+
+
+//-----------------------------------------------------------------------------
+std::optional<LoadGen::RecordSizes> LoadGen::RecordSizes::parse(const std::string& text)
+{
+    RecordSizes result;
+
+    if (text.rfind("exp:", 0) == 0)
+    {
+        auto mean = parseSize(text.substr(4));
+        if (!mean)
+        {
+            return std::nullopt;
+        }
+
+        result.kind = Kind::Exponential;
+        result.first = result.second = mean.value();
+        return result;
+    }
+
+    auto dash = text.find('-');
+    if (dash == std::string::npos)
+    {
+        auto size = parseSize(text);
+        if (!size)
+        {
+            return std::nullopt;
+        }
+
+        result.first = result.second = size.value();
+        return result;
+    }
+
+    auto low = parseSize(text.substr(0, dash));
+    auto high = parseSize(text.substr(dash + 1));
+    if (!low || !high || low.value() > high.value())
+    {
+        return std::nullopt;
+    }
+
+    result.kind = Kind::Uniform;
+    result.first = low.value();
+    result.second = high.value();
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+size_t LoadGen::RecordSizes::draw(std::mt19937_64& random) const
+{
+    switch (kind)
+    {
+    case Kind::Uniform:
+        return std::uniform_int_distribution<size_t>(first, second)(random);
+
+    case Kind::Exponential:
+    {
+        auto size = std::exponential_distribution<double>(1.0 / static_cast<double>(first))(random);
+        return std::clamp<size_t>(static_cast<size_t>(size + 0.5), 1, MAX_RECORD_SIZE);
+    }
+
+    case Kind::Fixed:
+    default:
+        return first;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void LoadGen::Report::merge(const Report& other)
+{
+    records += other.records;
+    bytesSent += other.bytesSent;
+    bytesEchoed += other.bytesEchoed;
+    connects += other.connects;
+    connectFailures += other.connectFailures;
+    connectTimeouts += other.connectTimeouts;
+    disconnects += other.disconnects;
+    churned += other.churned;
+    acceptLatency.merge(other.acceptLatency);
+}
+
+
+//-----------------------------------------------------------------------------
+LoadGen::LoadGen(const Config& config)
+    : mConfig(config)
+    , mRecord(MAX_RECORD_SIZE, 'x')
+{
+    if (mConfig.connections == 0 || mConfig.threads == 0)
+    {
+        throw Exception("At least one connection and one thread are required.");
+    }
+
+    // No thread sits idle without connections.
+    mConfig.threads = std::min(mConfig.threads, mConfig.connections);
+    mConfig.churnBurst = std::max<size_t>(mConfig.churnBurst, 1);
+
+    mAddress.sin_family = AF_INET;
+    mAddress.sin_port = htons(mConfig.target.port);
+    if (inet_pton(AF_INET, mConfig.target.addr.c_str(), &mAddress.sin_addr) != 1)
+    {
+        throw Exception("Invalid receiver address: " + mConfig.target.addr);
+    }
+
+    reserveDescriptors(mConfig.connections);
+}
+
+//-----------------------------------------------------------------------------
+LoadGen::CommandLineData LoadGen::parseCommandLine(int argc, const char* const* argv)
+{
+    CommandLineData data;
+    data.config.target = Common::Endpoint{SERVER_ADDR, SERVER_PORT};
+
+    for (int input = 1; input < argc; ++input)
+    {
+        const char* option = argv[input];
+
+        if (std::strcmp(option, "--echo") == 0)
+        {
+            data.config.echo = true;
+            continue;
+        }
+
+        if (++input >= argc)
+        {
+            throw Exception(std::string(option) + " requires a value.");
+        }
+        const char* value = argv[input];
+
+        if (std::strcmp(option, "--receiver") == 0)
+        {
+            auto endpoint = Common::Endpoint::parse(value, SERVER_PORT);
+            if (!endpoint)
+            {
+                throw Exception(std::string("Invalid receiver address: ") + value);
+            }
+
+            data.config.target = endpoint.value();
+        }
+        else if (std::strcmp(option, "--record-size") == 0)
+        {
+            auto sizes = RecordSizes::parse(value);
+            if (!sizes)
+            {
+                throw Exception(std::string("Invalid record size (<n>, <min>-<max> or exp:<mean>, at most ")
+                                + std::to_string(MAX_RECORD_SIZE) + "): " + value);
+            }
+
+            data.config.sizes = sizes.value();
+        }
+        else if (std::strcmp(option, "--rate") == 0 || std::strcmp(option, "--churn-rate") == 0)
+        {
+            char* end = nullptr;
+            auto rate = std::strtod(value, &end);
+            if (end == value || *end != '\0' || !(rate >= 0))
+            {
+                throw Exception(std::string("Invalid rate for ") + option + ": " + value);
+            }
+
+            (std::strcmp(option, "--rate") == 0 ? data.config.rate : data.config.churnRate) = rate;
+        }
+        else if (std::strcmp(option, "--connections") == 0)
+        {
+            data.config.connections = parseNumber(option, value);
+        }
+        else if (std::strcmp(option, "--threads") == 0)
+        {
+            data.config.threads = parseNumber(option, value);
+        }
+        else if (std::strcmp(option, "--churn-burst") == 0)
+        {
+            data.config.churnBurst = parseNumber(option, value);
+        }
+        else if (std::strcmp(option, "--duration-ms") == 0)
+        {
+            data.config.duration = std::chrono::milliseconds(parseNumber(option, value));
+        }
+        else if (std::strcmp(option, "--connect-timeout-ms") == 0)
+        {
+            data.config.connectTimeout = std::chrono::milliseconds(parseNumber(option, value));
+        }
+        else
+        {
+            throw Exception(std::string("Unknown option: ") + option);
+        }
+    }
+
+    return data;
+}
+
+//-----------------------------------------------------------------------------
+LoadGen::Report LoadGen::run()
+{
+    std::vector<Report> reports(mConfig.threads);
+    std::vector<std::exception_ptr> failures(mConfig.threads);
+    std::vector<std::thread> threads;
+
+    const auto start = Clock::now();
+
+    for (size_t index = 0; index < mConfig.threads; ++index)
+    {
+        threads.emplace_back([this, index, &reports, &failures]()
+        {
+            try
+            {
+                Worker(*this, index, reports[index]).run();
+            }
+            catch (...)
+            {
+                failures[index] = std::current_exception();
+                stop();
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (const auto& failure : failures)
+    {
+        if (failure)
+        {
+            std::rethrow_exception(failure);
+        }
+    }
+
+    Report result;
+    result.elapsed = Clock::now() - start;
+    for (const auto& report : reports)
+    {
+        result.merge(report);
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+void LoadGen::stop() noexcept
+{
+    mStopping.store(true, std::memory_order_relaxed);
+}
@@ -0,0 +1,191 @@
+/**
+ * @brief Simulates many concurrent senders, to find where a receiver stops keeping up
+ *
+ * @file LoadGen.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+// Project Headers
+#include "Common/Endpoint.h"
+#include "Common/LatencyHistogram.h"
+
+// System Headers
+#include <netinet/in.h>
+
+// Standard Headers
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * @brief Opens thousands of connections to a receiver from a few threads, and sends records of
+ *          varying size over each, at a set rate or as fast as the receiver takes them.
+ * @details Each thread serves its share of the connections with non-blocking sockets and one
+ *          epoll loop, as a Sender in line mode would: one record per send, each ending in a
+ *          newline. Connections can be dropped and replaced as it runs (churn), steadily or in
+ *          bursts; a large burst is a connect/disconnect storm.
+ *
+ *          Accept latency is the time from connect() until the receiver is serving the
+ *          connection. Against a receiver started with --echo, that is until its first echo
+ *          comes back, and throughput is what it echoes: the data its connection threads
+ *          actually handled. Otherwise it is until the handshake completes (a full accept queue
+ *          shows as connects that take a SYN retransmit, a second or more), and throughput is
+ *          what the receiver's kernel took.
+ *
+ *          Connections that fail to connect, time out connecting, or are ended by the receiver
+ *          are counted, and tried again after RETRY_DELAY.
+ */
+class LoadGen
+{
+    LoadGen(const LoadGen&) = delete;
+    LoadGen& operator =(const LoadGen&) = delete;
+
+public: // Definitions
+    class Exception;
+    struct CommandLineData;
+
+    /// The largest record sent; sizes drawn above it are cut to it
+    static constexpr size_t MAX_RECORD_SIZE = 1024 * 1024;
+
+    /// How long a failed connection waits before it is tried again
+    static constexpr std::chrono::milliseconds RETRY_DELAY{100};
+
+    /// How record sizes are drawn
+    struct RecordSizes
+    {
+        enum class Kind
+        {
+            Fixed,          ///< Always 'first' bytes
+            Uniform,        ///< Evenly from 'first' to 'second' bytes
+            Exponential,    ///< Many small and a few large, 'first' bytes on average
+        };
+
+        Kind        kind{Kind::Fixed};
+        size_t      first{100};
+        size_t      second{100};
+
+        /**
+         * @brief Parse a size distribution
+         * @param[in] text  - "<n>" (fixed), "<min>-<max>" (uniform) or "exp:<mean>" (exponential)
+         * @return The distribution, or unset if the text is not one (or a size is 0 or above
+         *          MAX_RECORD_SIZE)
+         */
+        static std::optional<RecordSizes> parse(const std::string& text);
+
+        /// @brief Draw a size (1 to MAX_RECORD_SIZE bytes, including the newline)
+        size_t draw(std::mt19937_64& random) const;
+    };
+
+    /// The load to generate
+    struct Config
+    {
+        Common::Endpoint            target;
+        size_t                      connections{100};
+        size_t                      threads{2};
+        double                      rate{0};                ///< Records per second on each connection (0: as fast as possible)
+        RecordSizes                 sizes;
+        double                      churnRate{0};           ///< Connections dropped and replaced per second, across all (0: none)
+        size_t                      churnBurst{1};          ///< Connections dropped together at each churn
+        std::chrono::milliseconds   duration{10000};
+        std::chrono::milliseconds   connectTimeout{5000};
+        bool                        echo{false};            ///< The receiver echoes what it is sent (receiver --echo)
+    };
+
+    /// What a run achieved
+    struct Report
+    {
+        std::chrono::duration<double>   elapsed{0};
+        uint64_t                    records{0};             ///< Records sent in full
+        uint64_t                    bytesSent{0};           ///< Taken by the receiver's kernel
+        uint64_t                    bytesEchoed{0};         ///< Handled by the receiver, and sent back (with echo)
+        uint64_t                    connects{0};            ///< Connections established (and, with echo, served)
+        uint64_t                    connectFailures{0};     ///< Refused, or failed in the handshake
+        uint64_t                    connectTimeouts{0};     ///< Not established within Config::connectTimeout
+        uint64_t                    disconnects{0};         ///< Established connections ended by the receiver or an error
+        uint64_t                    churned{0};             ///< Connections dropped on purpose, and replaced
+        Common::LatencyHistogram    acceptLatency;          ///< From connect() until served, in nanoseconds
+
+        /// @brief Add another thread's counts to these
+        void merge(const Report& other);
+    };
+
+public: // Methods
+    /**
+     * @brief Construct a LoadGen
+     * @param[in] config    - The load to generate
+     * @throws Exception if the target address is not an IPv4 address, or there are no
+     *          connections or threads
+     */
+    explicit LoadGen(const Config& config);
+
+    virtual ~LoadGen() = default;
+
+    /**
+     * @brief Parse the command line
+     * @param[in] argc      - The command line argc
+     * @param[in] argv      - The command line argv
+     * @throws Exception on an invalid option
+     */
+    static CommandLineData parseCommandLine(int argc, const char* const* argv);
+
+    /**
+     * @brief Generate the load for the configured duration, or until stop() is called
+     * @return What the run achieved, across all threads
+     * @throws Exception if a thread cannot set up its epoll loop
+     */
+    Report run();
+
+    /// @brief End run() early; safe to call from a signal handler
+    void stop() noexcept;
+
+private: // Definitions
+    struct Connection;
+    class Worker;
+
+private: // Members
+    Config                  mConfig;
+    sockaddr_in             mAddress{};         ///< The target, ready for connect()
+    std::vector<char>       mRecord;            ///< The body every record is sent from
+    std::atomic<bool>       mStopping{false};
+
+}; // class LoadGen
+
+
+/**
+ * @brief Exceptions on the LoadGen class
+ */
+class LoadGen::Exception : public std::exception
+{
+public:
+    Exception(const std::string& message)
+        : mMessage(message)
+    {
+    }
+
+    virtual ~Exception() = default;
+
+    virtual const char* what() const noexcept override
+    {
+        return mMessage.c_str();
+    }
+
+private:
+    std::string     mMessage;
+
+}; // class LoadGen::Exception
+
+struct LoadGen::CommandLineData
+{
+    Config      config;
+};
@@ -0,0 +1,92 @@
+/**
+ * @brief Load generator program entry
+ *
+ * @file main.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Project headers
+#include "LoadGen.h"
+
+// System headers
+#include <csignal>
+
+// Standard headers
+#include <exception>
+#include <iomanip>
+#include <iostream>
+
+
+static LoadGen* sLoadGen = nullptr;
+
+//-----------------------------------------------------------------------------
+static void onStopSignal(int)
+{
+    // Only an atomic store, so safe in a signal handler.
+    sLoadGen->stop();
+}
+
+//-----------------------------------------------------------------------------
+static void printReport(const LoadGen::Config& config, const LoadGen::Report& report)
+{
+    const auto seconds = report.elapsed.count();
+    auto perSecond = [seconds](double value) { return seconds > 0 ? value / seconds : 0.0; };
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "connections:     " << config.connections << " over " << config.threads << " threads, "
+              << seconds << " s\n"
+              << "records:         " << report.records << " (" << perSecond(static_cast<double>(report.records)) << "/s)\n"
+              << "sent:            " << perSecond(static_cast<double>(report.bytesSent)) / 1e6 << " MB/s\n";
+
+    if (config.echo)
+    {
+        std::cout << "echoed:          " << perSecond(static_cast<double>(report.bytesEchoed)) / 1e6 << " MB/s\n";
+    }
+
+    std::cout << "accept (us):     ";
+    for (auto percentile : Common::LatencyHistogram::SUMMARY_PERCENTILES)
+    {
+        std::cout << "p" << std::defaultfloat << std::setprecision(6) << percentile << " "
+                  << std::fixed << std::setprecision(1) << static_cast<double>(report.acceptLatency.percentile(percentile)) / 1000.0 << "  ";
+    }
+    std::cout << "max " << static_cast<double>(report.acceptLatency.max()) / 1000.0 << "\n";
+
+    std::cout << "connects:        " << report.connects << " (" << report.churned << " churned)\n"
+              << "failures:        " << report.connectFailures << " refused/failed, "
+              << report.connectTimeouts << " timed out, " << report.disconnects << " disconnected" << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, const char* const* argv)
+{
+    if (argc > 1 && std::string(argv[1]) == "--help")
+    {
+        std::cout << "Usage: loadgen [--receiver <addr[:port]>] [--connections <n>] [--threads <n>] [--rate <n>]\n"
+                  << "               [--record-size <n>|<min>-<max>|exp:<mean>] [--churn-rate <n>] [--churn-burst <n>]\n"
+                  << "               [--duration-ms <n>] [--connect-timeout-ms <n>] [--echo]" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        auto data = LoadGen::parseCommandLine(argc, argv);
+
+        LoadGen loadGen{data.config};
+
+        sLoadGen = &loadGen;
+        std::signal(SIGINT, onStopSignal);
+        std::signal(SIGTERM, onStopSignal);
+
+        auto report = loadGen.run();
+        printReport(data.config, report);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
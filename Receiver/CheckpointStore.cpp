@@ -0,0 +1,254 @@
+/**
+ * @brief Durable storage of partially received files, for resumable transfers
+ *
+ * @file CheckpointStore.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#include "CheckpointStore.h"
+
+// System headers
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Standard headers
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+
+namespace
+{
+    std::string errorText(const std::string& what)
+    {
+        return what + ": " + std::strerror(errno);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+CheckpointStore::CheckpointStore(const std::string& directory)
+    : mDirectory(directory)
+{
+    if (mkdir(mDirectory.c_str(), 0755) < 0 && errno != EEXIST)
+    {
+        throw Exception(errorText("Cannot create " + mDirectory));
+    }
+}
+
+//-----------------------------------------------------------------------------
+CheckpointStore::~CheckpointStore()
+{
+    for (auto& entry : mFiles)
+    {
+        _close(entry.second);
+    }
+}
+
+//-----------------------------------------------------------------------------
+uint64_t CheckpointStore::open(uint64_t fileId, const std::string& name, Owner& owner)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto existing = mFiles.find(fileId);
+    if (existing != mFiles.end())
+    {
+        // Still open from a connection that dropped. Taking it over keeps that connection,
+        // still winding down, from checkpointing or releasing it under us.
+        existing->second.owner = mNextOwner++;
+        owner = existing->second.owner;
+        return existing->second.durable;
+    }
+
+    // Only the final component of the name is used, and never one that leaves the directory.
+    auto slash = name.rfind('/');
+    auto baseName = (slash == std::string::npos) ? name : name.substr(slash + 1);
+    if (baseName.empty() || baseName == "." || baseName == "..")
+    {
+        throw Exception("Invalid file name: " + name);
+    }
+
+    File file;
+    file.name = baseName;
+
+    file.fd = ::open(_path(fileId, ".part").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (file.fd < 0)
+    {
+        throw Exception(errorText("Cannot open " + _path(fileId, ".part")));
+    }
+
+    file.checkpointFd = ::open(_path(fileId, ".ckpt").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (file.checkpointFd < 0)
+    {
+        _close(file);
+        throw Exception(errorText("Cannot open " + _path(fileId, ".ckpt")));
+    }
+
+    // The checkpoint is the last length known to be on disk. A short or missing one means zero.
+    uint64_t checkpoint = 0;
+    if (pread(file.checkpointFd, &checkpoint, sizeof(checkpoint), 0) != sizeof(checkpoint))
+    {
+        checkpoint = 0;
+    }
+
+    struct stat info;
+    if (fstat(file.fd, &info) < 0)
+    {
+        _close(file);
+        throw Exception(errorText("Cannot examine " + _path(fileId, ".part")));
+    }
+
+    file.durable = std::min<uint64_t>(checkpoint, static_cast<uint64_t>(info.st_size));
+    file.owner = mNextOwner++;
+
+    owner = file.owner;
+    auto durable = file.durable;
+    mFiles.emplace(fileId, file);
+
+    return durable;
+}
+
+//-----------------------------------------------------------------------------
+void CheckpointStore::write(uint64_t fileId, Owner owner, uint64_t offset, const void* data, size_t len)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto& file = _file(fileId, owner);
+
+    auto bytes = static_cast<const char*>(data);
+    while (len > 0)
+    {
+        auto written = pwrite(file.fd, bytes, len, static_cast<off_t>(offset));
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            throw Exception(errorText("Cannot write " + _path(fileId, ".part")));
+        }
+
+        bytes += written;
+        offset += static_cast<uint64_t>(written);
+        len -= static_cast<size_t>(written);
+    }
+}
+
+//-----------------------------------------------------------------------------
+uint64_t CheckpointStore::sync(uint64_t fileId, Owner owner, uint64_t length)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // A connection that was taken over knows less than the one that replaced it.
+    auto found = mFiles.find(fileId);
+    if (found != mFiles.end() && found->second.owner != owner)
+    {
+        return found->second.durable;
+    }
+
+    auto& file = _file(fileId, owner);
+
+    // Data first, then the checkpoint that vouches for it.
+    if (fdatasync(file.fd) < 0)
+    {
+        throw Exception(errorText("Cannot sync " + _path(fileId, ".part")));
+    }
+
+    if (pwrite(file.checkpointFd, &length, sizeof(length), 0) != sizeof(length)
+        || fdatasync(file.checkpointFd) < 0)
+    {
+        throw Exception(errorText("Cannot checkpoint " + _path(fileId, ".ckpt")));
+    }
+
+    file.durable = length;
+    return file.durable;
+}
+
+//-----------------------------------------------------------------------------
+void CheckpointStore::complete(uint64_t fileId, Owner owner, uint64_t length)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto& file = _file(fileId, owner);
+
+    if (ftruncate(file.fd, static_cast<off_t>(length)) < 0 || fdatasync(file.fd) < 0)
+    {
+        throw Exception(errorText("Cannot sync " + _path(fileId, ".part")));
+    }
+
+    auto finalPath = mDirectory + "/" + file.name;
+    if (std::rename(_path(fileId, ".part").c_str(), finalPath.c_str()) < 0)
+    {
+        throw Exception(errorText("Cannot rename to " + finalPath));
+    }
+
+    unlink(_path(fileId, ".ckpt").c_str());
+
+    _close(file);
+    mFiles.erase(fileId);
+}
+
+//-----------------------------------------------------------------------------
+void CheckpointStore::release(uint64_t fileId, Owner owner) noexcept
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto found = mFiles.find(fileId);
+    if (found != mFiles.end() && found->second.owner == owner)
+    {
+        _close(found->second);
+        mFiles.erase(found);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Private Methods
+//-----------------------------------------------------------------------------
+
+/// @internal
+/// @brief Look up an open file held by 'owner' (the caller holds mMutex)
+CheckpointStore::File& CheckpointStore::_file(uint64_t fileId, Owner owner)
+{
+    auto found = mFiles.find(fileId);
+    if (found == mFiles.end())
+    {
+        throw Exception("File is not open: " + std::to_string(fileId));
+    }
+
+    if (found->second.owner != owner)
+    {
+        throw Exception("File was taken over by a newer connection: " + std::to_string(fileId));
+    }
+
+    return found->second;
+}
+
+/// @internal
+/// @brief The path of one of a file's working files
+std::string CheckpointStore::_path(uint64_t fileId, const char* suffix) const
+{
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(fileId));
+    return mDirectory + "/" + name + suffix;
+}
+
+/// @internal
+/// @brief Release a file's descriptors
+void CheckpointStore::_close(File& file) noexcept
+{
+    if (file.fd >= 0)
+    {
+        close(file.fd);
+        file.fd = -1;
+    }
+
+    if (file.checkpointFd >= 0)
+    {
+        close(file.checkpointFd);
+        file.checkpointFd = -1;
+    }
+}
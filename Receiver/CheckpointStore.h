@@ -0,0 +1,147 @@
+/**
+ * @brief Durable storage of partially received files, for resumable transfers
+ *
+ * @file CheckpointStore.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+#include <string>
+#include <map>
+#include <exception>
+#include <mutex>
+#include <stdint.h>
+
+
+/**
+ * @brief Keeps received files in a directory, identified by the sender's file id.
+ * @details Data is written to "<dir>/<id>.part". After each sync, the durable length is recorded
+ *          in "<id>.ckpt"; that checkpoint, not the size of the .part file, is what is reported
+ *          to a resuming sender, since bytes past it may not have reached the disk. A completed
+ *          file is renamed to its own name within the directory.
+ *
+ *          All methods are thread-safe; a reconnecting sender may be served by a new connection
+ *          while the old one is still winding down. Each open file has one owner: opening it
+ *          again takes it over, after which the old owner's sync() and release() do nothing and
+ *          its write() and complete() fail, so it cannot disturb the transfer that replaced it.
+ */
+class CheckpointStore
+{
+    CheckpointStore(const CheckpointStore&) = delete;
+    CheckpointStore& operator =(const CheckpointStore&) = delete;
+
+public: // Definitions
+    class Exception;
+
+    /// Identifies the holder of an open file, as given out by open()
+    using Owner = uint64_t;
+
+public: // Methods
+    /**
+     * @brief Construct a CheckpointStore
+     * @param[in] directory     - The directory to keep files in (created if missing)
+     * @throws Exception on failure
+     */
+    explicit CheckpointStore(const std::string& directory);
+
+    virtual ~CheckpointStore();
+
+    /**
+     * @brief Begin (or resume) receiving a file
+     * @param[in] fileId    - The sender's identifier for the file
+     * @param[in] name      - The file's name (any directory part is ignored)
+     * @param[out] owner    - Identifies the caller in later calls about the file. If the file
+     *                        is still open, the caller takes it over from its previous owner.
+     * @return The number of bytes already durably held; the sender continues from here.
+     * @throws Exception on failure
+     */
+    uint64_t open(uint64_t fileId, const std::string& name, Owner& owner);
+
+    /**
+     * @brief Store received bytes
+     * @param[in] fileId    - An open file
+     * @param[in] owner     - The file's owner
+     * @param[in] offset    - The position of the bytes in the file
+     * @param[in] data      - The bytes
+     * @param[in] len       - The number of bytes
+     * @throws Exception on failure, or if 'owner' no longer holds the file
+     */
+    void write(uint64_t fileId, Owner owner, uint64_t offset, const void* data, size_t len);
+
+    /**
+     * @brief Make everything written so far durable, and checkpoint it
+     * @param[in] fileId    - An open file
+     * @param[in] owner     - The file's owner
+     * @param[in] length    - The number of contiguous bytes received from the start of the file
+     * @return The new durable length (unchanged if 'owner' no longer holds the file)
+     * @throws Exception on failure
+     */
+    uint64_t sync(uint64_t fileId, Owner owner, uint64_t length);
+
+    /**
+     * @brief Finish a file: sync it and move it to its final name
+     * @param[in] fileId    - An open file whose every byte has been written
+     * @param[in] owner     - The file's owner
+     * @param[in] length    - The total size of the file
+     * @throws Exception on failure, or if 'owner' no longer holds the file
+     */
+    void complete(uint64_t fileId, Owner owner, uint64_t length);
+
+    /**
+     * @brief Stop receiving a file without completing it (e.g. the sender disconnected). A
+     *          later open() resumes from its last checkpoint. Nothing is done if 'owner' no
+     *          longer holds the file.
+     * @param[in] fileId    - An open file
+     * @param[in] owner     - The file's owner
+     */
+    void release(uint64_t fileId, Owner owner) noexcept;
+
+private: // Definitions
+    struct File
+    {
+        int         fd{-1};
+        int         checkpointFd{-1};
+        std::string name;
+        uint64_t    durable{0};
+        Owner       owner{0};
+    };
+
+private: // Methods
+    File& _file(uint64_t fileId, Owner owner);
+    std::string _path(uint64_t fileId, const char* suffix) const;
+    void _close(File& file) noexcept;
+
+private: // Members
+    std::string                 mDirectory;
+    std::mutex                  mMutex;
+    std::map<uint64_t, File>    mFiles;
+    Owner                       mNextOwner{1};
+
+}; // class CheckpointStore
+
+
+/**
+ * @brief Exceptions on the CheckpointStore class
+ */
+class CheckpointStore::Exception : public std::exception
+{
+public:
+    Exception(const std::string& message)
+        : mMessage(message)
+    {
+    }
+
+    virtual ~Exception() = default;
+
+    virtual const char* what() const noexcept override
+    {
+        return mMessage.c_str();
+    }
+
+private:
+    std::string     mMessage;
+
+}; // class CheckpointStore::Exception
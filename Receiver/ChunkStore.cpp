@@ -0,0 +1,230 @@
+/**
+ * @brief Content-addressed storage of chunks, for deduplicated transfers
+ *
+ * @file ChunkStore.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#include "ChunkStore.h"
+
+// Project headers
+#include "Common/Protocol.h"
+
+// System headers
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+// Standard headers
+#include <cstring>
+
+
+namespace
+{
+    /// Fingerprint and length
+    constexpr size_t RECORD_HEADER_SIZE = Common::Fingerprint::SIZE + sizeof(uint32_t);
+
+    std::string errorText(const std::string& what)
+    {
+        return what + ": " + std::strerror(errno);
+    }
+
+    /// Read exactly 'len' bytes, or report that the file ends first
+    bool readAll(int fd, void* data, size_t len, uint64_t offset)
+    {
+        auto bytes = static_cast<char*>(data);
+        while (len > 0)
+        {
+            auto got = pread(fd, bytes, len, static_cast<off_t>(offset));
+            if (got < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if (got <= 0)
+            {
+                return false;
+            }
+
+            bytes += got;
+            len -= static_cast<size_t>(got);
+            offset += static_cast<uint64_t>(got);
+        }
+
+        return true;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+ChunkStore::ChunkStore(const std::string& directory)
+    : mPath(directory + "/chunks.pack")
+{
+    if (mkdir(directory.c_str(), 0755) < 0 && errno != EEXIST)
+    {
+        throw Exception(errorText("Cannot create " + directory));
+    }
+
+    mFd = ::open(mPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (mFd < 0)
+    {
+        throw Exception(errorText("Cannot open " + mPath));
+    }
+
+    try
+    {
+        _load();
+    }
+    catch (...)
+    {
+        close(mFd);
+        throw;
+    }
+}
+
+//-----------------------------------------------------------------------------
+ChunkStore::~ChunkStore()
+{
+    close(mFd);
+}
+
+//-----------------------------------------------------------------------------
+bool ChunkStore::contains(const Common::Fingerprint& fingerprint) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mIndex.count(fingerprint) != 0;
+}
+
+//-----------------------------------------------------------------------------
+void ChunkStore::put(const Common::Fingerprint& fingerprint, const void* data, size_t len)
+{
+    if (len > MAX_CHUNK)
+    {
+        throw Exception("Chunk too large to store");
+    }
+
+    uint8_t header[RECORD_HEADER_SIZE];
+    fingerprint.encode(header);
+    Common::Protocol::putU32(header + Common::Fingerprint::SIZE, static_cast<uint32_t>(len));
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (mIndex.count(fingerprint))
+    {
+        return;
+    }
+
+    struct iovec parts[2] = {
+        {header, sizeof(header)},
+        {const_cast<void*>(data), len},
+    };
+
+    // One write per record, so a record is only ever cut short at the end of the pack.
+    const auto total = sizeof(header) + len;
+    auto written = pwritev(mFd, parts, 2, static_cast<off_t>(mEnd));
+    if (written < 0 || static_cast<size_t>(written) != total)
+    {
+        // Leave nothing half written for the next record to follow; failing that, the next
+        // load cuts it off.
+        auto truncated = ftruncate(mFd, static_cast<off_t>(mEnd));
+        (void)truncated;
+
+        throw Exception(written < 0 ? errorText("Cannot write to " + mPath) : "Short write to " + mPath);
+    }
+
+    mIndex.emplace(fingerprint, Location{mEnd + sizeof(header), static_cast<uint32_t>(len)});
+    mEnd += total;
+    ++mStats.chunks;
+    mStats.bytes += len;
+}
+
+//-----------------------------------------------------------------------------
+bool ChunkStore::get(const Common::Fingerprint& fingerprint, std::vector<char>& data) const
+{
+    Location location;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto found = mIndex.find(fingerprint);
+        if (found == mIndex.end())
+        {
+            return false;
+        }
+
+        location = found->second;
+    }
+
+    // Records are never rewritten, so the read needs no lock.
+    data.resize(location.length);
+    if (!readAll(mFd, data.data(), data.size(), location.offset))
+    {
+        throw Exception(errorText("Cannot read from " + mPath));
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+ChunkStore::Stats ChunkStore::stats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+//-----------------------------------------------------------------------------
+// Private Methods
+//-----------------------------------------------------------------------------
+
+/// @internal
+/// @brief Index the pack, cutting off anything after the last whole, intact record
+void ChunkStore::_load()
+{
+    struct stat info;
+    if (fstat(mFd, &info) < 0)
+    {
+        throw Exception(errorText("Cannot examine " + mPath));
+    }
+
+    const auto size = static_cast<uint64_t>(info.st_size);
+    std::vector<char> data;
+
+    while (mEnd + RECORD_HEADER_SIZE <= size)
+    {
+        uint8_t header[RECORD_HEADER_SIZE];
+        if (!readAll(mFd, header, sizeof(header), mEnd))
+        {
+            break;
+        }
+
+        auto fingerprint = Common::Fingerprint::decode(header);
+        auto len = Common::Protocol::getU32(header + Common::Fingerprint::SIZE);
+        if (len > MAX_CHUNK || mEnd + sizeof(header) + len > size)
+        {
+            break;
+        }
+
+        // A crash can leave a whole header in front of data that never reached the disk.
+        data.resize(len);
+        if (!readAll(mFd, data.data(), len, mEnd + sizeof(header))
+            || Common::Fingerprint::of(data.data(), len) != fingerprint)
+        {
+            break;
+        }
+
+        if (mIndex.emplace(fingerprint, Location{mEnd + sizeof(header), len}).second)
+        {
+            ++mStats.chunks;
+            mStats.bytes += len;
+        }
+
+        mEnd += sizeof(header) + len;
+    }
+
+    if (mEnd < size && ftruncate(mFd, static_cast<off_t>(mEnd)) < 0)
+    {
+        throw Exception(errorText("Cannot truncate " + mPath));
+    }
+}
@@ -0,0 +1,127 @@
+/**
+ * @brief Content-addressed storage of chunks, for deduplicated transfers
+ *
+ * @file ChunkStore.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+#include "Common/Fingerprint.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <exception>
+#include <mutex>
+#include <stdint.h>
+
+
+/**
+ * @brief Keeps every chunk received, so that later transfers need not carry it again.
+ * @details Chunks are appended to "<dir>/chunks.pack" as records of
+ *              16 byte fingerprint, u32 length, data
+ *          and found again through an index kept in memory, rebuilt by scanning the pack on
+ *          construction. A record cut short by a crash is cut off the pack then; nothing is
+ *          synced, since a chunk lost this way is only sent again.
+ *
+ *          The pack only grows. Removing the directory empties the store.
+ *
+ *          All methods are thread-safe.
+ */
+class ChunkStore
+{
+    ChunkStore(const ChunkStore&) = delete;
+    ChunkStore& operator =(const ChunkStore&) = delete;
+
+public: // Definitions
+    class Exception;
+
+    /// Chunks larger than this are refused (more than any chunker makes)
+    static constexpr uint32_t MAX_CHUNK = 16 * 1024 * 1024;
+
+    struct Stats
+    {
+        uint64_t    chunks{0};          ///< Chunks held
+        uint64_t    bytes{0};           ///< Chunk bytes held (excluding record headers)
+    };
+
+public: // Methods
+    /**
+     * @brief Construct a ChunkStore
+     * @param[in] directory     - The directory to keep chunks in (created if missing)
+     * @throws Exception on failure
+     */
+    explicit ChunkStore(const std::string& directory);
+
+    virtual ~ChunkStore();
+
+    /// @brief Determine whether a chunk is held
+    bool contains(const Common::Fingerprint& fingerprint) const;
+
+    /**
+     * @brief Add a chunk, unless it is already held
+     * @param[in] fingerprint   - The chunk's fingerprint (the caller has checked it)
+     * @param[in] data          - The chunk
+     * @param[in] len           - Its length
+     * @throws Exception on failure
+     */
+    void put(const Common::Fingerprint& fingerprint, const void* data, size_t len);
+
+    /**
+     * @brief Read a chunk
+     * @param[in]  fingerprint  - The chunk's fingerprint
+     * @param[out] data         - Receives the chunk
+     * @return Whether the chunk is held
+     * @throws Exception on failure
+     */
+    bool get(const Common::Fingerprint& fingerprint, std::vector<char>& data) const;
+
+    /// @brief Get what the store holds
+    Stats stats() const;
+
+private: // Definitions
+    struct Location
+    {
+        uint64_t    offset;             ///< Of the chunk's data within the pack
+        uint32_t    length;
+    };
+
+private: // Methods
+    void _load();
+
+private: // Members
+    std::string         mPath;
+    int                 mFd{-1};
+    uint64_t            mEnd{0};        ///< The length of the pack
+    Stats               mStats;
+    mutable std::mutex  mMutex;
+    std::unordered_map<Common::Fingerprint, Location, Common::Fingerprint::Hash>    mIndex;
+
+}; // class ChunkStore
+
+
+/**
+ * @brief Exceptions on the ChunkStore class
+ */
+class ChunkStore::Exception : public std::exception
+{
+public:
+    Exception(const std::string& message)
+        : mMessage(message)
+    {
+    }
+
+    virtual ~Exception() = default;
+
+    virtual const char* what() const noexcept override
+    {
+        return mMessage.c_str();
+    }
+
+private:
+    std::string     mMessage;
+
+}; // class ChunkStore::Exception
@@ -0,0 +1,232 @@
+/**
+ * @brief A bounded queue between a connection and its handler, granting flow control credit
+ *
+ * @file DeliveryQueue.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#include "DeliveryQueue.h"
+
+// Project headers
+#include "Common/Affinity.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+//-----------------------------------------------------------------------------
+DeliveryQueue::DeliveryQueue(const Receiver::Handler& handler, uint64_t start, size_t capacity,
+                             const Grant& grant, int node, const std::vector<int>& cpus,
+                             Common::BufferArena* arena)
+    : mHandler(handler)
+    , mCapacity(capacity)
+    , mGrant(grant)
+    , mCpus(cpus)
+    , mRing(arena, capacity)
+    , mReceived(start)
+    , mDelivered(start)
+    , mLimit(start + capacity)
+{
+    // Before the ring is written, so that its pages are mostly placed rather than moved. Arena
+    // memory is left alone: moving part of it would split the huge pages it is there to provide,
+    // and explicit huge pages cannot be moved in 4 KiB pieces at all.
+    if (node >= 0 && !mRing.isFromArena())
+    {
+        Common::Affinity::bindMemory(mRing.get(), mCapacity, node);
+    }
+
+    mThread = std::thread(&DeliveryQueue::_deliveryThread, this);
+}
+
+//-----------------------------------------------------------------------------
+DeliveryQueue::~DeliveryQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+
+    mWake.notify_one();
+    mThread.join();
+}
+
+//-----------------------------------------------------------------------------
+uint64_t DeliveryQueue::limit() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mLimit;
+}
+
+//-----------------------------------------------------------------------------
+void DeliveryQueue::push(const void* data, size_t len)
+{
+    uint64_t at;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        _rethrowLocked();
+
+        if (mReceived + len > mLimit)
+        {
+            throw Exception("The sender exceeded its credit.");
+        }
+
+        at = mReceived;
+    }
+
+    // Within the credit limit, the bytes land where the delivery thread is not reading. Only this
+    // thread moves mReceived, so the copy needs no lock.
+    auto bytes = static_cast<const char*>(data);
+    while (len > 0)
+    {
+        const auto index = static_cast<size_t>(at % mCapacity);
+        const auto piece = std::min(len, mCapacity - index);
+        std::memcpy(mRing.get() + index, bytes, piece);
+
+        bytes += piece;
+        at += piece;
+        len -= piece;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        mReceived = at;
+
+        if (mReceived == mLimit && !mStallStart)
+        {
+            // The sender cannot send more until the handler catches up.
+            mStallStart = std::chrono::steady_clock::now();
+        }
+    }
+
+    mWake.notify_one();
+}
+
+//-----------------------------------------------------------------------------
+void DeliveryQueue::drain()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    mDrained.wait(lock, [this]{ return (mReceived == mDelivered && !mDelivering) || mError; });
+
+    _rethrowLocked();
+}
+
+//-----------------------------------------------------------------------------
+std::chrono::microseconds DeliveryQueue::stallTime() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStalled;
+}
+
+//-----------------------------------------------------------------------------
+// Private Methods
+//-----------------------------------------------------------------------------
+
+/// @internal
+/// @brief Hand queued data to the handler, extending credit as it is consumed
+void DeliveryQueue::_deliveryThread()
+{
+    if (!mCpus.empty())
+    {
+        Common::Affinity::pin(mCpus);
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    for (;;)
+    {
+        mWake.wait(lock, [this]{ return mReceived != mDelivered || mStopping; });
+
+        if (mReceived == mDelivered)
+        {
+            break;
+        }
+
+        // What is queued, as far as the end of the ring, and no more than a quarter of it so that
+        // credit keeps flowing.
+        const auto index = static_cast<size_t>(mDelivered % mCapacity);
+        const auto len = std::min({static_cast<size_t>(mReceived - mDelivered), mCapacity - index,
+                                   std::max<size_t>(mCapacity / 4, 1)});
+        const char* data = mRing.get() + index;
+        mDelivering = true;
+
+        // Once the handler has failed, the rest of the stream is dropped.
+        bool failed = static_cast<bool>(mError);
+
+        lock.unlock();
+
+        std::exception_ptr error;
+        try
+        {
+            if (!failed)
+            {
+                mHandler(data, len);
+            }
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+
+        mDelivered += len;
+
+        if (error && !mError)
+        {
+            mError = error;
+        }
+
+        std::optional<uint64_t> grant;
+        if (!mError && mDelivered + mCapacity >= mLimit + mCapacity / 4)
+        {
+            mLimit = mDelivered + mCapacity;
+            grant = mLimit;
+
+            if (mStallStart)
+            {
+                mStalled += std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - mStallStart.value());
+                mStallStart.reset();
+            }
+        }
+
+        if (grant)
+        {
+            lock.unlock();
+
+            try
+            {
+                mGrant(grant.value());
+            }
+            catch (...)
+            {
+                // The connection is gone; the reader will find out for itself.
+            }
+
+            lock.lock();
+        }
+
+        // Only now is this delivery finished, so that drain() returns after its grant is sent.
+        mDelivering = false;
+
+        if ((mReceived == mDelivered && !mDelivering) || mError)
+        {
+            mDrained.notify_all();
+        }
+    }
+}
+
+/// @internal
+/// @brief Report a handler failure (the caller holds mMutex)
+void DeliveryQueue::_rethrowLocked()
+{
+    if (mError)
+    {
+        std::rethrow_exception(mError);
+    }
+}
@@ -0,0 +1,140 @@
+/**
+ * @brief A bounded queue between a connection and its handler, granting flow control credit
+ *
+ * @file DeliveryQueue.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+#include "Receiver.h"
+#include "Common/BufferArena.h"
+
+#include <functional>
+#include <memory>
+#include <chrono>
+#include <optional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <stdint.h>
+
+
+/**
+ * @brief Delivers one stream's data to a handler on a thread of its own.
+ * @details The sender may only send as far as the credit limit, which is kept at most 'capacity'
+ *          bytes past what the handler has consumed, so the queue never holds more than that.
+ *          Because each stream has its own queue and thread, a slow handler holds back only its
+ *          own stream; the connection keeps reading control frames and other streams' data.
+ *
+ *          Credit is extended once a quarter of the window has been consumed, rather than for
+ *          every delivery, to keep Credit frames infrequent.
+ *
+ *          Queued data is kept in a ring of 'capacity' bytes, allocated with the queue (from the
+ *          receiver's BufferArena, if it has one), so that queueing and delivering allocate
+ *          nothing. The handler is given the queued bytes as they lie in the ring, up to a
+ *          quarter of it at a time, regardless of how they arrived.
+ */
+class DeliveryQueue
+{
+    DeliveryQueue(const DeliveryQueue&) = delete;
+    DeliveryQueue& operator =(const DeliveryQueue&) = delete;
+
+public: // Definitions
+    class Exception;
+
+    /// Called (from the delivery thread) with each new credit limit
+    using Grant = std::function<void(uint64_t limit)>;
+
+public: // Methods
+    /**
+     * @brief Construct a DeliveryQueue
+     * @param[in] handler   - Receives the stream's data, in order
+     * @param[in] start     - The stream offset of the first byte to be queued
+     * @param[in] capacity  - The most bytes that may be queued
+     * @param[in] grant     - Sends new credit limits to the sender
+     * @param[in] node      - The NUMA node to keep the queued data on (-1: wherever it is first
+     *                        touched). A ring taken from the arena stays where the arena lies.
+     * @param[in] cpus      - The CPUs to run the handler on (empty: wherever the scheduler likes)
+     * @param[in] arena     - Where to take the queue's memory from (null: the heap)
+     */
+    DeliveryQueue(const Receiver::Handler& handler, uint64_t start, size_t capacity, const Grant& grant,
+                  int node = -1, const std::vector<int>& cpus = {}, Common::BufferArena* arena = nullptr);
+
+    /// Delivers whatever is still queued, then stops.
+    virtual ~DeliveryQueue();
+
+    /// @brief The credit limit granted so far; the first is start + capacity.
+    uint64_t limit() const;
+
+    /**
+     * @brief Queue received data for the handler
+     * @param[in] data      - The data, which is copied into the queue
+     * @param[in] len       - The length of 'data', in bytes
+     * @throws Exception if the data goes past the credit limit
+     * @throws Whatever the handler threw, if it has failed
+     */
+    void push(const void* data, size_t len);
+
+    /**
+     * @brief Wait until the handler has consumed everything queued
+     * @throws Whatever the handler threw, if it has failed
+     */
+    void drain();
+
+    /// @brief The total time the sender has been out of credit because the handler was behind
+    std::chrono::microseconds stallTime() const;
+
+private: // Methods
+    void _deliveryThread();
+    void _rethrowLocked();
+
+private: // Members
+    Receiver::Handler                       mHandler;
+    size_t                                  mCapacity;
+    Grant                                   mGrant;
+    std::vector<int>                        mCpus;
+
+    mutable std::mutex                      mMutex;
+    std::condition_variable                 mWake;          ///< Data queued, or stopping
+    std::condition_variable                 mDrained;       ///< The queue emptied
+    Common::BufferArena::Buffer             mRing;          ///< Stream offset 'n' is kept at n % mCapacity
+    bool                                    mDelivering{false};
+    uint64_t                                mReceived;      ///< Stream offset after the last queued byte
+    uint64_t                                mDelivered;     ///< Stream offset after the last consumed byte
+    uint64_t                                mLimit;
+    std::optional<std::chrono::steady_clock::time_point>    mStallStart;
+    std::chrono::microseconds               mStalled{0};
+    std::exception_ptr                      mError;
+    bool                                    mStopping{false};
+    std::thread                             mThread;
+
+}; // class DeliveryQueue
+
+
+/**
+ * @brief Exceptions on the DeliveryQueue class
+ */
+class DeliveryQueue::Exception : public std::exception
+{
+public:
+    Exception(const std::string& message)
+        : mMessage(message)
+    {
+    }
+
+    virtual ~Exception() = default;
+
+    virtual const char* what() const noexcept override
+    {
+        return mMessage.c_str();
+    }
+
+private:
+    std::string     mMessage;
+
+}; // class DeliveryQueue::Exception
@@ -0,0 +1,195 @@
+/**
+ * @brief The receive loop, with its transport and handler fixed at compile time
+ *
+ * @file ReceiveLoop.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+// Project headers
+#include "Common/Socket.h"
+#include "Common/UnixSocket.h"
+
+// System headers
+#include <unistd.h>
+
+// Standard headers
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <utility>
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * @brief Transport policies for ReceiveLoop. Each reads into a buffer with
+ *          std::optional<size_t> recv(void* buffer, size_t len), returning an empty result once
+ *          there is nothing more to come.
+ */
+namespace Transport
+{
+    /// A connected TCP socket (in the unit tests, the Socket mock)
+    struct Tcp
+    {
+        Common::Socket& socket;
+
+        std::optional<size_t> recv(void* buffer, size_t len)
+        {
+            return socket.recv(buffer, len);
+        }
+    };
+
+    /**
+     * A connected TCP socket, polled without sleeping for up to 'budget' at a time. Data is
+     *  handled as soon as it lands, by a thread that is already running with its caches warm,
+     *  rather than after a wakeup. Once the budget passes with nothing, the thread sleeps until
+     *  data comes, so an idle connection does not hold its CPU.
+     */
+    struct BusyPoll
+    {
+        Common::Socket&             socket;
+        std::chrono::microseconds   budget;
+
+        std::optional<size_t> recv(void* buffer, size_t len)
+        {
+            auto deadline = std::chrono::steady_clock::now() + budget;
+
+            for (;;)
+            {
+                auto received = socket.tryRecv(buffer, len);
+                if (!received || received.value() > 0)
+                {
+                    return received;
+                }
+
+                if (std::chrono::steady_clock::now() >= deadline)
+                {
+                    socket.waitReadable(std::chrono::milliseconds(-1));
+                    deadline = std::chrono::steady_clock::now() + budget;
+                }
+#if defined(__x86_64__)
+                else
+                {
+                    // Eases the spin on a hyperthread's sibling, and on the memory bus.
+                    __builtin_ia32_pause();
+                }
+#endif
+            }
+        }
+    };
+
+    /// A connected Unix domain socket. Descriptors passed along with the data are not wanted here.
+    struct Unix
+    {
+        Common::UnixSocket& socket;
+
+        std::optional<size_t> recv(void* buffer, size_t len)
+        {
+            int fd = -1;
+            auto received = socket.recv(buffer, len, fd);
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+            return received;
+        }
+    };
+
+    /// A region of memory already filled, e.g. a shared memory mapping written by another process
+    struct Memory
+    {
+        const char*     data;
+        size_t          len;
+        size_t          offset{0};
+
+        std::optional<size_t> recv(void* buffer, size_t size)
+        {
+            if (offset == len)
+            {
+                return std::nullopt;
+            }
+
+            const auto count = std::min(size, len - offset);
+            std::memcpy(buffer, data + offset, count);
+            offset += count;
+            return count;
+        }
+    };
+
+} // namespace Transport
+
+
+/**
+ * @brief Hands everything received from a transport to a handler, until the transport ends
+ * @tparam Transport    - Where the data comes from (see namespace Transport)
+ * @tparam Handler      - Called with each piece received, as handler(const void* buffer, size_t len).
+ *                        May be a reference type, to use a handler kept elsewhere.
+ * @details Both are known at compile time, so each piece costs a direct call to the transport and
+ *          one to the handler, and a handler whose body is visible here is inlined into the loop.
+ *          Receiver::Handler is a std::function: serving through it (as Receiver does, for its
+ *          type-erased API) costs an indirect call per piece instead.
+ */
+template <typename Transport, typename Handler>
+class ReceiveLoop
+{
+public: // Definitions
+    /// The size of each receive
+    static constexpr size_t BUFFER_SIZE = 1024;
+
+public: // Methods
+    ReceiveLoop(Transport transport, Handler handler)
+        : mTransport(std::move(transport))
+        , mHandler(std::forward<Handler>(handler))
+    {
+    }
+
+    /**
+     * @brief Hand over 'first' (already received), then everything else until the transport ends
+     * @param[in] first     - Data received before the loop started, if any
+     * @param[in] len       - The length of 'first', in bytes
+     * @return The number of bytes handed over
+     * @throws Whatever the transport or the handler throws
+     */
+    uint64_t run(const void* first = nullptr, size_t len = 0)
+    {
+        uint64_t total = 0;
+
+        if (len > 0)
+        {
+            mHandler(first, len);
+            total += len;
+        }
+
+        while (auto received = mTransport.recv(mBuffer.data(), mBuffer.size()))
+        {
+            mHandler(static_cast<const void*>(mBuffer.data()), received.value());
+            total += received.value();
+        }
+
+        return total;
+    }
+
+private: // Members
+    Transport                           mTransport;
+    Handler                             mHandler;
+    std::array<char, BUFFER_SIZE>       mBuffer;
+
+}; // class ReceiveLoop
+
+
+/**
+ * @brief Run a ReceiveLoop over a transport, with a handler used in place
+ * @return The number of bytes handed over
+ */
+template <typename Transport, typename Handler>
+uint64_t receiveAll(Transport transport, Handler&& handler, const void* first = nullptr, size_t len = 0)
+{
+    ReceiveLoop<Transport, Handler&&> loop(std::move(transport), std::forward<Handler>(handler));
+    return loop.run(first, len);
+}
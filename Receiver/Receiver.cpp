@@ -11,52 +11,548 @@
 
 // Project headers
 #include "Common/Socket.h"
+#include "Common/Protocol.h"
+#include "Common/CommonData.h"
+#include "Common/Affinity.h"
+#include "Common/Probes.h"
+#include "Common/RecordFilter.h"
+#include "Session.h"
+#include "Relay.h"
+#include "ReceiveLoop.h"
+
+// System headers
+#include <fcntl.h>
+#include <unistd.h>
 
 // Standard headers
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
 #include <thread>
 #include <array>
 #include <iostream>
 #include <list>
+#include <optional>
+#include <memory>
+
+
+namespace
+{
+    /// Hand-off messages: the listening socket is offered with the first, and the
+    /// replacement receiver confirms with the second that it holds it.
+    constexpr char HANDOFF_OFFER = 'L';
+    constexpr char HANDOFF_TAKEN = 'A';
+
+    /// How long connections cut off at shutdown get to read out what the kernel holds for them
+    constexpr auto CUT_OFF_GRACE = std::chrono::milliseconds(100);
+
+    /// Marks the end of a captured connection, however serving it ends
+    struct CaptureEnd
+    {
+        CaptureEnd(Common::TrafficCapture& _capture, uint32_t _connection)
+            : capture(_capture)
+            , connection(_connection)
+        {
+        }
+
+        ~CaptureEnd()
+        {
+            try
+            {
+                capture.close(connection);
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << e.what() << std::endl;
+            }
+        }
+
+        Common::TrafficCapture& capture;
+        uint32_t                connection;
+    };
+}
 
 
 //-----------------------------------------------------------------------------
-void Receiver::execute(const std::string& addr, uint16_t port, Handler handler)
+Receiver::Receiver()
+    : Receiver(Config{})
 {
-    Common::Socket listenSocket(addr, port);
-    listenSocket.bind();
-    listenSocket.listen();
-    
-    std::list<std::thread> threads;
+}
 
-    for (;;)
+//-----------------------------------------------------------------------------
+Receiver::Receiver(const Config& config)
+    : mConfig(config)
+{
+    // Non-blocking, so execute() can empty it without waiting.
+    if (pipe2(mStopPipe, O_CLOEXEC | O_NONBLOCK) < 0)
+    {
+        throw Exception(std::string("Cannot create pipe: ") + std::strerror(errno));
+    }
+
+    // Made before execute() pins any thread, so the arena's pages lie on the node this thread
+    // runs on. Queues taken from it stay there, rather than being moved to their connection's.
+    if (mConfig.arenaBytes > 0)
     {
-        auto recvSocket = listenSocket.accept();
-        if (recvSocket)
+        mArena = std::make_unique<Common::BufferArena>(mConfig.arenaBytes, mConfig.arenaPrefault);
+    }
+}
+
+//-----------------------------------------------------------------------------
+Receiver::~Receiver()
+{
+    close(mStopPipe[0]);
+    close(mStopPipe[1]);
+}
+
+//-----------------------------------------------------------------------------
+Receiver::CommandLineData Receiver::parseCommandLine(int argc, const char* const* argv)
+{
+    CommandLineData data;
+    data.listen = Common::Endpoint{SERVER_ADDR, SERVER_PORT};
+
+    for (int input = 1; input < argc; ++input)
+    {
+        if (std::strcmp(argv[input], "--profile") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--profile requires a name.");
+            }
+
+            auto profile = Common::SocketOptions::profile(argv[input]);
+            if (!profile)
+            {
+                throw Exception(std::string("Unknown profile: ") + argv[input]);
+            }
+
+            data.config.socketOptions = profile.value();
+        }
+        else if (std::strcmp(argv[input], "--listen") == 0)
         {
-            // Fire off a worker thread to handle the connection
+            if (++input >= argc)
+            {
+                throw Exception("--listen requires an address.");
+            }
 
-            auto data = std::make_unique<ConnThreadData>(
-                std::move(recvSocket.value()),
-                handler
-            );
+            auto endpoint = Common::Endpoint::parse(argv[input], SERVER_PORT);
+            if (!endpoint)
+            {
+                throw Exception(std::string("Invalid listen address: ") + argv[input]);
+            }
+
+            data.listen = endpoint.value();
+        }
+        else if (std::strcmp(argv[input], "--forward") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--forward requires an address.");
+            }
+
+            auto endpoint = Common::Endpoint::parse(argv[input], SERVER_PORT);
+            if (!endpoint)
+            {
+                throw Exception(std::string("Invalid forwarding address: ") + argv[input]);
+            }
+
+            data.config.forwardTo.push_back(endpoint.value());
+        }
+        else if (std::strcmp(argv[input], "--output-dir") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--output-dir requires a directory.");
+            }
+
+            data.config.outputDirectory = argv[input];
+        }
+        else if (std::strcmp(argv[input], "--wal-dir") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--wal-dir requires a directory.");
+            }
+
+            data.config.walDirectory = argv[input];
+        }
+        else if (std::strcmp(argv[input], "--chunk-dir") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--chunk-dir requires a directory.");
+            }
+
+            data.config.chunkDirectory = argv[input];
+        }
+        else if (std::strcmp(argv[input], "--capture") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--capture requires a file.");
+            }
+
+            data.config.capturePath = argv[input];
+        }
+        else if (std::strcmp(argv[input], "--push-filter") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--push-filter requires a clause.");
+            }
+
+            // Clauses accumulate; each is checked here rather than by every sender.
+            try
+            {
+                Common::RecordFilter check{argv[input]};
+            }
+            catch (const Common::RecordFilter::Exception& e)
+            {
+                throw Exception(std::string("Invalid --push-filter: ") + e.what());
+            }
+
+            data.config.pushFilter += argv[input];
+            data.config.pushFilter += '\n';
+        }
+        else if (std::strcmp(argv[input], "--handoff-socket") == 0
+                 || std::strcmp(argv[input], "--take-over") == 0)
+        {
+            auto option = argv[input];
+            if (++input >= argc)
+            {
+                throw Exception(std::string(option) + " requires a path.");
+            }
+
+            if (std::strcmp(option, "--handoff-socket") == 0)
+            {
+                data.config.handoffPath = argv[input];
+            }
+            else
+            {
+                data.config.takeOverPath = argv[input];
+            }
+        }
+        else if (std::strcmp(argv[input], "--accept-cpus") == 0
+                 || std::strcmp(argv[input], "--io-cpus") == 0
+                 || std::strcmp(argv[input], "--handler-cpus") == 0)
+        {
+            auto option = argv[input];
+            if (++input >= argc)
+            {
+                throw Exception(std::string(option) + " requires a CPU list.");
+            }
+
+            auto cpus = Common::Affinity::parseCpuList(argv[input]);
+            if (!cpus)
+            {
+                throw Exception(std::string("Invalid CPU list for ") + option + ": " + argv[input]);
+            }
+
+            if (std::strcmp(option, "--accept-cpus") == 0)
+            {
+                data.config.acceptCpus = cpus.value();
+            }
+            else if (std::strcmp(option, "--io-cpus") == 0)
+            {
+                data.config.ioCpus = cpus.value();
+            }
+            else
+            {
+                data.config.handlerCpus = cpus.value();
+            }
+        }
+        else if (std::strcmp(argv[input], "--incoming-cpu") == 0)
+        {
+            data.config.followIncomingCpu = true;
+        }
+        else if (std::strcmp(argv[input], "--echo") == 0)
+        {
+            data.config.echo = true;
+        }
+        else if (std::strcmp(argv[input], "--no-prefault") == 0)
+        {
+            data.config.arenaPrefault = false;
+        }
+        else if (std::strcmp(argv[input], "--checkpoint-bytes") == 0
+                 || std::strcmp(argv[input], "--queue-bytes") == 0
+                 || std::strcmp(argv[input], "--forward-queue-bytes") == 0
+                 || std::strcmp(argv[input], "--forward-stall-ms") == 0
+                 || std::strcmp(argv[input], "--wal-segment-bytes") == 0
+                 || std::strcmp(argv[input], "--wal-commit-bytes") == 0
+                 || std::strcmp(argv[input], "--wal-commit-us") == 0
+                 || std::strcmp(argv[input], "--drain-ms") == 0
+                 || std::strcmp(argv[input], "--arena-bytes") == 0
+                 || std::strcmp(argv[input], "--busy-poll-us") == 0
+                 || std::strcmp(argv[input], "--fifo-priority") == 0)
+        {
+            auto option = argv[input];
+            if (++input >= argc)
+            {
+                throw Exception(std::string(option) + " requires a number.");
+            }
 
-            // Ownership of 'data' is transferred to the thread.
-            threads.push_back(std::thread(_connectionThread, std::move(data)));
+            char* end = nullptr;
+            auto value = std::strtoull(argv[input], &end, 10);
+            if (end == argv[input] || *end != '\0' || value == 0)
+            {
+                throw Exception(std::string("Invalid number for ") + option + ": " + argv[input]);
+            }
+
+            if (std::strcmp(option, "--checkpoint-bytes") == 0)
+            {
+                data.config.checkpointInterval = value;
+            }
+            else if (std::strcmp(option, "--queue-bytes") == 0)
+            {
+                data.config.queueBytes = value;
+            }
+            else if (std::strcmp(option, "--forward-queue-bytes") == 0)
+            {
+                data.config.forwardQueueBytes = value;
+            }
+            else if (std::strcmp(option, "--forward-stall-ms") == 0)
+            {
+                data.config.forwardStall = std::chrono::milliseconds(value);
+            }
+            else if (std::strcmp(option, "--wal-segment-bytes") == 0)
+            {
+                data.config.walSegmentBytes = value;
+            }
+            else if (std::strcmp(option, "--wal-commit-bytes") == 0)
+            {
+                data.config.walCommitBytes = value;
+            }
+            else if (std::strcmp(option, "--wal-commit-us") == 0)
+            {
+                data.config.walCommitDelay = std::chrono::microseconds(value);
+            }
+            else if (std::strcmp(option, "--drain-ms") == 0)
+            {
+                data.config.drainTimeout = std::chrono::milliseconds(value);
+            }
+            else if (std::strcmp(option, "--arena-bytes") == 0)
+            {
+                data.config.arenaBytes = value;
+            }
+            else if (std::strcmp(option, "--busy-poll-us") == 0)
+            {
+                data.config.busyPollBudget = std::chrono::microseconds(value);
+            }
+            else if (value > 99)
+            {
+                throw Exception(std::string("--fifo-priority must be 1 to 99: ") + argv[input]);
+            }
+            else
+            {
+                data.config.fifoPriority = static_cast<int>(value);
+            }
         }
         else
         {
-            break;
+            throw Exception(std::string("Unknown option: ") + argv[input]);
+        }
+    }
+
+    return data;
+}
+
+//-----------------------------------------------------------------------------
+void Receiver::setStreamHandlers(StreamHandlerFactory factory)
+{
+    mStreamHandlers = std::move(factory);
+}
+
+//-----------------------------------------------------------------------------
+void Receiver::execute(const std::string& addr, uint16_t port, Handler handler)
+{
+    if (!mConfig.outputDirectory.empty() && !mStore)
+    {
+        mStore = std::make_unique<CheckpointStore>(mConfig.outputDirectory);
+    }
+
+    if (!mConfig.walDirectory.empty() && !mWal)
+    {
+        mWal = std::make_unique<WriteAheadLog>(mConfig.walDirectory, mConfig.walSegmentBytes,
+                                               mConfig.walCommitBytes, mConfig.walCommitDelay);
+    }
+
+    if (!mConfig.chunkDirectory.empty() && !mChunks)
+    {
+        mChunks = std::make_unique<ChunkStore>(mConfig.chunkDirectory);
+    }
+
+    if (!mConfig.capturePath.empty() && !mCapture)
+    {
+        mCapture = std::make_unique<Common::TrafficCapture>(mConfig.capturePath);
+    }
+
+    if (!mConfig.acceptCpus.empty() && !Common::Affinity::pin(mConfig.acceptCpus))
+    {
+        std::cerr << "Cannot pin the accepting thread; not pinned." << std::endl;
+    }
+
+    std::optional<Common::Socket> listenSocket;
+    if (!mConfig.takeOverPath.empty())
+    {
+        // Already bound and listening, with its options set.
+        listenSocket.emplace(_takeOver());
+    }
+    else
+    {
+        listenSocket.emplace(addr, port);
+
+        for (const auto& option : listenSocket->setOptions(mConfig.socketOptions))
+        {
+            std::cerr << option << " is not available here; skipped." << std::endl;
+        }
+
+        listenSocket->bind();
+        listenSocket->listen();
+    }
+
+    std::thread handoffThread;
+    if (!mConfig.handoffPath.empty())
+    {
+        mHandoff = std::make_unique<Common::UnixSocket>(mConfig.handoffPath);
+        mHandoff->bind();
+        mHandoff->listen();
+        handoffThread = std::thread(&Receiver::_offerHandoff, this, std::ref(listenSocket.value()));
+    }
+
+    // Connections cut off at shutdown drop what they still hold rather than handle it.
+    const auto gatedHandler = _gate(std::move(handler));
+
+    StreamHandlerFactory streamHandlers;
+    if (mStreamHandlers)
+    {
+        streamHandlers = [this, factory = mStreamHandlers](uint16_t stream, const std::string& name)
+        {
+            return _gate(factory(stream, name));
+        };
+    }
+
+    std::exception_ptr error;
+
+    try
+    {
+        while (listenSocket->waitAcceptable(mStopPipe[0]))
+        {
+            auto recvSocket = listenSocket->accept();
+            if (!recvSocket)
+            {
+                // Another process sharing the socket took the connection.
+                continue;
+            }
+
+            // Most options are inherited from the listening socket, but not all (e.g. TCP_QUICKACK).
+            // A connection that will not take them is dropped; the others are still served.
+            try
+            {
+                recvSocket->setOptions(mConfig.socketOptions);
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << "Cannot set the options of a connection (" << e.what() << "); dropped."
+                          << std::endl;
+                continue;
+            }
+
+            const auto cpu = _place(recvSocket.value());
+
+            // Hand the connection to an idle worker, or start one if all are busy
+
+            std::lock_guard<std::mutex> lock(mConnectionsMutex);
+
+            Connection* worker;
+            if (mIdle.empty())
+            {
+                worker = &mWorkers.emplace_back();
+                worker->thread = std::thread(&Receiver::_connectionThread, this, worker);
+                mIdle.reserve(mWorkers.size());
+            }
+            else
+            {
+                worker = mIdle.back();
+                mIdle.pop_back();
+            }
+
+            worker->data.emplace(
+                std::move(recvSocket.value()),
+                gatedHandler,
+                streamHandlers,
+                mStore.get(),
+                mWal.get(),
+                mChunks.get(),
+                mArena.get(),
+                mCapture.get(),
+                mConfig
+            );
+            worker->data->cpu = cpu;
+            ++mServing;
+
+            worker->assigned.notify_one();
         }
     }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    // Take what stop() wrote, so that a later execute() runs until it is stopped again.
+    char stopped[16];
+    while (read(mStopPipe[0], stopped, sizeof(stopped)) > 0)
+    {
+    }
 
-    // Join all of the threads before exiting.
-    for (auto& t : threads)
+    // Withdraw the offer of the listening socket, unless it has been taken.
     {
-        if (t.joinable())
+        std::lock_guard<std::mutex> lock(mHandoffMutex);
+        if (mHandoff)
         {
-            t.join();
+            mHandoff->shutdown();
         }
     }
+
+    if (handoffThread.joinable())
+    {
+        handoffThread.join();
+    }
+    mHandoff.reset();
+
+    // Stop accepting. A replacement receiver holds the socket open if it was handed over.
+    listenSocket.reset();
+
+    _drain();
+
+    // Flush and close what the connections wrote to.
+    mWal.reset();
+    mStore.reset();
+    mChunks.reset();
+
+    if (mCapture)
+    {
+        mReport.captured = mCapture->stats();
+        mCapture.reset();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void Receiver::stop() noexcept
+{
+    const char stop = 0;
+    while (write(mStopPipe[1], &stop, sizeof(stop)) < 0 && errno == EINTR)
+    {
+    }
+}
+
+//-----------------------------------------------------------------------------
+const Receiver::ShutdownReport& Receiver::shutdownReport() const noexcept
+{
+    return mReport;
 }
 
 //-----------------------------------------------------------------------------
@@ -65,29 +561,196 @@ void Receiver::execute(const std::string& addr, uint16_t port, Handler handler)
 
 /**
  * @internal
- * @brief Thread to process the data coming in over the connected socket
- * @param[in] data      - A reference to an object containing information for the thread.
+ * @brief Worker thread, serving each connection it is assigned until the receiver closes
+ * @param[in] worker    - The worker's entry
+ */
+void Receiver::_connectionThread(Connection* worker)
+{
+    if (!mConfig.acceptCpus.empty())
+    {
+        // Started by the accepting thread, whose placement it would otherwise keep.
+        Common::Affinity::pin(std::vector<int>());
+    }
+
+    if (mConfig.fifoPriority > 0 && !Common::Affinity::setRealtime(mConfig.fifoPriority))
+    {
+        std::cerr << "Cannot run a connection thread under SCHED_FIFO (needs CAP_SYS_NICE)" << std::endl;
+    }
+
+    std::unique_lock<std::mutex> lock(mConnectionsMutex);
+
+    for (;;)
+    {
+        worker->assigned.wait(lock, [this, worker]() { return worker->data || mClosing; });
+        if (!worker->data)
+        {
+            break;
+        }
+
+        lock.unlock();
+
+        auto cpu = worker->data->cpu;
+        if (cpu < 0 && mConfig.busyPollBudget.count() > 0)
+        {
+            // A thread that spins must not be moved, or it takes its spinning elsewhere.
+            cpu = worker->cpu >= 0 ? worker->cpu : Common::Affinity::currentCpu();
+        }
+
+        if (cpu != worker->cpu)
+        {
+            // Moved before anything of the connection's is touched here.
+            if (cpu >= 0)
+            {
+                Common::Affinity::pin(cpu);
+            }
+            else
+            {
+                Common::Affinity::pin(std::vector<int>());
+            }
+            worker->cpu = cpu;
+        }
+
+        _serve(worker->data.value());
+        lock.lock();
+
+        // Closes the socket, so it must not be cut off from here on.
+        worker->data.reset();
+        mIdle.push_back(worker);
+        --mServing;
+
+        mConnectionEnded.notify_all();
+    }
+}
+
+/**
+ * @internal
+ * @brief Serve a connection until the peer disconnects (or it is cut off)
+ * @param[in] data      - The connection, and what it needs to be served
  */
-void Receiver::_connectionThread(std::unique_ptr<ConnThreadData> data)
+void Receiver::_serve(ConnThreadData& data)
 {
-    auto& recvSocket = data->recvSocket;
-    auto& handler = data->handler;
+    auto& recvSocket = data.recvSocket;
+
+    // Recorded on its way to the handler, under a number of its own, with its end marked however
+    // the connection ends. Each stream of a framed connection is recorded as a connection of its
+    // own, numbered as it opens and ended as its handler is let go, so that a replay sends each
+    // stream's data whole rather than interleaved with the others'.
+    std::optional<CaptureEnd> captureEnd;
+    Handler captured;
+    StreamHandlerFactory capturedStreams;
+    if (data.capture)
+    {
+        captured = [&captureEnd, &handler = data.handler](const void* buffer, size_t len)
+        {
+            captureEnd->capture.append(captureEnd->connection, buffer, len);
+            handler(buffer, len);
+        };
+
+        capturedStreams = [&data](uint16_t stream, const std::string& name) -> Handler
+        {
+            auto end = std::make_shared<CaptureEnd>(*data.capture, data.capture->open());
+            auto handler = data.streamHandlers ? data.streamHandlers(stream, name) : data.handler;
+            return [end, handler](const void* buffer, size_t len)
+            {
+                end->capture.append(end->connection, buffer, len);
+                handler(buffer, len);
+            };
+        };
+    }
+    const auto& handler = data.capture ? captured : data.handler;
+    const auto& streamHandlers = data.capture ? capturedStreams : data.streamHandlers;
 
     try
     {
-        // Receive connections forever
-        for (;;)
+        constexpr size_t BUFFER_SIZE = 1024;
+        std::array<char, BUFFER_SIZE> buffer;
+
+        auto first = recvSocket.recv(buffer.data(), buffer.size());
+        if (!first)
         {
-            constexpr size_t BUFFER_SIZE = 1024;
-            std::array<char, BUFFER_SIZE> buffer;
+            return;
+        }
 
-            auto received = recvSocket.recv(buffer.data(), buffer.size());
-            if (!received)
+        // A sender that wants framing opens with a Hello header (see Common/Protocol.h). Anything
+        // else is raw data, delivered as it came, even if it starts out like one.
+        size_t received = first.value();
+        auto hello = Common::Protocol::matchHello(buffer.data(), received);
+        while (hello == Common::Protocol::HelloMatch::Partial)
+        {
+            auto more = recvSocket.recv(buffer.data() + received, buffer.size() - received);
+            if (!more)
             {
                 break;
             }
 
-            handler(buffer.data(), received.value());
+            received += more.value();
+            hello = Common::Protocol::matchHello(buffer.data(), received);
+        }
+
+        if (hello == Common::Protocol::HelloMatch::Match)
+        {
+            if (!data.config.forwardTo.empty())
+            {
+                std::cerr << "Framed connections are served here, not forwarded." << std::endl;
+            }
+
+            Session session(recvSocket, data.handler, streamHandlers, data.store, data.wal,
+                            data.chunks, data.arena, data.config);
+            session.run(buffer.data(), received);
+            return;
+        }
+
+        if (data.capture)
+        {
+            captureEnd.emplace(*data.capture, data.capture->open());
+        }
+
+        if (!data.config.forwardTo.empty())
+        {
+            // Relay the connection to the next tier as well as handling it here.
+            Relay relay(data.config.forwardTo, data.config.forwardQueueBytes, data.config.forwardStall,
+                        data.config.socketOptions);
+
+            relay.forward(buffer.data(), received);
+            handler(buffer.data(), received);
+
+            relay.run(recvSocket, handler);
+
+            for (const auto& hop : relay.finish())
+            {
+                std::cerr << "forwarded to " << hop.downstream << ": " << hop.bytesForwarded << " bytes,"
+                          << " added latency " << hop.averageLatency.count() << " us avg, "
+                          << hop.maxLatency.count() << " us max"
+                          << (hop.cutOff ? " (cut off)" : "") << std::endl;
+            }
+            return;
+        }
+
+        // Round trips are measured from the sender; each piece goes back as soon as it arrives.
+        Handler echo;
+        if (data.config.echo)
+        {
+            // Each echo is sent at once, not held back by Nagle until the last one is acknowledged.
+            Common::SocketOptions options;
+            options.noDelay = true;
+            recvSocket.setOptions(options);
+
+            echo = [&recvSocket](const void* buffer, size_t len)
+            {
+                recvSocket.send(buffer, len);
+            };
+        }
+        const auto& target = data.config.echo ? echo : handler;
+
+        // Receive until the peer disconnects
+        if (data.config.busyPollBudget.count() > 0)
+        {
+            receiveAll(Transport::BusyPoll{recvSocket, data.config.busyPollBudget}, target,
+                       buffer.data(), received);
+        }
+        else
+        {
+            receiveAll(Transport::Tcp{recvSocket}, target, buffer.data(), received);
         }
     }
     catch (const std::exception& e)
@@ -96,3 +759,208 @@ void Receiver::_connectionThread(std::unique_ptr<ConnThreadData> data)
     }
 }
 
+/**
+ * @internal
+ * @brief Wrap a handler so that nothing more reaches it once connections are cut off
+ * @param[in] handler   - The handler to wrap
+ * @return A handler that counts what it drops after the cut-off
+ */
+Receiver::Handler Receiver::_gate(Handler handler)
+{
+    return [this, handler = std::move(handler)](const void* buffer, size_t len)
+    {
+        if (mCutOff.load(std::memory_order_relaxed))
+        {
+            mDropped += len;
+            return;
+        }
+
+        NS_PROBE2(handler_entry, buffer, len);
+        handler(buffer, len);
+        NS_PROBE2(handler_return, buffer, len);
+    };
+}
+
+/**
+ * @internal
+ * @brief Choose the CPU to serve a connection on
+ * @param[in] recvSocket    - The accepted connection
+ * @return One of Config::ioCpus, the connection's incoming CPU, or -1 to serve it anywhere
+ */
+int Receiver::_place(const Common::Socket& recvSocket)
+{
+    const auto& cpus = mConfig.ioCpus;
+
+    if (mConfig.followIncomingCpu)
+    {
+        if (auto incoming = recvSocket.incomingCpu())
+        {
+            if (cpus.empty() || std::find(cpus.begin(), cpus.end(), incoming.value()) != cpus.end())
+            {
+                return incoming.value();
+            }
+
+            // Not one of ours: the next of ours on the same node, if any.
+            const auto node = Common::Affinity::nodeOf(incoming.value());
+            for (size_t step = 0; step < cpus.size(); ++step)
+            {
+                const auto cpu = cpus[(mNextCpu + step) % cpus.size()];
+                if (Common::Affinity::nodeOf(cpu) == node)
+                {
+                    mNextCpu += step + 1;
+                    return cpu;
+                }
+            }
+        }
+    }
+
+    if (cpus.empty())
+    {
+        return -1;
+    }
+
+    return cpus[mNextCpu++ % cpus.size()];
+}
+
+/**
+ * @internal
+ * @brief Give open connections the drain timeout to finish, then cut off the rest
+ */
+void Receiver::_drain()
+{
+    std::unique_lock<std::mutex> lock(mConnectionsMutex);
+
+    const auto open = mServing;
+
+    mConnectionEnded.wait_for(lock, mConfig.drainTimeout, [this]() { return mServing == 0; });
+
+    // Shutting the receiving side down wakes their workers, which read out what the kernel still
+    // holds; whatever reaches a handler after this is dropped, and counted.
+    mCutOff = true;
+    for (auto& worker : mWorkers)
+    {
+        if (worker.data)
+        {
+            worker.data->recvSocket.shutdownRead();
+            ++mReport.connectionsCutOff;
+        }
+    }
+    mReport.connectionsFinished = open - mReport.connectionsCutOff;
+
+    // A worker stuck sending (e.g. echoing to a peer that does not read) is woken outright.
+    mConnectionEnded.wait_for(lock, CUT_OFF_GRACE, [this]() { return mServing == 0; });
+    for (auto& worker : mWorkers)
+    {
+        if (worker.data)
+        {
+            worker.data->recvSocket.shutdown();
+        }
+    }
+
+    // Workers exit once they are done with their connections.
+    mClosing = true;
+    for (auto& worker : mWorkers)
+    {
+        worker.assigned.notify_one();
+    }
+    lock.unlock();
+
+    for (auto& worker : mWorkers)
+    {
+        worker.thread.join();
+    }
+
+    mWorkers.clear();
+    mIdle.clear();
+
+    mReport.bytesDropped = mDropped;
+    mReport.handedOff = mHandedOff;
+}
+
+/**
+ * @internal
+ * @brief Take the listening socket from the receiver offering it at Config::takeOverPath
+ * @return The listening socket
+ */
+Common::Socket Receiver::_takeOver()
+{
+    Common::UnixSocket predecessor(mConfig.takeOverPath);
+    predecessor.connect();
+
+    char offer = 0;
+    int fd = -1;
+    auto received = predecessor.recv(&offer, sizeof(offer), fd);
+    if (!received || offer != HANDOFF_OFFER || fd < 0)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+
+        throw Exception("No listening socket was handed over at " + mConfig.takeOverPath);
+    }
+
+    std::optional<Common::Socket> listenSocket;
+    try
+    {
+        listenSocket.emplace(Common::Socket::adopt(fd));
+    }
+    catch (...)
+    {
+        close(fd);
+        throw;
+    }
+
+    // The predecessor keeps accepting until it hears this.
+    predecessor.send(&HANDOFF_TAKEN, sizeof(HANDOFF_TAKEN));
+
+    return std::move(listenSocket.value());
+}
+
+/**
+ * @internal
+ * @brief Thread to offer the listening socket to a replacement receiver, and stop once it is taken
+ * @param[in] listenSocket  - The socket to offer
+ */
+void Receiver::_offerHandoff(Common::Socket& listenSocket)
+{
+    try
+    {
+        auto successor = mHandoff->accept();
+        if (!successor)
+        {
+            // Withdrawn: the receiver is stopping.
+            return;
+        }
+
+        {
+            // Give up the path, so that the successor can offer hand-off there in turn. It cannot
+            // bind the path before it has the socket, which is sent after this.
+            std::lock_guard<std::mutex> lock(mHandoffMutex);
+            mHandoff.reset();
+        }
+
+        successor->send(&HANDOFF_OFFER, sizeof(HANDOFF_OFFER), listenSocket.descriptor());
+
+        char reply = 0;
+        int fd = -1;
+        auto received = successor->recv(&reply, sizeof(reply), fd);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+
+        if (received && reply == HANDOFF_TAKEN)
+        {
+            mHandedOff = true;
+            stop();
+            return;
+        }
+
+        std::cerr << "The replacement receiver did not take the listening socket; still serving." << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Hand-off failed: " << e.what() << std::endl;
+    }
+}
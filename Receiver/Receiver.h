@@ -10,11 +10,28 @@
 #pragma once
 
 #include "Common/Socket.h"
+#include "Common/UnixSocket.h"
+#include "Common/SocketOptions.h"
+#include "Common/Endpoint.h"
+#include "Common/BufferArena.h"
+#include "Common/TrafficCapture.h"
+#include "CheckpointStore.h"
+#include "WriteAheadLog.h"
+#include "ChunkStore.h"
 
 #include <string>
+#include <vector>
 #include <stdint.h>
 #include <functional>
 #include <memory>
+#include <chrono>
+#include <exception>
+#include <list>
+#include <optional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 class Receiver
 {
@@ -24,32 +41,233 @@ class Receiver
 public: // Definitions
     using Handler = std::function<void(const void* buffer, size_t len)>;
 
+    /// Makes the handler for one stream of a framed connection, given its id and name
+    using StreamHandlerFactory = std::function<Handler(uint16_t stream, const std::string& name)>;
+
+    class Exception;
+    struct CommandLineData;
+
+    static constexpr uint64_t DEFAULT_CHECKPOINT_INTERVAL = 4 * 1024 * 1024;
+    static constexpr size_t DEFAULT_QUEUE_BYTES = 4 * 1024 * 1024;
+    static constexpr size_t DEFAULT_FORWARD_QUEUE_BYTES = 1024 * 1024;
+    static constexpr std::chrono::milliseconds DEFAULT_FORWARD_STALL{1000};
+    static constexpr uint64_t DEFAULT_WAL_SEGMENT_BYTES = 64 * 1024 * 1024;
+    static constexpr size_t DEFAULT_WAL_COMMIT_BYTES = 1024 * 1024;
+    static constexpr std::chrono::microseconds DEFAULT_WAL_COMMIT_DELAY{2000};
+    static constexpr std::chrono::milliseconds DEFAULT_DRAIN_TIMEOUT{5000};
+
+    /// Settings for a Receiver
+    struct Config
+    {
+        Common::SocketOptions   socketOptions;      ///< Tuning for the listening and accepted sockets
+        std::string             outputDirectory;    ///< Where resumable transfers are kept (empty: not kept)
+        uint64_t                checkpointInterval{DEFAULT_CHECKPOINT_INTERVAL};    ///< Bytes between checkpoints
+        size_t                  queueBytes{DEFAULT_QUEUE_BYTES};    ///< Per-stream data awaiting the handler (framed connections)
+        std::vector<Common::Endpoint>   forwardTo;  ///< Receivers to relay unframed connections to (see Relay)
+        size_t                  forwardQueueBytes{DEFAULT_FORWARD_QUEUE_BYTES};    ///< Per-downstream queue bound
+        std::chrono::milliseconds   forwardStall{DEFAULT_FORWARD_STALL};    ///< How long a full queue may wait before its receiver is cut off
+        std::string             walDirectory;       ///< Where framed data is logged before it is acknowledged (empty: not logged)
+        uint64_t                walSegmentBytes{DEFAULT_WAL_SEGMENT_BYTES};     ///< Preallocated size of each log segment
+        size_t                  walCommitBytes{DEFAULT_WAL_COMMIT_BYTES};       ///< Pending bytes that start a commit early
+        std::chrono::microseconds   walCommitDelay{DEFAULT_WAL_COMMIT_DELAY};   ///< Longest wait for a group to form
+        std::string             chunkDirectory;     ///< Where chunks are kept for deduplicated transfers (empty: none)
+        std::chrono::milliseconds   drainTimeout{DEFAULT_DRAIN_TIMEOUT};    ///< How long open connections may take to finish once stopping
+        std::string             handoffPath;        ///< Where to offer the listening socket to a replacement receiver (empty: not offered)
+        std::string             takeOverPath;       ///< Take the listening socket from the receiver offering it here, rather than binding one
+        std::vector<int>        acceptCpus;         ///< CPUs for the thread that accepts connections (empty: not pinned)
+        std::vector<int>        ioCpus;             ///< CPUs for connection threads, one each in turn (empty: not pinned)
+        std::vector<int>        handlerCpus;        ///< CPUs for framed streams' handlers (empty: those of the connection's node, if it is pinned)
+        bool                    followIncomingCpu{false};   ///< Serve each connection on the CPU its packets arrive on (SO_INCOMING_CPU)
+        std::chrono::microseconds   busyPollBudget{0};  ///< How long connection threads spin for data before sleeping (0: they sleep at once)
+        int                     fifoPriority{0};    ///< Run connection threads under SCHED_FIFO at this priority (0: not)
+        bool                    echo{false};        ///< Send unframed data straight back to its sender, instead of to the handler (for sender --ping-pong)
+        size_t                  arenaBytes{0};      ///< Huge pages to take stream queues from (0: the heap)
+        bool                    arenaPrefault{true};    ///< Fault the arena's pages in at construction
+        std::string             capturePath;        ///< Where to record what connections (and framed streams, each on its own) hand the handler, for sender --replay (empty: not recorded)
+        std::string             pushFilter;         ///< A Common::RecordFilter for senders to apply to framed streams (empty: every record is wanted)
+    };
+
+    /// What became of the connections open when a Receiver stopped
+    struct ShutdownReport
+    {
+        size_t      connectionsFinished{0};     ///< Connections that ended by themselves within the drain timeout
+        size_t      connectionsCutOff{0};       ///< Connections still open at the drain timeout, and cut off
+        uint64_t    bytesDropped{0};            ///< Data received but not handled, because its connection was cut off
+        bool        handedOff{false};           ///< The listening socket went to a replacement receiver
+        Common::TrafficCapture::Stats   captured;   ///< What was recorded to Config::capturePath
+    };
+
 public: // Methods
-    Receiver() = default;
-    virtual ~Receiver() = default;
+    Receiver();
 
     /**
-     * @brief Execute the receive operation
+     * @brief Construct a Receiver with the given settings
+     * @param[in] config    - The settings to use
+     * @throws Exception if the stop pipe cannot be made
+     * @throws Common::BufferArena::Exception if an arena is asked for and cannot be mapped
+     */
+    explicit Receiver(const Config& config);
+
+    virtual ~Receiver();
+
+    /**
+     * @brief Parse the command line
+     * @param[in] argc      - The command line argc
+     * @param[in] argv      - The command line argv
+     * @throws Exception on an invalid option
+     */
+    static CommandLineData parseCommandLine(int argc, const char* const* argv);
+
+    /**
+     * @brief Give each stream of a framed connection a handler of its own
+     * @details Without this, every stream shares the handler passed to execute(), and data from
+     *          streams multiplexed onto one connection reaches it interleaved.
+     * @param[in] factory   - Called as each stream opens
+     */
+    void setStreamHandlers(StreamHandlerFactory factory);
+
+    /**
+     * @brief Execute the receive operation, until stop() is called or the listening socket is
+     *          handed over to a replacement receiver
      * @param[in] addr      - The IP address on which to listen
      * @param[in] port      - The port on which to listen
      * @param[in] handler   - A handler function to be called repeatedly received data
+     * @details On stopping, no more connections are accepted. Those already open are given the
+     *          drain timeout to finish, their queued data reaching the handlers as usual, and are
+     *          then cut off; what they still held is dropped and counted (see shutdownReport()).
+     *          The log and stores are then flushed and closed.
+     *
+     *          With Config::handoffPath set, a replacement receiver started with
+     *          Config::takeOverPath naming the same path is passed the listening socket itself
+     *          (SCM_RIGHTS). Connections waiting to be accepted carry over to it, so none are
+     *          refused across the restart, and this receiver then stops as above.
+     *
+     *          With Config::acceptCpus set, the calling thread is pinned to them, and stays so.
+     *          With Config::ioCpus set, each connection is served by a thread pinned to one of
+     *          them, taken in turn. With Config::followIncomingCpu, a connection is served on the
+     *          CPU that its packets arrive on instead (when that is one of Config::ioCpus, or any
+     *          CPU if none are given), so that the receive queue, the socket and the thread
+     *          reading it share a CPU and its caches.
+     *
+     *          With Config::busyPollBudget set, unframed connections are read without sleeping
+     *          for up to that long at a time (see Transport::BusyPoll), on threads pinned to a
+     *          CPU (the one they were on, if Config::ioCpus does not say), so that data reaches
+     *          the handler without a wakeup in between.
      */
     void execute(const std::string& addr, uint16_t port, Handler handler);
 
+    /**
+     * @brief Stop accepting connections, and have execute() return once those open have drained
+     * @details Only writes to a pipe, so it is safe to call from a signal handler.
+     */
+    void stop() noexcept;
+
+    /// @brief What became of the open connections, once execute() has returned
+    const ShutdownReport& shutdownReport() const noexcept;
+
 private: // Definitions
+    /// A connection, and what it needs to be served. The handlers are the receiver's own, held
+    /// for as long as it runs, so nothing is copied per connection.
     struct ConnThreadData
     {
-        ConnThreadData(Common::Socket&& _recvSocket, const Handler& _handler)
+        ConnThreadData(Common::Socket&& _recvSocket, const Handler& _handler,
+                       const StreamHandlerFactory& _streamHandlers, CheckpointStore* _store,
+                       WriteAheadLog* _wal, ChunkStore* _chunks, Common::BufferArena* _arena,
+                       Common::TrafficCapture* _capture, const Config& _config)
             : recvSocket(std::move(_recvSocket))
             , handler(_handler)
+            , streamHandlers(_streamHandlers)
+            , store(_store)
+            , wal(_wal)
+            , chunks(_chunks)
+            , arena(_arena)
+            , capture(_capture)
+            , config(_config)
         {
         }
 
         Common::Socket recvSocket;
-        Handler handler;
+        int cpu{-1};                        ///< Where to serve it (-1: anywhere)
+        const Handler& handler;
+        const StreamHandlerFactory& streamHandlers;
+        CheckpointStore* store;
+        WriteAheadLog* wal;
+        ChunkStore* chunks;
+        Common::BufferArena* arena;
+        Common::TrafficCapture* capture;
+        const Config& config;
+    };
+
+    /// A worker thread, and the connection it is serving, if any. Workers are kept once started
+    /// and serve one connection after another, so a new connection allocates nothing.
+    struct Connection
+    {
+        std::thread                     thread;
+        std::condition_variable         assigned;       ///< A connection was assigned, or the receiver is closing
+        std::optional<ConnThreadData>   data;           ///< The connection being served
+        int                             cpu{-1};        ///< Where the worker is pinned (-1: not pinned)
     };
 
 private: // Methods
-    static void _connectionThread(std::unique_ptr<ConnThreadData> handler);
+    void _connectionThread(Connection* worker);
+    static void _serve(ConnThreadData& data);
+    Handler _gate(Handler handler);
+    int _place(const Common::Socket& recvSocket);
+    void _drain();
+    Common::Socket _takeOver();
+    void _offerHandoff(Common::Socket& listenSocket);
+
+private: // Members
+    Config                              mConfig;
+    std::unique_ptr<Common::BufferArena>    mArena;         ///< Made up front, and kept for the receiver's life
+    StreamHandlerFactory                mStreamHandlers;
+    std::unique_ptr<CheckpointStore>    mStore;
+    std::unique_ptr<WriteAheadLog>      mWal;
+    std::unique_ptr<ChunkStore>         mChunks;
+    std::unique_ptr<Common::TrafficCapture> mCapture;
+    int                                 mStopPipe[2]{-1, -1};   ///< Written by stop(), to wake the accept loop
+    std::mutex                          mConnectionsMutex;
+    std::condition_variable             mConnectionEnded;
+    std::list<Connection>               mWorkers;           ///< Every worker started (the list keeps them in place)
+    std::vector<Connection*>            mIdle;              ///< Workers waiting for a connection
+    size_t                              mServing{0};        ///< Workers serving a connection
+    bool                                mClosing{false};    ///< Workers are to exit
+    size_t                              mNextCpu{0};        ///< The next of Config::ioCpus to place a connection on
+    std::atomic<bool>                   mCutOff{false};     ///< The drain timeout has passed; handle nothing more
+    std::atomic<uint64_t>               mDropped{0};
+    std::mutex                          mHandoffMutex;
+    std::unique_ptr<Common::UnixSocket> mHandoff;           ///< Where the listening socket is offered, until taken
+    std::atomic<bool>                   mHandedOff{false};
+    ShutdownReport                      mReport;
+};
+
+
+/**
+ * @brief Exceptions on the Receiver class
+ */
+class Receiver::Exception : public std::exception
+{
+public:
+    Exception(const std::string& message)
+        : mMessage(message)
+    {
+    }
+
+    virtual ~Exception() = default;
+
+    virtual const char* what() const noexcept override
+    {
+        return mMessage.c_str();
+    }
+
+private:
+    std::string     mMessage;
+
+}; // class Receiver::Exception
+
+struct Receiver::CommandLineData
+{
+    Config              config;
+    Common::Endpoint    listen;         ///< --listen <addr[:port]>
 };
 
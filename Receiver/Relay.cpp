@@ -0,0 +1,341 @@
+/**
+ * @brief Passes a connection's data on to downstream receivers
+ *
+ * @file Relay.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#include "Relay.h"
+
+// System headers
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+// Standard headers
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+
+//-----------------------------------------------------------------------------
+Relay::Relay(const std::vector<Common::Endpoint>& downstream, size_t queueBytes,
+             std::chrono::milliseconds stallTimeout, const Common::SocketOptions& options)
+    : mStallTimeout(stallTimeout)
+{
+    try
+    {
+        if (pipe2(mIngest, O_CLOEXEC) != 0)
+        {
+            throw Exception(std::string("Cannot make a pipe: ") + std::strerror(errno));
+        }
+
+        for (const auto& endpoint : downstream)
+        {
+            auto hop = std::make_unique<Downstream>(endpoint);
+
+            try
+            {
+                hop->socket.setOptions(options);
+                hop->socket.connect();
+
+                // Only ever written by spliceFrom(), which waits with poll() and must not block.
+                hop->socket.setNonBlocking();
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << "Not forwarding to " << hop->stats.downstream << ": " << e.what() << std::endl;
+                continue;
+            }
+
+            if (pipe2(hop->queue, O_CLOEXEC) != 0)
+            {
+                throw Exception(std::string("Cannot make a pipe: ") + std::strerror(errno));
+            }
+
+            // The pipe is the queue. The kernel rounds the size, and caps it for unprivileged
+            // processes (/proc/sys/fs/pipe-max-size), in which case the default stands.
+            fcntl(hop->queue[1], F_SETPIPE_SZ, static_cast<int>(queueBytes));
+
+            // Writes to the queue must not block; waiting is bounded by the stall timeout instead.
+            fcntl(hop->queue[1], F_SETFL, O_NONBLOCK);
+
+            mDownstream.push_back(std::move(hop));
+        }
+
+        for (auto& hop : mDownstream)
+        {
+            hop->thread = std::thread(_forwardThread, std::ref(*hop));
+        }
+    }
+    catch (...)
+    {
+        finish();
+        throw;
+    }
+}
+
+//-----------------------------------------------------------------------------
+Relay::~Relay()
+{
+    finish();
+}
+
+//-----------------------------------------------------------------------------
+void Relay::forward(const void* buffer, size_t len)
+{
+    const auto taken = std::chrono::steady_clock::now();
+
+    for (auto& hop : mDownstream)
+    {
+        if (hop->queue[1] >= 0)
+        {
+            _push(*hop, static_cast<const char*>(buffer), len, taken);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void Relay::run(Common::Socket& upstream, const Receiver::Handler& handler)
+{
+    std::vector<char> buffer(CHUNK_SIZE);
+    std::vector<size_t> teed(mDownstream.size());
+
+    while (auto moved = upstream.spliceTo(mIngest[1], CHUNK_SIZE))
+    {
+        const auto len = moved.value();
+        const auto taken = std::chrono::steady_clock::now();
+
+        // Each downstream queue gets its own reference to the same pages.
+        for (size_t index = 0; index < mDownstream.size(); ++index)
+        {
+            auto& hop = *mDownstream[index];
+            teed[index] = len;
+
+            if (hop.queue[1] < 0)
+            {
+                continue;
+            }
+
+            auto result = ::tee(mIngest[0], hop.queue[1], len, SPLICE_F_NONBLOCK);
+            teed[index] = static_cast<size_t>(std::max<ssize_t>(result, 0));
+
+            if (teed[index])
+            {
+                _queue(hop, teed[index], taken);
+            }
+        }
+
+        // Local delivery takes the chunk out of the ingest pipe.
+        size_t total = 0;
+        while (total < len)
+        {
+            auto got = ::read(mIngest[0], buffer.data() + total, len - total);
+            if (got < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if (got <= 0)
+            {
+                throw Exception(std::string("Cannot read the ingest pipe: ") + std::strerror(errno));
+            }
+
+            total += static_cast<size_t>(got);
+        }
+
+        // A full queue could not take all of the chunk; the rest is copied in as room appears.
+        for (size_t index = 0; index < mDownstream.size(); ++index)
+        {
+            auto& hop = *mDownstream[index];
+            if (teed[index] < len && hop.queue[1] >= 0)
+            {
+                _push(hop, buffer.data() + teed[index], len - teed[index], taken);
+            }
+        }
+
+        handler(buffer.data(), len);
+    }
+}
+
+//-----------------------------------------------------------------------------
+std::vector<Relay::HopStats> Relay::finish()
+{
+    std::vector<HopStats> result;
+
+    if (mFinished)
+    {
+        return result;
+    }
+
+    mFinished = true;
+
+    // Closing the write ends lets each thread send what is queued, then stop.
+    for (auto& hop : mDownstream)
+    {
+        if (hop->queue[1] >= 0)
+        {
+            close(hop->queue[1]);
+            hop->queue[1] = -1;
+        }
+    }
+
+    for (auto& hop : mDownstream)
+    {
+        if (hop->thread.joinable())
+        {
+            hop->thread.join();
+        }
+
+        if (hop->queue[0] >= 0)
+        {
+            close(hop->queue[0]);
+        }
+
+        auto stats = hop->stats;
+        if (hop->latencyCount)
+        {
+            stats.averageLatency = std::chrono::microseconds(hop->latencySum / hop->latencyCount);
+        }
+
+        result.push_back(stats);
+    }
+
+    // Closes the downstream connections
+    mDownstream.clear();
+
+    for (auto& fd : mIngest)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// Private Methods
+//-----------------------------------------------------------------------------
+
+/// @internal
+/// @brief Note that a chunk was queued for a downstream receiver, for latency accounting
+void Relay::_queue(Downstream& downstream, size_t len, std::chrono::steady_clock::time_point taken)
+{
+    std::lock_guard<std::mutex> lock(downstream.mutex);
+
+    downstream.queued += len;
+    downstream.chunks.push_back(Chunk{downstream.queued, taken});
+}
+
+/// @internal
+/// @brief Copy data into a downstream receiver's queue, waiting up to the stall timeout for room
+void Relay::_push(Downstream& downstream, const char* data, size_t len,
+                  std::chrono::steady_clock::time_point taken)
+{
+    while (len)
+    {
+        auto written = ::write(downstream.queue[1], data, len);
+        if (written > 0)
+        {
+            _queue(downstream, static_cast<size_t>(written), taken);
+            data += written;
+            len -= static_cast<size_t>(written);
+            continue;
+        }
+
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (written < 0 && errno == EAGAIN)
+        {
+            pollfd ready{downstream.queue[1], POLLOUT, 0};
+            auto result = ::poll(&ready, 1, static_cast<int>(mStallTimeout.count()));
+            if (result > 0 && !(ready.revents & (POLLERR | POLLHUP)))
+            {
+                continue;
+            }
+
+            if (result < 0 && errno == EINTR)
+            {
+                continue;
+            }
+        }
+
+        // No room within the stall timeout, or the receiver's connection failed
+        _cutOff(downstream);
+        return;
+    }
+}
+
+/// @internal
+/// @brief Stop forwarding to a downstream receiver, ending its connection
+void Relay::_cutOff(Downstream& downstream)
+{
+    close(downstream.queue[1]);
+    downstream.queue[1] = -1;
+
+    // It has stopped taking data, so what is queued may never go; this also wakes its thread.
+    downstream.socket.shutdown();
+
+    std::lock_guard<std::mutex> lock(downstream.mutex);
+    if (!downstream.stats.cutOff)
+    {
+        downstream.stats.cutOff = true;
+        std::cerr << "Forwarding to " << downstream.stats.downstream
+                  << " cut off: its queue had no room for " << mStallTimeout.count() << " ms." << std::endl;
+    }
+}
+
+/**
+ * @internal
+ * @brief Thread to send a downstream receiver's queue to it
+ * @param[in] downstream    - The receiver
+ */
+void Relay::_forwardThread(Downstream& downstream)
+{
+    try
+    {
+        uint64_t sent = 0;
+
+        while (auto moved = downstream.socket.spliceFrom(downstream.queue[0], CHUNK_SIZE))
+        {
+            sent += moved;
+            const auto now = std::chrono::steady_clock::now();
+
+            std::lock_guard<std::mutex> lock(downstream.mutex);
+            downstream.stats.bytesForwarded = sent;
+
+            while (!downstream.chunks.empty() && downstream.chunks.front().end <= sent)
+            {
+                auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                    now - downstream.chunks.front().taken);
+
+                downstream.latencySum += static_cast<uint64_t>(latency.count());
+                ++downstream.latencyCount;
+                downstream.stats.maxLatency = std::max(downstream.stats.maxLatency, latency);
+
+                downstream.chunks.pop_front();
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::lock_guard<std::mutex> lock(downstream.mutex);
+        if (!downstream.stats.cutOff)
+        {
+            downstream.stats.cutOff = true;
+            std::cerr << "Forwarding to " << downstream.stats.downstream << ": " << e.what() << std::endl;
+        }
+    }
+
+    // Further tees into the queue now fail, which cuts the receiver off.
+    close(downstream.queue[0]);
+    downstream.queue[0] = -1;
+}
@@ -0,0 +1,169 @@
+/**
+ * @brief Passes a connection's data on to downstream receivers
+ *
+ * @file Relay.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+#include "Receiver.h"
+
+#include "Common/Socket.h"
+#include "Common/Endpoint.h"
+#include "Common/SocketOptions.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <exception>
+#include <stdint.h>
+
+
+/**
+ * @brief Forwards one incoming connection to each of a set of downstream receivers, and to the
+ *          local handler.
+ * @details Data is spliced from the incoming socket into a pipe and tee()d from there into a
+ *          pipe per downstream receiver, so what is forwarded never passes through user space;
+ *          only the local handler's copy is read out. A thread per downstream receiver splices
+ *          its pipe into its socket.
+ *
+ *          Each downstream pipe is that receiver's queue, bounded at 'queueBytes'. When a queue
+ *          is full, the relay waits for room, but only for the stall timeout: a receiver that
+ *          makes no room in that time is cut off, and its connection is ended. A stuck receiver
+ *          therefore holds back the incoming connection and the other receivers once, for at
+ *          most the stall timeout.
+ *
+ *          The latency this hop adds is measured per chunk, from when it was taken off the
+ *          incoming socket until it was handed to the downstream socket.
+ */
+class Relay
+{
+    Relay(const Relay&) = delete;
+    Relay& operator =(const Relay&) = delete;
+
+public: // Definitions
+    class Exception;
+
+    /// What happened on the way to one downstream receiver
+    struct HopStats
+    {
+        std::string                 downstream;         ///< "addr:port"
+        uint64_t                    bytesForwarded{0};
+        std::chrono::microseconds   averageLatency{0};  ///< Added by this hop, per chunk
+        std::chrono::microseconds   maxLatency{0};
+        bool                        cutOff{false};      ///< Stalled for too long, or failed
+    };
+
+    /// The most moved off the incoming socket at once
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+public: // Methods
+    /**
+     * @brief Construct a Relay, connecting to the downstream receivers
+     * @param[in] downstream    - The receivers to forward to. Any that cannot be reached are
+     *                            reported and left out.
+     * @param[in] queueBytes    - The bound on each downstream receiver's queue (rounded by the
+     *                            kernel to a pipe size)
+     * @param[in] stallTimeout  - How long a full queue may hold up the relay before its receiver
+     *                            is cut off
+     * @param[in] options       - Socket tuning for the downstream connections
+     * @throws Exception if pipes cannot be made
+     */
+    Relay(const std::vector<Common::Endpoint>& downstream, size_t queueBytes,
+          std::chrono::milliseconds stallTimeout, const Common::SocketOptions& options);
+
+    /// Finishes, if finish() was not called.
+    virtual ~Relay();
+
+    /**
+     * @brief Forward data that was already read from the incoming socket
+     * @param[in] buffer    - The data
+     * @param[in] len       - The size of the data, in bytes
+     */
+    void forward(const void* buffer, size_t len);
+
+    /**
+     * @brief Forward and deliver the incoming connection until it closes
+     * @param[in] upstream  - The incoming connection
+     * @param[in] handler   - Receives the data locally
+     * @throws Common::Socket::Exception on a failure of the incoming connection
+     */
+    void run(Common::Socket& upstream, const Receiver::Handler& handler);
+
+    /**
+     * @brief Let each downstream receiver's queue drain, and close the connections
+     * @return What happened on the way to each downstream receiver
+     */
+    std::vector<HopStats> finish();
+
+private: // Definitions
+    struct Chunk
+    {
+        uint64_t                                end;    ///< Queued offset just past the chunk
+        std::chrono::steady_clock::time_point   taken;  ///< When it came off the incoming socket
+    };
+
+    struct Downstream
+    {
+        Downstream(const Common::Endpoint& endpoint)
+            : socket(endpoint.addr, endpoint.port)
+        {
+            stats.downstream = endpoint.toString();
+        }
+
+        Common::Socket          socket;
+        int                     queue[2]{-1, -1};   ///< The pipe: read end, write end
+        std::thread             thread;
+        std::mutex              mutex;              ///< Guards the members below
+        std::deque<Chunk>       chunks;             ///< Queued but not yet sent
+        uint64_t                queued{0};
+        uint64_t                latencySum{0};      ///< Microseconds, over 'latencyCount' chunks
+        uint64_t                latencyCount{0};
+        HopStats                stats;
+    };
+
+private: // Methods
+    void _queue(Downstream& downstream, size_t len, std::chrono::steady_clock::time_point taken);
+    void _push(Downstream& downstream, const char* data, size_t len,
+               std::chrono::steady_clock::time_point taken);
+    void _cutOff(Downstream& downstream);
+    static void _forwardThread(Downstream& downstream);
+
+private: // Members
+    std::vector<std::unique_ptr<Downstream>>    mDownstream;
+    int                                         mIngest[2]{-1, -1};    ///< The pipe: read end, write end
+    std::chrono::milliseconds                   mStallTimeout;
+    bool                                        mFinished{false};
+
+}; // class Relay
+
+
+/**
+ * @brief Exceptions on the Relay class
+ */
+class Relay::Exception : public std::exception
+{
+public:
+    Exception(const std::string& message)
+        : mMessage(message)
+    {
+    }
+
+    virtual ~Exception() = default;
+
+    virtual const char* what() const noexcept override
+    {
+        return mMessage.c_str();
+    }
+
+private:
+    std::string     mMessage;
+
+}; // class Relay::Exception
@@ -0,0 +1,600 @@
+/**
+ * @brief Handles a connection that speaks the framed protocol
+ *
+ * @file Session.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#include "Session.h"
+
+// Project headers
+#include "Common/SocketException.h"
+#include "Common/Crc32c.h"
+#include "Common/Affinity.h"
+
+// System headers
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// Standard headers
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+using Common::Protocol::FrameType;
+using Common::Protocol::FrameHeader;
+
+
+//-----------------------------------------------------------------------------
+Session::Session(Common::Socket& socket, const Receiver::Handler& handler,
+                 const Receiver::StreamHandlerFactory& factory, CheckpointStore* store,
+                 WriteAheadLog* wal, ChunkStore* chunks, Common::BufferArena* arena,
+                 const Receiver::Config& config)
+    : mSocket(socket)
+    , mHandler(handler)
+    , mFactory(factory)
+    , mStore(store)
+    , mWal(wal)
+    , mChunks(chunks)
+    , mArena(arena)
+    , mCheckpointInterval(config.checkpointInterval)
+    , mQueueBytes(config.queueBytes)
+    , mHandlerCpus(config.handlerCpus)
+    , mPushFilter(config.pushFilter)
+{
+    if (!config.ioCpus.empty() || config.followIncomingCpu)
+    {
+        // The connection's thread has been placed: keep its streams' queues on its node, and
+        // unless told otherwise, their handlers too (they would otherwise share its one CPU).
+        mNode = Common::Affinity::nodeOf(Common::Affinity::currentCpu());
+        if (mHandlerCpus.empty())
+        {
+            mHandlerCpus = Common::Affinity::cpusOf(mNode);
+        }
+    }
+
+    if (mWal)
+    {
+        mCommitEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (mCommitEvent < 0)
+        {
+            throw WriteAheadLog::Exception(std::string("Cannot create eventfd: ") + std::strerror(errno));
+        }
+
+        // Runs on the log's commit thread, which must not be held up by this connection's peer.
+        mSubscription = mWal->subscribe([this](uint64_t durable)
+        {
+            mCommitted.store(durable, std::memory_order_release);
+
+            uint64_t value = 1;
+            while (::write(mCommitEvent, &value, sizeof(value)) < 0 && errno == EINTR)
+            {
+            }
+        });
+    }
+}
+
+//-----------------------------------------------------------------------------
+Session::~Session()
+{
+    _releaseAll();
+
+    if (mWal)
+    {
+        mWal->unsubscribe(mSubscription);
+        close(mCommitEvent);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void Session::run(const void* prefix, size_t len)
+{
+    Common::Protocol::FrameReader reader(mSocket);
+    reader.prime(prefix, len);
+
+    // A Data frame cannot run past its stream's credit, so a buffer the size of the window holds
+    // any of them. Reserving it now (untouched until used) keeps frames from growing it later.
+    std::vector<char> payload;
+    payload.reserve(std::min<size_t>(mQueueBytes + Common::Protocol::CRC_SIZE, Common::Protocol::MAX_PAYLOAD));
+
+    auto hello = reader.next(payload);
+    if (!hello)
+    {
+        return;
+    }
+
+    if (hello->type != FrameType::Hello || hello->offset != Common::Protocol::MAGIC)
+    {
+        throw Common::Socket::Exception("peer", "Not a framed session");
+    }
+
+    // Older senders sent no features.
+    if (payload.size() >= sizeof(uint32_t))
+    {
+        mPeerFeatures = Common::Protocol::getU32(reinterpret_cast<const uint8_t*>(payload.data()));
+    }
+
+    // Answer with our own Hello, advertising what this receiver can do.
+    uint32_t features = Common::Protocol::FEATURE_CREDIT | Common::Protocol::FEATURE_CRC;
+    if (mStore)
+    {
+        features |= Common::Protocol::FEATURE_RESUME;
+    }
+
+    if (mChunks)
+    {
+        features |= Common::Protocol::FEATURE_DEDUP;
+    }
+
+    uint8_t featureBytes[sizeof(features)];
+    Common::Protocol::putU32(featureBytes, features);
+
+    FrameHeader reply;
+    reply.type = FrameType::Hello;
+    reply.flags = Common::Protocol::VERSION;
+    reply.length = sizeof(featureBytes);
+    reply.offset = Common::Protocol::MAGIC;
+    {
+        std::lock_guard<std::mutex> lock(mSendMutex);
+        Common::Protocol::sendFrame(mSocket, reply, featureBytes);
+    }
+
+    for (;;)
+    {
+        // Acknowledge commits as they land, even while the sender has nothing more to send.
+        while (mWal && !reader.hasBufferedFrame()
+               && !mSocket.waitReadable(std::chrono::milliseconds(-1), mCommitEvent))
+        {
+            _sendAcks();
+        }
+
+        auto header = reader.next(payload);
+        if (!header)
+        {
+            break;
+        }
+
+        switch (header->type)
+        {
+        case FrameType::Open:
+            _onOpen(header.value(), payload);
+            break;
+
+        case FrameType::Data:
+            _onData(header.value(), payload);
+            break;
+
+        case FrameType::Recipe:
+            _onRecipe(header.value(), payload);
+            break;
+
+        case FrameType::Close:
+            _onClose(header.value());
+            break;
+
+        default:
+            // Frames we do not understand are skipped, so newer senders can talk to us.
+            break;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Private Methods
+//-----------------------------------------------------------------------------
+
+/// @internal
+/// @brief Begin a stream, telling the sender where to start
+void Session::_onOpen(const FrameHeader& header, const std::vector<char>& payload)
+{
+    if (payload.size() < sizeof(uint64_t))
+    {
+        throw Common::Socket::Exception("peer", "Malformed Open frame");
+    }
+
+    Stream stream;
+    stream.fileId = Common::Protocol::getU64(reinterpret_cast<const uint8_t*>(payload.data()));
+    std::string name(payload.begin() + sizeof(uint64_t), payload.end());
+
+    // Streams (as opposed to files) are delivered but never kept or resumed.
+    if (mStore && !(header.flags & Common::Protocol::OPEN_STREAM))
+    {
+        stream.received = mStore->open(stream.fileId, name, stream.owner);
+        stream.stored = true;
+    }
+
+    auto id = header.stream;
+    stream.queue = std::make_unique<DeliveryQueue>(mFactory ? mFactory(id, name) : mHandler,
+        stream.received, mQueueBytes,
+        [this, id](uint64_t limit){ _reply(FrameType::Credit, id, limit); }, mNode, mHandlerCpus, mArena);
+
+    auto limit = stream.queue->limit();
+    auto resume = stream.received;
+
+    stream.planned = stream.received;
+
+    // Chunks are collected into a buffer of their own, so that the payload buffer keeps what
+    // was reserved for it.
+    if (mChunks)
+    {
+        stream.partial.reserve(PARTIAL_RESERVE);
+    }
+
+    mStreams[id] = std::move(stream);
+
+    // Records we do not want need not be sent at all. Files are kept whole, so only streams
+    // are filtered, and only by a sender that understands the request.
+    if (!mPushFilter.empty() && (header.flags & Common::Protocol::OPEN_STREAM)
+        && (mPeerFeatures & Common::Protocol::FEATURE_FILTER))
+    {
+        _reply(FrameType::Filter, id, 0, mPushFilter.data(), mPushFilter.size());
+    }
+
+    _reply(FrameType::Resume, id, resume);
+    _reply(FrameType::Credit, id, limit);
+}
+
+/// @internal
+/// @brief Store and deliver data, checkpointing at intervals
+void Session::_onData(const FrameHeader& header, std::vector<char>& payload)
+{
+    auto found = mStreams.find(header.stream);
+    if (found == mStreams.end())
+    {
+        throw Common::Socket::Exception("peer", "Data for a stream that is not open");
+    }
+
+    auto& stream = found->second;
+    if (!stream.recipe.empty())
+    {
+        _onChunkData(header, stream, payload);
+        return;
+    }
+
+    if (header.offset != stream.received)
+    {
+        throw Common::Socket::Exception("peer", "Data out of sequence");
+    }
+
+    if (header.flags & Common::Protocol::DATA_CRC)
+    {
+        _verify(header, payload);
+    }
+
+    _accept(header.stream, stream, payload.data(), payload.size());
+    stream.planned = stream.received;
+}
+
+/// @internal
+/// @brief Ask for the chunks of a Recipe that are not held, then deliver any held ones that are
+///         next in the stream
+void Session::_onRecipe(const FrameHeader& header, const std::vector<char>& payload)
+{
+    using Common::Protocol::RECIPE_ENTRY_SIZE;
+
+    auto found = mStreams.find(header.stream);
+    if (found == mStreams.end() || !mChunks)
+    {
+        throw Common::Socket::Exception("peer", "Recipe for a stream that is not open");
+    }
+
+    auto& stream = found->second;
+    if (payload.size() % RECIPE_ENTRY_SIZE != 0)
+    {
+        throw Common::Socket::Exception("peer", "Malformed Recipe frame");
+    }
+
+    if (header.offset != stream.planned)
+    {
+        throw Common::Socket::Exception("peer", "Recipe out of sequence");
+    }
+
+    const auto entries = payload.size() / RECIPE_ENTRY_SIZE;
+    std::vector<uint8_t> want;
+    want.reserve(entries * sizeof(uint32_t));
+
+    auto entry = reinterpret_cast<const uint8_t*>(payload.data());
+    for (uint32_t index = 0; index < entries; ++index, entry += RECIPE_ENTRY_SIZE)
+    {
+        Chunk chunk;
+        chunk.length = Common::Protocol::getU32(entry);
+        chunk.fingerprint = Common::Fingerprint::decode(entry + sizeof(uint32_t));
+
+        if (chunk.length == 0 || chunk.length > ChunkStore::MAX_CHUNK)
+        {
+            throw Common::Socket::Exception("peer", "Malformed Recipe frame");
+        }
+
+        // A chunk already asked for is in the store by the time a later copy of it is reached.
+        chunk.held = mChunks->contains(chunk.fingerprint) || stream.wanted.count(chunk.fingerprint);
+        if (!chunk.held)
+        {
+            stream.wanted.insert(chunk.fingerprint);
+            want.resize(want.size() + sizeof(uint32_t));
+            Common::Protocol::putU32(want.data() + want.size() - sizeof(uint32_t), index);
+        }
+
+        stream.planned += chunk.length;
+        stream.recipe.push_back(chunk);
+    }
+
+    _reply(FrameType::Want, header.stream, header.offset, want.data(), want.size());
+    _drainRecipe(header.stream, stream);
+}
+
+/// @internal
+/// @brief Collect a wanted chunk, which may span several Data frames, and deliver it once its
+///         fingerprint checks out
+void Session::_onChunkData(const FrameHeader& header, Stream& stream, std::vector<char>& payload)
+{
+    auto& chunk = stream.recipe.front();
+
+    if (header.offset != stream.received + stream.partial.size())
+    {
+        throw Common::Socket::Exception("peer", "Data out of sequence");
+    }
+
+    if (header.flags & Common::Protocol::DATA_CRC)
+    {
+        _verify(header, payload);
+    }
+
+    if (stream.partial.size() + payload.size() > chunk.length)
+    {
+        throw Common::Socket::Exception("peer", "Data overruns its chunk");
+    }
+
+    stream.partial.insert(stream.partial.end(), payload.begin(), payload.end());
+
+    if (stream.partial.size() < chunk.length)
+    {
+        return;
+    }
+
+    if (Common::Fingerprint::of(stream.partial.data(), stream.partial.size()) != chunk.fingerprint)
+    {
+        throw Common::Socket::Exception("peer", "Chunk does not match its fingerprint");
+    }
+
+    mChunks->put(chunk.fingerprint, stream.partial.data(), stream.partial.size());
+    stream.wanted.erase(chunk.fingerprint);
+    stream.recipe.pop_front();
+
+    _deliver(header.stream, stream, stream.partial);
+    stream.partial.clear();
+
+    _drainRecipe(header.stream, stream);
+}
+
+/// @internal
+/// @brief Store, log and queue the next bytes of a stream, checkpointing at intervals
+void Session::_accept(uint16_t id, Stream& stream, const char* data, size_t len)
+{
+    const auto offset = stream.received;
+
+    if (stream.stored)
+    {
+        mStore->write(stream.fileId, stream.owner, offset, data, len);
+    }
+
+    if (mWal)
+    {
+        stream.logged = mWal->append(stream.fileId, offset, data, len);
+        stream.unacked.emplace_back(stream.logged, offset + len);
+    }
+
+    stream.queue->push(data, len);
+
+    stream.received += len;
+    stream.sinceCheckpoint += len;
+
+    if (stream.stored && stream.sinceCheckpoint >= mCheckpointInterval)
+    {
+        _reply(FrameType::Ack, id, mStore->sync(stream.fileId, stream.owner, stream.received));
+        stream.sinceCheckpoint = 0;
+    }
+}
+
+/// @internal
+/// @brief Deliver the held chunks at the front of a stream's recipe from the store
+void Session::_drainRecipe(uint16_t id, Stream& stream)
+{
+    std::vector<char> data;
+
+    while (!stream.recipe.empty() && stream.recipe.front().held)
+    {
+        const auto chunk = stream.recipe.front();
+        if (!mChunks->get(chunk.fingerprint, data))
+        {
+            throw ChunkStore::Exception("Chunk " + chunk.fingerprint.toString() + " is missing from the store");
+        }
+
+        _deliver(id, stream, data);
+        data.clear();
+
+        stream.deduplicated += chunk.length;
+        stream.recipe.pop_front();
+    }
+}
+
+/// @internal
+/// @brief Accept a whole chunk, as the handler makes room for it. A chunk is only offered once it
+///         starts within credit, and then comes whole, so it may run past the credit limit.
+void Session::_deliver(uint16_t id, Stream& stream, const std::vector<char>& data)
+{
+    size_t done = 0;
+    while (done < data.size())
+    {
+        const auto room = stream.queue->limit() - stream.received;
+        if (room == 0)
+        {
+            stream.queue->drain();
+            continue;
+        }
+
+        if (done == 0 && room >= data.size())
+        {
+            _accept(id, stream, data.data(), data.size());
+            return;
+        }
+
+        const auto piece = static_cast<size_t>(std::min<uint64_t>(room, data.size() - done));
+        _accept(id, stream, data.data() + done, piece);
+        done += piece;
+    }
+}
+
+/// @internal
+/// @brief Finish a stream, acknowledging all of it
+void Session::_onClose(const FrameHeader& header)
+{
+    auto found = mStreams.find(header.stream);
+    if (found == mStreams.end())
+    {
+        return;
+    }
+
+    auto& stream = found->second;
+    _drainRecipe(header.stream, stream);
+
+    if (header.offset != stream.received)
+    {
+        throw Common::Socket::Exception("peer", "Stream closed before all of its data arrived");
+    }
+
+    // Everything is delivered before it is acknowledged.
+    stream.queue->drain();
+    _reportStall(header.stream, stream);
+
+    if (stream.deduplicated > 0)
+    {
+        std::cerr << "Stream " << header.stream << ": " << stream.deduplicated << " of "
+                  << stream.received << " bytes came from the chunk store." << std::endl;
+    }
+
+    if (stream.stored)
+    {
+        mStore->complete(stream.fileId, stream.owner, stream.received);
+    }
+
+    if (mWal)
+    {
+        mWal->waitDurable(stream.logged);
+    }
+
+    _reply(FrameType::Ack, header.stream, stream.received);
+    mStreams.erase(found);
+}
+
+/// @internal
+/// @brief Check a Data frame's CRC and strip it from the payload. A mismatch ends the connection,
+///         before the bad bytes are stored or delivered; a resuming sender then sends them again.
+void Session::_verify(const FrameHeader& header, std::vector<char>& payload)
+{
+    using Common::Protocol::CRC_SIZE;
+
+    if (payload.size() < CRC_SIZE)
+    {
+        throw Common::Socket::Exception("peer", "Malformed Data frame");
+    }
+
+    const auto len = payload.size() - CRC_SIZE;
+    const auto expected = Common::Protocol::getU32(reinterpret_cast<const uint8_t*>(payload.data() + len));
+    const auto actual = Common::Crc32c::extend(0, payload.data(), len);
+
+    if (actual != expected)
+    {
+        std::cerr << "Stream " << header.stream << ": CRC mismatch in the " << len
+                  << " bytes at offset " << header.offset << std::hex
+                  << " (sent 0x" << expected << ", computed 0x" << actual << ")" << std::dec << std::endl;
+        throw Common::Socket::Exception("peer", "Data failed its CRC check");
+    }
+
+    payload.resize(len);
+}
+
+/// @internal
+/// @brief Send a frame back to the sender, header-only unless a payload is given
+void Session::_reply(FrameType type, uint16_t stream, uint64_t offset, const void* payload, size_t len)
+{
+    FrameHeader header;
+    header.type = type;
+    header.stream = stream;
+    header.length = static_cast<uint32_t>(len);
+    header.offset = offset;
+
+    std::lock_guard<std::mutex> lock(mSendMutex);
+    Common::Protocol::sendFrame(mSocket, header, len ? payload : nullptr);
+}
+
+/// @internal
+/// @brief Acknowledge what the log's latest commit made durable: one Ack per stream, for the
+///         furthest of its records that the commit covers
+void Session::_sendAcks()
+{
+    uint64_t value;
+    auto drained = ::read(mCommitEvent, &value, sizeof(value));
+    (void)drained;
+
+    const auto durable = mCommitted.load(std::memory_order_acquire);
+
+    for (auto& entry : mStreams)
+    {
+        auto& unacked = entry.second.unacked;
+        auto covered = std::find_if(unacked.begin(), unacked.end(),
+                                    [durable](const auto& record){ return record.first > durable; });
+        if (covered != unacked.begin())
+        {
+            _reply(FrameType::Ack, entry.first, std::prev(covered)->second);
+
+            // Erasing from the front keeps the capacity, so once the list has grown to the
+            // most records a commit spans, neither this nor _accept() allocates.
+            unacked.erase(unacked.begin(), covered);
+        }
+    }
+}
+
+/// @internal
+/// @brief Checkpoint and release every incomplete stream, so that a reconnecting sender
+///         resumes from everything that arrived rather than from the last interval.
+void Session::_releaseAll() noexcept
+{
+    for (auto& entry : mStreams)
+    {
+        auto& stream = entry.second;
+        if (stream.stored)
+        {
+            try
+            {
+                mStore->sync(stream.fileId, stream.owner, stream.received);
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << e.what() << std::endl;
+            }
+
+            mStore->release(stream.fileId, stream.owner);
+        }
+
+        // Deliver what already arrived
+        _reportStall(entry.first, stream);
+        stream.queue.reset();
+    }
+
+    mStreams.clear();
+}
+
+/// @internal
+/// @brief Report how long a slow handler held the sender back on a stream, if at all
+void Session::_reportStall(uint16_t id, const Stream& stream) const
+{
+    auto stall = stream.queue ? stream.queue->stallTime() : std::chrono::microseconds(0);
+    if (stall.count() > 0)
+    {
+        std::cerr << "Stream " << id << ": sender waited " << stall.count()
+                  << " us for the handler to catch up." << std::endl;
+    }
+}
@@ -0,0 +1,152 @@
+/**
+ * @brief Handles a connection that speaks the framed protocol
+ *
+ * @file Session.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+#include "Receiver.h"
+#include "CheckpointStore.h"
+#include "WriteAheadLog.h"
+#include "DeliveryQueue.h"
+#include "ChunkStore.h"
+
+#include "Common/Socket.h"
+#include "Common/Protocol.h"
+#include "Common/Fingerprint.h"
+
+#include <map>
+#include <deque>
+#include <unordered_set>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <utility>
+#include <stdint.h>
+
+
+/**
+ * @brief Serves one framed connection: answers Open with the durable offset held for the
+ *          file, stores and delivers Data, and acknowledges progress as checkpoints are made.
+ * @details Each stream's data reaches the handler through a DeliveryQueue of its own, which
+ *          grants the sender Credit as the handler keeps up. Replies are sent from the
+ *          connection's thread and the delivery threads, so sending is serialized.
+ *
+ *          With a WriteAheadLog, every Data frame is logged before it is delivered. The log's
+ *          commits only wake the connection's thread, which then sends each stream one Ack for
+ *          the furthest of its data the commit made durable; a stream's final Ack waits for its
+ *          last record to be durable.
+ *
+ *          Data frames that carry a CRC are checked before anything else is done with them.
+ *
+ *          With a ChunkStore, a sender may describe what follows on a stream as a Recipe of
+ *          chunks. The Session asks for the chunks it does not hold, delivers the rest from the
+ *          store in their place, and stores each new chunk once its fingerprint checks out.
+ */
+class Session
+{
+    Session(const Session&) = delete;
+    Session& operator =(const Session&) = delete;
+
+public: // Methods
+    /**
+     * @brief Construct a Session
+     * @param[in] socket    - The connected socket
+     * @param[in] handler   - Receives the data of every stream, unless 'factory' is set
+     * @param[in] factory   - Makes a handler for each stream as it opens (may be empty)
+     * @param[in] store     - Where files are kept for resuming, or null if they are not kept
+     * @param[in] wal       - The log to persist data in before acknowledging it, or null
+     * @param[in] chunks    - Where chunks are kept for deduplication, or null if they are not
+     * @param[in] arena     - Where stream queues' memory is taken from, or null for the heap
+     * @param[in] config    - The receiver's settings
+     */
+    Session(Common::Socket& socket, const Receiver::Handler& handler,
+            const Receiver::StreamHandlerFactory& factory, CheckpointStore* store,
+            WriteAheadLog* wal, ChunkStore* chunks, Common::BufferArena* arena,
+            const Receiver::Config& config);
+
+    virtual ~Session();
+
+    /**
+     * @brief Serve frames until the peer disconnects
+     * @param[in] prefix    - Bytes already read from the socket (the start of the Hello frame)
+     * @param[in] len       - The number of bytes in 'prefix'
+     * @throws Common::Socket::Exception on failure or a protocol violation
+     * @throws CheckpointStore::Exception if received data cannot be stored
+     * @throws WriteAheadLog::Exception if received data cannot be logged
+     * @throws ChunkStore::Exception if a chunk cannot be stored or read back
+     */
+    void run(const void* prefix, size_t len);
+
+private: // Definitions
+    /// Room made, on opening a stream, for collecting a chunk: a sender's largest by default.
+    /// A larger chunk grows it once.
+    static constexpr size_t PARTIAL_RESERVE = 64 * 1024;
+
+    /// An entry of a Recipe
+    struct Chunk
+    {
+        uint32_t                length{0};
+        Common::Fingerprint     fingerprint;
+        bool                    held{false};    ///< To come from the store rather than the sender
+    };
+
+    struct Stream
+    {
+        uint64_t    fileId{0};
+        uint64_t    received{0};            ///< Contiguous bytes received from the start of the file
+        uint64_t    sinceCheckpoint{0};
+        bool        stored{false};          ///< Open in mStore
+        CheckpointStore::Owner  owner{0};   ///< This session's hold on the file in mStore
+        uint64_t    logged{0};              ///< Log position just past the stream's last record
+        std::vector<std::pair<uint64_t, uint64_t>>  unacked;    ///< Log position and stream offset just past each record not yet acknowledged
+        uint64_t    planned{0};             ///< Stream offset just past the last chunk of a Recipe
+        uint64_t    deduplicated{0};        ///< Bytes delivered from the chunk store
+        std::deque<Chunk>       recipe;     ///< Chunks announced but not yet delivered, in order
+        std::vector<char>       partial;    ///< What has arrived of the first chunk of 'recipe'
+        std::unordered_set<Common::Fingerprint, Common::Fingerprint::Hash>  wanted;     ///< Asked for, not yet stored
+        std::unique_ptr<DeliveryQueue>  queue;
+    };
+
+private: // Methods
+    void _onOpen(const Common::Protocol::FrameHeader& header, const std::vector<char>& payload);
+    void _onData(const Common::Protocol::FrameHeader& header, std::vector<char>& payload);
+    void _onRecipe(const Common::Protocol::FrameHeader& header, const std::vector<char>& payload);
+    void _onChunkData(const Common::Protocol::FrameHeader& header, Stream& stream, std::vector<char>& payload);
+    void _onClose(const Common::Protocol::FrameHeader& header);
+    void _accept(uint16_t id, Stream& stream, const char* data, size_t len);
+    void _drainRecipe(uint16_t id, Stream& stream);
+    void _deliver(uint16_t id, Stream& stream, const std::vector<char>& data);
+    void _verify(const Common::Protocol::FrameHeader& header, std::vector<char>& payload);
+    void _reply(Common::Protocol::FrameType type, uint16_t stream, uint64_t offset,
+                const void* payload = nullptr, size_t len = 0);
+    void _sendAcks();
+    void _releaseAll() noexcept;
+    void _reportStall(uint16_t id, const Stream& stream) const;
+
+private: // Members
+    Common::Socket&                 mSocket;
+    const Receiver::Handler&        mHandler;
+    const Receiver::StreamHandlerFactory&   mFactory;
+    CheckpointStore*                mStore;
+    WriteAheadLog*                  mWal;
+    ChunkStore*                     mChunks;
+    Common::BufferArena*            mArena;
+    int                             mCommitEvent{-1};   ///< An eventfd the log's commits signal
+    uint64_t                        mSubscription{0};   ///< To the log's commits
+    std::atomic<uint64_t>           mCommitted{0};  ///< The log position made durable by the latest commit
+    uint64_t                        mCheckpointInterval;
+    size_t                          mQueueBytes;
+    int                             mNode{-1};      ///< Where stream queues are kept (-1: not placed)
+    std::vector<int>                mHandlerCpus;   ///< Where stream handlers run (empty: not placed)
+    std::string                     mPushFilter;    ///< Asked of the sender for each stream (empty: none)
+    uint32_t                        mPeerFeatures{0};   ///< Common::Protocol::Features the sender advertised
+    std::map<uint16_t, Stream>      mStreams;
+    std::mutex                      mSendMutex;
+
+}; // class Session
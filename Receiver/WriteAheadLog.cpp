@@ -0,0 +1,426 @@
+/**
+ * @brief An append-only log that makes received data durable in groups
+ *
+ * @file WriteAheadLog.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#include "WriteAheadLog.h"
+
+// Project headers
+#include "Common/Protocol.h"
+
+// System headers
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <dirent.h>
+
+// Standard headers
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+
+namespace
+{
+    std::string errorText(const std::string& what)
+    {
+        return what + ": " + std::strerror(errno);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+WriteAheadLog::WriteAheadLog(const std::string& directory, uint64_t segmentBytes, size_t commitBytes,
+                             std::chrono::microseconds commitDelay)
+    : mDirectory(directory)
+    , mSegmentBytes(std::max<uint64_t>(segmentBytes, HEADER_SIZE + 1))
+    , mCommitBytes(std::max<size_t>(commitBytes, 1))
+    , mCommitDelay(commitDelay)
+{
+    if (mkdir(mDirectory.c_str(), 0755) < 0 && errno != EEXIST)
+    {
+        throw Exception(errorText("Cannot create " + mDirectory));
+    }
+
+    mDirectoryFd = ::open(mDirectory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (mDirectoryFd < 0)
+    {
+        throw Exception(errorText("Cannot open " + mDirectory));
+    }
+
+    // Never append to an old segment: its preallocated tail cannot be told from the end of the log.
+    auto existing = _segments(mDirectory);
+    if (!existing.empty())
+    {
+        mNextIndex = std::strtoull(existing.back().c_str(), nullptr, 10) + 1;
+    }
+
+    try
+    {
+        _startSegment();
+    }
+    catch (...)
+    {
+        close(mDirectoryFd);
+        throw;
+    }
+
+    mThread = std::thread(&WriteAheadLog::_commitThread, this);
+}
+
+//-----------------------------------------------------------------------------
+WriteAheadLog::~WriteAheadLog()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mCommitCondition.notify_one();
+
+    if (mThread.joinable())
+    {
+        mThread.join();
+    }
+
+    for (auto fd : mRetired)
+    {
+        close(fd);
+    }
+
+    if (mFd >= 0)
+    {
+        // Everything is committed; the unused preallocation is no longer needed.
+        if (mError.empty() && ftruncate(mFd, static_cast<off_t>(mSegmentUsed)) == 0)
+        {
+            fsync(mFd);
+        }
+        close(mFd);
+    }
+
+    if (mDirectoryFd >= 0)
+    {
+        close(mDirectoryFd);
+    }
+}
+
+//-----------------------------------------------------------------------------
+uint64_t WriteAheadLog::append(uint64_t source, uint64_t offset, const void* data, size_t len)
+{
+    const uint64_t size = HEADER_SIZE + len;
+
+    uint8_t header[HEADER_SIZE];
+    Common::Protocol::putU32(header, MAGIC);
+    Common::Protocol::putU32(header + 4, static_cast<uint32_t>(len));
+    Common::Protocol::putU64(header + 8, source);
+    Common::Protocol::putU64(header + 16, offset);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    if (!mError.empty())
+    {
+        throw Exception(mError);
+    }
+
+    if (size > mSegmentBytes || len > UINT32_MAX)
+    {
+        throw Exception("A record of " + std::to_string(len) + " bytes does not fit in a log segment.");
+    }
+
+    if (mSegmentUsed + size > mSegmentBytes)
+    {
+        // The full segment is closed once the commit that covers its last record is done.
+        mRetired.push_back(mFd);
+        mFd = -1;
+        _startSegment();
+    }
+
+    iovec parts[2]{{header, HEADER_SIZE}, {const_cast<void*>(data), len}};
+    size_t written = 0;
+    while (written < size)
+    {
+        // Skip whatever an earlier, short write already covered.
+        iovec remaining[2];
+        int count = 0;
+        size_t skip = written;
+        for (auto& part : parts)
+        {
+            if (skip >= part.iov_len)
+            {
+                skip -= part.iov_len;
+                continue;
+            }
+            remaining[count++] = iovec{static_cast<char*>(part.iov_base) + skip, part.iov_len - skip};
+            skip = 0;
+        }
+
+        auto result = pwritev(mFd, remaining, count, static_cast<off_t>(mSegmentUsed + written));
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (result <= 0)
+        {
+            throw Exception(errorText("Cannot write the write-ahead log"));
+        }
+
+        written += static_cast<size_t>(result);
+    }
+
+    const bool idle = (mWritten == mCommitting);
+    if (idle)
+    {
+        mPendingSince = std::chrono::steady_clock::now();
+    }
+
+    mSegmentUsed += size;
+    mWritten += size;
+
+    if (mDirty.empty() || mDirty.back() != mFd)
+    {
+        mDirty.push_back(mFd);
+    }
+
+    ++mStats.records;
+    mStats.bytes += len;
+
+    const auto position = mWritten;
+    const bool full = (mWritten - mCommitting >= mCommitBytes);
+    lock.unlock();
+
+    // The commit thread sleeps until its window closes; it only needs waking to open one, or to
+    // cut it short.
+    if (idle || full)
+    {
+        mCommitCondition.notify_one();
+    }
+
+    return position;
+}
+
+//-----------------------------------------------------------------------------
+uint64_t WriteAheadLog::subscribe(Committed committed)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto subscription = mNextSubscription++;
+    mSubscribers.emplace(subscription, std::move(committed));
+    return subscription;
+}
+
+//-----------------------------------------------------------------------------
+void WriteAheadLog::unsubscribe(uint64_t subscription) noexcept
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSubscribers.erase(subscription);
+}
+
+//-----------------------------------------------------------------------------
+void WriteAheadLog::waitDurable(uint64_t position)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDurableCondition.wait(lock, [&]{ return mDurable >= position || !mError.empty(); });
+
+    if (mDurable < position)
+    {
+        throw Exception(mError);
+    }
+}
+
+//-----------------------------------------------------------------------------
+uint64_t WriteAheadLog::durable() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mDurable;
+}
+
+//-----------------------------------------------------------------------------
+WriteAheadLog::Stats WriteAheadLog::stats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+//-----------------------------------------------------------------------------
+size_t WriteAheadLog::replay(const std::string& directory, const Visitor& visitor)
+{
+    size_t records = 0;
+
+    for (const auto& name : _segments(directory))
+    {
+        std::ifstream file(directory + "/" + name, std::ios::binary);
+        if (!file)
+        {
+            throw Exception("Cannot read " + directory + "/" + name);
+        }
+
+        std::vector<char> contents{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+        auto bytes = reinterpret_cast<const uint8_t*>(contents.data());
+
+        size_t position = 0;
+        while (contents.size() - position >= HEADER_SIZE
+               && Common::Protocol::getU32(bytes + position) == MAGIC)
+        {
+            const size_t len = Common::Protocol::getU32(bytes + position + 4);
+            if (contents.size() - position - HEADER_SIZE < len)
+            {
+                break;
+            }
+
+            visitor(Common::Protocol::getU64(bytes + position + 8),
+                    Common::Protocol::getU64(bytes + position + 16),
+                    contents.data() + position + HEADER_SIZE, len);
+
+            position += HEADER_SIZE + len;
+            ++records;
+        }
+    }
+
+    return records;
+}
+
+//-----------------------------------------------------------------------------
+// Private Methods
+//-----------------------------------------------------------------------------
+
+/// @internal
+/// @brief Create and preallocate the next segment, making its name durable. Called with mMutex
+///         held (or before the commit thread starts).
+void WriteAheadLog::_startSegment()
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llu.wal", static_cast<unsigned long long>(mNextIndex));
+    auto path = mDirectory + "/" + name;
+
+    mFd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (mFd < 0)
+    {
+        throw Exception(errorText("Cannot create " + path));
+    }
+
+    // Allocating the whole segment now keeps each commit to a data-only sync. A file system
+    // that cannot preallocate still works, only with a metadata update per commit.
+    if (fallocate(mFd, 0, 0, static_cast<off_t>(mSegmentBytes)) != 0 && errno == ENOSPC)
+    {
+        close(mFd);
+        mFd = -1;
+        unlink(path.c_str());
+        throw Exception(errorText("Cannot preallocate " + path));
+    }
+
+    if (fsync(mFd) != 0 || fsync(mDirectoryFd) != 0)
+    {
+        throw Exception(errorText("Cannot sync " + path));
+    }
+
+    ++mNextIndex;
+    ++mStats.segments;
+    mSegmentUsed = 0;
+}
+
+/**
+ * @internal
+ * @brief Thread to commit the log in groups
+ */
+void WriteAheadLog::_commitThread()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    for (;;)
+    {
+        mCommitCondition.wait(lock, [this]{ return mStopping || mWritten > mCommitting; });
+        if (mWritten == mCommitting)
+        {
+            break;
+        }
+
+        // Let the group form, unless enough is pending already (or the log is closing).
+        mCommitCondition.wait_until(lock, mPendingSince + mCommitDelay, [this]
+        {
+            return mStopping || mWritten - mCommitting >= mCommitBytes;
+        });
+
+        const auto target = mWritten;
+        mCommitting = target;
+        auto dirty = std::move(mDirty);
+        auto retired = std::move(mRetired);
+        mDirty.clear();
+        mRetired.clear();
+        lock.unlock();
+
+        // Appends continue into the page cache while this runs; the next commit covers them.
+        std::string error;
+        for (auto fd : dirty)
+        {
+            if (fdatasync(fd) != 0 && error.empty())
+            {
+                error = errorText("Cannot sync the write-ahead log");
+            }
+        }
+
+        for (auto fd : retired)
+        {
+            close(fd);
+        }
+
+        lock.lock();
+
+        if (!error.empty())
+        {
+            // Whether any of it reached the disk is unknown, so nothing more is acknowledged.
+            mError = error;
+            mDurableCondition.notify_all();
+            break;
+        }
+
+        ++mStats.commits;
+        mDurable = target;
+
+        // Subscribers only take note of the position, so one that is slow to act on it (e.g. a
+        // connection whose peer stopped reading its acks) holds up no one else.
+        for (auto& subscriber : mSubscribers)
+        {
+            subscriber.second(target);
+        }
+
+        mDurableCondition.notify_all();
+    }
+}
+
+/// @internal
+/// @brief The names of the segments in a log directory, oldest first
+std::vector<std::string> WriteAheadLog::_segments(const std::string& directory)
+{
+    std::vector<std::string> result;
+
+    auto dir = opendir(directory.c_str());
+    if (!dir)
+    {
+        return result;
+    }
+
+    while (auto entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if (name.size() == 20 && name.compare(16, 4, ".wal") == 0
+            && std::all_of(name.begin(), name.begin() + 16, [](char c){ return c >= '0' && c <= '9'; }))
+        {
+            result.push_back(name);
+        }
+    }
+
+    closedir(dir);
+
+    // Fixed-width names sort in index order.
+    std::sort(result.begin(), result.end());
+    return result;
+}
@@ -0,0 +1,186 @@
+/**
+ * @brief An append-only log that makes received data durable in groups
+ *
+ * @file WriteAheadLog.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <exception>
+#include <stdint.h>
+
+
+/**
+ * @brief Persists records from every connection in one log, syncing them to disk in groups.
+ * @details Records are appended to segment files "<dir>/<index>.wal", each preallocated to the
+ *          segment size so that appending never changes the file's size, and fdatasync() has
+ *          only data to flush. When a record does not fit, the next segment is started.
+ *
+ *          One thread commits the log: it waits until either 'commitBytes' are pending or the
+ *          commit delay has passed since the first of them was appended, then syncs everything
+ *          appended so far with one fdatasync(). Appending carries on while a sync is under way,
+ *          so each sync covers whatever arrived during the last. Many small writes, from all
+ *          connections, then share each sync rather than paying for one apiece.
+ *
+ *          A position in the log is the number of bytes appended before it, counted across
+ *          segments. Each record is:
+ *              u32 MAGIC, u32 payload length, u64 source, u64 offset, payload
+ *          A record is only ever trusted once its position is durable; replay() stops at the
+ *          first record that is not whole.
+ *
+ *          All methods are thread-safe.
+ */
+class WriteAheadLog
+{
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator =(const WriteAheadLog&) = delete;
+
+public: // Definitions
+    class Exception;
+
+    /// Called on the commit thread with the position the log is now durable up to. It runs with
+    /// the log locked, so it should only record the position and wake whoever acts on it.
+    using Committed = std::function<void(uint64_t durable)>;
+
+    /// Called by replay() for each record, in the order they were appended
+    using Visitor = std::function<void(uint64_t source, uint64_t offset, const char* data, size_t len)>;
+
+    struct Stats
+    {
+        uint64_t    records{0};
+        uint64_t    bytes{0};       ///< Payload bytes appended
+        uint64_t    commits{0};     ///< Syncs made; bytes / commits is the average group
+        uint64_t    segments{0};    ///< Segment files started
+    };
+
+    static constexpr uint32_t MAGIC = 0x57414c31;  // "WAL1"
+    static constexpr size_t HEADER_SIZE = 24;
+
+public: // Methods
+    /**
+     * @brief Construct a WriteAheadLog, starting a new segment after any already in the directory
+     * @param[in] directory     - Where the segments are kept (created if missing)
+     * @param[in] segmentBytes  - The size each segment is preallocated to
+     * @param[in] commitBytes   - Pending bytes that start a commit without waiting out the delay
+     * @param[in] commitDelay   - The longest an appended record waits for its commit to start
+     * @throws Exception on failure
+     */
+    WriteAheadLog(const std::string& directory, uint64_t segmentBytes, size_t commitBytes,
+                  std::chrono::microseconds commitDelay);
+
+    /// Commits everything appended, then trims the last segment to what it holds.
+    virtual ~WriteAheadLog();
+
+    /**
+     * @brief Append a record
+     * @param[in] source    - Identifies where the data came from (e.g. a sender's file id)
+     * @param[in] offset    - The data's position within its source
+     * @param[in] data      - The payload
+     * @param[in] len       - The size of the payload, in bytes
+     * @return The log position just past the record
+     * @throws Exception on failure, including an earlier failure to commit
+     */
+    uint64_t append(uint64_t source, uint64_t offset, const void* data, size_t len);
+
+    /**
+     * @brief Be told of every commit from now on
+     * @param[in] committed - Called after each commit, before waitDurable() returns for it
+     * @return Identifies the subscription to unsubscribe()
+     */
+    uint64_t subscribe(Committed committed);
+
+    /**
+     * @brief Stop being told of commits. Once this returns, the callback is not running and
+     *          will not be called again.
+     * @param[in] subscription  - As returned by subscribe()
+     */
+    void unsubscribe(uint64_t subscription) noexcept;
+
+    /**
+     * @brief Wait until the log is durable up to a position
+     * @param[in] position  - A position returned by append()
+     * @throws Exception if the log could not be committed
+     */
+    void waitDurable(uint64_t position);
+
+    /// The position up to which the log is durable
+    uint64_t durable() const;
+
+    Stats stats() const;
+
+    /**
+     * @brief Read back every whole record in a log directory
+     * @param[in] directory - The log's directory
+     * @param[in] visitor   - Called for each record
+     * @return The number of records read
+     * @throws Exception if a segment cannot be read
+     */
+    static size_t replay(const std::string& directory, const Visitor& visitor);
+
+private: // Methods
+    void _startSegment();
+    void _commitThread();
+    static std::vector<std::string> _segments(const std::string& directory);
+
+private: // Members
+    std::string                     mDirectory;
+    int                             mDirectoryFd{-1};
+    uint64_t                        mSegmentBytes;
+    size_t                          mCommitBytes;
+    std::chrono::microseconds       mCommitDelay;
+
+    mutable std::mutex              mMutex;             ///< Guards the members below
+    std::condition_variable         mCommitCondition;   ///< Wakes the commit thread
+    std::condition_variable         mDurableCondition;  ///< Wakes waitDurable()
+    uint64_t                        mNextIndex{0};      ///< Of the next segment file
+    int                             mFd{-1};            ///< The segment being appended to
+    uint64_t                        mSegmentUsed{0};
+    std::vector<int>                mDirty;             ///< Segments written since the last commit began
+    std::vector<int>                mRetired;           ///< Full segments, closed after their last commit
+    uint64_t                        mWritten{0};        ///< Position of the end of the log
+    uint64_t                        mCommitting{0};     ///< Position the current or last commit covers
+    uint64_t                        mDurable{0};
+    std::chrono::steady_clock::time_point   mPendingSince;  ///< When the first uncommitted record arrived
+    std::map<uint64_t, Committed>   mSubscribers;       ///< By subscription
+    uint64_t                        mNextSubscription{1};
+    std::string                     mError;             ///< Set if a commit failed; the log is then unusable
+    bool                            mStopping{false};
+    Stats                           mStats;
+    std::thread                     mThread;
+
+}; // class WriteAheadLog
+
+
+/**
+ * @brief Exceptions on the WriteAheadLog class
+ */
+class WriteAheadLog::Exception : public std::exception
+{
+public:
+    Exception(const std::string& message)
+        : mMessage(message)
+    {
+    }
+
+    virtual ~Exception() = default;
+
+    virtual const char* what() const noexcept override
+    {
+        return mMessage.c_str();
+    }
+
+private:
+    std::string     mMessage;
+
+}; // class WriteAheadLog::Exception
@@ -9,26 +9,111 @@
 
 #include "Receiver.h"
 
-#include "Common/CommonData.h"
 
 #include <iostream>
 #include <thread>
+#include <csignal>
+#include <mutex>
+#include <memory>
+#include <string>
 
 
+static std::mutex sOutputMutex;
+static Receiver* sReceiver = nullptr;
+
+//----------------------------------------------------------------------------
+static void onStopSignal(int)
+{
+    // Only a write to a pipe, so safe in a signal handler.
+    sReceiver->stop();
+}
+
 //----------------------------------------------------------------------------
 static void printBuffer(const void* buffer, size_t size)
 {
+    std::lock_guard<std::mutex> lock(sOutputMutex);
     std::cout.write(static_cast<const char*>(buffer), size);
 }
 
+/**
+ * @brief The part of a stream's last line that has not been printed yet
+ * @details Streams are printed a whole line at a time, so streams that arrive together on one
+ *          connection do not interleave mid-line. Whatever is left prints when the stream ends.
+ */
+struct PendingLine
+{
+    std::string text;
+
+    ~PendingLine()
+    {
+        if (!text.empty())
+        {
+            printBuffer(text.data(), text.size());
+        }
+    }
+};
+
+//----------------------------------------------------------------------------
+static Receiver::Handler printLines(uint16_t, const std::string&)
+{
+    auto pending = std::make_shared<PendingLine>();
+
+    return [pending](const void* buffer, size_t size)
+    {
+        auto data = static_cast<const char*>(buffer);
+        auto end = data + size;
+
+        auto last = end;
+        while (last != data && *(last - 1) != '\n')
+        {
+            --last;
+        }
+
+        if (last != data)
+        {
+            std::lock_guard<std::mutex> lock(sOutputMutex);
+            std::cout.write(pending->text.data(), pending->text.size());
+            std::cout.write(data, last - data);
+            pending->text.clear();
+        }
+
+        pending->text.append(last, end);
+    };
+}
+
 //----------------------------------------------------------------------------
 int main(int argc, const char* const* argv)
 {
     try
     {
-        Receiver receiver;
+        auto data = Receiver::parseCommandLine(argc, argv);
+
+        // A peer that goes away while it is written to (a sender awaiting a reply, its echo, or
+        // a downstream receiver) must be cut off, not take every other connection with it.
+        // Socket::send() asks for no signal already; sendfile() and splice() cannot.
+        std::signal(SIGPIPE, SIG_IGN);
+
+        Receiver receiver{data.config};
+        receiver.setStreamHandlers(printLines);
+
+        sReceiver = &receiver;
+        std::signal(SIGINT, onStopSignal);
+        std::signal(SIGTERM, onStopSignal);
+
+        receiver.execute(data.listen.addr, data.listen.port, printBuffer);
+        std::cout.flush();
+
+        const auto& report = receiver.shutdownReport();
+        std::cerr << "shut down: " << report.connectionsFinished << " connections finished, "
+                  << report.connectionsCutOff << " cut off (" << report.bytesDropped << " bytes dropped)"
+                  << (report.handedOff ? ", listening socket handed over" : "") << std::endl;
 
-        receiver.execute(SERVER_ADDR, SERVER_PORT, printBuffer);
+        if (!data.config.capturePath.empty())
+        {
+            std::cerr << "captured to " << data.config.capturePath << ": " << report.captured.connections
+                      << " connections, " << report.captured.records << " records, "
+                      << report.captured.bytes << " bytes" << std::endl;
+        }
     }
     catch (const std::exception& e)
     {
@@ -0,0 +1,160 @@
+/**
+ * @brief Coalesces small records into larger sends, with a bound on how long a record waits
+ *
+ * @file Batcher.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Source header
+#include "Batcher.h"
+
+
+//-----------------------------------------------------------------------------
+Batcher::Batcher(const Flush& flush, size_t threshold, std::chrono::microseconds maxDelay)
+    : mFlush(flush)
+    , mThreshold(threshold)
+    , mMaxDelay(maxDelay)
+{
+    mBuffer.reserve(mThreshold);
+
+    mTimer = std::thread(&Batcher::_timerThread, this);
+}
+
+
+//-----------------------------------------------------------------------------
+Batcher::~Batcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+
+    mWake.notify_one();
+    mTimer.join();
+}
+
+
+//-----------------------------------------------------------------------------
+void Batcher::add(const void* data, size_t len)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    _rethrowLocked();
+
+    if (mBuffer.size() + len > mThreshold)
+    {
+        _flushLocked();
+    }
+
+    if (len >= mThreshold)
+    {
+        // Nothing to coalesce with; pass it on without copying.
+        mFlush(data, len);
+        ++mBatches;
+        return;
+    }
+
+    bool wasEmpty = mBuffer.empty();
+
+    auto bytes = static_cast<const char*>(data);
+    mBuffer.insert(mBuffer.end(), bytes, bytes + len);
+
+    if (wasEmpty)
+    {
+        // This record starts the clock for the batch.
+        mDeadline = std::chrono::steady_clock::now() + mMaxDelay;
+        lock.unlock();
+        mWake.notify_one();
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+void Batcher::flush()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    _rethrowLocked();
+    _flushLocked();
+}
+
+
+//-----------------------------------------------------------------------------
+uint64_t Batcher::batches() const noexcept
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mBatches;
+}
+
+
+//-----------------------------------------------------------------------------
+// Private Methods
+//-----------------------------------------------------------------------------
+
+/// @internal
+/// @brief Flush batches whose delay has expired, until stopped
+void Batcher::_timerThread()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    while (!mStopping)
+    {
+        if (mBuffer.empty() || mError)
+        {
+            mWake.wait(lock);
+            continue;
+        }
+
+        if (mWake.wait_until(lock, mDeadline) == std::cv_status::timeout
+            && !mBuffer.empty() && std::chrono::steady_clock::now() >= mDeadline)
+        {
+            try
+            {
+                _flushLocked();
+            }
+            catch (...)
+            {
+                mError = std::current_exception();
+            }
+        }
+    }
+}
+
+/// @internal
+/// @brief Pass on the pending batch (the caller holds mMutex)
+void Batcher::_flushLocked()
+{
+    if (mBuffer.empty())
+    {
+        return;
+    }
+
+    // The batch is gone whether or not the flush succeeds; a failed connection does not
+    // get the same bytes again.
+    try
+    {
+        mFlush(mBuffer.data(), mBuffer.size());
+    }
+    catch (...)
+    {
+        mBuffer.clear();
+        throw;
+    }
+
+    mBuffer.clear();
+    ++mBatches;
+}
+
+/// @internal
+/// @brief Report a failure from the timer thread to the producer (the caller holds mMutex)
+void Batcher::_rethrowLocked()
+{
+    if (mError)
+    {
+        auto error = mError;
+        mError = nullptr;
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,90 @@
+/**
+ * @brief Coalesces small records into larger sends, with a bound on how long a record waits
+ *
+ * @file Batcher.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+// Standard Headers
+#include <functional>
+#include <vector>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+#include <stdint.h>
+
+
+/**
+ * @brief Accumulates records and passes them on in batches.
+ * @details A batch is flushed when adding a record would take it past the byte threshold, or
+ *          once its oldest record has waited 'maxDelay', whichever comes first. The delay is
+ *          enforced by a timer thread, so a record is not held back while the producer is blocked
+ *          waiting for more input (e.g. an interactive terminal).
+ *
+ *          The flush function is called with the batch lock held, from either the producer's
+ *          thread or the timer thread, but never from both at once. If it throws on the timer
+ *          thread, the exception is rethrown to the producer by its next call.
+ */
+class Batcher
+{
+    Batcher(const Batcher&) = delete;
+    Batcher& operator =(const Batcher&) = delete;
+
+public: // Definitions
+    using Flush = std::function<void(const void* buffer, size_t len)>;
+
+public: // Methods
+    /**
+     * @brief Construct a Batcher
+     * @param[in] flush         Receives each batch
+     * @param[in] threshold     The batch size, in bytes. Larger records are passed on by themselves.
+     * @param[in] maxDelay      The longest a record may wait before its batch is flushed
+     */
+    Batcher(const Flush& flush, size_t threshold, std::chrono::microseconds maxDelay);
+
+    /// Stops the timer. Anything still pending is discarded; call flush() first to keep it.
+    virtual ~Batcher();
+
+    /**
+     * @brief Add a record
+     * @param[in] data      The record
+     * @param[in] len       The size of the record, in bytes
+     * @throws Whatever the flush function throws
+     */
+    void add(const void* data, size_t len);
+
+    /**
+     * @brief Pass on whatever is pending now
+     * @throws Whatever the flush function throws
+     */
+    void flush();
+
+    /// @brief The number of batches passed on so far
+    uint64_t batches() const noexcept;
+
+private: // Methods
+    void _timerThread();
+    void _flushLocked();
+    void _rethrowLocked();
+
+private: // Members
+    Flush                                   mFlush;
+    size_t                                  mThreshold;
+    std::chrono::microseconds               mMaxDelay;
+
+    mutable std::mutex                      mMutex;
+    std::condition_variable                 mWake;
+    std::vector<char>                       mBuffer;
+    std::chrono::steady_clock::time_point   mDeadline;      ///< When the pending batch must go (if any)
+    std::exception_ptr                      mError;         ///< A failure on the timer thread
+    uint64_t                                mBatches{0};
+    bool                                    mStopping{false};
+    std::thread                             mTimer;
+
+}; // class Batcher
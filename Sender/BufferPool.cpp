@@ -0,0 +1,111 @@
+/**
+ * @brief A fixed set of send buffers that are only reused once the kernel is done with them
+ *
+ * @file BufferPool.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Source header
+#include "BufferPool.h"
+
+// Project headers
+#include "Common/Probes.h"
+
+
+namespace
+{
+    /// Buffers are page aligned so that zero-copy sends pin as few pages as possible.
+    constexpr size_t PAGE_SIZE = 4096;
+}
+
+
+//-----------------------------------------------------------------------------
+BufferPool::BufferPool(size_t count, size_t bufferSize, Common::BufferArena* arena)
+    : mBufferSize((bufferSize + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE)
+    , mMemory(arena, count * mBufferSize)
+{
+    // Hand out low indices first
+    for (size_t index = count; index > 0; --index)
+    {
+        mFree.push_back(index - 1);
+    }
+
+    mInFlight.reserve(count);
+}
+
+
+//-----------------------------------------------------------------------------
+BufferPool::~BufferPool() = default;
+
+
+//-----------------------------------------------------------------------------
+size_t BufferPool::bufferSize() const noexcept
+{
+    return mBufferSize;
+}
+
+
+//-----------------------------------------------------------------------------
+std::optional<size_t> BufferPool::tryAcquire()
+{
+    std::optional<size_t> result;
+
+    if (!mFree.empty())
+    {
+        result = mFree.back();
+        mFree.pop_back();
+    }
+    else
+    {
+        NS_PROBE1(bufferpool_exhausted, mInFlight.size());
+    }
+
+    return result;
+}
+
+
+//-----------------------------------------------------------------------------
+char* BufferPool::data(size_t index) noexcept
+{
+    return mMemory.get() + index * mBufferSize;
+}
+
+
+//-----------------------------------------------------------------------------
+void BufferPool::release(size_t index)
+{
+    mFree.push_back(index);
+}
+
+
+//-----------------------------------------------------------------------------
+void BufferPool::releaseInFlight(size_t index, Ticket ticket)
+{
+    mInFlight.push_back(InFlight{index, ticket});
+}
+
+
+//-----------------------------------------------------------------------------
+size_t BufferPool::reclaim(const std::function<bool(Ticket)>& isComplete)
+{
+    // Sends complete in order, so stop at the first one still outstanding.
+    size_t reclaimed = 0;
+    while (reclaimed < mInFlight.size() && isComplete(mInFlight[reclaimed].ticket))
+    {
+        mFree.push_back(mInFlight[reclaimed].index);
+        ++reclaimed;
+    }
+
+    mInFlight.erase(mInFlight.begin(), mInFlight.begin() + reclaimed);
+
+    return reclaimed;
+}
+
+
+//-----------------------------------------------------------------------------
+size_t BufferPool::inFlight() const noexcept
+{
+    return mInFlight.size();
+}
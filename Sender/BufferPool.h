@@ -0,0 +1,102 @@
+/**
+ * @brief A fixed set of send buffers that are only reused once the kernel is done with them
+ *
+ * @file BufferPool.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+// Project headers
+#include "Common/BufferArena.h"
+
+// Standard Headers
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <stdint.h>
+#include <cstdlib>
+
+
+/**
+ * @brief A pool of equally sized buffers for block sends.
+ * @details A buffer handed to a zero-copy send is still being read by the kernel after the send
+ *          returns. Such buffers are released "in flight" with the socket's completion ticket and
+ *          are not handed out again until reclaim() confirms the ticket has completed, so data
+ *          queued for transmission is never overwritten.
+ */
+class BufferPool
+{
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator =(const BufferPool&) = delete;
+
+public: // Definitions
+    /// Identifies a zero-copy send; see Common::Socket::sendZeroCopy()
+    using Ticket = uint32_t;
+
+public: // Methods
+    /**
+     * @brief Construct a BufferPool
+     * @param[in] count         The number of buffers
+     * @param[in] bufferSize    The size of each buffer, in bytes
+     * @param[in] arena         Where to take the buffers' memory from (null: the heap)
+     */
+    BufferPool(size_t count, size_t bufferSize, Common::BufferArena* arena = nullptr);
+
+    virtual ~BufferPool();
+
+    /// @brief The size of each buffer, in bytes
+    size_t bufferSize() const noexcept;
+
+    /**
+     * @brief Take a free buffer
+     * @return The index of the buffer, or unset if every buffer is held or in flight
+     */
+    std::optional<size_t> tryAcquire();
+
+    /**
+     * @brief Get the memory of a buffer
+     * @param[in] index     A buffer index from tryAcquire()
+     */
+    char* data(size_t index) noexcept;
+
+    /**
+     * @brief Return a buffer that nothing else refers to
+     * @param[in] index     A buffer index from tryAcquire()
+     */
+    void release(size_t index);
+
+    /**
+     * @brief Return a buffer that the kernel may still be reading
+     * @param[in] index     A buffer index from tryAcquire()
+     * @param[in] ticket    The completion ticket of the send that used it
+     */
+    void releaseInFlight(size_t index, Ticket ticket);
+
+    /**
+     * @brief Make in-flight buffers whose sends have completed available again
+     * @param[in] isComplete    Reports whether a ticket has completed
+     * @return The number of buffers reclaimed
+     */
+    size_t reclaim(const std::function<bool(Ticket)>& isComplete);
+
+    /// @brief The number of buffers waiting on the kernel
+    size_t inFlight() const noexcept;
+
+private: // Definitions
+    struct InFlight
+    {
+        size_t  index;
+        Ticket  ticket;
+    };
+
+private: // Members
+    size_t                              mBufferSize;
+    Common::BufferArena::Buffer         mMemory;
+    std::vector<size_t>                 mFree;
+    std::vector<InFlight>               mInFlight;          ///< In send order, so tickets ascend
+
+}; // class BufferPool
@@ -0,0 +1,107 @@
+/**
+ * @brief Content-defined chunking, so that data shared between files divides the same way in each
+ *
+ * @file Chunker.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#include "Chunker.h"
+
+// Standard headers
+#include <array>
+#include <algorithm>
+
+
+namespace
+{
+    /// One random value per byte value, fixed so that every sender cuts alike
+    constexpr std::array<uint64_t, 256> makeGear() noexcept
+    {
+        std::array<uint64_t, 256> gear{};
+        uint64_t state = 0x4765617254616231ull;
+        for (auto& value : gear)
+        {
+            // splitmix64
+            uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            value = z ^ (z >> 31);
+        }
+        return gear;
+    }
+
+    constexpr auto GEAR = makeGear();
+
+    /// A mask of the top 'bits' bits, which depend on the most recent bytes of all
+    constexpr uint64_t topBits(unsigned bits) noexcept
+    {
+        return (bits == 0) ? 0 : ~0ull << (64 - bits);
+    }
+
+    unsigned log2(size_t value) noexcept
+    {
+        unsigned bits = 0;
+        while (value >>= 1)
+        {
+            ++bits;
+        }
+        return bits;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+Chunker::Chunker(size_t minSize, size_t averageSize, size_t maxSize)
+    : mMinSize(minSize)
+    , mAverageSize(averageSize)
+    , mMaxSize(maxSize)
+{
+    if (minSize > averageSize || averageSize > maxSize || averageSize < 4
+        || (averageSize & (averageSize - 1)) != 0)
+    {
+        throw Exception("Chunk sizes must satisfy min <= average <= max, with a power of two average.");
+    }
+
+    // Normalization level 1: one bit more than the average calls for, then one bit fewer.
+    const auto bits = log2(averageSize);
+    mSmallMask = topBits(std::min(bits + 1, 63u));
+    mLargeMask = topBits(bits - 1);
+}
+
+//-----------------------------------------------------------------------------
+size_t Chunker::cut(const void* data, size_t len) const noexcept
+{
+    if (len <= mMinSize)
+    {
+        return len;
+    }
+
+    auto bytes = static_cast<const uint8_t*>(data);
+    const auto normal = std::min(mAverageSize, len);
+    const auto end = std::min(mMaxSize, len);
+
+    uint64_t hash = 0;
+    size_t position = mMinSize;
+
+    for (; position < normal; ++position)
+    {
+        hash = (hash << 1) + GEAR[bytes[position]];
+        if ((hash & mSmallMask) == 0)
+        {
+            return position + 1;
+        }
+    }
+
+    for (; position < end; ++position)
+    {
+        hash = (hash << 1) + GEAR[bytes[position]];
+        if ((hash & mLargeMask) == 0)
+        {
+            return position + 1;
+        }
+    }
+
+    return end;
+}
@@ -0,0 +1,89 @@
+/**
+ * @brief Content-defined chunking, so that data shared between files divides the same way in each
+ *
+ * @file Chunker.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+// Standard Headers
+#include <exception>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * @brief Finds chunk boundaries by content, with FastCDC.
+ * @details A Gear hash rolls over the data (h = (h << 1) + GEAR[byte]), and a chunk ends where its
+ *          top bits are all zero. Since the hash only depends on the last 64 bytes, boundaries
+ *          follow the content: an insertion early in a file shifts the boundaries after it along
+ *          with the data, rather than changing every chunk from there on as fixed-size blocks would.
+ *
+ *          No boundary is looked for in the first 'minSize' bytes of a chunk, which is both the
+ *          bulk of the speed-up and a floor on chunk size. Normalized chunking then tests more bits
+ *          before 'averageSize' and fewer after, which gathers chunk sizes closely around the
+ *          average; 'maxSize' ends a chunk regardless.
+ */
+class Chunker
+{
+public: // Definitions
+    class Exception;
+
+    static constexpr size_t MIN_SIZE = 2 * 1024;
+    static constexpr size_t AVERAGE_SIZE = 8 * 1024;
+    static constexpr size_t MAX_SIZE = 64 * 1024;
+
+public: // Methods
+    /**
+     * @brief Construct a Chunker
+     * @param[in] minSize       The smallest chunk, other than the last of the data
+     * @param[in] averageSize   The size chunks are gathered around; a power of two
+     * @param[in] maxSize       The largest chunk
+     * @throws Exception unless minSize <= averageSize <= maxSize
+     */
+    explicit Chunker(size_t minSize = MIN_SIZE, size_t averageSize = AVERAGE_SIZE, size_t maxSize = MAX_SIZE);
+
+    /**
+     * @brief Find the end of the chunk at the start of some data
+     * @param[in] data      The data, from the start of a chunk
+     * @param[in] len       The number of bytes; the data ends at most here
+     * @return The length of the chunk
+     */
+    size_t cut(const void* data, size_t len) const noexcept;
+
+private: // Members
+    size_t      mMinSize;
+    size_t      mAverageSize;
+    size_t      mMaxSize;
+    uint64_t    mSmallMask;         ///< Harder to match, before the average size
+    uint64_t    mLargeMask;         ///< Easier to match, after it
+
+}; // class Chunker
+
+
+/**
+ * @brief Exceptions on the Chunker class
+ */
+class Chunker::Exception : public std::exception
+{
+public:
+    Exception(const std::string& message)
+        : mMessage(message)
+    {
+    }
+
+    virtual ~Exception() = default;
+
+    virtual const char* what() const noexcept override
+    {
+        return mMessage.c_str();
+    }
+
+private:
+    std::string     mMessage;
+
+}; // class Chunker::Exception
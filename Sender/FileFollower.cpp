@@ -0,0 +1,704 @@
+/**
+ * @brief Follows files as they grow, across rotation, without polling
+ *
+ * @file FileFollower.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Source header
+#include "FileFollower.h"
+
+// System headers
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+// Standard headers
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+
+namespace
+{
+    /// Events on a followed file: appends, and signs that it may no longer be at its path
+    constexpr uint32_t FILE_EVENTS = IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF;
+
+    /// Events on a followed file's directory: something new at one of the paths
+    constexpr uint32_t DIRECTORY_EVENTS = IN_CREATE | IN_MOVED_TO | IN_ONLYDIR;
+
+    /// Room for the inotify events of one read
+    constexpr size_t EVENT_BUFFER_SIZE = 64 * 1024;
+
+    std::string errorText(const std::string& what)
+    {
+        return what + ": " + std::strerror(errno);
+    }
+
+    bool sameFile(const struct stat& first, const struct stat& second)
+    {
+        return first.st_dev == second.st_dev && first.st_ino == second.st_ino;
+    }
+
+    /// Each file can hold two descriptors open at a rotation; lift the soft limit to make room.
+    void reserveDescriptors(size_t files)
+    {
+        struct rlimit limit;
+        if (getrlimit(RLIMIT_NOFILE, &limit) < 0)
+        {
+            return;
+        }
+
+        const auto wanted = static_cast<rlim_t>(2 * files + 64);
+        if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < wanted)
+        {
+            limit.rlim_cur = (limit.rlim_max == RLIM_INFINITY) ? wanted : std::min(wanted, limit.rlim_max);
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+FileFollower::FileFollower(const std::vector<std::string>& paths, bool fromStart)
+    : mBuffer(READ_SIZE)
+{
+    reserveDescriptors(paths.size());
+
+    try
+    {
+        mInotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (mInotify < 0)
+        {
+            throw Exception(errorText("Cannot create inotify instance"));
+        }
+
+        mStopEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (mStopEvent < 0)
+        {
+            throw Exception(errorText("Cannot create eventfd"));
+        }
+
+        mEpoll = epoll_create1(EPOLL_CLOEXEC);
+        if (mEpoll < 0)
+        {
+            throw Exception(errorText("Cannot create epoll instance"));
+        }
+
+        for (auto fd : {mInotify, mStopEvent})
+        {
+            struct epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            if (epoll_ctl(mEpoll, EPOLL_CTL_ADD, fd, &event) < 0)
+            {
+                throw Exception(errorText("Cannot add to epoll instance"));
+            }
+        }
+
+        mFiles.reserve(paths.size());
+        for (const auto& path : paths)
+        {
+            File file;
+            file.path = path;
+            auto slash = path.rfind('/');
+            file.name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+            mFiles.push_back(std::move(file));
+        }
+
+        for (size_t index = 0; index < mFiles.size(); ++index)
+        {
+            // Watch the directory first, so that a file created meanwhile is not missed.
+            _watchDirectory(index);
+            _open(index, fromStart);
+        }
+    }
+    catch (...)
+    {
+        _closeAll();
+        throw;
+    }
+}
+
+//-----------------------------------------------------------------------------
+FileFollower::~FileFollower()
+{
+    _closeAll();
+}
+
+//-----------------------------------------------------------------------------
+void FileFollower::run(const Deliver& deliver)
+{
+    mDeliver = &deliver;
+
+    try
+    {
+        // Anything appended since construction has raised no event to wait for.
+        for (size_t index = 0; index < mFiles.size(); ++index)
+        {
+            _queue(index);
+        }
+
+        bool stopping = false;
+        while (!stopping)
+        {
+            // Block only when every file has been read up to date.
+            struct epoll_event events[2];
+            auto count = epoll_wait(mEpoll, events, 2, mReady.empty() ? -1 : 0);
+            if (count < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                throw Exception(errorText("Cannot wait for file events"));
+            }
+
+            for (int event = 0; event < count; ++event)
+            {
+                if (events[event].data.fd == mStopEvent)
+                {
+                    uint64_t value;
+                    auto drained = read(mStopEvent, &value, sizeof(value));
+                    (void)drained;
+                    stopping = true;
+                }
+                else
+                {
+                    _onEvents();
+                }
+            }
+
+            // One turn for each file with data; those with more go round again.
+            for (auto turns = mReady.size(); turns > 0; --turns)
+            {
+                auto index = mReady.front();
+                mReady.pop_front();
+                mFiles[index].ready = false;
+
+                size_t budget = TURN_BYTES;
+                if (_read(index, budget))
+                {
+                    _queue(index);
+                }
+            }
+        }
+
+        // Pass on everything written up to now, and the lines still in progress.
+        mReady.clear();
+        for (size_t index = 0; index < mFiles.size(); ++index)
+        {
+            auto& file = mFiles[index];
+            file.ready = false;
+
+            size_t budget = std::numeric_limits<size_t>::max();
+            _read(index, budget);
+            _completeLine(file, index);
+        }
+    }
+    catch (...)
+    {
+        mDeliver = nullptr;
+        throw;
+    }
+
+    mDeliver = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+void FileFollower::stop() noexcept
+{
+    uint64_t value = 1;
+    while (write(mStopEvent, &value, sizeof(value)) < 0 && errno == EINTR)
+    {
+    }
+}
+
+//-----------------------------------------------------------------------------
+const std::string& FileFollower::path(size_t file) const
+{
+    return mFiles.at(file).path;
+}
+
+//-----------------------------------------------------------------------------
+const FileFollower::Stats& FileFollower::stats() const noexcept
+{
+    return mStats;
+}
+
+//-----------------------------------------------------------------------------
+// Private Methods
+//-----------------------------------------------------------------------------
+
+/// @internal
+/// @brief Watch the directory of a file, for new files at its path
+void FileFollower::_watchDirectory(size_t index)
+{
+    const auto& path = mFiles[index].path;
+    auto slash = path.rfind('/');
+    std::string directory = (slash == std::string::npos) ? "." : (slash == 0) ? "/" : path.substr(0, slash);
+
+    auto wd = inotify_add_watch(mInotify, directory.c_str(), DIRECTORY_EVENTS);
+    if (wd < 0)
+    {
+        throw Exception(errorText("Cannot watch " + directory));
+    }
+
+    auto& watch = mWatches[wd];
+    watch.directory = true;
+    watch.files.push_back(index);
+}
+
+//-----------------------------------------------------------------------------
+/// @internal
+/// @brief Watch an open file
+/// @return The watch descriptor
+int FileFollower::_watch(size_t index, int fd)
+{
+    // Watch the file that is open rather than whatever is at its path by now.
+    auto opened = "/proc/self/fd/" + std::to_string(fd);
+    auto wd = inotify_add_watch(mInotify, opened.c_str(), FILE_EVENTS);
+    if (wd < 0 && errno == ENOENT)
+    {
+        wd = inotify_add_watch(mInotify, mFiles[index].path.c_str(), FILE_EVENTS);
+    }
+
+    if (wd < 0)
+    {
+        if (errno == ENOSPC)
+        {
+            throw Exception("Cannot watch " + mFiles[index].path + ": out of inotify watches"
+                            " (see fs.inotify.max_user_watches)");
+        }
+
+        throw Exception(errorText("Cannot watch " + mFiles[index].path));
+    }
+
+    auto& files = mWatches[wd].files;
+    if (std::find(files.begin(), files.end(), index) == files.end())
+    {
+        files.push_back(index);
+    }
+
+    return wd;
+}
+
+//-----------------------------------------------------------------------------
+/// @internal
+/// @brief Stop watching a file for the given follower; the watch goes once no follower needs it
+void FileFollower::_unwatch(size_t index, int wd)
+{
+    auto found = mWatches.find(wd);
+    if (found == mWatches.end())
+    {
+        return;
+    }
+
+    auto& files = found->second.files;
+    files.erase(std::remove(files.begin(), files.end(), index), files.end());
+
+    // The same file can be followed at two paths, or be both the current and retired file of one.
+    const bool stillUsed = std::any_of(files.begin(), files.end(), [this, wd](size_t other)
+    {
+        return mFiles[other].wd == wd || mFiles[other].retiredWd == wd;
+    });
+
+    if (!stillUsed)
+    {
+        inotify_rm_watch(mInotify, wd);
+        mWatches.erase(found);
+    }
+}
+
+//-----------------------------------------------------------------------------
+/// @internal
+/// @brief Open the file at a path and watch it
+/// @return false if there is no file there
+bool FileFollower::_open(size_t index, bool fromStart)
+{
+    auto& file = mFiles[index];
+
+    auto fd = ::open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        if (errno == ENOENT)
+        {
+            return false;
+        }
+
+        throw Exception(errorText("Cannot open " + file.path));
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) < 0 || !S_ISREG(info.st_mode))
+    {
+        close(fd);
+        throw Exception(file.path + " is not a regular file");
+    }
+
+    try
+    {
+        file.wd = _watch(index, fd);
+    }
+    catch (...)
+    {
+        close(fd);
+        throw;
+    }
+
+    file.fd = fd;
+    file.offset = fromStart ? 0 : static_cast<uint64_t>(info.st_size);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/// @internal
+/// @brief Read and act on every inotify event pending
+void FileFollower::_onEvents()
+{
+    alignas(struct inotify_event) char buffer[EVENT_BUFFER_SIZE];
+
+    for (;;)
+    {
+        auto got = read(mInotify, buffer, sizeof(buffer));
+        if (got < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            if (errno == EAGAIN)
+            {
+                return;
+            }
+
+            throw Exception(errorText("Cannot read file events"));
+        }
+
+        for (char* next = buffer; next < buffer + got; )
+        {
+            auto event = reinterpret_cast<const struct inotify_event*>(next);
+            next += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                // Events were lost; look at everything again.
+                for (size_t index = 0; index < mFiles.size(); ++index)
+                {
+                    _checkPath(index);
+                    _queue(index);
+                }
+                continue;
+            }
+
+            auto found = mWatches.find(event->wd);
+            if (found == mWatches.end())
+            {
+                continue;
+            }
+
+            if (event->mask & IN_IGNORED)
+            {
+                // The file is gone, and its watch with it.
+                for (auto index : found->second.files)
+                {
+                    auto& file = mFiles[index];
+                    file.wd = (file.wd == event->wd) ? -1 : file.wd;
+                    file.retiredWd = (file.retiredWd == event->wd) ? -1 : file.retiredWd;
+                }
+                mWatches.erase(found);
+                continue;
+            }
+
+            // Acting on an event can change the watches.
+            const auto watch = found->second;
+
+            for (auto index : watch.files)
+            {
+                if (watch.directory)
+                {
+                    if (event->len > 0 && mFiles[index].name == event->name)
+                    {
+                        _checkPath(index);
+                    }
+                    continue;
+                }
+
+                if ((event->mask & (IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF)) && mFiles[index].wd == event->wd)
+                {
+                    _checkPath(index);
+                }
+
+                _queue(index);
+            }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+/// @internal
+/// @brief Give a file a turn to be read
+void FileFollower::_queue(size_t index)
+{
+    auto& file = mFiles[index];
+    if (!file.ready)
+    {
+        file.ready = true;
+        mReady.push_back(index);
+    }
+}
+
+//-----------------------------------------------------------------------------
+/// @internal
+/// @brief Pass on what has been appended to a file, up to a budget of bytes
+/// @return true if the budget ran out before the end of the file
+bool FileFollower::_read(size_t index, size_t& budget)
+{
+    auto& file = mFiles[index];
+
+    if (file.retiredFd >= 0)
+    {
+        if (_readFd(file, index, file.retiredFd, file.retiredOffset, budget))
+        {
+            return true;
+        }
+
+        // The old file is finished with once the writer has moved over to the new one.
+        struct stat info;
+        if (file.fd < 0 || fstat(file.fd, &info) < 0 || info.st_size == 0)
+        {
+            return false;
+        }
+
+        _completeLine(file, index);
+        _closeRetired(file, index);
+    }
+
+    if (file.fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(file.fd, &info) < 0)
+    {
+        throw Exception(errorText("Cannot examine " + file.path));
+    }
+
+    if (static_cast<uint64_t>(info.st_size) < file.offset)
+    {
+        // Truncated in place; what is there now was written since.
+        _completeLine(file, index);
+        file.offset = 0;
+        ++mStats.truncations;
+    }
+
+    return _readFd(file, index, file.fd, file.offset, budget);
+}
+
+//-----------------------------------------------------------------------------
+/// @internal
+/// @brief Pass on one descriptor's data from an offset, up to a budget of bytes
+/// @return true if the budget ran out before the end of the file
+bool FileFollower::_readFd(File& file, size_t index, int fd, uint64_t& offset, size_t& budget)
+{
+    while (budget > 0)
+    {
+        auto got = pread(fd, mBuffer.data(), std::min(mBuffer.size(), budget), static_cast<off_t>(offset));
+        if (got < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            throw Exception(errorText("Cannot read " + file.path));
+        }
+
+        if (got == 0)
+        {
+            return false;
+        }
+
+        offset += static_cast<uint64_t>(got);
+        budget -= static_cast<size_t>(got);
+        _pass(file, index, mBuffer.data(), static_cast<size_t>(got));
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/// @internal
+/// @brief Pass on the whole lines in some data read from a file, and keep the rest
+void FileFollower::_pass(File& file, size_t index, const char* data, size_t len)
+{
+    auto last = static_cast<const char*>(memrchr(data, '\n', len));
+    if (last != nullptr)
+    {
+        const auto whole = static_cast<size_t>(last - data) + 1;
+        if (file.partial.empty())
+        {
+            (*mDeliver)(index, data, whole);
+        }
+        else
+        {
+            file.partial.append(data, whole);
+            (*mDeliver)(index, file.partial.data(), file.partial.size());
+            file.partial.clear();
+        }
+
+        mStats.bytes += whole;
+        data += whole;
+        len -= whole;
+    }
+
+    file.partial.append(data, len);
+    if (file.partial.size() >= MAX_LINE)
+    {
+        _completeLine(file, index);
+    }
+}
+
+//-----------------------------------------------------------------------------
+/// @internal
+/// @brief Pass on a line in progress, ended with a newline
+void FileFollower::_completeLine(File& file, size_t index)
+{
+    if (file.partial.empty())
+    {
+        return;
+    }
+
+    file.partial.push_back('\n');
+    (*mDeliver)(index, file.partial.data(), file.partial.size());
+    mStats.bytes += file.partial.size();
+    file.partial.clear();
+}
+
+//-----------------------------------------------------------------------------
+/// @internal
+/// @brief Follow whichever file is at a path now, if it is not the one followed already
+void FileFollower::_checkPath(size_t index)
+{
+    auto& file = mFiles[index];
+
+    struct stat atPath;
+    const bool exists = (stat(file.path.c_str(), &atPath) == 0);
+
+    struct stat info;
+    if (file.fd >= 0 && fstat(file.fd, &info) == 0 && exists && sameFile(info, atPath))
+    {
+        return;
+    }
+
+    if (file.fd >= 0)
+    {
+        // Renamed or removed, though its writer may still be appending to it.
+        _retire(index);
+    }
+
+    if (!exists)
+    {
+        return;
+    }
+
+    if (file.retiredFd >= 0 && fstat(file.retiredFd, &info) == 0 && sameFile(info, atPath))
+    {
+        // Moved back again: carry on from where reading it left off.
+        file.fd = file.retiredFd;
+        file.wd = file.retiredWd;
+        file.offset = file.retiredOffset;
+        file.retiredFd = -1;
+        file.retiredWd = -1;
+        file.retiredOffset = 0;
+        return;
+    }
+
+    // Written since it appeared, so all of it is new.
+    if (_open(index, true))
+    {
+        _queue(index);
+    }
+}
+
+//-----------------------------------------------------------------------------
+/// @internal
+/// @brief Keep reading the file at a path only until its writer moves over to a new one
+void FileFollower::_retire(size_t index)
+{
+    auto& file = mFiles[index];
+
+    if (file.retiredFd >= 0)
+    {
+        // Rotated twice over; the oldest is finished with.
+        size_t budget = std::numeric_limits<size_t>::max();
+        _readFd(file, index, file.retiredFd, file.retiredOffset, budget);
+        _completeLine(file, index);
+        _closeRetired(file, index);
+    }
+
+    file.retiredFd = file.fd;
+    file.retiredWd = file.wd;
+    file.retiredOffset = file.offset;
+    file.fd = -1;
+    file.wd = -1;
+    file.offset = 0;
+    ++mStats.rotations;
+}
+
+//-----------------------------------------------------------------------------
+/// @internal
+/// @brief Close the file previously at a path
+void FileFollower::_closeRetired(File& file, size_t index)
+{
+    // A file moved back to its path is current again, and so still watched.
+    if (file.retiredWd >= 0 && file.retiredWd != file.wd)
+    {
+        _unwatch(index, file.retiredWd);
+    }
+
+    close(file.retiredFd);
+    file.retiredFd = -1;
+    file.retiredWd = -1;
+    file.retiredOffset = 0;
+}
+
+//-----------------------------------------------------------------------------
+/// @internal
+/// @brief Release every descriptor
+void FileFollower::_closeAll() noexcept
+{
+    for (auto& file : mFiles)
+    {
+        for (auto fd : {file.fd, file.retiredFd})
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+        file.fd = -1;
+        file.retiredFd = -1;
+    }
+
+    // Closing the inotify instance removes its watches.
+    for (auto fd : {mEpoll, mStopEvent, mInotify})
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+    mEpoll = -1;
+    mStopEvent = -1;
+    mInotify = -1;
+}
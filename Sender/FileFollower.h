@@ -0,0 +1,173 @@
+/**
+ * @brief Follows files as they grow, across rotation, without polling
+ *
+ * @file FileFollower.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+// Standard Headers
+#include <exception>
+#include <functional>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * @brief Passes on what is appended to a set of files, a line at a time, as it is written.
+ * @details Every file is held open and watched through one inotify descriptor, which an epoll
+ *          loop waits on, so an append wakes the loop at once and an idle file costs nothing.
+ *          Thousands of files can be followed by the one thread that calls run().
+ *
+ *          Both kinds of log rotation are followed:
+ *          - Truncation in place (copytruncate): the file is found to be shorter than what has
+ *            been read of it, and is read again from its start.
+ *          - Rename (or removal) and re-creation: the parent directory is watched too, and when
+ *            the path names a new file, that file is followed from its start. The old file stays
+ *            open, since its writer may not have moved over yet, and is read to its end once the
+ *            new file receives data. Lines written before the rotation are therefore passed on
+ *            before any written after it.
+ *
+ *          Only whole lines are passed on, so that lines from different files can share one
+ *          connection without being split apart. A line is completed with a newline when its file
+ *          is rotated or the follower stops, or once MAX_LINE bytes of it are pending.
+ */
+class FileFollower
+{
+    FileFollower(const FileFollower&) = delete;
+    FileFollower& operator =(const FileFollower&) = delete;
+
+public: // Definitions
+    class Exception;
+
+    /// Receives whole lines appended to the file with the given index (in the order given)
+    using Deliver = std::function<void(size_t file, const char* data, size_t len)>;
+
+    /// The most read from one file per turn, so a busy file cannot starve the rest
+    static constexpr size_t TURN_BYTES = 1024 * 1024;
+
+    /// The size of each read
+    static constexpr size_t READ_SIZE = 64 * 1024;
+
+    /// A line that grows past this is passed on in pieces
+    static constexpr size_t MAX_LINE = 64 * 1024;
+
+    /// Statistics gathered by a FileFollower
+    struct Stats
+    {
+        uint64_t    bytes{0};           ///< Bytes passed on (including completing newlines)
+        uint64_t    truncations{0};     ///< Files found truncated and read again from the start
+        uint64_t    rotations{0};       ///< Files moved or removed from their path, and followed anew there
+    };
+
+public: // Methods
+    /**
+     * @brief Construct a FileFollower, and start watching the files
+     * @param[in] paths         The files to follow. A file need not exist yet, but its directory must.
+     * @param[in] fromStart     Pass on what the files already hold, rather than only what is
+     *                          appended from now on. Files that appear later are always read from
+     *                          their start.
+     * @throws Exception upon failure to watch a file or its directory
+     */
+    explicit FileFollower(const std::vector<std::string>& paths, bool fromStart = false);
+
+    virtual ~FileFollower();
+
+    /**
+     * @brief Pass on lines as they are appended, until stop() is called
+     * @param[in] deliver   Called on this thread with each run of whole lines
+     * @throws Exception upon failure, or whatever 'deliver' throws
+     */
+    void run(const Deliver& deliver);
+
+    /**
+     * @brief Make run() return, once it has passed on any partial lines. Safe from any thread.
+     */
+    void stop() noexcept;
+
+    /// @brief The path of a file followed, by index
+    const std::string& path(size_t file) const;
+
+    /// @brief Get the statistics gathered so far (from the thread that calls run(), or after it returns)
+    const Stats& stats() const noexcept;
+
+private: // Definitions
+    struct File
+    {
+        std::string     path;
+        std::string     name;               ///< The last component of the path
+        int             fd{-1};             ///< The file now at the path, if any
+        int             wd{-1};             ///< Its inotify watch
+        uint64_t        offset{0};          ///< How much of it has been read
+        int             retiredFd{-1};      ///< The file previously at the path, until its writer moves over
+        int             retiredWd{-1};
+        uint64_t        retiredOffset{0};
+        std::string     partial;            ///< The start of a line not yet complete
+        bool            ready{false};       ///< Queued to be read
+    };
+
+    struct Watch
+    {
+        bool                directory{false};
+        std::vector<size_t> files;
+    };
+
+private: // Methods
+    void _watchDirectory(size_t index);
+    int _watch(size_t index, int fd);
+    void _unwatch(size_t index, int wd);
+    bool _open(size_t index, bool fromStart);
+    void _onEvents();
+    void _queue(size_t index);
+    bool _read(size_t index, size_t& budget);
+    bool _readFd(File& file, size_t index, int fd, uint64_t& offset, size_t& budget);
+    void _pass(File& file, size_t index, const char* data, size_t len);
+    void _completeLine(File& file, size_t index);
+    void _checkPath(size_t index);
+    void _retire(size_t index);
+    void _closeRetired(File& file, size_t index);
+    void _closeAll() noexcept;
+
+private: // Members
+    int                                 mInotify{-1};
+    int                                 mEpoll{-1};
+    int                                 mStopEvent{-1};     ///< An eventfd that stop() signals
+    std::vector<File>                   mFiles;
+    std::unordered_map<int, Watch>      mWatches;           ///< By inotify watch descriptor
+    std::deque<size_t>                  mReady;             ///< Files with data to read, in turn
+    std::vector<char>                   mBuffer;
+    const Deliver*                      mDeliver{nullptr};  ///< While run() is running
+    Stats                               mStats;
+
+}; // class FileFollower
+
+
+/**
+ * @brief Exceptions on the FileFollower class
+ */
+class FileFollower::Exception : public std::exception
+{
+public:
+    Exception(const std::string& message)
+        : mMessage(message)
+    {
+    }
+
+    virtual ~Exception() = default;
+
+    virtual const char* what() const noexcept override
+    {
+        return mMessage.c_str();
+    }
+
+private:
+    std::string     mMessage;
+
+}; // class FileFollower::Exception
@@ -0,0 +1,255 @@
+/**
+ * @brief Spreads inputs across a fleet of receivers by key
+ *
+ * @file ReceiverSet.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Source header
+#include "ReceiverSet.h"
+
+// Standard headers
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+
+//-----------------------------------------------------------------------------
+ReceiverSet::ReceiverSet(const std::vector<Member>& members, size_t maxConnections, Connect connect,
+                         const Common::SocketOptions& options)
+    : mMembers(members)
+    , mHealth(members.size())
+    , mMaxConnections(std::max<size_t>(maxConnections, 1))
+    , mConnect(std::move(connect))
+{
+    if (mMembers.empty())
+    {
+        throw Exception("A receiver set needs at least one receiver.");
+    }
+
+    for (auto& member : mMembers)
+    {
+        member.weight = std::max(member.weight, 1u);
+        mNames.push_back(member.endpoint.toString());
+    }
+
+    if (!mConnect)
+    {
+        mConnect = [options](const Common::Endpoint& endpoint)
+        {
+            auto sender = std::make_unique<Sender>(endpoint.addr, endpoint.port);
+            sender->setSocketOptions(options);
+            sender->connect(CONNECT_RETRIES);
+            return sender;
+        };
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+ReceiverSet::~ReceiverSet() = default;
+
+
+//-----------------------------------------------------------------------------
+std::vector<size_t> ReceiverSet::rank(const std::string& key) const
+{
+    // Weighted rendezvous: each receiver draws a uniform u in (0, 1) from the hash of the pair
+    // and scores weight / -ln(u). The best score wins, with probability proportional to weight.
+    std::vector<double> scores(mMembers.size());
+    for (size_t index = 0; index < mMembers.size(); ++index)
+    {
+        auto unit = (static_cast<double>(_hash(key, mNames[index]) >> 11) + 0.5) / 9007199254740992.0;
+        scores[index] = mMembers[index].weight / -std::log(unit);
+    }
+
+    std::vector<size_t> order(mMembers.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&scores](size_t left, size_t right){ return scores[left] > scores[right]; });
+
+    return order;
+}
+
+
+//-----------------------------------------------------------------------------
+Sender& ReceiverSet::sender(const std::string& key)
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    for (auto member : rank(key))
+    {
+        if (!mHealth[member].up && now < mHealth[member].retryAt)
+        {
+            continue;
+        }
+
+        auto found = _find(member);
+        if (found != mConnections.end())
+        {
+            // Most recently used moves to the front.
+            mConnections.splice(mConnections.begin(), mConnections, found);
+            return *mConnections.front().sender;
+        }
+
+        try
+        {
+            return _connect(member);
+        }
+        catch (const std::exception&)
+        {
+            // Fail over to the key's next receiver.
+            _markDown(member);
+        }
+    }
+
+    throw Exception("No receiver can be reached for " + key + ".");
+}
+
+
+//-----------------------------------------------------------------------------
+void ReceiverSet::failed(const std::string& key)
+{
+    // sender() handed out the best-ranked receiver that was up.
+    for (auto member : rank(key))
+    {
+        if (mHealth[member].up)
+        {
+            _markDown(member);
+            return;
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+size_t ReceiverSet::checkHealth()
+{
+    const auto now = std::chrono::steady_clock::now();
+    size_t up = 0;
+
+    for (size_t member = 0; member < mMembers.size(); ++member)
+    {
+        if (!mHealth[member].up && now >= mHealth[member].retryAt)
+        {
+            try
+            {
+                // A probe only; the connection is not kept, so the set stays small.
+                mConnect(mMembers[member].endpoint);
+                _markUp(member);
+            }
+            catch (const std::exception&)
+            {
+                _markDown(member);
+            }
+        }
+
+        up += mHealth[member].up ? 1 : 0;
+    }
+
+    return up;
+}
+
+
+//-----------------------------------------------------------------------------
+bool ReceiverSet::isUp(size_t member) const
+{
+    return mHealth.at(member).up;
+}
+
+
+//-----------------------------------------------------------------------------
+size_t ReceiverSet::openConnections() const noexcept
+{
+    return mConnections.size();
+}
+
+
+//-----------------------------------------------------------------------------
+const std::vector<ReceiverSet::Member>& ReceiverSet::members() const noexcept
+{
+    return mMembers;
+}
+
+
+//-----------------------------------------------------------------------------
+// Private Methods
+//-----------------------------------------------------------------------------
+
+/// @internal
+/// @brief Hash a key together with a member's name (FNV-1a, then a 64-bit finalizer)
+uint64_t ReceiverSet::_hash(const std::string& key, const std::string& member) noexcept
+{
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const std::string& text)
+    {
+        for (auto c : text)
+        {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 1099511628211ull;
+        }
+    };
+
+    mix(key);
+    hash ^= 0xff;       // A byte no text contains, so ("ab", "c") and ("a", "bc") differ
+    hash *= 1099511628211ull;
+    mix(member);
+
+    // FNV alone spreads similar names poorly; finish with the splitmix64 finalizer.
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebull;
+    hash ^= hash >> 31;
+
+    return hash;
+}
+
+/// @internal
+/// @brief Find the held connection to a member
+std::list<ReceiverSet::Connection>::iterator ReceiverSet::_find(size_t member)
+{
+    return std::find_if(mConnections.begin(), mConnections.end(),
+                        [member](const Connection& connection){ return connection.member == member; });
+}
+
+/// @internal
+/// @brief Connect to a member, closing the least recently used connection if at the limit
+/// @throws Whatever the connect function throws
+Sender& ReceiverSet::_connect(size_t member)
+{
+    auto sender = mConnect(mMembers[member].endpoint);
+    _markUp(member);
+
+    if (mConnections.size() >= mMaxConnections)
+    {
+        mConnections.pop_back();
+    }
+
+    mConnections.push_front(Connection{member, std::move(sender)});
+    return *mConnections.front().sender;
+}
+
+/// @internal
+/// @brief Take a member out of service until its next retry, closing its connection
+void ReceiverSet::_markDown(size_t member)
+{
+    auto& health = mHealth[member];
+    health.up = false;
+    health.retryAt = std::chrono::steady_clock::now() + health.backoff.next();
+
+    auto found = _find(member);
+    if (found != mConnections.end())
+    {
+        mConnections.erase(found);
+    }
+}
+
+/// @internal
+/// @brief Return a member to service
+void ReceiverSet::_markUp(size_t member)
+{
+    mHealth[member].up = true;
+    mHealth[member].backoff.reset();
+}
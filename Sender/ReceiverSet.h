@@ -0,0 +1,177 @@
+/**
+ * @brief Spreads inputs across a fleet of receivers by key
+ *
+ * @file ReceiverSet.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+// Project Headers
+#include "Sender.h"
+#include "Common/Endpoint.h"
+#include "Common/Backoff.h"
+#include "Common/SocketOptions.h"
+
+// Standard Headers
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <list>
+#include <chrono>
+#include <exception>
+#include <stdint.h>
+
+
+/**
+ * @brief Maps keys onto receivers with weighted rendezvous hashing, and holds connections to them.
+ * @details Every key ranks every receiver by a hash of the pair, scaled by the receiver's weight;
+ *          the key goes to the best-ranked receiver that is up. The same key therefore always
+ *          lands on the same receiver, and adding or removing a receiver only moves the keys
+ *          that rank it first.
+ *
+ *          A receiver that cannot be reached (or fails mid-transfer, see failed()) is marked down
+ *          and its keys move to their next-ranked receiver. It is tried again after a backoff
+ *          delay, either by the next key that ranks it first or by checkHealth().
+ *
+ *          Connections are made only when a key first needs them, and at most 'maxConnections'
+ *          are held; the least recently used is closed to make room for another.
+ */
+class ReceiverSet
+{
+    ReceiverSet(const ReceiverSet&) = delete;
+    ReceiverSet& operator =(const ReceiverSet&) = delete;
+
+public: // Definitions
+    class Exception;
+
+    /// A receiver and its share of the keys relative to the others
+    struct Member
+    {
+        Common::Endpoint    endpoint;
+        unsigned            weight{1};
+    };
+
+    /// Makes a connected Sender, or throws if the receiver cannot be reached
+    using Connect = std::function<std::unique_ptr<Sender>(const Common::Endpoint& endpoint)>;
+
+    static constexpr size_t DEFAULT_MAX_CONNECTIONS = 4;
+
+    /// Delays before a receiver that is down is tried again (with jitter, doubling to the cap)
+    static constexpr std::chrono::milliseconds RETRY_DOWN_BASE{1000};
+    static constexpr std::chrono::milliseconds RETRY_DOWN_CAP{30000};
+
+    /// Connection attempts per receiver before it is marked down
+    static constexpr int CONNECT_RETRIES = 1;
+
+public: // Methods
+    /**
+     * @brief Construct a ReceiverSet
+     * @param[in] members           The receivers. Must not be empty; weights of 0 count as 1.
+     * @param[in] maxConnections    The most connections to hold open at once (at least 1)
+     * @param[in] connect           Makes connections (default: a Sender per receiver, connected
+     *                              with CONNECT_RETRIES retries and 'options' applied)
+     * @param[in] options           Socket tuning for the default connect function
+     */
+    explicit ReceiverSet(const std::vector<Member>& members,
+                         size_t maxConnections = DEFAULT_MAX_CONNECTIONS,
+                         Connect connect = nullptr,
+                         const Common::SocketOptions& options = {});
+
+    virtual ~ReceiverSet();
+
+    /**
+     * @brief Rank the receivers for a key, best first
+     * @param[in] key       The key
+     * @return Indexes into the members, in the order the key would try them
+     */
+    std::vector<size_t> rank(const std::string& key) const;
+
+    /**
+     * @brief Get the connection for a key, connecting if need be
+     * @param[in] key       The key
+     * @return The Sender connected to the best-ranked receiver that is up
+     * @throws Exception if no receiver can be reached
+     */
+    Sender& sender(const std::string& key);
+
+    /**
+     * @brief Report that the connection for a key failed
+     * @param[in] key       The key passed to sender()
+     * @details Its receiver is marked down and the connection closed, so the next sender() for
+     *          any of that receiver's keys fails over.
+     */
+    void failed(const std::string& key);
+
+    /**
+     * @brief Try every receiver that is down and due to be tried again
+     * @return The number that are now up
+     */
+    size_t checkHealth();
+
+    /// @brief Determine whether a receiver is currently considered up
+    bool isUp(size_t member) const;
+
+    /// @brief Get the number of connections held open
+    size_t openConnections() const noexcept;
+
+    /// @brief Get the receivers
+    const std::vector<Member>& members() const noexcept;
+
+private: // Definitions
+    struct Health
+    {
+        bool                                    up{true};
+        std::chrono::steady_clock::time_point   retryAt;
+        Common::Backoff                         backoff{RETRY_DOWN_BASE, RETRY_DOWN_CAP};
+    };
+
+    struct Connection
+    {
+        size_t                      member;
+        std::unique_ptr<Sender>     sender;
+    };
+
+private: // Methods
+    static uint64_t _hash(const std::string& key, const std::string& member) noexcept;
+    std::list<Connection>::iterator _find(size_t member);
+    Sender& _connect(size_t member);
+    void _markDown(size_t member);
+    void _markUp(size_t member);
+
+private: // Members
+    std::vector<Member>         mMembers;
+    std::vector<std::string>    mNames;             ///< The members' endpoints, hashed with keys
+    std::vector<Health>         mHealth;
+    size_t                      mMaxConnections;
+    Connect                     mConnect;
+    std::list<Connection>       mConnections;       ///< Most recently used first
+
+}; // class ReceiverSet
+
+
+/**
+ * @brief Exceptions on the ReceiverSet class
+ */
+class ReceiverSet::Exception : public std::exception
+{
+public:
+    Exception(const std::string& message)
+        : mMessage(message)
+    {
+    }
+
+    virtual ~Exception() = default;
+
+    virtual const char* what() const noexcept override
+    {
+        return mMessage.c_str();
+    }
+
+private:
+    std::string     mMessage;
+
+}; // class ReceiverSet::Exception
@@ -0,0 +1,281 @@
+/**
+ * @brief Passes on only the records of an input that its filters and sampling let through
+ *
+ * @file RecordSieve.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Source header
+#include "RecordSieve.h"
+
+// Standard headers
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+//-----------------------------------------------------------------------------
+RecordSieve::RecordSieve(std::vector<std::shared_ptr<const Common::RecordFilter>> filters, double sampleRate,
+                         uint64_t seed)
+    : mRandom(seed)
+{
+    for (auto& filter : filters)
+    {
+        if (!filter)
+        {
+            continue;
+        }
+
+        sampleRate *= filter->sampleRate();
+        if (!filter->passesAll())
+        {
+            mFilters.push_back(std::move(filter));
+        }
+    }
+
+    mSeekDecides = (mFilters.size() == 1 && mFilters.front()->seekDecides());
+
+    if (sampleRate < 1.0)
+    {
+        mSampling = true;
+        mThreshold = static_cast<uint64_t>(std::ldexp(std::max(sampleRate, 0.0), 64));
+    }
+}
+
+//-----------------------------------------------------------------------------
+bool RecordSieve::keep(const char* record, size_t len) noexcept
+{
+    return _passes(record, len) && _sampled();
+}
+
+//-----------------------------------------------------------------------------
+void RecordSieve::select(const char* data, size_t len, const Emit& emit)
+{
+    _sift(data, len, true, emit);
+}
+
+//-----------------------------------------------------------------------------
+size_t RecordSieve::read(const Source& source, char* out, size_t len)
+{
+    if (mOutBegin == mOutEnd && !ended())
+    {
+        if (mBuffer.empty())
+        {
+            mBuffer.resize(BUFFER_SIZE);
+        }
+
+        // Keep the record in progress, at the front, and read more after it.
+        auto buffer = mBuffer.data();
+        std::memmove(buffer, buffer + mBegin, mEnd - mBegin);
+        mEnd -= mBegin;
+        mBegin = 0;
+        mOutBegin = 0;
+        mOutEnd = 0;
+
+        if (!mSourceEnded)
+        {
+            auto got = source(buffer + mEnd, BUFFER_SIZE - mEnd);
+            mSourceEnded = (got == 0);
+            mEnd += got;
+        }
+
+        // Kept records move down to the front; they never overtake what is still to be judged.
+        const Emit keepHere = [this, buffer](const char* data, size_t len)
+        {
+            std::memmove(buffer + mOutEnd, data, len);
+            mOutEnd += len;
+        };
+
+        size_t consumed = 0;
+        if (mInLongRecord)
+        {
+            // The rest of a record too long for the buffer goes the way its first piece went.
+            auto newline = static_cast<const char*>(std::memchr(buffer, '\n', mEnd));
+            consumed = newline ? static_cast<size_t>(newline - buffer) + 1 : mEnd;
+            _settle(buffer, consumed, mKeepingLongRecord, keepHere);
+            mInLongRecord = (!newline && !mSourceEnded);
+        }
+
+        consumed += _sift(buffer + consumed, mEnd - consumed, mSourceEnded, keepHere);
+        if (consumed == 0 && mEnd == BUFFER_SIZE)
+        {
+            // No newline in a full buffer: the record is judged on what there is of it.
+            mKeepingLongRecord = _passes(buffer, mEnd) && _sampled();
+            mInLongRecord = true;
+            _settle(buffer, mEnd, mKeepingLongRecord, keepHere);
+            consumed = mEnd;
+        }
+
+        mBegin = consumed;
+    }
+
+    auto taken = std::min(len, mOutEnd - mOutBegin);
+    std::memcpy(out, mBuffer.data() + mOutBegin, taken);
+    mOutBegin += taken;
+
+    return taken;
+}
+
+//-----------------------------------------------------------------------------
+size_t RecordSieve::take(const Source& source, char* out, size_t len)
+{
+    size_t taken = 0;
+    while (taken == 0 && !ended())
+    {
+        taken = read(source, out, len);
+    }
+
+    return taken;
+}
+
+//-----------------------------------------------------------------------------
+size_t RecordSieve::held() const noexcept
+{
+    return mOutEnd - mOutBegin;
+}
+
+//-----------------------------------------------------------------------------
+bool RecordSieve::ended() const noexcept
+{
+    return mSourceEnded && mBegin == mEnd && mOutBegin == mOutEnd;
+}
+
+//-----------------------------------------------------------------------------
+uint64_t RecordSieve::bytesDropped() const noexcept
+{
+    return mDropped;
+}
+
+//-----------------------------------------------------------------------------
+// Private Methods
+//-----------------------------------------------------------------------------
+
+/// @internal
+/// @brief Determine whether a record passes every filter
+bool RecordSieve::_passes(const char* record, size_t len) const noexcept
+{
+    for (const auto& filter : mFilters)
+    {
+        if (!filter->matches(record, len))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// @internal
+/// @brief Draw whether to keep a passing record
+bool RecordSieve::_sampled() noexcept
+{
+    if (!mSampling)
+    {
+        return true;
+    }
+
+    // splitmix64: cheap, and good enough that every record has the same chance.
+    auto draw = (mRandom += 0x9e3779b97f4a7c15ull);
+    draw = (draw ^ (draw >> 30)) * 0xbf58476d1ce4e5b9ull;
+    draw = (draw ^ (draw >> 27)) * 0x94d049bb133111ebull;
+    draw ^= draw >> 31;
+
+    return draw < mThreshold;
+}
+
+/// @internal
+/// @brief Pass on or leave out a piece of a record that has been judged
+void RecordSieve::_settle(const char* data, size_t len, bool keep, const Emit& emit)
+{
+    if (keep)
+    {
+        emit(data, len);
+    }
+    else
+    {
+        mDropped += len;
+    }
+}
+
+/// @internal
+/// @brief Judge the whole records at the front of 'data', passing on runs of kept ones
+/// @param[in] whole    - The last record is whole even without a newline
+/// @return The bytes judged; the rest is a record still in progress
+size_t RecordSieve::_sift(const char* data, size_t len, bool whole, const Emit& emit)
+{
+    size_t at = 0;
+    size_t spanBegin = 0;
+    size_t spanEnd = 0;
+
+    while (at < len)
+    {
+        // Every record before the one holding the furthest seek fails some filter.
+        size_t hit = 0;
+        for (const auto& filter : mFilters)
+        {
+            auto found = filter->seek(data + at, len - at);
+            if (found == Common::RecordFilter::NOT_FOUND)
+            {
+                hit = found;
+                break;
+            }
+            hit = std::max(hit, found);
+        }
+
+        if (hit == Common::RecordFilter::NOT_FOUND)
+        {
+            // Nothing further can pass; only whole records are done with, though.
+            auto last = static_cast<const char*>(memrchr(data + at, '\n', len - at));
+            auto end = whole ? len : (last ? static_cast<size_t>(last - data) + 1 : at);
+            mDropped += end - at;
+            at = end;
+            break;
+        }
+
+        auto before = static_cast<const char*>(memrchr(data + at, '\n', hit));
+        const auto begin = before ? static_cast<size_t>(before - data) + 1 : at;
+
+        auto newline = static_cast<const char*>(std::memchr(data + at + hit, '\n', len - at - hit));
+        if (!newline && !whole)
+        {
+            // The candidate is still arriving; what came before it is done with.
+            mDropped += begin - at;
+            at = begin;
+            break;
+        }
+
+        const auto end = newline ? static_cast<size_t>(newline - data) : len;
+        const auto next = newline ? end + 1 : len;
+
+        mDropped += begin - at;
+
+        // The record holding the seek's hit needs no test if the hit alone decides it.
+        if ((mSeekDecides || _passes(data + begin, end - begin)) && _sampled())
+        {
+            if (spanEnd != begin)
+            {
+                if (spanEnd > spanBegin)
+                {
+                    emit(data + spanBegin, spanEnd - spanBegin);
+                }
+                spanBegin = begin;
+            }
+            spanEnd = next;
+        }
+        else
+        {
+            mDropped += next - begin;
+        }
+
+        at = next;
+    }
+
+    if (spanEnd > spanBegin)
+    {
+        emit(data + spanBegin, spanEnd - spanBegin);
+    }
+
+    return at;
+}
@@ -0,0 +1,128 @@
+/**
+ * @brief Passes on only the records of an input that its filters and sampling let through
+ *
+ * @file RecordSieve.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+// Project Headers
+#include "Common/RecordFilter.h"
+
+// Standard Headers
+#include <functional>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+
+/**
+ * @brief Applies filters (see Common::RecordFilter) and a sampling rate to the records of one
+ *          input. A record is a line; the last of an input need not end in a newline.
+ * @details Records are judged whole and passed on whole, so a receiver never sees part of one.
+ *          Where a filter can seek, runs of records it cannot pass are skipped with one literal
+ *          search rather than judged one by one; records passed on together go out as one span.
+ *
+ *          Sampling keeps each passing record with a fixed probability, independently, so the
+ *          records kept are spread evenly whatever the order of the input.
+ *
+ *          Not thread-safe; each input has a sieve of its own.
+ */
+class RecordSieve
+{
+    RecordSieve(const RecordSieve&) = delete;
+    RecordSieve& operator =(const RecordSieve&) = delete;
+
+public: // Definitions
+    /// Reads more of the input into 'buffer', returning the bytes read (0: the input has ended)
+    using Source = std::function<size_t(char* buffer, size_t len)>;
+
+    /// Receives a span of whole records that are kept
+    using Emit = std::function<void(const char* data, size_t len)>;
+
+    /// The input read() holds at once. A longer record is judged on its first this many bytes,
+    /// and the rest of it is kept or left out with them.
+    static constexpr size_t BUFFER_SIZE = 256 * 1024;
+
+public: // Methods
+    /**
+     * @brief Construct a RecordSieve
+     * @param[in] filters       - Every one must pass a record for it to be kept (null entries
+     *                            are ignored); their sampling applies too
+     * @param[in] sampleRate    - The fraction of passing records to keep, on top of the filters'
+     * @param[in] seed          - Starts the sampling's random sequence
+     */
+    RecordSieve(std::vector<std::shared_ptr<const Common::RecordFilter>> filters, double sampleRate,
+                uint64_t seed);
+
+    virtual ~RecordSieve() = default;
+
+    /**
+     * @brief Judge one record
+     * @param[in] record    - The record, without its newline
+     * @param[in] len       - Its length, in bytes
+     * @return True to keep it
+     */
+    bool keep(const char* record, size_t len) noexcept;
+
+    /**
+     * @brief Pass on the kept records among whole ones
+     * @param[in] data  - Records; the last is whole even without a newline
+     * @param[in] len   - Their length, in bytes
+     * @param[in] emit  - Called with each run of kept records, in order
+     */
+    void select(const char* data, size_t len, const Emit& emit);
+
+    /**
+     * @brief Take kept records from an input
+     * @param[in]  source   - The input (the same one on every call)
+     * @param[out] out      - Receives whole kept records, the last possibly cut short by 'len'
+     *                        (the rest follows on the next call)
+     * @param[in]  len      - The most to take
+     * @return The number of bytes taken. The source is read at most once, so this may be 0
+     *          before the input ends if nothing read was kept; see ended().
+     * @throws Whatever the source throws
+     */
+    size_t read(const Source& source, char* out, size_t len);
+
+    /**
+     * @brief read(), reading the source as often as it takes to keep something
+     * @return The number of bytes taken; 0 only once the input has ended
+     */
+    size_t take(const Source& source, char* out, size_t len);
+
+    /// @brief The kept bytes read() can return without reading the source
+    size_t held() const noexcept;
+
+    /// @brief Determine whether the input has ended and everything kept has been taken
+    bool ended() const noexcept;
+
+    /// @brief The bytes of input left out so far
+    uint64_t bytesDropped() const noexcept;
+
+private: // Methods
+    bool _passes(const char* record, size_t len) const noexcept;
+    bool _sampled() noexcept;
+    void _settle(const char* data, size_t len, bool keep, const Emit& emit);
+    size_t _sift(const char* data, size_t len, bool whole, const Emit& emit);
+
+private: // Members
+    std::vector<std::shared_ptr<const Common::RecordFilter>>    mFilters;   ///< Those that do not pass everything
+    bool                    mSeekDecides{false};    ///< A record the lone filter seeks to passes it
+    bool                    mSampling{false};
+    uint64_t                mThreshold{0};      ///< A random draw below this keeps a record
+    uint64_t                mRandom;            ///< splitmix64 state
+    uint64_t                mDropped{0};
+    std::vector<char>       mBuffer;            ///< For read() (allocated on first use)
+    size_t                  mOutBegin{0};       ///< Kept bytes not yet taken are [mOutBegin, mOutEnd)
+    size_t                  mOutEnd{0};
+    size_t                  mBegin{0};          ///< Input not yet judged is [mBegin, mEnd)
+    size_t                  mEnd{0};
+    bool                    mSourceEnded{false};
+    bool                    mInLongRecord{false};       ///< The input resumes in a record longer than the buffer
+    bool                    mKeepingLongRecord{false};  ///< ...which its first piece decided to keep
+
+}; // class RecordSieve
@@ -0,0 +1,110 @@
+/**
+ * @brief Replays captured traffic to a receiver, with its original timing or faster
+ *
+ * @file Replay.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Source header
+#include "Replay.h"
+
+// Project headers
+#include "Common/TrafficCapture.h"
+
+// Standard headers
+#include <algorithm>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+
+//-----------------------------------------------------------------------------
+Replay::Replay(const Config& config)
+    : mConfig(config)
+{
+    mConfig.speed = std::max(mConfig.speed, 0.0);
+}
+
+//-----------------------------------------------------------------------------
+Replay::Report Replay::run(const std::string& path)
+{
+    Report report;
+
+    Common::TrafficCapture::Reader reader(path);
+
+    std::chrono::nanoseconds first{-1};
+    Clock::time_point start;
+
+    while (auto record = reader.next())
+    {
+        if (first.count() < 0)
+        {
+            first = record->time;
+            start = Clock::now();
+        }
+
+        report.captured = record->time - first;
+
+        if (mConfig.speed > 0)
+        {
+            const auto due = start + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double, std::nano>(static_cast<double>(report.captured.count()) / mConfig.speed));
+
+            const auto now = Clock::now();
+            if (due > now)
+            {
+                std::this_thread::sleep_until(due);
+            }
+            else
+            {
+                report.maxLag = std::max(report.maxLag, std::chrono::duration_cast<std::chrono::nanoseconds>(now - due));
+            }
+        }
+
+        if (record->len == 0)
+        {
+            // The captured connection ended here.
+            mConnections.erase(record->connection);
+            continue;
+        }
+
+        auto open = mConnections.find(record->connection);
+        if (open == mConnections.end())
+        {
+            open = mConnections.emplace(record->connection, _connect()).first;
+            ++report.connections;
+        }
+
+        open->second->send(record->data, record->len);
+
+        ++report.records;
+        report.bytes += record->len;
+    }
+
+    // Connections still open when the capture was cut short end with the replay.
+    mConnections.clear();
+
+    if (first.count() >= 0)
+    {
+        report.elapsed = Clock::now() - start;
+    }
+
+    return report;
+}
+
+//-----------------------------------------------------------------------------
+// Private Methods
+//-----------------------------------------------------------------------------
+
+/// @internal
+/// @brief Open a connection to replay a captured one on
+std::unique_ptr<Common::Socket> Replay::_connect()
+{
+    auto socket = std::make_unique<Common::Socket>(mConfig.target.addr, mConfig.target.port);
+    socket->setOptions(mConfig.socketOptions);
+    socket->connect();
+
+    return socket;
+}
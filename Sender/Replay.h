@@ -0,0 +1,89 @@
+/**
+ * @brief Replays captured traffic to a receiver, with its original timing or faster
+ *
+ * @file Replay.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+// Project Headers
+#include "Common/Endpoint.h"
+#include "Common/Socket.h"
+#include "Common/SocketOptions.h"
+
+// Standard Headers
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <stdint.h>
+
+
+/**
+ * @brief Sends what a receiver captured (Receiver --capture) to a receiver again, connection for
+ *          connection, so that a production workload can be reproduced anywhere.
+ * @details Each captured connection is opened when its first record is due and closed where
+ *          its capture ended, and each record is sent on its own connection, unframed, as it was
+ *          received. Records are due at their captured times, counted from the first record and
+ *          divided by the speed: 1 is the original timing, 2 twice as fast, and 0 as fast as the
+ *          receiver takes them.
+ *
+ *          One thread sends everything, in capture order, so a receiver sees the records in the
+ *          order they were captured. A receiver that falls behind holds up every connection, as
+ *          it held up the sender that caused the delay; how far the replay fell behind its
+ *          schedule is reported.
+ */
+class Replay
+{
+    Replay(const Replay&) = delete;
+    Replay& operator =(const Replay&) = delete;
+
+public: // Definitions
+    struct Config
+    {
+        Common::Endpoint        target;
+        double                  speed{1.0};         ///< Relative to the captured timing (0: as fast as possible)
+        Common::SocketOptions   socketOptions;
+    };
+
+    /// What a replay sent
+    struct Report
+    {
+        uint64_t                        connections{0};
+        uint64_t                        records{0};
+        uint64_t                        bytes{0};
+        std::chrono::nanoseconds        captured{0};    ///< From the first record to the last, as captured
+        std::chrono::duration<double>   elapsed{0};
+        std::chrono::nanoseconds        maxLag{0};      ///< The furthest a record was sent behind its time
+    };
+
+public: // Methods
+    /**
+     * @brief Construct a Replay
+     * @param[in] config    - Where to replay to, and how fast
+     */
+    explicit Replay(const Config& config);
+
+    virtual ~Replay() = default;
+
+    /**
+     * @brief Replay a capture
+     * @param[in] path  - A file written by Receiver --capture
+     * @return What was sent
+     * @throws Common::TrafficCapture::Exception if the capture cannot be read
+     * @throws Common::Socket::Exception if a connection cannot be made, or fails
+     */
+    Report run(const std::string& path);
+
+private: // Methods
+    std::unique_ptr<Common::Socket> _connect();
+
+private: // Members
+    Config                  mConfig;
+    std::unordered_map<uint32_t, std::unique_ptr<Common::Socket>>  mConnections;   ///< Open captured connections, by number
+
+}; // class Replay
+
@@ -13,53 +13,374 @@
 // Project headers
 #include "Common/Socket.h"
 #include "Common/SocketException.h"
+#include "Common/Backoff.h"
+#include "Common/Crc32c.h"
+#include "Common/Fingerprint.h"
+#include "Common/Affinity.h"
+#include "Common/CommonData.h"
+#include "Batcher.h"
+#include "Spool.h"
+#include "Chunker.h"
+#include "FileFollower.h"
+#include "RecordSieve.h"
+
+// System headers
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // Standard headers
 #include <cstring>
+#include <cstdlib>
 #include <cmath>
 #include <iostream>
 #include <array>
+#include <algorithm>
 #include <thread>
 #include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <optional>
+#include <random>
 
 using namespace std::literals::chrono_literals;
 
 
+namespace
+{
+    /// How much of a file is read at a time to checksum it; small enough to stay in cache
+    constexpr size_t CRC_READ_SIZE = 64 * 1024;
+
+    /// How much of a file is read at a time to chunk it
+    constexpr size_t CHUNK_READ_SIZE = 1024 * 1024;
+
+    /**
+     * @brief Read part of a file. It is read rather than mapped, so that a file truncated in the
+     *          meantime reads short instead of raising SIGBUS.
+     * @return The bytes read, fewer than 'len' only if the file ended first
+     * @throws Sender::Exception if the file cannot be read
+     */
+    size_t readAt(int fd, char* buffer, size_t len, uint64_t offset)
+    {
+        size_t have = 0;
+        while (have < len)
+        {
+            auto got = pread(fd, buffer + have, len - have, static_cast<off_t>(offset + have));
+            if (got < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if (got < 0)
+            {
+                throw Sender::Exception(std::string("Failure while reading input: ") + std::strerror(errno));
+            }
+
+            if (got == 0)
+            {
+                break;
+            }
+
+            have += static_cast<size_t>(got);
+        }
+
+        return have;
+    }
+
+    /// An eventfd, closed when done with
+    struct EventFd
+    {
+        EventFd()
+            : fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+        {
+            if (fd < 0)
+            {
+                throw Sender::Exception(std::string("Cannot create eventfd: ") + std::strerror(errno));
+            }
+        }
+
+        ~EventFd()
+        {
+            close(fd);
+        }
+
+        EventFd(const EventFd&) = delete;
+        EventFd& operator =(const EventFd&) = delete;
+
+        /// Take what was signalled, so that the next wait blocks until more is
+        void drain()
+        {
+            uint64_t count;
+            auto drained = read(fd, &count, sizeof(count));
+            (void)drained;
+        }
+
+        const int fd;
+    };
+
+    /// A chunk of a file being sent deduplicated
+    struct FileChunk
+    {
+        uint64_t                offset;
+        uint32_t                length;
+        Common::Fingerprint     fingerprint;
+    };
+
+    /**
+     * @brief Chunks and fingerprints a file on a thread of its own, staying a bounded distance
+     *          ahead of the sending that consumes the chunks.
+     */
+    class ChunkFeed
+    {
+    public:
+        /// How many chunks may be ready before the thread waits
+        static constexpr size_t AHEAD = Sender::RECIPE_CHUNKS * Sender::RECIPE_WINDOW;
+
+        ChunkFeed(int fd, uint64_t size)
+            : mThread(&ChunkFeed::_run, this, fd, size)
+        {
+        }
+
+        ~ChunkFeed()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mStopping = true;
+            }
+
+            mChanged.notify_all();
+            mThread.join();
+        }
+
+        /// Take the next chunk, waiting for it if need be; false once the file is all taken.
+        /// @throws Sender::Exception if the file shrank or could not be read
+        bool next(FileChunk& chunk)
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mChanged.wait(lock, [this]{ return !mReady.empty() || mFinished; });
+
+            if (mReady.empty())
+            {
+                if (mError)
+                {
+                    std::rethrow_exception(mError);
+                }
+                return false;
+            }
+
+            chunk = mReady.front();
+            mReady.pop_front();
+            mChanged.notify_all();
+            return true;
+        }
+
+    private:
+        void _run(int fd, uint64_t size)
+        {
+            try
+            {
+                _chunk(fd, size);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mError = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            mFinished = true;
+            mChanged.notify_all();
+        }
+
+        void _chunk(int fd, uint64_t size)
+        {
+            Chunker chunker;
+            // What is read but not yet chunked is window[begin, end), from file offset 'offset'.
+            std::vector<char> window(CHUNK_READ_SIZE);
+            size_t begin = 0;
+            size_t end = 0;
+            uint64_t offset = 0;
+
+            while (offset < size)
+            {
+                // A chunk is cut from up to Chunker::MAX_SIZE bytes, so keep that much at hand.
+                const auto left = size - offset;
+                if (end - begin < std::min<uint64_t>(Chunker::MAX_SIZE, left))
+                {
+                    std::memmove(window.data(), window.data() + begin, end - begin);
+                    end -= begin;
+                    begin = 0;
+
+                    const auto wanted = static_cast<size_t>(std::min<uint64_t>(window.size() - end, left - end));
+                    if (readAt(fd, window.data() + end, wanted, offset + end) != wanted)
+                    {
+                        throw Sender::Exception("The input shrank while it was being sent.");
+                    }
+                    end += wanted;
+                }
+
+                const auto data = window.data() + begin;
+                FileChunk chunk;
+                chunk.offset = offset;
+                chunk.length = static_cast<uint32_t>(chunker.cut(data, static_cast<size_t>(std::min<uint64_t>(end - begin, left))));
+                chunk.fingerprint = Common::Fingerprint::of(data, chunk.length);
+                offset += chunk.length;
+                begin += chunk.length;
+
+                std::unique_lock<std::mutex> lock(mMutex);
+                mChanged.wait(lock, [this]{ return mReady.size() < AHEAD || mStopping; });
+
+                if (mStopping)
+                {
+                    return;
+                }
+
+                mReady.push_back(chunk);
+                mChanged.notify_all();
+            }
+        }
+
+    private:
+        std::mutex                  mMutex;
+        std::condition_variable     mChanged;
+        std::deque<FileChunk>       mReady;
+        bool                        mFinished{false};
+        std::exception_ptr          mError;         ///< Why chunking stopped short, if it did
+        bool                        mStopping{false};
+        std::thread                 mThread;        ///< Last, so it starts once the rest is ready
+    };
+
+    /// Fill a block with kept records unless the input ends, so sends stay large
+    size_t fillKept(RecordSieve& sieve, const RecordSieve::Source& read, char* buffer, size_t len)
+    {
+        size_t have = 0;
+        while (have < len)
+        {
+            auto taken = sieve.take(read, buffer + have, len - have);
+            if (taken == 0)
+            {
+                break;
+            }
+
+            have += taken;
+        }
+
+        return have;
+    }
+}
+
+
 //-----------------------------------------------------------------------------
 Sender::Sender(const std::string& addr, uint16_t port)
-    : mSocket{addr, port}
+    : Sender(std::vector<Common::Endpoint>{{addr, port}})
 {
 }
 
 
+//-----------------------------------------------------------------------------
+Sender::Sender(const std::vector<Common::Endpoint>& candidates)
+    : mSocket{_primary(candidates).addr, _primary(candidates).port}
+    , mEndpoints(candidates)
+{
+    // The first candidate is mSocket; the rest are held aside until one of them wins.
+    for (size_t index = 1; index < candidates.size(); ++index)
+    {
+        mAlternates.emplace_back(candidates[index].addr, candidates[index].port);
+    }
+}
+
+
 //-----------------------------------------------------------------------------
 Sender::~Sender() = default;
 
 
+//-----------------------------------------------------------------------------
+std::vector<std::string> Sender::setSocketOptions(const Common::SocketOptions& options)
+{
+    mOptions = options;
+
+    auto refused = mSocket.setOptions(options);
+
+    // Alternates are the same kind of socket, so they refuse the same options.
+    for (auto& alternate : mAlternates)
+    {
+        alternate.setOptions(options);
+    }
+
+    mZeroCopy = options.zeroCopy.value_or(false)
+        && std::find(refused.begin(), refused.end(), "SO_ZEROCOPY") == refused.end();
+
+    return refused;
+}
+
+
 //-----------------------------------------------------------------------------
 void Sender::connect(int retries)
 {
+    const auto start = std::chrono::steady_clock::now();
+    Common::Backoff backoff(RETRY_DELAY_BASE, RETRY_DELAY_CAP);
+
+    std::vector<Common::Socket*> candidates{&mSocket};
+    for (auto& alternate : mAlternates)
+    {
+        candidates.push_back(&alternate);
+    }
+
+    std::optional<size_t> winner;
+
     // Add one to the number of "retries" to get our total number of attempts
-    for (int retry = 0; retry < retries+1; ++retry)
+    for (int retry = 0; retry < retries+1 && !winner; ++retry)
     {
-        try
+        ++mStats.connectAttempts;
+
+        // Start an attempt on every idle candidate. Attempts still in progress from
+        // an earlier round are left to continue.
+        for (size_t index = 0; index < candidates.size() && !winner; ++index)
         {
-            mSocket.connect();
-            break;
+            try
+            {
+                if (!candidates[index]->isConnecting() && candidates[index]->connectAsync())
+                {
+                    winner = index;
+                }
+            }
+            catch (const Common::Socket::Exception& e)
+            {
+                // Refused, or unreachable from here; this candidate is retried next round
+            }
+        }
+
+        if (!winner)
+        {
+            winner = Common::Socket::waitAnyConnected(candidates, CONNECT_TIMEOUT);
         }
-        catch (const Common::Socket::ConnectionRefusalException& e)
+
+        if (!winner && retry < retries)
         {
             std::cout << "Cannot connect to server. Retrying..." << std::endl;
 
-            // Wait a second before trying again
-            std::this_thread::sleep_for(1s);
+            std::this_thread::sleep_for(backoff.next());
         }
     }
 
-    if (!mSocket.isConnected())
+    if (!winner)
     {
         throw Exception("Failed to connect to server.");
     }
+
+    if (winner.value() != 0)
+    {
+        mSocket = std::move(*candidates[winner.value()]);
+    }
+
+    // Abandon the losing attempts
+    mAlternates.clear();
+
+    mStats.connectLatency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    mStats.connectedTo = mEndpoints[winner.value()].toString();
 }
 
 
@@ -67,19 +388,424 @@ void Sender::connect(int retries)
 Sender::CommandLineData Sender::parseCommandLine(int argc, const char* const* argv)
 {
     CommandLineData data;
+    data.daemonSocket = DAEMON_SOCKET_PATH;
+
+    StreamSettings settings;
 
     for (int input = 1; input < argc; ++input)
     {
         if (std::strcmp(argv[input], "-") == 0)
         {
             data.readStdin = true;
+            data.stdinSettings = settings;
 
             // No files after '-'
             break;
         }
+        else if (std::strcmp(argv[input], "--receiver") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--receiver requires an address.");
+            }
+
+            auto endpoint = Common::Endpoint::parse(argv[input], SERVER_PORT);
+            if (!endpoint)
+            {
+                throw Exception(std::string("Invalid receiver address: ") + argv[input]);
+            }
+
+            data.receivers.push_back(endpoint.value());
+        }
+        else if (std::strcmp(argv[input], "--cluster") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--cluster requires an address.");
+            }
+
+            // addr[:port][@weight]
+            std::string text = argv[input];
+            unsigned weight = 1;
+
+            auto at = text.rfind('@');
+            if (at != std::string::npos)
+            {
+                char* end = nullptr;
+                auto value = std::strtoul(text.c_str() + at + 1, &end, 10);
+                if (end == text.c_str() + at + 1 || *end != '\0' || value == 0)
+                {
+                    throw Exception(std::string("Invalid receiver weight: ") + argv[input]);
+                }
+
+                weight = static_cast<unsigned>(value);
+                text.erase(at);
+            }
+
+            auto endpoint = Common::Endpoint::parse(text, SERVER_PORT);
+            if (!endpoint)
+            {
+                throw Exception(std::string("Invalid receiver address: ") + argv[input]);
+            }
+
+            data.cluster.push_back(endpoint.value());
+            data.clusterWeights.push_back(weight);
+        }
+        else if (std::strcmp(argv[input], "--key") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--key requires a key.");
+            }
+
+            data.key = argv[input];
+        }
+        else if (std::strcmp(argv[input], "--max-connections") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--max-connections requires a number.");
+            }
+
+            char* end = nullptr;
+            auto value = std::strtoul(argv[input], &end, 10);
+            if (end == argv[input] || *end != '\0' || value == 0)
+            {
+                throw Exception(std::string("Invalid number for --max-connections: ") + argv[input]);
+            }
+
+            data.maxConnections = value;
+        }
+        else if (std::strcmp(argv[input], "--stats") == 0)
+        {
+            data.printStats = true;
+        }
+        else if (std::strcmp(argv[input], "--daemon") == 0)
+        {
+            data.daemon = true;
+        }
+        else if (std::strcmp(argv[input], "--via-daemon") == 0)
+        {
+            data.viaDaemon = true;
+        }
+        else if (std::strcmp(argv[input], "--daemon-socket") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--daemon-socket requires a path.");
+            }
+
+            data.daemonSocket = argv[input];
+        }
+        else if (std::strcmp(argv[input], "--block") == 0)
+        {
+            data.mode = Mode::Block;
+        }
+        else if (std::strcmp(argv[input], "--resume") == 0)
+        {
+            data.resume = true;
+        }
+        else if (std::strcmp(argv[input], "--framed") == 0)
+        {
+            data.framed = true;
+        }
+        else if (std::strcmp(argv[input], "--mux") == 0)
+        {
+            data.multiplex = true;
+        }
+        else if (std::strcmp(argv[input], "--dedup") == 0)
+        {
+            data.dedup = true;
+        }
+        else if (std::strcmp(argv[input], "--crc") == 0)
+        {
+            data.checksums = true;
+        }
+        else if (std::strcmp(argv[input], "--follow") == 0)
+        {
+            data.follow = true;
+        }
+        else if (std::strcmp(argv[input], "--priority") == 0
+                 || std::strcmp(argv[input], "--weight") == 0)
+        {
+            auto option = argv[input];
+            if (++input >= argc)
+            {
+                throw Exception(std::string(option) + " requires a number.");
+            }
+
+            char* end = nullptr;
+            auto value = std::strtol(argv[input], &end, 10);
+            if (end == argv[input] || *end != '\0')
+            {
+                throw Exception(std::string("Invalid number for ") + option + ": " + argv[input]);
+            }
+
+            // Applies to the inputs that follow
+            if (std::strcmp(option, "--priority") == 0)
+            {
+                settings.priority = static_cast<int>(value);
+            }
+            else if (value < 1)
+            {
+                throw Exception("--weight must be at least 1.");
+            }
+            else
+            {
+                settings.weight = static_cast<unsigned>(value);
+            }
+        }
+        else if (std::strcmp(argv[input], "--sample") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--sample requires a rate.");
+            }
+
+            char* end = nullptr;
+            auto value = std::strtod(argv[input], &end);
+            if (end == argv[input] || *end != '\0' || !(value > 0) || value > 1)
+            {
+                throw Exception(std::string("Invalid rate for --sample: ") + argv[input]);
+            }
+
+            // Applies to the inputs that follow
+            settings.sample = value;
+        }
+        else if (std::strcmp(argv[input], "--filter") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--filter requires a clause.");
+            }
+
+            data.filter += argv[input];
+            data.filter += '\n';
+        }
+        else if (std::strcmp(argv[input], "--batch-bytes") == 0
+                 || std::strcmp(argv[input], "--max-delay-us") == 0)
+        {
+            auto option = argv[input];
+            if (++input >= argc)
+            {
+                throw Exception(std::string(option) + " requires a number.");
+            }
+
+            char* end = nullptr;
+            auto value = std::strtoull(argv[input], &end, 10);
+            if (end == argv[input] || *end != '\0')
+            {
+                throw Exception(std::string("Invalid number for ") + option + ": " + argv[input]);
+            }
+
+            // Either option turns batching on.
+            if (std::strcmp(option, "--batch-bytes") == 0)
+            {
+                data.batchBytes = value;
+            }
+            else
+            {
+                data.maxDelay = std::chrono::microseconds(value);
+                data.batchBytes = data.batchBytes ? data.batchBytes : BATCH_BYTES;
+            }
+        }
+        else if (std::strcmp(argv[input], "--arena-bytes") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--arena-bytes requires a number.");
+            }
+
+            char* end = nullptr;
+            auto value = std::strtoull(argv[input], &end, 10);
+            if (end == argv[input] || *end != '\0')
+            {
+                throw Exception(std::string("Invalid number for --arena-bytes: ") + argv[input]);
+            }
+
+            data.arenaBytes = value;
+        }
+        else if (std::strcmp(argv[input], "--no-prefault") == 0)
+        {
+            data.arenaPrefault = false;
+        }
+        else if (std::strcmp(argv[input], "--cpus") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--cpus requires a CPU list.");
+            }
+
+            auto cpus = Common::Affinity::parseCpuList(argv[input]);
+            if (!cpus)
+            {
+                throw Exception(std::string("Invalid CPU list for --cpus: ") + argv[input]);
+            }
+
+            data.cpus = cpus.value();
+        }
+        else if (std::strcmp(argv[input], "--profile") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--profile requires a name.");
+            }
+
+            auto profile = Common::SocketOptions::profile(argv[input]);
+            if (!profile)
+            {
+                throw Exception(std::string("Unknown profile: ") + argv[input]);
+            }
+
+            data.socketOptions = profile.value();
+            data.profile = argv[input];
+        }
+        else if (std::strcmp(argv[input], "--ping-pong") == 0)
+        {
+            data.pingPong = true;
+        }
+        else if (std::strcmp(argv[input], "--ping-count") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--ping-count requires a number.");
+            }
+
+            char* end = nullptr;
+            auto value = std::strtoull(argv[input], &end, 10);
+            if (end == argv[input] || *end != '\0' || value == 0)
+            {
+                throw Exception(std::string("Invalid number for --ping-count: ") + argv[input]);
+            }
+
+            data.pingCount = value;
+        }
+        else if (std::strcmp(argv[input], "--ping-rates") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--ping-rates requires a list of rates.");
+            }
+
+            data.pingRates.clear();
+
+            const char* rate = argv[input];
+            for (;;)
+            {
+                char* end = nullptr;
+                auto value = std::strtoull(rate, &end, 10);
+                if (end == rate || (*end != ',' && *end != '\0'))
+                {
+                    throw Exception(std::string("Invalid rate list for --ping-rates: ") + argv[input]);
+                }
+
+                data.pingRates.push_back(value);
+                if (*end == '\0')
+                {
+                    break;
+                }
+                rate = end + 1;
+            }
+        }
+        else if (std::strcmp(argv[input], "--ping-histograms") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--ping-histograms requires a file name.");
+            }
+
+            data.pingHistograms = argv[input];
+        }
+        else if (std::strcmp(argv[input], "--replay") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--replay requires a capture file.");
+            }
+
+            data.replayFile = argv[input];
+        }
+        else if (std::strcmp(argv[input], "--replay-speed") == 0)
+        {
+            if (++input >= argc)
+            {
+                throw Exception("--replay-speed requires a speed.");
+            }
+
+            char* end = nullptr;
+            auto value = std::strtod(argv[input], &end);
+            if (std::strcmp(argv[input], "max") == 0)
+            {
+                data.replaySpeed = 0;
+            }
+            else if (end == argv[input] || *end != '\0' || !(value > 0))
+            {
+                throw Exception(std::string("Invalid speed for --replay-speed: ") + argv[input]);
+            }
+            else
+            {
+                data.replaySpeed = value;
+            }
+        }
         else
         {
             data.filesToSend.emplace_back(argv[input]);
+            data.fileSettings.push_back(settings);
+        }
+    }
+
+    if (data.pingPong
+        && (data.readStdin || !data.filesToSend.empty() || data.framed || data.resume || data.dedup
+            || data.multiplex || data.follow || !data.cluster.empty() || data.daemon || data.viaDaemon))
+    {
+        throw Exception("--ping-pong sends its own requests to one receiver; it takes no inputs, and"
+                        " cannot be combined with another mode.");
+    }
+
+    if (!data.replayFile.empty()
+        && (data.readStdin || !data.filesToSend.empty() || data.framed || data.resume || data.dedup
+            || data.multiplex || data.follow || data.pingPong || !data.cluster.empty() || data.daemon
+            || data.viaDaemon))
+    {
+        throw Exception("--replay sends a capture to one receiver; it takes no other inputs, and"
+                        " cannot be combined with another mode.");
+    }
+
+    bool sampled = (data.readStdin && data.stdinSettings.sample < 1.0)
+        || std::any_of(data.fileSettings.begin(), data.fileSettings.end(),
+                       [](const StreamSettings& each){ return each.sample < 1.0; });
+
+    if ((!data.filter.empty() || sampled)
+        && (data.resume || data.dedup || data.pingPong || !data.replayFile.empty() || data.daemon || data.viaDaemon))
+    {
+        throw Exception("--filter and --sample select records; they cannot be combined with --resume, --dedup,"
+                        " --ping-pong, --replay or the daemon, which send inputs whole.");
+    }
+
+    if (!data.filter.empty())
+    {
+        try
+        {
+            Common::RecordFilter check{data.filter};
+        }
+        catch (const Common::RecordFilter::Exception& e)
+        {
+            throw Exception(std::string("Invalid --filter: ") + e.what());
+        }
+    }
+
+    if (data.follow)
+    {
+        if (data.readStdin || data.filesToSend.empty())
+        {
+            throw Exception("--follow requires files to follow (standard input cannot be followed).");
+        }
+
+        if (data.framed || data.resume || data.dedup || data.multiplex || !data.cluster.empty()
+            || data.daemon || data.viaDaemon)
+        {
+            throw Exception("--follow sends lines to one receiver, unframed; it cannot be combined"
+                            " with --framed, --resume, --dedup, --mux, --cluster or the daemon.");
         }
     }
 
@@ -87,6 +813,48 @@ Sender::CommandLineData Sender::parseCommandLine(int argc, const char* const* ar
 }
 
 
+//-----------------------------------------------------------------------------
+void Sender::setMode(Mode mode) noexcept
+{
+    mMode = mode;
+}
+
+
+//-----------------------------------------------------------------------------
+void Sender::setBatching(size_t bytes, std::chrono::microseconds maxDelay) noexcept
+{
+    mBatchBytes = bytes;
+    mBatchDelay = maxDelay;
+}
+
+
+//-----------------------------------------------------------------------------
+void Sender::setArena(Common::BufferArena* arena) noexcept
+{
+    mArena = arena;
+}
+
+
+//-----------------------------------------------------------------------------
+void Sender::setFilter(std::shared_ptr<const Common::RecordFilter> filter) noexcept
+{
+    mFilter = std::move(filter);
+}
+
+
+//-----------------------------------------------------------------------------
+void Sender::setSampling(double rate) noexcept
+{
+    mSampleRate = rate;
+}
+
+//-----------------------------------------------------------------------------
+void Sender::setChecksums(bool enabled) noexcept
+{
+    mChecksums = enabled;
+}
+
+
 //-----------------------------------------------------------------------------
 void Sender::sendStream(std::istream& input)
 {
@@ -95,17 +863,1393 @@ void Sender::sendStream(std::istream& input)
         throw Exception("Socket is not connected.");
     }
 
-    constexpr size_t BUFFER_SIZE = 1024;
-    std::array<char, BUFFER_SIZE> line;
-    // Subtract 1 to make room for a newline
-    while (input.getline(line.data(), line.size() - 1))
-    {
-        // Note: line is NOT terminated
+    auto sieve = _sieve(mSampleRate);
 
-        auto dataToSend = std::min(static_cast<size_t>(input.gcount()), line.size() - 1);
-        line[dataToSend - 1] = '\n';         // Replace the newline as the last character
+    if (mMode == Mode::Block)
+    {
+        const RecordSieve::Source read = [&input](char* buffer, size_t len)
+        {
+            input.read(buffer, static_cast<std::streamsize>(len));
+            return static_cast<size_t>(input.gcount());
+        };
+
+        if (sieve)
+        {
+            _sendBlocks([&](char* buffer, size_t len){ return fillKept(*sieve, read, buffer, len); });
+            mStats.bytesFiltered += sieve->bytesDropped();
+        }
+        else
+        {
+            _sendBlocks(read);
+        }
+
+        return;
+    }
+
+    auto send = [this](const void* buffer, size_t len)
+    {
+        mSocket.send(buffer, len);
+        ++mStats.lineSends;
+    };
+
+    std::unique_ptr<Batcher> batcher;
+    if (mBatchBytes > 0)
+    {
+        batcher = std::make_unique<Batcher>(send, mBatchBytes, mBatchDelay);
+    }
+
+    constexpr size_t BUFFER_SIZE = 1024;
+    std::array<char, BUFFER_SIZE> line;
+    // Subtract 1 to make room for a newline
+    while (input.getline(line.data(), line.size() - 1))
+    {
+        // Note: line is NOT terminated
+
+        auto dataToSend = std::min(static_cast<size_t>(input.gcount()), line.size() - 1);
+        line[dataToSend - 1] = '\n';         // Replace the newline as the last character
+
+        if (sieve && !sieve->keep(line.data(), dataToSend - 1))
+        {
+            mStats.bytesFiltered += dataToSend;
+            continue;
+        }
 
         // Send it over the connection
-        mSocket.send(line.data(), dataToSend);
+        if (batcher)
+        {
+            batcher->add(line.data(), dataToSend);
+        }
+        else
+        {
+            send(line.data(), dataToSend);
+        }
+
+        mStats.bytesSent += dataToSend;
+    }
+
+    if (batcher)
+    {
+        batcher->flush();
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+uint64_t Sender::sendFile(int fd)
+{
+    if (!mSocket.isConnected())
+    {
+        throw Exception("Socket is not connected.");
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) < 0)
+    {
+        throw Exception(std::string("Cannot examine input: ") + std::strerror(errno));
+    }
+
+    // Records are judged here, so only an unfiltered file can go straight to the socket.
+    auto sieve = _sieve(mSampleRate);
+
+    if (S_ISREG(info.st_mode) && !sieve)
+    {
+        // Let the kernel move the pages straight to the socket.
+        auto sent = mSocket.sendFile(fd, 0, static_cast<size_t>(info.st_size));
+        mStats.bytesSent += sent;
+        return sent;
+    }
+
+    const RecordSieve::Source read = [fd](char* buffer, size_t len)
+    {
+        // Fill the block unless the input ends, so sends stay large.
+        size_t have = 0;
+        while (have < len)
+        {
+            auto readResult = ::read(fd, buffer + have, len - have);
+            if (readResult < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                throw Exception(std::string("Failure while reading input: ") + std::strerror(errno));
+            }
+
+            if (readResult == 0)
+            {
+                break;
+            }
+
+            have += static_cast<size_t>(readResult);
+        }
+
+        return have;
+    };
+
+    if (!sieve)
+    {
+        return _sendBlocks(read);
+    }
+
+    auto sent = _sendBlocks([&](char* buffer, size_t len){ return fillKept(*sieve, read, buffer, len); });
+    mStats.bytesFiltered += sieve->bytesDropped();
+    return sent;
+}
+
+
+//-----------------------------------------------------------------------------
+uint64_t Sender::sendFileResumable(const std::string& path, int reconnects)
+{
+    if (!mSocket.isConnected())
+    {
+        throw Exception("Socket is not connected.");
+    }
+
+    auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw Exception(path + ": " + std::strerror(errno));
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) < 0 || !S_ISREG(info.st_mode))
+    {
+        close(fd);
+        throw Exception(path + ": only regular files can be resumed.");
+    }
+
+    auto slash = path.rfind('/');
+    auto name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+    auto size = static_cast<uint64_t>(info.st_size);
+
+    // A changed file gets a new id, so it is never spliced onto a stale partial copy.
+    auto mtime = static_cast<uint64_t>(info.st_mtim.tv_sec) * 1000000000ull
+        + static_cast<uint64_t>(info.st_mtim.tv_nsec);
+    auto fileId = Common::Protocol::fileId(name, size, mtime);
+
+    uint64_t sent = 0;
+
+    for (int attempt = 0; ; ++attempt)
+    {
+        try
+        {
+            if (!mReader)
+            {
+                _handshake();
+            }
+
+            sent += _sendResumable(fd, fileId, name, size);
+            break;
+        }
+        catch (const Common::Socket::Exception& e)
+        {
+            if (attempt >= reconnects)
+            {
+                close(fd);
+                throw;
+            }
+
+            std::cout << "Connection lost (" << e.what() << "). Resuming..." << std::endl;
+        }
+
+        try
+        {
+            _reconnect();
+        }
+        catch (...)
+        {
+            close(fd);
+            throw;
+        }
+    }
+
+    close(fd);
+    return sent;
+}
+
+
+//-----------------------------------------------------------------------------
+uint64_t Sender::sendFramed(int fd, const std::string& name)
+{
+    using namespace Common::Protocol;
+
+    if (!mSocket.isConnected())
+    {
+        throw Exception("Socket is not connected.");
+    }
+
+    if (!mReader)
+    {
+        _handshake();
+    }
+
+    // Start reading ahead before anything can stall us.
+    Spool spool(fd);
+
+    const auto stream = _open(OPEN_STREAM, 0, name, 0);
+    _await(FrameType::Resume);
+
+    // A filter the receiver wants comes before its Resume.
+    auto sieve = _sieve(mSampleRate, _pushedFilter(stream));
+    const RecordSieve::Source read = [&spool](char* buffer, size_t len){ return spool.read(buffer, len); };
+
+    Common::BufferArena::Buffer buffer(mArena, RESUME_FRAME_SIZE + CRC_SIZE);
+    uint64_t position = 0;
+
+    for (;;)
+    {
+        auto credit = _awaitCredit(stream, position);
+        auto want = static_cast<size_t>(std::min<uint64_t>(RESUME_FRAME_SIZE, credit));
+
+        auto len = sieve ? sieve->take(read, buffer.get(), want) : read(buffer.get(), want);
+        if (len == 0)
+        {
+            break;
+        }
+
+        _sendData(stream, position, buffer.get(), len);
+
+        position += len;
+        mStats.bytesSent += len;
+    }
+
+    FrameHeader closing;
+    closing.type = FrameType::Close;
+    closing.stream = stream;
+    closing.offset = position;
+    sendFrame(mSocket, closing);
+
+    _awaitAck(stream, position);
+
+    mStats.bytesSpooled += spool.spooledBytes();
+    if (sieve)
+    {
+        mStats.bytesFiltered += sieve->bytesDropped();
+    }
+
+    return position;
+}
+
+
+//-----------------------------------------------------------------------------
+uint64_t Sender::sendDeduplicated(int fd, const std::string& name)
+{
+    using namespace Common::Protocol;
+
+    if (!mSocket.isConnected())
+    {
+        throw Exception("Socket is not connected.");
+    }
+
+    if (!mReader)
+    {
+        _handshake();
+    }
+
+    struct stat info;
+    if (!(mPeerFeatures & FEATURE_DEDUP) || fstat(fd, &info) < 0 || !S_ISREG(info.st_mode))
+    {
+        return sendFramed(fd, name);
+    }
+
+    const auto size = static_cast<uint64_t>(info.st_size);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // Chunking starts at once, so it overlaps the handshake for the stream.
+    ChunkFeed feed(fd, size);
+
+    const auto stream = _open(OPEN_STREAM, 0, name, 0);
+    _await(FrameType::Resume);
+
+    struct Offered
+    {
+        uint64_t                offset;     ///< Of the first chunk
+        std::vector<FileChunk>  chunks;
+    };
+
+    std::deque<Offered> offered;
+    std::optional<FileChunk> next;
+    bool exhausted = false;
+    uint64_t planned = 0;                   ///< Stream offset past the last chunk offered
+
+    auto peek = [&]()
+    {
+        FileChunk chunk;
+        if (!next && !exhausted)
+        {
+            if (feed.next(chunk))
+            {
+                next = chunk;
+            }
+            else
+            {
+                exhausted = true;
+            }
+        }
+        return next.has_value();
+    };
+
+    std::vector<uint8_t> recipe(RECIPE_CHUNKS * RECIPE_ENTRY_SIZE);
+    Common::BufferArena::Buffer buffer(mArena, MUX_FRAME_SIZE + CRC_SIZE);
+    uint64_t sent = 0;
+
+    for (;;)
+    {
+        // Offer the chunks that start within credit, a few Recipes ahead of the data, so the
+        // receiver's answers arrive while earlier chunks are still being sent.
+        while (offered.size() < RECIPE_WINDOW && peek() && _credit(stream, planned) > 0)
+        {
+            Offered batch{planned, {}};
+            auto entry = recipe.data();
+
+            while (batch.chunks.size() < RECIPE_CHUNKS && peek() && _credit(stream, planned) > 0)
+            {
+                putU32(entry, next->length);
+                next->fingerprint.encode(entry + sizeof(uint32_t));
+                entry += RECIPE_ENTRY_SIZE;
+
+                planned += next->length;
+                batch.chunks.push_back(next.value());
+                next.reset();
+            }
+
+            FrameHeader header;
+            header.type = FrameType::Recipe;
+            header.stream = stream;
+            header.length = static_cast<uint32_t>(entry - recipe.data());
+            header.offset = batch.offset;
+            sendFrame(mSocket, header, recipe.data());
+
+            offered.push_back(std::move(batch));
+        }
+
+        if (offered.empty())
+        {
+            if (!peek())
+            {
+                break;
+            }
+
+            _awaitCredit(stream, planned);
+            continue;
+        }
+
+        auto batch = std::move(offered.front());
+        offered.pop_front();
+
+        uint64_t wanted = 0;
+        int64_t previous = -1;
+
+        for (auto index : _awaitWant(stream, batch.offset))
+        {
+            // In stream order, since that is the order the receiver takes them in
+            if (index >= batch.chunks.size() || static_cast<int64_t>(index) <= previous)
+            {
+                throw Exception("The receiver asked for chunks that were not offered.");
+            }
+
+            previous = index;
+
+            // The chunk starts within credit, since it was offered, and goes whole: the receiver
+            // holds it back until it can check its fingerprint, so no credit would come mid-chunk.
+            // It is read frame by frame into the one buffer, so a CRC can follow each.
+            const auto& chunk = batch.chunks[index];
+            auto position = chunk.offset;
+            const auto end = chunk.offset + chunk.length;
+
+            while (position < end)
+            {
+                auto len = static_cast<size_t>(std::min<uint64_t>(MUX_FRAME_SIZE, end - position));
+
+                if (readAt(fd, buffer.get(), len, position) != len)
+                {
+                    throw Exception(name + " shrank while it was being sent.");
+                }
+                _sendData(stream, position, buffer.get(), len);
+
+                position += len;
+                mStats.bytesSent += len;
+            }
+
+            wanted += chunk.length;
+        }
+
+        const auto& last = batch.chunks.back();
+        mStats.bytesDeduplicated += last.offset + last.length - batch.offset - wanted;
+        sent += wanted;
+    }
+
+    FrameHeader closing;
+    closing.type = FrameType::Close;
+    closing.stream = stream;
+    closing.offset = size;
+    sendFrame(mSocket, closing);
+
+    _awaitAck(stream, size);
+
+    return sent;
+}
+
+
+//-----------------------------------------------------------------------------
+uint64_t Sender::sendStreams(const std::vector<StreamSource>& sources)
+{
+    using namespace Common::Protocol;
+    using namespace std::chrono_literals;
+
+    if (!mSocket.isConnected())
+    {
+        throw Exception("Socket is not connected.");
+    }
+
+    if (!mReader)
+    {
+        _handshake();
+    }
+
+    struct Outgoing
+    {
+        int                     fd{-1};
+        bool                    regular{false};     ///< Sent with sendfile(); otherwise through 'spool'
+        uint64_t                size{0};
+        uint64_t                position{0};
+        double                  sample{1.0};
+        std::unique_ptr<Spool>  spool;
+        std::unique_ptr<RecordSieve>    sieve;      ///< Judges the records read from 'spool', if any are left out
+    };
+
+    // Spools signal this as their input arrives, so that waiting for input and for credit is
+    // one wait. Declared first, so that it outlives them.
+    EventFd inputArrived;
+
+    std::map<uint16_t, Outgoing> streams;
+    StreamScheduler scheduler;
+
+    for (const auto& source : sources)
+    {
+        Outgoing outgoing;
+        outgoing.fd = source.fd;
+        outgoing.sample = source.settings.sample;
+
+        struct stat info;
+        if (fstat(source.fd, &info) == 0 && S_ISREG(info.st_mode))
+        {
+            outgoing.regular = true;
+            outgoing.size = static_cast<uint64_t>(info.st_size);
+        }
+        else
+        {
+            outgoing.spool = std::make_unique<Spool>(source.fd, Spool::DEFAULT_MEMORY_LIMIT,
+                                                     Spool::DEFAULT_DIRECTORY, inputArrived.fd);
+        }
+
+        auto stream = _open(OPEN_STREAM, 0, source.name, outgoing.size);
+        scheduler.add(stream, source.settings.priority, source.settings.weight);
+        streams.emplace(stream, std::move(outgoing));
+    }
+
+    // Each Open is answered in turn; streams are not resumed, so they start at zero.
+    for (size_t count = 0; count < sources.size(); ++count)
+    {
+        _await(FrameType::Resume);
     }
+
+    // With the Resumes came any filters the receiver wants. A filtered file cannot go out
+    // with sendfile(), since its records are judged here.
+    for (auto& [stream, outgoing] : streams)
+    {
+        outgoing.sieve = _sieve(outgoing.sample, _pushedFilter(stream));
+        if (outgoing.sieve && outgoing.regular)
+        {
+            outgoing.regular = false;
+            outgoing.spool = std::make_unique<Spool>(outgoing.fd, Spool::DEFAULT_MEMORY_LIMIT,
+                                                     Spool::DEFAULT_DIRECTORY, inputArrived.fd);
+        }
+    }
+
+    auto ended = [](const Outgoing& outgoing)
+    {
+        if (outgoing.regular)
+        {
+            return outgoing.position >= outgoing.size;
+        }
+
+        return outgoing.sieve ? outgoing.sieve->ended() : outgoing.spool->ended();
+    };
+
+    // Whether a turn would find input without waiting for it
+    auto hasInput = [](const Outgoing& outgoing)
+    {
+        return outgoing.regular || outgoing.spool->ready() || (outgoing.sieve && outgoing.sieve->held() > 0);
+    };
+
+    // A stream can take a turn if it can close, or if it has both input and credit.
+    auto ready = [&](uint16_t stream)
+    {
+        const auto& outgoing = streams.at(stream);
+        if (ended(outgoing))
+        {
+            return true;
+        }
+
+        return hasInput(outgoing) && _credit(stream, outgoing.position) > 0;
+    };
+
+    Common::BufferArena::Buffer buffer(mArena, MUX_FRAME_SIZE + CRC_SIZE);
+    std::map<uint16_t, uint64_t> finalOffsets;
+    uint64_t sent = 0;
+
+    while (!scheduler.empty())
+    {
+        _pollFrames();
+
+        auto turn = scheduler.next(ready);
+        if (!turn)
+        {
+            bool awaitingInput = std::any_of(streams.begin(), streams.end(), [&](const auto& entry)
+            {
+                return !hasInput(entry.second);
+            });
+
+            if (awaitingInput)
+            {
+                // Sleep until input or credit arrives, whichever is first. Input that arrived
+                // since the turn was looked for has already signalled, so none is missed.
+                mSocket.waitReadable(std::chrono::milliseconds(-1), inputArrived.fd);
+                inputArrived.drain();
+            }
+            else
+            {
+                // Everything is waiting for credit.
+                const auto start = std::chrono::steady_clock::now();
+                std::vector<char> payload;
+                _nextFrame(payload);
+                mStats.creditStall += std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start);
+            }
+
+            continue;
+        }
+
+        auto stream = turn->stream;
+        auto& outgoing = streams.at(stream);
+
+        if (ended(outgoing))
+        {
+            FrameHeader closing;
+            closing.type = FrameType::Close;
+            closing.stream = stream;
+            closing.offset = outgoing.position;
+            sendFrame(mSocket, closing);
+
+            finalOffsets[stream] = outgoing.position;
+            if (outgoing.spool)
+            {
+                mStats.bytesSpooled += outgoing.spool->spooledBytes();
+            }
+
+            if (outgoing.sieve)
+            {
+                mStats.bytesFiltered += outgoing.sieve->bytesDropped();
+            }
+
+            scheduler.remove(stream);
+            continue;
+        }
+
+        auto len = static_cast<size_t>(std::min<uint64_t>({turn->allowance, MUX_FRAME_SIZE,
+                                                          _credit(stream, outgoing.position)}));
+
+        if (outgoing.regular)
+        {
+            len = static_cast<size_t>(std::min<uint64_t>(len, outgoing.size - outgoing.position));
+
+            if (_sendFileData(stream, outgoing.position, outgoing.fd, len) != len)
+            {
+                throw Exception("An input shrank while it was being sent.");
+            }
+        }
+        else if (outgoing.sieve)
+        {
+            // One read of the input per turn, which may leave every record of it out.
+            auto& spool = *outgoing.spool;
+            len = outgoing.sieve->read([&spool](char* data, size_t size){ return spool.read(data, size); },
+                                       buffer.get(), len);
+            if (len == 0)
+            {
+                continue;
+            }
+
+            _sendData(stream, outgoing.position, buffer.get(), len);
+        }
+        else
+        {
+            len = outgoing.spool->read(buffer.get(), len);
+            _sendData(stream, outgoing.position, buffer.get(), len);
+        }
+
+        outgoing.position += len;
+        sent += len;
+        mStats.bytesSent += len;
+
+        scheduler.charge(stream, len);
+    }
+
+    for (const auto& [stream, offset] : finalOffsets)
+    {
+        _awaitAck(stream, offset);
+    }
+
+    return sent;
+}
+
+
+//-----------------------------------------------------------------------------
+uint64_t Sender::sendFollowed(FileFollower& follower, const std::vector<double>& sampleRates)
+{
+    if (!mSocket.isConnected())
+    {
+        throw Exception("Socket is not connected.");
+    }
+
+    auto send = [this](const void* buffer, size_t len)
+    {
+        mSocket.send(buffer, len);
+        ++mStats.lineSends;
+    };
+
+    std::unique_ptr<Batcher> batcher;
+    if (mBatchBytes > 0)
+    {
+        batcher = std::make_unique<Batcher>(send, mBatchBytes, mBatchDelay);
+    }
+
+    uint64_t sent = 0;
+    auto forward = [&](const char* data, size_t len)
+    {
+        if (batcher)
+        {
+            batcher->add(data, len);
+        }
+        else
+        {
+            send(data, len);
+        }
+
+        sent += len;
+        mStats.bytesSent += len;
+    };
+
+    // The follower hands over whole lines, so each file's sieve judges them as they come.
+    std::map<size_t, std::unique_ptr<RecordSieve>> sieves;
+    follower.run([&](size_t index, const char* data, size_t len)
+    {
+        auto found = sieves.find(index);
+        if (found == sieves.end())
+        {
+            auto rate = (index < sampleRates.size()) ? sampleRates[index] : mSampleRate;
+            found = sieves.emplace(index, _sieve(rate)).first;
+        }
+
+        if (!found->second)
+        {
+            forward(data, len);
+            return;
+        }
+
+        const auto before = found->second->bytesDropped();
+        found->second->select(data, len, forward);
+        mStats.bytesFiltered += found->second->bytesDropped() - before;
+    });
+
+    if (batcher)
+    {
+        batcher->flush();
+    }
+
+    return sent;
+}
+
+//-----------------------------------------------------------------------------
+Sender::RoundTrips Sender::pingPong(size_t messageSize, uint64_t count, uint64_t rate)
+{
+    if (!mSocket.isConnected())
+    {
+        throw Exception("Socket is not connected.");
+    }
+
+    using Clock = std::chrono::steady_clock;
+
+    RoundTrips result;
+    result.messageSize = messageSize;
+    result.rate = rate;
+
+    Common::BufferArena::Buffer request(mArena, messageSize);
+    Common::BufferArena::Buffer response(mArena, messageSize);
+
+    // Not a frame type, so that the receiver takes the connection to be unframed.
+    std::memset(request.get(), 'p', messageSize);
+
+    auto receive = [&](size_t& echoed, bool wait)
+    {
+        while (echoed < messageSize)
+        {
+            auto received = wait ? mSocket.recv(response.get() + echoed, messageSize - echoed)
+                                 : mSocket.tryRecv(response.get() + echoed, messageSize - echoed);
+            if (!received)
+            {
+                throw Exception("The receiver disconnected during a round trip; is it running with --echo?");
+            }
+
+            if (received.value() == 0)
+            {
+                return;
+            }
+            echoed += received.value();
+        }
+    };
+
+    const auto interval = rate ? std::chrono::nanoseconds(1000000000 / rate) : std::chrono::nanoseconds(0);
+    auto due = Clock::now();
+
+    for (uint64_t trip = 0; trip < count; ++trip)
+    {
+        if (rate)
+        {
+            // Returns at once if the last round trip overran.
+            std::this_thread::sleep_until(due);
+        }
+
+        const auto start = Clock::now();
+        if (!rate)
+        {
+            due = start;
+        }
+
+        size_t echoed = 0;
+        for (size_t offset = 0; offset < messageSize; )
+        {
+            // Large requests are echoed while still being sent; taking the echo back as it comes
+            // keeps both ends from blocking on full socket buffers.
+            const auto piece = std::min(PING_PIECE_SIZE, messageSize - offset);
+            mSocket.send(request.get() + offset, piece);
+            offset += piece;
+
+            receive(echoed, false);
+        }
+
+        if (mOptions.cork.value_or(false))
+        {
+            // The request is complete: push out its last partial segment now, rather than when
+            // the cork times out.
+            Common::SocketOptions flush;
+            flush.cork = false;
+            mSocket.setOptions(flush);
+            flush.cork = true;
+            mSocket.setOptions(flush);
+        }
+        receive(echoed, true);
+
+        const auto end = Clock::now();
+        result.measured.record(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        result.corrected.record(std::chrono::duration_cast<std::chrono::nanoseconds>(end - due).count());
+
+        mStats.bytesSent += messageSize;
+        due += interval;
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+const Sender::Stats& Sender::stats() const noexcept
+{
+    return mStats;
+}
+
+
+//-----------------------------------------------------------------------------
+// Private Methods
+//-----------------------------------------------------------------------------
+
+/**
+ * @internal
+ * @brief Validate the candidate list and return the primary (first) candidate
+ * @param[in] candidates    - The candidate server addresses
+ * @throws Exception if there are no candidates
+ */
+const Common::Endpoint& Sender::_primary(const std::vector<Common::Endpoint>& candidates)
+{
+    if (candidates.empty())
+    {
+        throw Exception("At least one server address is required.");
+    }
+
+    return candidates.front();
+}
+
+/**
+ * @internal
+ * @brief Send input in pool blocks until it ends
+ * @param[in] read      - Fills a block, returning the number of bytes read (0 at the end)
+ * @return The number of bytes sent
+ */
+uint64_t Sender::_sendBlocks(const std::function<size_t(char* buffer, size_t len)>& read)
+{
+    if (!mPool)
+    {
+        mPool = std::make_unique<BufferPool>(BLOCK_COUNT, BLOCK_SIZE, mArena);
+    }
+
+    uint64_t sent = 0;
+
+    for (;;)
+    {
+        auto index = _acquireBlock();
+        auto block = mPool->data(index);
+
+        size_t len = 0;
+        try
+        {
+            len = read(block, mPool->bufferSize());
+        }
+        catch (...)
+        {
+            mPool->release(index);
+            throw;
+        }
+
+        if (len == 0)
+        {
+            mPool->release(index);
+            break;
+        }
+
+        std::optional<uint32_t> ticket;
+        if (mZeroCopy && len >= ZEROCOPY_THRESHOLD)
+        {
+            ticket = mSocket.sendZeroCopy(block, len);
+            ++mStats.zeroCopySends;
+        }
+        else
+        {
+            mSocket.send(block, len);
+        }
+
+        // A zero-copy block stays out of circulation until the kernel is done with it.
+        if (ticket)
+        {
+            mPool->releaseInFlight(index, ticket.value());
+        }
+        else
+        {
+            mPool->release(index);
+        }
+
+        sent += len;
+    }
+
+    mStats.bytesSent += sent;
+    return sent;
+}
+
+/**
+ * @internal
+ * @brief Get a block that neither we nor the kernel are using, waiting for one if necessary
+ * @return The pool index of the block
+ */
+size_t Sender::_acquireBlock()
+{
+    auto isComplete = [this](BufferPool::Ticket ticket){ return mSocket.isSendComplete(ticket); };
+
+    for (;;)
+    {
+        if (mPool->inFlight() > 0)
+        {
+            mPool->reclaim(isComplete);
+
+            if (mZeroCopy && mSocket.isZeroCopyDeferred())
+            {
+                // The kernel is copying anyway (e.g. loopback); stop paying to pin pages.
+                mZeroCopy = false;
+                mStats.zeroCopyDeferred = true;
+            }
+        }
+
+        if (auto index = mPool->tryAcquire())
+        {
+            return index.value();
+        }
+
+        constexpr std::chrono::milliseconds COMPLETION_WAIT{100};
+        mSocket.waitSendCompletions(COMPLETION_WAIT);
+    }
+}
+
+/**
+ * @internal
+ * @brief Switch the connection to the framed protocol
+ */
+void Sender::_handshake()
+{
+    using namespace Common::Protocol;
+
+    uint8_t features[sizeof(uint32_t)];
+    putU32(features, FEATURE_RESUME | FEATURE_CREDIT | FEATURE_CRC | FEATURE_DEDUP | FEATURE_FILTER);
+
+    FrameHeader hello;
+    hello.type = FrameType::Hello;
+    hello.flags = VERSION;
+    hello.length = sizeof(features);
+    hello.offset = MAGIC;
+    sendFrame(mSocket, hello, features);
+
+    mReader = std::make_unique<FrameReader>(mSocket);
+    mCredit.clear();
+    mAcked.clear();
+    mWants.clear();
+    mPushedFilters.clear();
+    mNextStream = 0;
+
+    std::vector<char> payload;
+    auto reply = _await(FrameType::Hello, &payload);
+    if (reply.offset != MAGIC)
+    {
+        throw Exception("The receiver does not speak the framed protocol.");
+    }
+
+    mPeerFeatures = (payload.size() >= sizeof(uint32_t))
+        ? getU32(reinterpret_cast<const uint8_t*>(payload.data()))
+        : 0;
+}
+
+/**
+ * @internal
+ * @brief Begin a stream on the framed connection
+ * @param[in] flags     - Common::Protocol::OpenFlags
+ * @param[in] fileId    - The file's identifier (0 for a stream)
+ * @param[in] name      - The file's name
+ * @param[in] size      - The file's size (0 for a stream)
+ * @return The new stream's id
+ */
+uint16_t Sender::_open(uint8_t flags, uint64_t fileId, const std::string& name, uint64_t size)
+{
+    using namespace Common::Protocol;
+
+    // A fresh id, so that late frames about an earlier stream cannot be mistaken for this one's
+    // Entries are made now, so that waiting on them later allocates nothing.
+    auto stream = mNextStream++;
+    mCredit[stream] = 0;
+    mAcked[stream] = 0;
+
+    std::vector<uint8_t> payload(sizeof(uint64_t) + name.size());
+    putU64(payload.data(), fileId);
+    std::memcpy(payload.data() + sizeof(uint64_t), name.data(), name.size());
+
+    FrameHeader open;
+    open.type = FrameType::Open;
+    open.flags = flags;
+    open.stream = stream;
+    open.length = static_cast<uint32_t>(payload.size());
+    open.offset = size;
+    sendFrame(mSocket, open, payload.data());
+
+    return stream;
+}
+
+/**
+ * @internal
+ * @brief Send a Data frame whose bytes are in memory, with their CRC if asked for and the
+ *          receiver checks it
+ * @param[in] stream    - The stream
+ * @param[in] offset    - The stream offset of the bytes
+ * @param[in] buffer    - The bytes, followed by CRC_SIZE bytes of room for the CRC
+ * @param[in] len       - The number of bytes
+ */
+void Sender::_sendData(uint16_t stream, uint64_t offset, char* buffer, size_t len)
+{
+    using namespace Common::Protocol;
+
+    FrameHeader data;
+    data.type = FrameType::Data;
+    data.stream = stream;
+    data.length = static_cast<uint32_t>(len);
+    data.offset = offset;
+
+    if (mChecksums && (mPeerFeatures & FEATURE_CRC))
+    {
+        putU32(reinterpret_cast<uint8_t*>(buffer + len), Common::Crc32c::extend(0, buffer, len));
+        data.flags = DATA_CRC;
+        data.length += CRC_SIZE;
+    }
+
+    sendFrame(mSocket, data, buffer);
+}
+
+/**
+ * @internal
+ * @brief Send a Data frame straight from a file with sendfile(), with its CRC if asked for and
+ *          the receiver checks it. The CRC is computed by reading the range into a small buffer
+ *          (see _fileCrc()), so the bytes sent still never pass through user space.
+ * @param[in] stream    - The stream
+ * @param[in] offset    - The stream offset of the bytes, which is also their offset in the file
+ * @param[in] fd        - The file
+ * @param[in] len       - The number of bytes
+ * @return The number of bytes sent; fewer than 'len' if the file is shorter
+ */
+size_t Sender::_sendFileData(uint16_t stream, uint64_t offset, int fd, size_t len)
+{
+    using namespace Common::Protocol;
+
+    const bool checked = mChecksums && (mPeerFeatures & FEATURE_CRC);
+
+    FrameHeader data;
+    data.type = FrameType::Data;
+    data.stream = stream;
+    data.length = static_cast<uint32_t>(len + (checked ? CRC_SIZE : 0));
+    data.offset = offset;
+    data.flags = checked ? DATA_CRC : 0;
+
+    uint8_t crc[CRC_SIZE];
+    if (checked)
+    {
+        auto value = _fileCrc(fd, offset, len);
+        if (!value)
+        {
+            // The file shrank; nothing is sent, and the caller reports it.
+            return 0;
+        }
+
+        putU32(crc, value.value());
+    }
+
+    sendFrame(mSocket, data);
+
+    auto sent = mSocket.sendFile(fd, static_cast<off_t>(offset), len);
+    if (checked && sent == len)
+    {
+        mSocket.send(crc, sizeof(crc));
+    }
+
+    return sent;
+}
+
+/**
+ * @internal
+ * @brief Compute the CRC-32C of a range of a file
+ * @param[in] fd        - The file
+ * @param[in] offset    - Where the range starts
+ * @param[in] len       - The length of the range
+ * @return The CRC, or unset if the file ends before the range does
+ * @throws Exception if the file cannot be read
+ * @details The range is read rather than mapped: a file truncated in the meantime then reads
+ *          short instead of raising SIGBUS, and one buffer serves every frame.
+ */
+std::optional<uint32_t> Sender::_fileCrc(int fd, uint64_t offset, size_t len)
+{
+    if (!mCrcBuffer)
+    {
+        mCrcBuffer = Common::BufferArena::Buffer(mArena, CRC_READ_SIZE);
+    }
+
+    Common::Crc32c crc;
+    while (len > 0)
+    {
+        auto got = pread(fd, mCrcBuffer.get(), std::min(len, mCrcBuffer.size()), static_cast<off_t>(offset));
+        if (got < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (got < 0)
+        {
+            throw Exception(std::string("Failure while reading input: ") + std::strerror(errno));
+        }
+
+        if (got == 0)
+        {
+            return std::nullopt;
+        }
+
+        crc.update(mCrcBuffer.get(), static_cast<size_t>(got));
+        offset += static_cast<uint64_t>(got);
+        len -= static_cast<size_t>(got);
+    }
+
+    return crc.value();
+}
+
+/**
+ * @internal
+ * @brief Send one file over the framed connection, starting where the receiver left off
+ * @param[in] fd        - The open file
+ * @param[in] fileId    - The file's identifier
+ * @param[in] name      - The file's name
+ * @param[in] size      - The file's size
+ * @return The number of bytes sent
+ */
+uint64_t Sender::_sendResumable(int fd, uint64_t fileId, const std::string& name, uint64_t size)
+{
+    using namespace Common::Protocol;
+
+    const auto stream = _open(0, fileId, name, size);
+
+    auto position = _await(FrameType::Resume).offset;
+    if (position > size)
+    {
+        throw Exception("The receiver holds more of " + name + " than exists.");
+    }
+
+    mStats.bytesResumed += position;
+    const auto start = position;
+
+    while (position < size)
+    {
+        auto len = static_cast<size_t>(std::min<uint64_t>({RESUME_FRAME_SIZE, size - position,
+                                                          _awaitCredit(stream, position)}));
+
+        // The payload goes from the page cache straight to the socket, from the resume point.
+        if (_sendFileData(stream, position, fd, len) != len)
+        {
+            throw Exception(name + " shrank while it was being sent.");
+        }
+
+        position += len;
+        mStats.bytesSent += len;
+    }
+
+    FrameHeader closing;
+    closing.type = FrameType::Close;
+    closing.stream = stream;
+    closing.offset = size;
+    sendFrame(mSocket, closing);
+
+    // Intermediate checkpoints may arrive first; the transfer is done once all of it is acked.
+    _awaitAck(stream, size);
+
+    return position - start;
+}
+
+/**
+ * @internal
+ * @brief Read frames until one of the given type arrives
+ * @param[in]  type     - The frame type to wait for
+ * @param[out] payload  - Receives the frame's payload (optional)
+ * @throws Common::Socket::Exception if the connection drops first
+ */
+Common::Protocol::FrameHeader Sender::_await(Common::Protocol::FrameType type, std::vector<char>* payload)
+{
+    std::vector<char> discarded;
+
+    for (;;)
+    {
+        auto header = _nextFrame(payload ? *payload : discarded);
+        if (header.type == type)
+        {
+            return header;
+        }
+    }
+}
+
+/**
+ * @internal
+ * @brief Read one frame, keeping track of credit and acknowledgements
+ * @param[out] payload  - Receives the frame's payload
+ * @throws Common::Socket::Exception if the connection has dropped
+ */
+Common::Protocol::FrameHeader Sender::_nextFrame(std::vector<char>& payload)
+{
+    auto header = mReader->next(payload);
+    if (!header)
+    {
+        throw Common::Socket::Exception(mEndpoints.front().addr, mEndpoints.front().port,
+                                        "The receiver closed the connection.");
+    }
+
+    // Neither only ever grows; a late frame must not shrink it.
+    if (header->type == Common::Protocol::FrameType::Credit)
+    {
+        auto& limit = mCredit[header->stream];
+        limit = std::max(limit, header->offset);
+    }
+    else if (header->type == Common::Protocol::FrameType::Ack)
+    {
+        auto& acked = mAcked[header->stream];
+        acked = std::max(acked, header->offset);
+        ++mStats.acks;
+    }
+    else if (header->type == Common::Protocol::FrameType::Want)
+    {
+        // Kept until asked for, since waiting on other frames would pass it by.
+        auto& indexes = mWants[std::make_pair(header->stream, header->offset)];
+        for (size_t at = 0; at + sizeof(uint32_t) <= payload.size(); at += sizeof(uint32_t))
+        {
+            indexes.push_back(Common::Protocol::getU32(reinterpret_cast<const uint8_t*>(payload.data() + at)));
+        }
+    }
+    else if (header->type == Common::Protocol::FrameType::Filter)
+    {
+        try
+        {
+            mPushedFilters[header->stream] = std::make_shared<const Common::RecordFilter>(
+                std::string(payload.begin(), payload.end()));
+        }
+        catch (const Common::RecordFilter::Exception& e)
+        {
+            throw Exception(std::string("The receiver asked for a filter that cannot be used: ") + e.what());
+        }
+    }
+
+    return header.value();
+}
+
+/**
+ * @internal
+ * @brief Wait until the receiver allows more of a stream to be sent
+ * @param[in] stream    - The stream
+ * @param[in] position  - The stream offset of the next byte to send
+ * @return The number of bytes that may be sent from 'position'
+ */
+uint64_t Sender::_awaitCredit(uint16_t stream, uint64_t position)
+{
+    if (auto credit = _credit(stream, position))
+    {
+        return credit;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    while (mCredit[stream] <= position)
+    {
+        _await(Common::Protocol::FrameType::Credit);
+    }
+
+    mStats.creditStall += std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    return mCredit[stream] - position;
+}
+
+/**
+ * @internal
+ * @brief Get how much of a stream the receiver allows to be sent, without waiting
+ * @param[in] stream    - The stream
+ * @param[in] position  - The stream offset of the next byte to send
+ */
+uint64_t Sender::_credit(uint16_t stream, uint64_t position)
+{
+    if (!(mPeerFeatures & Common::Protocol::FEATURE_CREDIT))
+    {
+        return UINT64_MAX;
+    }
+
+    auto limit = mCredit[stream];
+    return (limit > position) ? limit - position : 0;
+}
+
+/**
+ * @internal
+ * @brief Wait until the receiver has acknowledged a stream up to an offset
+ * @param[in] stream    - The stream
+ * @param[in] offset    - The offset to wait for
+ */
+void Sender::_awaitAck(uint16_t stream, uint64_t offset)
+{
+    while (mAcked[stream] < offset)
+    {
+        _await(Common::Protocol::FrameType::Ack);
+    }
+}
+
+/**
+ * @internal
+ * @brief Wait for the receiver's answer to a Recipe
+ * @param[in] stream    - The stream
+ * @param[in] offset    - The offset of the Recipe
+ * @return The indexes of the chunks the receiver wants sent
+ */
+std::vector<uint32_t> Sender::_awaitWant(uint16_t stream, uint64_t offset)
+{
+    const auto key = std::make_pair(stream, offset);
+    std::vector<char> payload;
+
+    while (!mWants.count(key))
+    {
+        _nextFrame(payload);
+    }
+
+    auto indexes = std::move(mWants[key]);
+    mWants.erase(key);
+    return indexes;
+}
+
+/**
+ * @internal
+ * @brief Take in whatever frames have already arrived (e.g. Credit), without waiting
+ */
+void Sender::_pollFrames()
+{
+    using namespace std::chrono_literals;
+
+    std::vector<char> payload;
+    while (mReader->hasBufferedFrame() || mSocket.waitReadable(0ms))
+    {
+        _nextFrame(payload);
+    }
+}
+
+/**
+ * @internal
+ * @brief Replace a failed connection with a new one to the same candidates
+ */
+void Sender::_reconnect()
+{
+    mReader.reset();
+
+    mSocket = Common::Socket(mEndpoints.front().addr, mEndpoints.front().port);
+    mAlternates.clear();
+    for (size_t index = 1; index < mEndpoints.size(); ++index)
+    {
+        mAlternates.emplace_back(mEndpoints[index].addr, mEndpoints[index].port);
+    }
+
+    setSocketOptions(mOptions);
+
+    ++mStats.reconnects;
+    connect();
+}
+
+/**
+ * @internal
+ * @brief Make the sieve an input's records go through, if any are to be left out
+ * @param[in] sampleRate    - The fraction of the input's records to send
+ * @param[in] pushed        - The filter the receiver asked for on the input's stream, if any
+ * @return The sieve, or null if every record is sent
+ */
+std::unique_ptr<RecordSieve> Sender::_sieve(double sampleRate, std::shared_ptr<const Common::RecordFilter> pushed)
+{
+    auto leavesOut = [](const std::shared_ptr<const Common::RecordFilter>& filter)
+    {
+        return filter && (!filter->passesAll() || filter->sampleRate() < 1.0);
+    };
+
+    if (!leavesOut(mFilter) && !leavesOut(pushed) && sampleRate >= 1.0)
+    {
+        return nullptr;
+    }
+
+    std::vector<std::shared_ptr<const Common::RecordFilter>> filters{mFilter, std::move(pushed)};
+    return std::make_unique<RecordSieve>(std::move(filters), sampleRate, std::random_device{}());
+}
+
+/**
+ * @internal
+ * @brief The filter the receiver asked for on a stream
+ * @return The filter, or null if it asked for none
+ */
+std::shared_ptr<const Common::RecordFilter> Sender::_pushedFilter(uint16_t stream) const
+{
+    auto found = mPushedFilters.find(stream);
+    return (found != mPushedFilters.end()) ? found->second : nullptr;
 }
@@ -10,15 +10,30 @@
 #pragma once
 
 // Project Headers
+#include "BufferPool.h"
+#include "StreamScheduler.h"
 #include "Common/Socket.h"
+#include "Common/Endpoint.h"
+#include "Common/Protocol.h"
+#include "Common/LatencyHistogram.h"
+#include "Common/RecordFilter.h"
 
 // Standard Headers
 #include <iostream>
 #include <exception>
 #include <string>
 #include <vector>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <map>
+#include <optional>
+#include <utility>
 #include <stdint.h>
 
+class FileFollower;
+class RecordSieve;
+
 
 /**
  * @brief A class to handle basic sending of streams over a socket
@@ -32,7 +47,97 @@ public: // Definitions
     class Exception;
     struct CommandLineData;
 
-    static constexpr int DEFAULT_RETRIES = 4;
+    /// How streams are divided into sends
+    enum class Mode
+    {
+        Line,           ///< One send per line
+        Block,          ///< Large fixed-size blocks, zero-copy when the socket allows it
+    };
+
+    /// Scheduling of one input among several sent at once (see sendStreams()), and its sampling
+    struct StreamSettings
+    {
+        int         priority{0};        ///< Higher priorities are always served first
+        unsigned    weight{1};          ///< Share of the connection relative to equal priorities
+        double      sample{1.0};        ///< The fraction of the input's records to send (see setSampling())
+    };
+
+    /// An input for sendStreams()
+    struct StreamSource
+    {
+        int             fd;             ///< Read until end of file (not owned)
+        std::string     name;           ///< For the receiver's information
+        StreamSettings  settings;
+    };
+
+    /// Statistics gathered by a Sender
+    struct Stats
+    {
+        std::chrono::microseconds   connectLatency{0};      ///< Time from connect() until a connection was established
+        int                         connectAttempts{0};     ///< Rounds of connection attempts made
+        std::string                 connectedTo;            ///< The candidate that won the connection
+        uint64_t                    bytesSent{0};
+        uint64_t                    zeroCopySends{0};       ///< Block sends made with MSG_ZEROCOPY
+        bool                        zeroCopyDeferred{false};///< The kernel copied anyway, so zero-copy was turned off
+        uint64_t                    bytesResumed{0};        ///< File bytes skipped because the receiver already held them
+        int                         reconnects{0};          ///< Connections re-established to resume a transfer
+        uint64_t                    lineSends{0};           ///< Socket sends made in line mode
+        std::chrono::microseconds   creditStall{0};         ///< Time spent waiting for the receiver to grant credit
+        uint64_t                    bytesSpooled{0};        ///< Framed input that overflowed to disk while waiting
+        uint64_t                    acks{0};                ///< Acknowledgements of durable data from the receiver
+        uint64_t                    bytesDeduplicated{0};   ///< File bytes not sent because the receiver held them as chunks
+        uint64_t                    bytesFiltered{0};       ///< Input not sent because filters or sampling left it out
+    };
+
+    /// Round trip times measured by pingPong(), in nanoseconds
+    struct RoundTrips
+    {
+        size_t                      messageSize{0};
+        uint64_t                    rate{0};                ///< Requests per second (0: each as soon as the last returns)
+        Common::LatencyHistogram    measured;               ///< From each request's send to the end of its echo
+        Common::LatencyHistogram    corrected;              ///< From when each request was due, so that a stall counts against every request it held back
+    };
+
+    static constexpr int DEFAULT_RETRIES = 8;
+
+    /// How long a single round of connection attempts may wait for a handshake
+    static constexpr std::chrono::milliseconds CONNECT_TIMEOUT{500};
+
+    /// The ceiling of the first retry delay; this doubles per retry up to RETRY_DELAY_CAP.
+    static constexpr std::chrono::milliseconds RETRY_DELAY_BASE{25};
+    static constexpr std::chrono::milliseconds RETRY_DELAY_CAP{1000};
+
+    /// Block mode send size, and the number of blocks that may be in flight at once
+    static constexpr size_t BLOCK_SIZE = 256 * 1024;
+    static constexpr size_t BLOCK_COUNT = 8;
+
+    /// Blocks smaller than this are copied: pinning pages for a zero-copy send costs more than
+    /// copying a small buffer.
+    static constexpr size_t ZEROCOPY_THRESHOLD = 32 * 1024;
+
+    /// Line mode batching defaults (see setBatching())
+    static constexpr size_t BATCH_BYTES = 64 * 1024;
+    static constexpr std::chrono::microseconds BATCH_DELAY{200};
+
+    /// The payload size of Data frames in resumable transfers
+    static constexpr size_t RESUME_FRAME_SIZE = 1024 * 1024;
+
+    /// The largest Data frame when streams are interleaved; this bounds how long an urgent
+    /// stream can wait behind a frame already being sent.
+    static constexpr size_t MUX_FRAME_SIZE = 64 * 1024;
+
+    /// The most chunks one Recipe describes (so that it fits in one small frame), and the number
+    /// of Recipes that may await their Want at once
+    static constexpr size_t RECIPE_CHUNKS = 200;
+    static constexpr size_t RECIPE_WINDOW = 4;
+
+    /// The message sizes pingPong() is swept over (in powers of two), and the round trips at each
+    static constexpr size_t PING_MIN_SIZE = 8;
+    static constexpr size_t PING_MAX_SIZE = 1024 * 1024;
+    static constexpr uint64_t PING_COUNT = 1000;
+
+    /// The most of a request sent before taking back what has been echoed of it
+    static constexpr size_t PING_PIECE_SIZE = 64 * 1024;
 
 public: // Methods
 
@@ -43,12 +148,28 @@ public: // Methods
      */
     Sender(const std::string& addr, uint16_t port);
 
+    /**
+     * @brief Construct a Sender object with several candidate server addresses
+     * @param[in] candidates    The addresses of the server, tried in parallel. Must not be empty.
+     */
+    explicit Sender(const std::vector<Common::Endpoint>& candidates);
+
     virtual ~Sender();
 
+    /**
+     * @brief Apply socket tuning to the connection (before connect())
+     * @param[in] options   The options to apply to every candidate connection
+     * @return The names of options the system could not apply (and skipped)
+     * @throws Common::Socket::Exception upon failure
+     */
+    std::vector<std::string> setSocketOptions(const Common::SocketOptions& options);
+
     /**
      * @brief Connect the sender to the server
-     * @param[in] retries   The number of times to retry for a connection if initially unsuccessful (default: 4)
+     * @param[in] retries   The number of times to retry for a connection if initially unsuccessful (default: 8)
      * @throws Exeception if ultimately unsuccessful
+     * @details All candidate addresses are attempted at once with non-blocking connects and the
+     *          first to complete is used. Retries back off exponentially with jitter.
      */
     void connect(int retries = DEFAULT_RETRIES);
 
@@ -56,18 +177,200 @@ public: // Methods
      * @brief Parse the command line
      * @param[in] argc      The command line argc
      * @param[in] argv      The command line argv
+     * @throws Exception on an invalid option
+     */
+    static CommandLineData parseCommandLine(int argc, const char* const* argv);
+
+    /**
+     * @brief Select how streams are divided into sends (default: Mode::Line)
+     * @param[in] mode      The mode to use
+     */
+    void setMode(Mode mode) noexcept;
+
+    /**
+     * @brief Coalesce lines into larger sends in line mode (default: off)
+     * @param[in] bytes     Send once this many bytes are pending; 0 turns batching off
+     * @param[in] maxDelay  Send once the oldest pending line has waited this long
+     */
+    void setBatching(size_t bytes, std::chrono::microseconds maxDelay = BATCH_DELAY) noexcept;
+
+    /**
+     * @brief Take block and frame buffers from an arena of huge pages (default: the heap)
+     * @param[in] arena     The arena, which must outlive the Sender; null for the heap
+     */
+    void setArena(Common::BufferArena* arena) noexcept;
+
+    /**
+     * @brief Send only the records (lines) that pass a filter (default: every record)
+     * @param[in] filter    The filter, or null for none
+     * @details Applies to every input sent as a stream of records: sendStream(), sendFile(),
+     *          sendFramed(), sendStreams() and sendFollowed(), in line and block mode alike. Files
+     *          sent to be resumed or deduplicated are copies of the file, and are sent whole.
+     *          Records are judged and sent whole. A receiver may add a filter of its own to a
+     *          framed stream (see Common::Protocol::FrameType::Filter); a record must pass both.
+     */
+    void setFilter(std::shared_ptr<const Common::RecordFilter> filter) noexcept;
+
+    /**
+     * @brief Send only a fraction of the records of each input (default: 1, all of them)
+     * @param[in] rate      The fraction to send, each record chosen at random, independently.
+     *                      sendStreams() takes each stream's from its StreamSettings instead.
      */
-    CommandLineData parseCommandLine(int argc, const char* const* argv);
+    void setSampling(double rate) noexcept;
 
     /**
-     * @brief Send the given input over the socket, one line at a time
+     * @brief Append a CRC-32C to each framed Data frame, where the receiver checks them
+     *          (default: off)
+     * @param[in] enabled   True to checksum
+     * @details The receiver checks every frame that carries one. Checksumming costs each end a
+     *          pass over the data, which is noticeable when both share a core, so it is asked for
+     *          rather than assumed.
+     */
+    void setChecksums(bool enabled) noexcept;
+
+    /**
+     * @brief Send the given input over the socket, one line or block at a time
      * @param[in] input             The stream to send over the socket
      * @throws Exception upon failure
      */
     void sendStream(std::istream& input);
 
+    /**
+     * @brief Send the entire contents of an open file descriptor over the socket
+     * @param[in] fd                The descriptor to read until end of file. Regular files are
+     *                              sent with sendfile() so their contents are never copied into
+     *                              this process; anything else (pipes, terminals) is read and sent
+     *                              in blocks.
+     * @return The number of bytes sent
+     * @throws Exception upon failure
+     */
+    uint64_t sendFile(int fd);
+
+    /**
+     * @brief Send a file so that a dropped connection does not mean starting over
+     * @param[in] path          The file to send
+     * @param[in] reconnects    The number of times to reconnect and resume after a failure
+     * @return The number of bytes sent (excluding any the receiver already held)
+     * @throws Exception upon failure, or once 'reconnects' is exhausted
+     * @details The connection switches to the framed protocol (see Common/Protocol.h). The
+     *          receiver reports how much of the file it already holds durably, and sending
+     *          starts from there.
+     */
+    uint64_t sendFileResumable(const std::string& path, int reconnects = DEFAULT_RETRIES);
+
+    /**
+     * @brief Send an input as a framed stream, subject to the receiver's flow control
+     * @param[in] fd        The input to read until end of file (e.g. standard input)
+     * @param[in] name      A name for the stream, for the receiver's information
+     * @return The number of bytes sent
+     * @throws Exception upon failure
+     * @details The input is read ahead of the connection. While the receiver withholds credit,
+     *          it accumulates in memory and then on local disk (see Spool), so the producer of
+     *          the input is not stalled by a slow receiver.
+     */
+    uint64_t sendFramed(int fd, const std::string& name);
+
+    /**
+     * @brief Send a file as a framed stream, leaving out the parts the receiver already holds
+     * @param[in] fd        The file to send (its position is not used)
+     * @param[in] name      A name for the stream, for the receiver's information
+     * @return The number of file bytes sent (excluding any the receiver already held)
+     * @throws Exception upon failure
+     * @details The file is divided into chunks by content (see Chunker) and each chunk is
+     *          fingerprinted, on a thread of its own as the sending goes on. Recipes of chunk
+     *          fingerprints go first; the receiver answers each with the chunks it lacks, and only
+     *          those are sent. Data shared with earlier transfers, wherever it lies in the file,
+     *          then crosses the network once.
+     *
+     *          If the receiver keeps no chunks, or the input is not a regular file (e.g. a pipe),
+     *          it is sent as sendFramed() would. An input that shrinks while it is sent is an error.
+     */
+    uint64_t sendDeduplicated(int fd, const std::string& name);
+
+    /**
+     * @brief Send several inputs at once, interleaved over the one connection
+     * @param[in] sources   The inputs. Each becomes a stream of its own, scheduled by its
+     *                      settings (see StreamScheduler), and subject to the receiver's flow
+     *                      control separately.
+     * @return The total number of bytes sent
+     * @throws Exception upon failure
+     */
+    uint64_t sendStreams(const std::vector<StreamSource>& sources);
+
+    /**
+     * @brief Send the lines appended to files as they are written, until the follower is stopped
+     * @param[in] follower      The files to follow (see FileFollower)
+     * @param[in] sampleRates   The fraction of each file's records to send, by the follower's
+     *                          index (files beyond these take setSampling()'s)
+     * @return The number of bytes sent
+     * @throws Exception upon failure
+     * @details Each run of whole lines read goes out in one send, or into a batch if batching
+     *          is on, so lines from different files share the connection without being split.
+     */
+    uint64_t sendFollowed(FileFollower& follower, const std::vector<double>& sampleRates = {});
+
+    /**
+     * @brief Measure round trips to a receiver that echoes what it is sent (receiver --echo)
+     * @param[in] messageSize   The size of each request, and so of each echo
+     * @param[in] count         The number of round trips to make
+     * @param[in] rate          Requests per second (0: each as soon as the last returns)
+     * @return The round trip times
+     * @throws Exception if the receiver disconnects, as one that does not echo eventually does
+     * @details At a fixed rate, each request is due at a fixed interval after the last. A request
+     *          held back by a slow round trip is sent late, and the time it spent waiting to be
+     *          sent is counted in RoundTrips::corrected but not in RoundTrips::measured. Measured
+     *          alone, a stall would be recorded once, rather than against every request a
+     *          steady client would have sent during it ("coordinated omission").
+     */
+    RoundTrips pingPong(size_t messageSize, uint64_t count, uint64_t rate = 0);
+
+    /// @brief Get the statistics gathered so far
+    const Stats& stats() const noexcept;
+
+private: // Methods
+    static const Common::Endpoint& _primary(const std::vector<Common::Endpoint>& candidates);
+    uint64_t _sendBlocks(const std::function<size_t(char* buffer, size_t len)>& read);
+    size_t _acquireBlock();
+    void _handshake();
+    uint64_t _sendResumable(int fd, uint64_t fileId, const std::string& name, uint64_t size);
+    Common::Protocol::FrameHeader _await(Common::Protocol::FrameType type, std::vector<char>* payload = nullptr);
+    Common::Protocol::FrameHeader _nextFrame(std::vector<char>& payload);
+    uint64_t _awaitCredit(uint16_t stream, uint64_t position);
+    uint64_t _credit(uint16_t stream, uint64_t position);
+    void _awaitAck(uint16_t stream, uint64_t offset);
+    std::vector<uint32_t> _awaitWant(uint16_t stream, uint64_t offset);
+    void _pollFrames();
+    uint16_t _open(uint8_t flags, uint64_t fileId, const std::string& name, uint64_t size);
+    void _sendData(uint16_t stream, uint64_t offset, char* buffer, size_t len);
+    size_t _sendFileData(uint16_t stream, uint64_t offset, int fd, size_t len);
+    std::optional<uint32_t> _fileCrc(int fd, uint64_t offset, size_t len);
+    void _reconnect();
+    std::unique_ptr<RecordSieve> _sieve(double sampleRate, std::shared_ptr<const Common::RecordFilter> pushed = nullptr);
+    std::shared_ptr<const Common::RecordFilter> _pushedFilter(uint16_t stream) const;
+
 private: // Members
-    Common::Socket      mSocket;
+    Common::Socket                  mSocket;
+    std::vector<Common::Socket>     mAlternates;        ///< Other candidate connections (until connected)
+    std::vector<Common::Endpoint>   mEndpoints;         ///< The candidate addresses, in the same order
+    Stats                           mStats;
+    Mode                            mMode{Mode::Line};
+    bool                            mZeroCopy{false};   ///< SO_ZEROCOPY is set and still worthwhile
+    std::unique_ptr<BufferPool>     mPool;              ///< Block buffers (created on first use)
+    Common::BufferArena*            mArena{nullptr};    ///< Where large buffers come from (null: the heap)
+    Common::BufferArena::Buffer     mCrcBuffer;         ///< Files are read through this to checksum them (allocated on first use)
+    size_t                          mBatchBytes{0};     ///< Line mode batch size (0: no batching)
+    std::chrono::microseconds       mBatchDelay{BATCH_DELAY};
+    Common::SocketOptions           mOptions;           ///< Applied again to new connections
+    std::unique_ptr<Common::Protocol::FrameReader> mReader;     ///< Set once the connection is framed
+    uint32_t                        mPeerFeatures{0};   ///< From the receiver's Hello
+    std::map<uint16_t, uint64_t>    mCredit;            ///< Credit limit per stream
+    std::map<uint16_t, uint64_t>    mAcked;             ///< Acknowledged offset per stream
+    std::map<std::pair<uint16_t, uint64_t>, std::vector<uint32_t>>  mWants;    ///< Want replies not yet acted on, by stream and offset
+    uint16_t                        mNextStream{0};     ///< Stream ids are not reused within a connection
+    std::shared_ptr<const Common::RecordFilter>     mFilter;        ///< Records must pass this to be sent (null: all pass)
+    double                          mSampleRate{1.0};   ///< The fraction of records sent
+    bool                            mChecksums{false};  ///< Data frames carry a CRC, if the receiver checks them
+    std::map<uint16_t, std::shared_ptr<const Common::RecordFilter>> mPushedFilters;    ///< Filters the receiver asked for, by stream
 
 }; // class Sender
 
@@ -97,6 +400,39 @@ private:
 
 struct Sender::CommandLineData
 {
-    std::vector<std::string>    filesToSend;
-    bool                        readStdin{false};
+    std::vector<std::string>        filesToSend;
+    bool                            readStdin{false};
+    std::vector<Common::Endpoint>   receivers;              ///< --receiver addr[:port] (repeatable)
+    std::vector<Common::Endpoint>   cluster;                ///< --cluster addr[:port][@weight] (repeatable)
+    std::vector<unsigned>           clusterWeights;         ///< The weight of each of 'cluster'
+    std::string                     key;                    ///< --key <key>: place every input by this key
+    size_t                          maxConnections{4};      ///< --max-connections <n> (with --cluster)
+    bool                            printStats{false};      ///< --stats
+    bool                            daemon{false};          ///< --daemon: keep a warm connection and serve local senders
+    bool                            viaDaemon{false};       ///< --via-daemon: hand inputs to a running daemon
+    std::string                     daemonSocket;           ///< --daemon-socket <path>
+    Common::SocketOptions           socketOptions;          ///< --profile <default|bulk|low-latency>
+    std::string                     profile;                ///< The name given to --profile (empty: none)
+    Mode                            mode{Mode::Line};       ///< --block
+    bool                            resume{false};          ///< --resume: send files resumably
+    bool                            framed{false};          ///< --framed: send inputs as flow-controlled streams
+    bool                            multiplex{false};       ///< --mux: send all inputs at once over one connection
+    bool                            dedup{false};           ///< --dedup: send files framed, without the chunks the receiver holds
+    bool                            checksums{false};       ///< --crc: checksum framed Data frames
+    bool                            follow{false};          ///< --follow: send lines as they are appended to the files
+    std::vector<StreamSettings>     fileSettings;           ///< --priority/--weight/--sample in effect for each of filesToSend
+    StreamSettings                  stdinSettings;          ///< --priority/--weight/--sample in effect for '-'
+    std::string                     filter;                 ///< --filter <clause> (repeatable): send only the records that pass every clause
+    size_t                          batchBytes{0};          ///< --batch-bytes <n>
+    std::chrono::microseconds       maxDelay{BATCH_DELAY};  ///< --max-delay-us <n>
+    std::vector<int>                cpus;                   ///< --cpus <list>: run the sender's threads on these CPUs
+    size_t                          arenaBytes{0};          ///< --arena-bytes <n>: take large buffers from huge pages (0: the heap)
+    bool                            arenaPrefault{true};    ///< --no-prefault: fault the arena in as it is used instead
+    bool                            pingPong{false};        ///< --ping-pong: measure round trips to a receiver running with --echo
+    uint64_t                        pingCount{PING_COUNT};  ///< --ping-count <n>: round trips per message size
+    std::vector<uint64_t>           pingRates{0};           ///< --ping-rates <n>[,<n>]...: requests per second to sweep (0: back to back)
+    std::string                     pingHistograms;         ///< --ping-histograms <file>: write each full distribution here
+    std::string                     replayFile;             ///< --replay <file>: send a capture made by receiver --capture
+    double                          replaySpeed{1.0};       ///< --replay-speed <x>|max: relative to the captured timing (0: max)
 };
+
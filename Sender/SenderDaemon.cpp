@@ -0,0 +1,231 @@
+/**
+ * @brief A long-running sender that keeps a warm connection for short-lived senders
+ *
+ * @file SenderDaemon.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Source header
+#include "SenderDaemon.h"
+
+// Project headers
+#include "Common/SocketException.h"
+
+// System headers
+#include <unistd.h>
+
+// Standard headers
+#include <iostream>
+
+
+namespace
+{
+    /// Request to send the descriptor that accompanies it
+    constexpr char SUBMIT_REQUEST = 'F';
+
+    /// The daemon's answer to a submitted descriptor
+    struct Reply
+    {
+        int32_t     status;         ///< 0 on success
+        uint64_t    bytesSent;
+    };
+
+    /// Read exactly 'len' bytes; false if the peer disconnected first
+    bool recvAll(Common::UnixSocket& socket, void* buffer, size_t len)
+    {
+        auto data = static_cast<char*>(buffer);
+        while (len > 0)
+        {
+            int fd = -1;
+            auto received = socket.recv(data, len, fd);
+            if (fd >= 0)
+            {
+                // Not expected here; don't leak it.
+                close(fd);
+            }
+
+            if (!received)
+            {
+                return false;
+            }
+
+            data += received.value();
+            len -= received.value();
+        }
+
+        return true;
+    }
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+SenderDaemon::SenderDaemon(const std::string& socketPath, const std::vector<Common::Endpoint>& receivers,
+                           const Common::SocketOptions& options)
+    : mReceivers(receivers)
+    , mOptions(options)
+    , mListenSocket(socketPath)
+{
+}
+
+
+//-----------------------------------------------------------------------------
+SenderDaemon::~SenderDaemon() = default;
+
+
+//-----------------------------------------------------------------------------
+void SenderDaemon::execute()
+{
+    // Warm the connection before the first client needs it.
+    _connect();
+
+    mListenSocket.bind();
+    mListenSocket.listen();
+
+    for (;;)
+    {
+        auto client = mListenSocket.accept();
+        if (!client)
+        {
+            break;
+        }
+
+        try
+        {
+            _serve(client.value());
+        }
+        catch (const std::exception& e)
+        {
+            // One misbehaving client must not take the daemon down.
+            std::cerr << e.what() << std::endl;
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+void SenderDaemon::stop() noexcept
+{
+    mListenSocket.shutdown();
+}
+
+
+//-----------------------------------------------------------------------------
+// Private Methods
+//-----------------------------------------------------------------------------
+
+/**
+ * @internal
+ * @brief Handle requests from one local sender until it disconnects
+ * @param[in] client    - The connected local sender
+ */
+void SenderDaemon::_serve(Common::UnixSocket& client)
+{
+    for (;;)
+    {
+        char request = 0;
+        int fd = -1;
+        auto received = client.recv(&request, sizeof(request), fd);
+        if (!received)
+        {
+            break;
+        }
+
+        Reply reply{0, 0};
+
+        if (request != SUBMIT_REQUEST || fd < 0)
+        {
+            reply.status = 1;
+        }
+        else
+        {
+            try
+            {
+                reply.bytesSent = _forward(fd);
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << e.what() << std::endl;
+                reply.status = 1;
+            }
+        }
+
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+
+        client.send(&reply, sizeof(reply));
+    }
+}
+
+/**
+ * @internal
+ * @brief Send a descriptor's contents over the warm connection, reconnecting if it was lost
+ * @param[in] fd        - The descriptor passed by the local sender
+ * @return The number of bytes sent
+ */
+uint64_t SenderDaemon::_forward(int fd)
+{
+    if (!mSender)
+    {
+        _connect();
+    }
+
+    try
+    {
+        return mSender->sendFile(fd);
+    }
+    catch (...)
+    {
+        // The connection is suspect; build a new one for the next request.
+        mSender.reset();
+        throw;
+    }
+}
+
+/**
+ * @internal
+ * @brief Establish the connection to the server
+ */
+void SenderDaemon::_connect()
+{
+    auto sender = std::make_unique<Sender>(mReceivers);
+    sender->setSocketOptions(mOptions);
+    sender->connect();
+    mSender = std::move(sender);
+}
+
+
+//-----------------------------------------------------------------------------
+// SenderDaemon::Client
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+SenderDaemon::Client::Client(const std::string& socketPath)
+    : mSocket(socketPath)
+{
+    mSocket.connect();
+}
+
+
+//-----------------------------------------------------------------------------
+uint64_t SenderDaemon::Client::submit(int fd)
+{
+    mSocket.send(&SUBMIT_REQUEST, sizeof(SUBMIT_REQUEST), fd);
+
+    Reply reply;
+    if (!recvAll(mSocket, &reply, sizeof(reply)))
+    {
+        throw Sender::Exception("The sender daemon disconnected.");
+    }
+
+    if (reply.status != 0)
+    {
+        throw Sender::Exception("The sender daemon failed to send the input.");
+    }
+
+    return reply.bytesSent;
+}
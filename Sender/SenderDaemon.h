@@ -0,0 +1,102 @@
+/**
+ * @brief A long-running sender that keeps a warm connection for short-lived senders
+ *
+ * @file SenderDaemon.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+// Project Headers
+#include "Sender.h"
+#include "Common/UnixSocket.h"
+#include "Common/Endpoint.h"
+
+// Standard Headers
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+
+/**
+ * @brief Holds a connection to the server open across many sender invocations.
+ * @details Local senders connect over a Unix socket and pass the open file descriptor of each
+ *          input (SCM_RIGHTS) rather than its contents. The daemon sends straight from that
+ *          descriptor, so the data is read once, by the process that owns the connection, and
+ *          callers pay neither the TCP handshake nor slow-start. Clients are served one at a
+ *          time so that inputs from different invocations are never interleaved.
+ */
+class SenderDaemon
+{
+    SenderDaemon(const SenderDaemon&) = delete;
+    SenderDaemon& operator =(const SenderDaemon&) = delete;
+
+public: // Definitions
+    class Client;
+
+public: // Methods
+    /**
+     * @brief Construct a SenderDaemon
+     * @param[in] socketPath    The Unix socket path on which to accept local senders
+     * @param[in] receivers     The candidate server addresses (see Sender)
+     * @param[in] options       Socket tuning for the connection to the server
+     */
+    SenderDaemon(const std::string& socketPath, const std::vector<Common::Endpoint>& receivers,
+                 const Common::SocketOptions& options = {});
+
+    virtual ~SenderDaemon();
+
+    /**
+     * @brief Connect to the server, then serve local senders until stop() is called
+     * @throws Sender::Exception if the initial connection fails
+     * @throws Common::Socket::Exception on failure of the local socket
+     */
+    void execute();
+
+    /**
+     * @brief Stop accepting local senders; execute() returns once the current client is done.
+     */
+    void stop() noexcept;
+
+private: // Methods
+    void _serve(Common::UnixSocket& client);
+    uint64_t _forward(int fd);
+    void _connect();
+
+private: // Members
+    std::vector<Common::Endpoint>   mReceivers;
+    Common::SocketOptions           mOptions;
+    Common::UnixSocket              mListenSocket;
+    std::unique_ptr<Sender>         mSender;            ///< The warm connection (reset after a failure)
+
+}; // class SenderDaemon
+
+
+/**
+ * @brief The short-lived side of the daemon: hands inputs to a running SenderDaemon
+ */
+class SenderDaemon::Client
+{
+public: // Methods
+    /**
+     * @brief Connect to a running daemon
+     * @param[in] socketPath    The daemon's Unix socket path
+     * @throws Common::Socket::Exception if no daemon is listening
+     */
+    explicit Client(const std::string& socketPath);
+
+    /**
+     * @brief Have the daemon send the contents of a file descriptor
+     * @param[in] fd    The descriptor to send to end of file. The caller keeps its own copy.
+     * @return The number of bytes the daemon sent
+     * @throws Sender::Exception if the daemon reports a failure
+     */
+    uint64_t submit(int fd);
+
+private: // Members
+    Common::UnixSocket  mSocket;
+
+}; // class SenderDaemon::Client
@@ -0,0 +1,307 @@
+/**
+ * @brief Reads an input ahead of the connection, overflowing to disk
+ *
+ * @file Spool.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Source header
+#include "Spool.h"
+
+// System headers
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+
+// Standard headers
+#include <cstring>
+#include <algorithm>
+
+
+namespace
+{
+    constexpr size_t READ_SIZE = 64 * 1024;
+
+    std::string errorText(const std::string& what)
+    {
+        return what + ": " + std::strerror(errno);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+Spool::Spool(int fd, size_t memoryLimit, const std::string& directory, int readySignal)
+    : mInput(fd)
+    , mMemoryLimit(memoryLimit)
+    , mDirectory(directory)
+    , mReadySignal(readySignal)
+{
+    if (pipe2(mStopPipe, O_CLOEXEC) < 0)
+    {
+        throw Exception(errorText("Cannot create pipe"));
+    }
+
+    mReader = std::thread(&Spool::_readerThread, this);
+}
+
+//-----------------------------------------------------------------------------
+Spool::~Spool()
+{
+    char stop = 0;
+    while (write(mStopPipe[1], &stop, sizeof(stop)) < 0 && errno == EINTR)
+    {
+    }
+
+    mReader.join();
+
+    close(mStopPipe[0]);
+    close(mStopPipe[1]);
+
+    if (mFile >= 0)
+    {
+        close(mFile);
+    }
+}
+
+//-----------------------------------------------------------------------------
+size_t Spool::read(char* buffer, size_t len)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    mReadable.wait(lock, [this]{ return _readyLocked(); });
+
+    // Memory holds the oldest input, then the file.
+    if (!mMemory.empty())
+    {
+        auto& front = mMemory.front();
+        auto count = std::min(len, front.size() - mFrontOffset);
+        std::memcpy(buffer, front.data() + mFrontOffset, count);
+
+        mFrontOffset += count;
+        if (mFrontOffset == front.size())
+        {
+            mMemoryBytes -= front.size();
+            mMemory.pop_front();
+            mFrontOffset = 0;
+        }
+
+        return count;
+    }
+
+    if (mFileRead < mFileWritten)
+    {
+        auto count = static_cast<size_t>(std::min<uint64_t>(len, mFileWritten - mFileRead));
+        auto offset = mFileRead;
+
+        // Only this thread reads the file, and the writer never touches what is already there.
+        lock.unlock();
+        auto readResult = pread(mFile, buffer, count, static_cast<off_t>(offset));
+        lock.lock();
+
+        if (readResult <= 0)
+        {
+            throw Exception(errorText("Cannot read the spool file"));
+        }
+
+        mFileRead += static_cast<uint64_t>(readResult);
+
+        if (mFileRead == mFileWritten && !mFileWriting)
+        {
+            // Drained: start over in memory, and give the disk space back.
+            mFileRead = 0;
+            mFileWritten = 0;
+            mFileActive = false;
+            if (ftruncate(mFile, 0) < 0)
+            {
+                throw Exception(errorText("Cannot truncate the spool file"));
+            }
+        }
+
+        return static_cast<size_t>(readResult);
+    }
+
+    if (mError)
+    {
+        std::rethrow_exception(mError);
+    }
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+bool Spool::ready() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return _readyLocked();
+}
+
+//-----------------------------------------------------------------------------
+bool Spool::ended() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEnded && !mError && mMemory.empty() && mFileRead >= mFileWritten;
+}
+
+//-----------------------------------------------------------------------------
+uint64_t Spool::spooledBytes() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mSpooled;
+}
+
+//-----------------------------------------------------------------------------
+// Private Methods
+//-----------------------------------------------------------------------------
+
+/// @internal
+/// @brief Read the input until it ends, an error occurs, or the Spool is destroyed
+void Spool::_readerThread()
+{
+    // Reads land in one buffer; what is queued in memory is copied out at its own size, so a short
+    // read does not hold a whole READ_SIZE and mMemoryBytes counts what is really held.
+    std::vector<char> scratch(READ_SIZE);
+
+    try
+    {
+        for (;;)
+        {
+            pollfd fds[2] =
+            {
+                { mInput, POLLIN, 0 },
+                { mStopPipe[0], POLLIN, 0 },
+            };
+
+            if (poll(fds, 2, -1) < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                throw Exception(errorText("Cannot wait for input"));
+            }
+
+            if (fds[1].revents)
+            {
+                return;
+            }
+
+            auto readResult = ::read(mInput, scratch.data(), scratch.size());
+            if (readResult < 0)
+            {
+                if (errno == EINTR || errno == EAGAIN)
+                {
+                    continue;
+                }
+
+                throw Exception(errorText("Failure while reading input"));
+            }
+
+            if (readResult == 0)
+            {
+                break;
+            }
+
+            const auto size = static_cast<size_t>(readResult);
+
+            std::unique_lock<std::mutex> lock(mMutex);
+
+            if (!mFileActive && mMemoryBytes + size <= mMemoryLimit)
+            {
+                mMemoryBytes += size;
+                mMemory.emplace_back(scratch.data(), scratch.data() + size);
+            }
+            else
+            {
+                // From now on input queues behind the file until the file drains.
+                mFileActive = true;
+                mFileWriting = true;
+                if (mFile < 0)
+                {
+                    _openFile();
+                }
+
+                auto offset = mFileWritten;
+                lock.unlock();
+
+                size_t written = 0;
+                while (written < size)
+                {
+                    auto writeResult = pwrite(mFile, scratch.data() + written, size - written,
+                                              static_cast<off_t>(offset + written));
+                    if (writeResult < 0 && errno != EINTR)
+                    {
+                        throw Exception(errorText("Cannot write the spool file"));
+                    }
+
+                    written += static_cast<size_t>(std::max<ssize_t>(writeResult, 0));
+                }
+
+                lock.lock();
+                mFileWriting = false;
+                mFileWritten += written;
+                mSpooled += written;
+            }
+
+            lock.unlock();
+            mReadable.notify_one();
+            _signalReady();
+        }
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mError = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEnded = true;
+    }
+
+    mReadable.notify_one();
+    _signalReady();
+}
+
+/// @internal
+/// @brief Tell a consumer waiting on the ready signal, if any, that there is something for it
+void Spool::_signalReady()
+{
+    if (mReadySignal < 0)
+    {
+        return;
+    }
+
+    const uint64_t one = 1;
+    while (write(mReadySignal, &one, sizeof(one)) < 0 && errno == EINTR)
+    {
+    }
+}
+
+/// @internal
+/// @brief Whether read() can proceed (the caller holds mMutex)
+bool Spool::_readyLocked() const
+{
+    return !mMemory.empty() || mFileRead < mFileWritten || mEnded || mError;
+}
+
+/// @internal
+/// @brief Create the overflow file (the caller holds mMutex)
+void Spool::_openFile()
+{
+    // An unnamed file disappears by itself however the process ends.
+    mFile = open(mDirectory.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if (mFile < 0)
+    {
+        auto path = mDirectory + "/sender-spool.XXXXXX";
+        mFile = mkostemp(path.data(), O_CLOEXEC);
+        if (mFile < 0)
+        {
+            throw Exception(errorText("Cannot create a spool file in " + mDirectory));
+        }
+
+        unlink(path.c_str());
+    }
+}
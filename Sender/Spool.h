@@ -0,0 +1,132 @@
+/**
+ * @brief Reads an input ahead of the connection, overflowing to disk
+ *
+ * @file Spool.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+// Standard Headers
+#include <string>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+#include <stdint.h>
+
+
+/**
+ * @brief Keeps reading an input while the connection cannot take more, so that a slow receiver
+ *          does not stall whatever is producing the input.
+ * @details Input is held in memory up to a limit. Beyond that it is appended to an unlinked
+ *          temporary file, and read back from there once memory has been consumed; data comes out
+ *          in the order it went in. When the file has been drained it is truncated and memory is
+ *          used again.
+ */
+class Spool
+{
+    Spool(const Spool&) = delete;
+    Spool& operator =(const Spool&) = delete;
+
+public: // Definitions
+    class Exception;
+
+    static constexpr size_t DEFAULT_MEMORY_LIMIT = 4 * 1024 * 1024;
+    static constexpr const char* DEFAULT_DIRECTORY = "/tmp";
+
+public: // Methods
+    /**
+     * @brief Construct a Spool and start reading the input
+     * @param[in] fd            The input (not owned; must stay open until the Spool is destroyed)
+     * @param[in] memoryLimit   The most input to hold in memory
+     * @param[in] directory     Where to create the overflow file
+     * @param[in] readySignal   An eventfd to signal whenever input arrives or ends, so that the
+     *                          consumer can wait for it alongside other descriptors (not owned;
+     *                          -1 for none)
+     * @throws Exception on failure
+     */
+    Spool(int fd, size_t memoryLimit = DEFAULT_MEMORY_LIMIT,
+          const std::string& directory = DEFAULT_DIRECTORY, int readySignal = -1);
+
+    /// Stops reading the input, even if it has not ended.
+    virtual ~Spool();
+
+    /**
+     * @brief Take the next input, waiting for some if none is held
+     * @param[out] buffer   Receives the input
+     * @param[in]  len      The size of 'buffer'
+     * @return The number of bytes taken; 0 once the input has ended and everything was taken
+     * @throws Exception if reading the input or the overflow file failed
+     */
+    size_t read(char* buffer, size_t len);
+
+    /**
+     * @brief Determine whether read() would return without waiting (there is input, or the
+     *          input has ended)
+     */
+    bool ready() const;
+
+    /// @brief Determine whether the input has ended and everything has been taken
+    bool ended() const;
+
+    /// @brief The number of bytes that overflowed to disk
+    uint64_t spooledBytes() const;
+
+private: // Methods
+    void _readerThread();
+    void _openFile();
+    bool _readyLocked() const;
+    void _signalReady();
+
+private: // Members
+    int                             mInput;
+    size_t                          mMemoryLimit;
+    std::string                     mDirectory;
+    int                             mStopPipe[2]{-1, -1};   ///< Wakes the reader to stop
+    int                             mReadySignal{-1};       ///< Signalled as input arrives or ends (-1: none)
+
+    mutable std::mutex              mMutex;
+    std::condition_variable         mReadable;
+    std::deque<std::vector<char>>   mMemory;
+    size_t                          mMemoryBytes{0};
+    size_t                          mFrontOffset{0};        ///< Bytes already taken from mMemory.front()
+    int                             mFile{-1};
+    uint64_t                        mFileRead{0};
+    uint64_t                        mFileWritten{0};
+    bool                            mFileActive{false};     ///< New input goes to the file, behind what is there
+    bool                            mFileWriting{false};
+    uint64_t                        mSpooled{0};
+    bool                            mEnded{false};
+    std::exception_ptr              mError;
+    std::thread                     mReader;
+
+}; // class Spool
+
+
+/**
+ * @brief Exceptions on the Spool class
+ */
+class Spool::Exception : public std::exception
+{
+public:
+    Exception(const std::string& message)
+        : mMessage(message)
+    {
+    }
+
+    virtual ~Exception() = default;
+
+    virtual const char* what() const noexcept override
+    {
+        return mMessage.c_str();
+    }
+
+private:
+    std::string     mMessage;
+
+}; // class Spool::Exception
@@ -0,0 +1,111 @@
+/**
+ * @brief Chooses which of several streams sends next
+ *
+ * @file StreamScheduler.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Source header
+#include "StreamScheduler.h"
+
+// Standard headers
+#include <algorithm>
+
+
+//-----------------------------------------------------------------------------
+void StreamScheduler::add(uint16_t stream, int priority, unsigned weight)
+{
+    remove(stream);
+
+    mLevels[priority].push_back(Entry{stream, std::max(weight, 1u)});
+    mPriorities[stream] = priority;
+}
+
+
+//-----------------------------------------------------------------------------
+void StreamScheduler::remove(uint16_t stream)
+{
+    auto found = mPriorities.find(stream);
+    if (found == mPriorities.end())
+    {
+        return;
+    }
+
+    auto& level = mLevels[found->second];
+    level.erase(std::find_if(level.begin(), level.end(),
+                             [stream](const Entry& entry){ return entry.stream == stream; }));
+    if (level.empty())
+    {
+        mLevels.erase(found->second);
+    }
+
+    mPriorities.erase(found);
+}
+
+
+//-----------------------------------------------------------------------------
+bool StreamScheduler::empty() const noexcept
+{
+    return mPriorities.empty();
+}
+
+
+//-----------------------------------------------------------------------------
+std::optional<StreamScheduler::Turn> StreamScheduler::next(const std::function<bool(uint16_t stream)>& ready)
+{
+    for (auto& [priority, level] : mLevels)
+    {
+        // Visit each stream of this level at most once.
+        for (size_t visited = 0; visited < level.size(); ++visited)
+        {
+            auto& front = level.front();
+
+            if (ready(front.stream))
+            {
+                if (front.deficit == 0)
+                {
+                    front.deficit = front.weight * QUANTUM;
+                }
+
+                return Turn{front.stream, front.deficit};
+            }
+
+            // Not ready: the turn passes, and an idle stream does not bank its allowance.
+            auto entry = front;
+            entry.deficit = 0;
+            level.pop_front();
+            level.push_back(entry);
+        }
+    }
+
+    return std::nullopt;
+}
+
+
+//-----------------------------------------------------------------------------
+void StreamScheduler::charge(uint16_t stream, size_t bytes)
+{
+    auto found = mPriorities.find(stream);
+    if (found == mPriorities.end())
+    {
+        return;
+    }
+
+    auto& level = mLevels[found->second];
+    auto& front = level.front();
+    if (front.stream != stream)
+    {
+        return;
+    }
+
+    front.deficit -= std::min(front.deficit, bytes);
+    if (front.deficit == 0)
+    {
+        // Allowance used up: the next stream's turn.
+        auto entry = front;
+        level.pop_front();
+        level.push_back(entry);
+    }
+}
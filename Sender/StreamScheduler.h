@@ -0,0 +1,88 @@
+/**
+ * @brief Chooses which of several streams sends next
+ *
+ * @file StreamScheduler.h
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+#pragma once
+
+// Standard Headers
+#include <functional>
+#include <optional>
+#include <map>
+#include <deque>
+#include <stdint.h>
+
+
+/**
+ * @brief Strict priority between levels, and deficit round robin within a level.
+ * @details A stream is only served when no stream of a higher priority is ready, so a small
+ *          urgent stream never waits behind bulk data. Streams of equal priority share the
+ *          connection in proportion to their weights: each turn a stream is allowed up to
+ *          weight * QUANTUM bytes, less whatever it used of its previous allowance. A stream
+ *          that is not ready when its turn comes forfeits the turn (and any unused allowance).
+ */
+class StreamScheduler
+{
+public: // Definitions
+    /// The allowance per turn of a stream of weight 1, in bytes
+    static constexpr size_t QUANTUM = 64 * 1024;
+
+    struct Turn
+    {
+        uint16_t    stream;
+        size_t      allowance;      ///< The most bytes the stream may send before charge() ends its turn
+    };
+
+public: // Methods
+    StreamScheduler() = default;
+
+    virtual ~StreamScheduler() = default;
+
+    /**
+     * @brief Add a stream
+     * @param[in] stream    The stream
+     * @param[in] priority  Higher priorities are served first
+     * @param[in] weight    The stream's share relative to others of the same priority (at least 1)
+     */
+    void add(uint16_t stream, int priority, unsigned weight);
+
+    /// @brief Remove a stream (e.g. once it has ended)
+    void remove(uint16_t stream);
+
+    /// @brief Determine whether there are no streams left
+    bool empty() const noexcept;
+
+    /**
+     * @brief Choose the stream to send from next
+     * @param[in] ready     Says whether a stream can send now
+     * @return The stream and its allowance, or unset if no stream is ready
+     */
+    std::optional<Turn> next(const std::function<bool(uint16_t stream)>& ready);
+
+    /**
+     * @brief Record that a stream sent some of its allowance
+     * @param[in] stream    The stream that next() chose
+     * @param[in] bytes     The number of bytes it sent
+     */
+    void charge(uint16_t stream, size_t bytes);
+
+private: // Definitions
+    struct Entry
+    {
+        uint16_t    stream;
+        unsigned    weight;
+        size_t      deficit{0};
+    };
+
+    /// Streams of one priority, in round-robin order; the front is the one whose turn it is.
+    using Level = std::deque<Entry>;
+
+private: // Members
+    std::map<int, Level, std::greater<int>>     mLevels;
+    std::map<uint16_t, int>                     mPriorities;
+
+}; // class StreamScheduler
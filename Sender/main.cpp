@@ -9,18 +9,462 @@
 
 // Project headers
 #include "Sender.h"
+#include "SenderDaemon.h"
+#include "ReceiverSet.h"
+#include "FileFollower.h"
+#include "Replay.h"
 #include "Common/CommonData.h"
+#include "Common/Affinity.h"
+#include "Common/BufferArena.h"
+
+// System headers
+#include <fcntl.h>
+#include <unistd.h>
+#include <csignal>
 
 // Standard headers
 #include <exception>
 #include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <algorithm>
+#include <memory>
+#include <cstring>
+
+//-----------------------------------------------------------------------------
+static void sendViaDaemon(const Sender::CommandLineData& data)
+{
+    SenderDaemon::Client client{data.daemonSocket};
+
+    // Hand over descriptors rather than contents; the daemon reads them directly.
+    for (const auto& file : data.filesToSend)
+    {
+        auto fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            std::cerr << file << ": " << std::strerror(errno) << std::endl;
+            continue;
+        }
+
+        try
+        {
+            client.submit(fd);
+        }
+        catch (...)
+        {
+            close(fd);
+            throw;
+        }
+
+        close(fd);
+    }
+
+    if (data.readStdin)
+    {
+        client.submit(STDIN_FILENO);
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void sendMultiplexed(Sender& sender, const Sender::CommandLineData& data)
+{
+    std::vector<Sender::StreamSource> sources;
+
+    for (size_t index = 0; index < data.filesToSend.size(); ++index)
+    {
+        const auto& file = data.filesToSend[index];
+
+        auto fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            std::cerr << file << ": " << std::strerror(errno) << std::endl;
+            continue;
+        }
+
+        sources.push_back(Sender::StreamSource{fd, file, data.fileSettings[index]});
+    }
+
+    if (data.readStdin)
+    {
+        sources.push_back(Sender::StreamSource{STDIN_FILENO, "-", data.stdinSettings});
+    }
+
+    try
+    {
+        sender.sendStreams(sources);
+    }
+    catch (...)
+    {
+        for (const auto& source : sources)
+        {
+            if (source.fd != STDIN_FILENO)
+            {
+                close(source.fd);
+            }
+        }
+        throw;
+    }
+
+    for (const auto& source : sources)
+    {
+        if (source.fd != STDIN_FILENO)
+        {
+            close(source.fd);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+/// Large buffers for every Sender, if requested; made at startup so that its pages are faulted in there
+static std::unique_ptr<Common::BufferArena> sArena;
+
+//-----------------------------------------------------------------------------
+static void configure(Sender& sender, const Sender::CommandLineData& data)
+{
+    for (const auto& option : sender.setSocketOptions(data.socketOptions))
+    {
+        std::cerr << option << " is not available here; skipped." << std::endl;
+    }
+
+    sender.setMode(data.mode);
+    sender.setBatching(data.batchBytes, data.maxDelay);
+    sender.setArena(sArena.get());
+    sender.setChecksums(data.checksums);
+
+    if (!data.filter.empty())
+    {
+        sender.setFilter(std::make_shared<const Common::RecordFilter>(data.filter));
+    }
+}
+
+//-----------------------------------------------------------------------------
+static const Sender::StreamSettings& settingsOf(const Sender::CommandLineData& data, const std::string& file)
+{
+    if (file == "-")
+    {
+        return data.stdinSettings;
+    }
+
+    auto found = std::find(data.filesToSend.begin(), data.filesToSend.end(), file);
+    return data.fileSettings[static_cast<size_t>(found - data.filesToSend.begin())];
+}
+
+//-----------------------------------------------------------------------------
+static void sendInput(Sender& sender, const Sender::CommandLineData& data, const std::string& file)
+{
+    // Framing is per connection: once a file is resumable, every input is framed.
+    const bool framed = data.framed || data.resume || data.dedup;
+
+    sender.setSampling(settingsOf(data, file).sample);
+
+    if (file == "-")
+    {
+        // If requested to read stdin...
+        if (framed)
+        {
+            sender.sendFramed(STDIN_FILENO, "-");
+        }
+        else
+        {
+            sender.sendStream(std::cin);
+        }
+
+        return;
+    }
+
+    if (data.resume)
+    {
+        sender.sendFileResumable(file);
+        return;
+    }
+
+    if (framed || data.mode == Sender::Mode::Block)
+    {
+        auto fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            std::cerr << file << ": " << std::strerror(errno) << std::endl;
+            return;
+        }
+
+        try
+        {
+            if (data.dedup)
+            {
+                sender.sendDeduplicated(fd, file);
+            }
+            else if (framed)
+            {
+                sender.sendFramed(fd, file);
+            }
+            else
+            {
+                // Whole files go to the kernel without passing through our buffers at all.
+                sender.sendFile(fd);
+            }
+        }
+        catch (...)
+        {
+            close(fd);
+            throw;
+        }
+
+        close(fd);
+        return;
+    }
+
+    std::ifstream inputFile(file);
+    sender.sendStream(inputFile);
+}
+
+//-----------------------------------------------------------------------------
+static FileFollower* sFollower = nullptr;
+
+static void stopFollowing(int)
+{
+    // stop() only writes to an eventfd, so it is safe in a signal handler.
+    if (sFollower)
+    {
+        sFollower->stop();
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void followFiles(Sender& sender, const Sender::CommandLineData& data)
+{
+    FileFollower follower{data.filesToSend};
+
+    // Ctrl-C ends following cleanly, after the lines in progress are sent.
+    sFollower = &follower;
+    std::signal(SIGINT, stopFollowing);
+    std::signal(SIGTERM, stopFollowing);
+
+    try
+    {
+        std::vector<double> sampleRates;
+        for (const auto& settings : data.fileSettings)
+        {
+            sampleRates.push_back(settings.sample);
+        }
+
+        sender.sendFollowed(follower, sampleRates);
+    }
+    catch (...)
+    {
+        sFollower = nullptr;
+        throw;
+    }
+
+    sFollower = nullptr;
+
+    if (data.printStats)
+    {
+        const auto& stats = follower.stats();
+        std::cerr << "files followed:  " << data.filesToSend.size()
+                  << " (" << stats.truncations << " truncation(s), " << stats.rotations << " rotation(s))" << std::endl;
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void printStats(const Sender::Stats& stats)
+{
+    std::cerr << "connected to:    " << stats.connectedTo << "\n"
+              << "connect latency: " << stats.connectLatency.count() << " us"
+              << " (" << stats.connectAttempts << " attempt(s))\n"
+              << "bytes sent:      " << stats.bytesSent << "\n"
+              << "zero-copy sends: " << stats.zeroCopySends
+              << (stats.zeroCopyDeferred ? " (kernel copied; disabled)" : "") << "\n"
+              << "bytes resumed:   " << stats.bytesResumed
+              << " (" << stats.reconnects << " reconnect(s))\n"
+              << "line sends:      " << stats.lineSends << "\n"
+              << "credit stall:    " << stats.creditStall.count() << " us"
+              << " (" << stats.bytesSpooled << " bytes spooled)\n"
+              << "acks received:   " << stats.acks << "\n"
+              << "bytes deduped:   " << stats.bytesDeduplicated << "\n"
+              << "bytes filtered:  " << stats.bytesFiltered << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+static void sendToCluster(const Sender::CommandLineData& data)
+{
+    std::vector<ReceiverSet::Member> members;
+    for (size_t index = 0; index < data.cluster.size(); ++index)
+    {
+        members.push_back(ReceiverSet::Member{data.cluster[index], data.clusterWeights[index]});
+    }
+
+    ReceiverSet receivers{members, data.maxConnections, [&data](const Common::Endpoint& endpoint)
+    {
+        auto sender = std::make_unique<Sender>(endpoint.addr, endpoint.port);
+        configure(*sender, data);
+        sender->connect(ReceiverSet::CONNECT_RETRIES);
+        return sender;
+    }};
+
+    auto inputs = data.filesToSend;
+    if (data.readStdin)
+    {
+        inputs.emplace_back("-");
+    }
+
+    for (const auto& input : inputs)
+    {
+        // Related inputs share a key, and so a receiver.
+        const auto& key = data.key.empty() ? input : data.key;
+
+        for (size_t attempt = 1; ; ++attempt)
+        {
+            auto& sender = receivers.sender(key);
+
+            try
+            {
+                sendInput(sender, data, input);
+
+                if (data.printStats)
+                {
+                    std::cerr << input << " -> " << sender.stats().connectedTo << std::endl;
+                }
+                break;
+            }
+            catch (const std::exception& e)
+            {
+                receivers.failed(key);
+
+                // Standard input cannot be read again, so it cannot fail over.
+                if (input == "-" || attempt >= members.size())
+                {
+                    throw;
+                }
+
+                std::cerr << input << ": " << e.what() << "; failing over." << std::endl;
+            }
+        }
+    }
+
+    if (data.printStats)
+    {
+        std::cerr << "receivers up:    " << receivers.checkHealth() << " of " << members.size()
+                  << " (" << receivers.openConnections() << " connection(s) open)" << std::endl;
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void printRoundTrips(const std::string& profile, const Sender::RoundTrips& trips)
+{
+    auto summarize = [](const Common::LatencyHistogram& histogram)
+    {
+        for (auto percentile : Common::LatencyHistogram::SUMMARY_PERCENTILES)
+        {
+            std::cout << std::setw(11) << static_cast<double>(histogram.percentile(percentile)) / 1000.0;
+        }
+        std::cout << std::setw(11) << static_cast<double>(histogram.max()) / 1000.0;
+    };
+
+    std::cout << std::left << std::setw(12) << profile << std::right
+              << std::setw(8) << trips.messageSize << std::setw(8) << trips.rate << " |";
+    summarize(trips.measured);
+    std::cout << " |";
+    summarize(trips.corrected);
+    std::cout << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+static void pingPong(const Sender::CommandLineData& data)
+{
+    // Every way a connection can be tuned, unless one was asked for.
+    std::vector<std::string> profiles(std::begin(Common::SocketOptions::PROFILE_NAMES),
+                                      std::end(Common::SocketOptions::PROFILE_NAMES));
+    if (!data.profile.empty())
+    {
+        profiles.assign(1, data.profile);
+    }
+
+    std::ofstream histograms;
+    if (!data.pingHistograms.empty())
+    {
+        histograms.open(data.pingHistograms);
+        if (!histograms)
+        {
+            throw Sender::Exception("Cannot write " + data.pingHistograms + ": " + std::strerror(errno));
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "round trip times in us; rate 0 is back to back; corrected counts from when each request was due\n"
+              << std::left << std::setw(12) << "profile" << std::right << std::setw(8) << "bytes" << std::setw(8) << "rate"
+              << " |" << std::setw(11 * 6) << "measured p50/p90/p99/p99.9/p99.99/max"
+              << " |" << std::setw(11 * 6) << "corrected p50/p90/p99/p99.9/p99.99/max" << std::endl;
+
+    for (const auto& profile : profiles)
+    {
+        auto settings = data;
+        settings.socketOptions = Common::SocketOptions::profile(profile).value();
+
+        Sender sender{data.receivers};
+        configure(sender, settings);
+        sender.connect();
+
+        for (auto rate : data.pingRates)
+        {
+            for (auto size = Sender::PING_MIN_SIZE; size <= Sender::PING_MAX_SIZE; size *= 2)
+            {
+                const auto trips = sender.pingPong(size, data.pingCount, rate);
+                printRoundTrips(profile, trips);
+
+                if (histograms.is_open())
+                {
+                    histograms << "# " << profile << ", " << size << " bytes, rate " << rate << "/s, measured (us)\n";
+                    trips.measured.writeDistribution(histograms, 1000.0);
+                    histograms << "\n# " << profile << ", " << size << " bytes, rate " << rate << "/s, corrected (us)\n";
+                    trips.corrected.writeDistribution(histograms, 1000.0);
+                    histograms << "\n";
+                }
+            }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void replay(const Sender::CommandLineData& data)
+{
+    Replay replay{Replay::Config{data.receivers.front(), data.replaySpeed, data.socketOptions}};
+
+    auto report = replay.run(data.replayFile);
+
+    const auto captured = std::chrono::duration<double>(report.captured).count();
+    std::cerr << std::fixed << std::setprecision(3)
+              << "replayed " << report.records << " records (" << report.bytes << " bytes) on "
+              << report.connections << " connections in " << report.elapsed.count() << " s"
+              << " (captured over " << captured << " s); at most "
+              << std::chrono::duration<double, std::milli>(report.maxLag).count() << " ms behind" << std::endl;
+}
 
 //-----------------------------------------------------------------------------
 int main(int argc, const char* const* argv)
 {
     if (argc < 2)
     {
-        std::cout << "Usage: sender [<filename_to_send>] [-]" << std::endl;
+        std::cout << "Usage: sender [--receiver <addr[:port]>]... [--stats] [--profile <name>] [--block]\n"
+                  << "              [--batch-bytes <n>] [--max-delay-us <n>] [<filename_to_send>] [-]\n"
+                  << "       sender [--receiver <addr[:port]>]... [--stats] [--profile <name>] --resume <filename_to_send>... [-]\n"
+                  << "       sender [--receiver <addr[:port]>]... [--stats] [--profile <name>] --framed [<filename_to_send>] [-]\n"
+                  << "       sender [--receiver <addr[:port]>]... [--stats] [--profile <name>] --dedup <filename_to_send>... [-]\n"
+                  << "       sender [--receiver <addr[:port]>]... [--stats] [--profile <name>] [--block]\n"
+                  << "              [--batch-bytes <n>] [--max-delay-us <n>] --follow <filename_to_follow>...\n"
+                  << "       sender [--receiver <addr[:port]>]... [--stats] [--profile <name>] --mux\n"
+                  << "              [[--priority <n>] [--weight <n>] <filename_to_send>|-]...\n"
+                  << "       sender --cluster <addr[:port][@weight]>... [--key <key>] [--max-connections <n>]\n"
+                  << "              [--stats] [--profile <name>] [--block|--framed|--resume] [<filename_to_send>]... [-]\n"
+                  << "       sender --daemon [--daemon-socket <path>] [--receiver <addr[:port]>]...\n"
+                  << "       sender --via-daemon [--daemon-socket <path>] [<filename_to_send>] [-]\n"
+                  << "       sender [--receiver <addr[:port]>] [--profile <name>] --ping-pong [--ping-count <n>]\n"
+                  << "              [--ping-rates <n>[,<n>]...] [--ping-histograms <file>]\n"
+                  << "       sender [--receiver <addr[:port]>] [--profile <name>] --replay <capture_file>\n"
+                  << "              [--replay-speed <x>|max]\n"
+                  << "       Framed modes (--resume, --framed, --dedup, --mux) take [--crc] to checksum each Data frame.\n"
+                  << "       Any mode sending lines takes [--filter <clause>]... and [--sample <rate>] before its inputs;\n"
+                  << "       clauses are contains:<text>, any:<text>|<text>..., regex:<pattern>, field:<n><op><value>,\n"
+                  << "       csv:<n><op><value> or sample:<rate>; all but sample: may be negated with a leading '!'" << std::endl;
         return 1;
     }
 
@@ -28,23 +472,110 @@ int main(int argc, const char* const* argv)
 
     try
     {
-        Sender sender{SERVER_ADDR, SERVER_PORT};
+        auto data = Sender::parseCommandLine(argc, argv);
+
+        // Before any thread starts, so that every one of them inherits the placement. Buffers are
+        // first touched by these threads, and so are allocated on their node.
+        if (!data.cpus.empty() && !Common::Affinity::pin(data.cpus))
+        {
+            std::cerr << "Cannot run on the CPUs given; not pinned." << std::endl;
+        }
+
+        if (data.arenaBytes > 0)
+        {
+            // After pinning, so that the pages are placed on the sender's node.
+            sArena = std::make_unique<Common::BufferArena>(data.arenaBytes, data.arenaPrefault);
+            if (data.printStats)
+            {
+                std::cerr << "buffer arena:    " << sArena->describe() << std::endl;
+            }
+        }
+
+        if (data.receivers.empty())
+        {
+            data.receivers.push_back(Common::Endpoint{SERVER_ADDR, SERVER_PORT});
+        }
 
-        auto data = sender.parseCommandLine(argc, argv);
+        if (data.daemon)
+        {
+            // A dropped connection must surface as an error to reconnect from, not kill the daemon.
+            std::signal(SIGPIPE, SIG_IGN);
+
+            SenderDaemon daemon{data.daemonSocket, data.receivers, data.socketOptions};
+            daemon.execute();
+            return 0;
+        }
+
+        if (data.viaDaemon)
+        {
+            sendViaDaemon(data);
+            return 0;
+        }
+
+        if (data.pingPong)
+        {
+            // A receiver that does not echo ends the connection; say so rather than die.
+            std::signal(SIGPIPE, SIG_IGN);
+
+            pingPong(data);
+            return 0;
+        }
+
+        if (!data.replayFile.empty())
+        {
+            // A receiver that goes away ends the replay with an error, not a signal.
+            std::signal(SIGPIPE, SIG_IGN);
+
+            replay(data);
+            return 0;
+        }
 
+        const bool framed = data.framed || data.resume || data.multiplex || data.dedup;
+
+        if (framed || !data.cluster.empty())
+        {
+            // A dropped connection must surface as an error to resume or fail over from, not
+            // kill the sender.
+            std::signal(SIGPIPE, SIG_IGN);
+        }
+
+        if (!data.cluster.empty())
+        {
+            sendToCluster(data);
+            return 0;
+        }
+
+        Sender sender{data.receivers};
+        configure(sender, data);
         sender.connect();
 
-        // Send requested files
-        for (const auto& file : data.filesToSend)
+        if (data.follow)
         {
-            std::ifstream inputFile(file);
-            sender.sendStream(inputFile);
+            // Runs until interrupted.
+            followFiles(sender, data);
         }
+        else if (data.multiplex)
+        {
+            // Every input shares the connection at once, interleaved by priority and weight.
+            sendMultiplexed(sender, data);
+        }
+        else
+        {
+            // Send requested files
+            for (const auto& file : data.filesToSend)
+            {
+                sendInput(sender, data, file);
+            }
 
-        if (data.readStdin)
+            if (data.readStdin)
+            {
+                sendInput(sender, data, "-");
+            }
+        }
+
+        if (data.printStats)
         {
-            // If requested to read stdin...
-            sender.sendStream(std::cin);
+            printStats(sender.stats());
         }
     }
     catch (const std::exception& e)
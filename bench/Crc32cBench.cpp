@@ -0,0 +1,168 @@
+/**
+ * @brief Benchmark of CRC-32C, alone and as part of a framed transfer over loopback
+ *
+ * @file Crc32cBench.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Project headers
+#include "Common/Crc32c.h"
+#include "Common/Protocol.h"
+#include "Common/Socket.h"
+#include "Common/CommonData.h"
+
+// Standard headers
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <chrono>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    constexpr const char* const BENCH_ADDR = "127.0.0.1";
+    constexpr uint16_t BENCH_PORT_BASE = SERVER_PORT + 200;
+
+    /// The sender's mux frame size, and a buffer small enough to stay in cache
+    constexpr size_t FRAME_SIZE = 64 * 1024;
+    constexpr size_t BUFFER_SIZE = 1024 * 1024;
+    constexpr auto PHASE_LIMIT = std::chrono::seconds(2);
+
+    /// The link rate the cost is judged against, in GB/s
+    constexpr double LINK_RATE = 10.0;
+
+    /// GB/s of a function over BUFFER_SIZE bytes, run repeatedly for the phase limit
+    template <typename Function>
+    double rate(Function function)
+    {
+        std::vector<char> buffer(BUFFER_SIZE, 'x');
+        const auto start = Clock::now();
+        uint64_t bytes = 0;
+        volatile uint32_t sink = 0;
+
+        while (Clock::now() - start < PHASE_LIMIT)
+        {
+            sink = sink + function(buffer.data(), buffer.size());
+            bytes += buffer.size();
+        }
+
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        return static_cast<double>(bytes) / elapsed.count() / 1e9;
+    }
+
+    /// GB/s of Data frames sent over loopback and read back, with or without a checked CRC
+    double framedRate(uint16_t port, bool withCrc)
+    {
+        using namespace Common::Protocol;
+
+        Common::Socket listenSocket(BENCH_ADDR, port);
+        listenSocket.bind();
+        listenSocket.listen();
+
+        uint64_t received = 0;
+        uint64_t mismatches = 0;
+
+        std::thread reader([&]
+        {
+            auto conn = listenSocket.accept();
+            FrameReader frames(conn.value());
+            std::vector<char> payload;
+
+            while (auto header = frames.next(payload))
+            {
+                auto len = payload.size();
+                if (header->flags & DATA_CRC)
+                {
+                    len -= CRC_SIZE;
+                    auto expected = getU32(reinterpret_cast<const uint8_t*>(payload.data() + len));
+                    mismatches += (Common::Crc32c::extend(0, payload.data(), len) != expected) ? 1 : 0;
+                }
+                received += len;
+            }
+        });
+
+        std::vector<char> buffer(FRAME_SIZE + CRC_SIZE, 'x');
+        const auto start = Clock::now();
+        {
+            Common::Socket socket(BENCH_ADDR, port);
+            socket.connect();
+
+            FrameHeader data;
+            data.type = FrameType::Data;
+            data.length = FRAME_SIZE;
+
+            while (Clock::now() - start < PHASE_LIMIT)
+            {
+                if (withCrc)
+                {
+                    putU32(reinterpret_cast<uint8_t*>(buffer.data() + FRAME_SIZE),
+                           Common::Crc32c::extend(0, buffer.data(), FRAME_SIZE));
+                    data.flags = DATA_CRC;
+                    data.length = FRAME_SIZE + CRC_SIZE;
+                }
+
+                sendFrame(socket, data, buffer.data());
+                data.offset += FRAME_SIZE;
+            }
+        }
+
+        reader.join();
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+
+        if (mismatches)
+        {
+            std::cerr << mismatches << " frames failed their CRC check." << std::endl;
+        }
+
+        return static_cast<double>(received) / elapsed.count() / 1e9;
+    }
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+int main()
+{
+    std::cout << std::fixed << std::setprecision(2);
+
+    auto hardware = rate([](const char* data, size_t len){ return Common::Crc32c::extend(0, data, len); });
+    auto portable = rate([](const char* data, size_t len){ return Common::Crc32c::extendPortable(0, data, len); });
+
+    std::vector<char> copy(BUFFER_SIZE);
+    auto memcpyRate = rate([&copy](const char* data, size_t len)
+    {
+        std::memcpy(copy.data(), data, len);
+        return static_cast<uint32_t>(copy[len / 2]);
+    });
+
+    const std::string accelerated = Common::Crc32c::isAccelerated() ? "crc32c (sse4.2)" : "crc32c (portable)";
+
+    std::cout << std::left << std::setw(28) << accelerated << std::right << std::setw(8) << hardware << " GB/s\n"
+              << std::left << std::setw(28) << "crc32c (portable)" << std::right << std::setw(8) << portable << " GB/s\n"
+              << std::left << std::setw(28) << "memcpy" << std::right << std::setw(8) << memcpyRate << " GB/s\n"
+              << "CPU time per byte at " << LINK_RATE << " GB/s: "
+              << 100.0 * LINK_RATE / hardware << "% of a core per direction"
+              << " (memcpy: " << 100.0 * LINK_RATE / memcpyRate << "%)\n";
+
+    try
+    {
+        auto plain = framedRate(BENCH_PORT_BASE, false);
+        auto checked = framedRate(BENCH_PORT_BASE + 1, true);
+
+        std::cout << std::left << std::setw(28) << "framed loopback, no CRC" << std::right << std::setw(8) << plain << " GB/s\n"
+                  << std::left << std::setw(28) << "framed loopback, with CRC" << std::right << std::setw(8) << checked << " GB/s"
+                  << " (" << 100.0 * (plain - checked) / plain << "% slower)" << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "framed loopback: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,239 @@
+/**
+ * @brief Benchmark of content-defined chunking and fingerprinting, and the bytes deduplication
+ *          saves when sending successive versions of a file
+ *
+ * @file DedupBench.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Project headers
+#include "Sender/Chunker.h"
+#include "Common/Fingerprint.h"
+#include "Common/Protocol.h"
+
+// Standard headers
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <unordered_set>
+#include <vector>
+#include <chrono>
+#include <string>
+#include <functional>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    /// The corpus: a base file, then versions of it, each a few small edits from the one before
+    constexpr size_t BASE_SIZE = 32 * 1024 * 1024;
+    constexpr int VERSIONS = 8;
+    constexpr int EDITS_PER_VERSION = 24;
+    constexpr size_t MAX_EDIT = 256;
+
+    /// Frame overheads, as the sender pays them (Data frames are at most this large)
+    constexpr size_t DATA_FRAME_SIZE = 64 * 1024;
+    constexpr size_t RECIPE_CHUNKS = 200;
+
+    using Version = std::vector<char>;
+    using Cutter = std::function<size_t(const char* data, size_t len)>;
+
+    /// Word-like text, so the corpus is neither trivially repetitive nor pure noise
+    Version makeBase(std::mt19937_64& random)
+    {
+        static const char* const WORDS[] = {"socket", "frame", "credit", "stream", "receiver", "sender",
+            "chunk", "offset", "payload", "resume", "checkpoint", "delivery", "queue", "handler"};
+
+        Version base;
+        base.reserve(BASE_SIZE + 64);
+        while (base.size() < BASE_SIZE)
+        {
+            const std::string word = WORDS[random() % (sizeof(WORDS) / sizeof(WORDS[0]))];
+            base.insert(base.end(), word.begin(), word.end());
+            base.push_back((random() % 12 == 0) ? '\n' : ' ');
+
+            if (random() % 8 == 0)
+            {
+                auto number = std::to_string(random() % 100000);
+                base.insert(base.end(), number.begin(), number.end());
+                base.push_back(' ');
+            }
+        }
+        return base;
+    }
+
+    /// Insert, delete or overwrite a few short runs at random places
+    Version edit(const Version& previous, std::mt19937_64& random)
+    {
+        Version next = previous;
+        for (int count = 0; count < EDITS_PER_VERSION; ++count)
+        {
+            const auto at = random() % next.size();
+            const auto len = 1 + random() % MAX_EDIT;
+            Version run(len);
+            for (auto& byte : run)
+            {
+                byte = static_cast<char>('a' + random() % 26);
+            }
+
+            switch (random() % 3)
+            {
+            case 0:
+                next.insert(next.begin() + static_cast<ptrdiff_t>(at), run.begin(), run.end());
+                break;
+            case 1:
+                next.erase(next.begin() + static_cast<ptrdiff_t>(at),
+                           next.begin() + static_cast<ptrdiff_t>(std::min(at + len, next.size())));
+                break;
+            default:
+                std::copy(run.begin(), run.begin() + static_cast<ptrdiff_t>(std::min(len, next.size() - at)),
+                          next.begin() + static_cast<ptrdiff_t>(at));
+                break;
+            }
+        }
+        return next;
+    }
+
+    /// GB/s of a pass over every version, run repeatedly for a second
+    double rate(const std::vector<Version>& corpus, const std::function<void(const Version&)>& pass)
+    {
+        const auto start = Clock::now();
+        uint64_t bytes = 0;
+        do
+        {
+            for (const auto& version : corpus)
+            {
+                pass(version);
+                bytes += version.size();
+            }
+        } while (Clock::now() - start < std::chrono::seconds(1));
+
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        return static_cast<double>(bytes) / elapsed.count() / 1e9;
+    }
+
+    struct Wire
+    {
+        uint64_t    input{0};           ///< Bytes of every version
+        uint64_t    plain{0};           ///< On the wire without deduplication
+        uint64_t    deduplicated{0};    ///< On the wire with it, Recipes and Wants included
+        uint64_t    chunks{0};
+    };
+
+    uint64_t dataFrames(uint64_t len)
+    {
+        const auto frames = (len + DATA_FRAME_SIZE - 1) / DATA_FRAME_SIZE;
+        return len + frames * (Common::Protocol::HEADER_SIZE + Common::Protocol::CRC_SIZE);
+    }
+
+    /// Send every version in turn to one receiver, which keeps every chunk it is sent
+    Wire simulate(const std::vector<Version>& corpus, const Cutter& cut)
+    {
+        using namespace Common::Protocol;
+
+        Wire wire;
+        std::unordered_set<Common::Fingerprint, Common::Fingerprint::Hash> held;
+
+        for (const auto& version : corpus)
+        {
+            wire.input += version.size();
+            wire.plain += dataFrames(version.size());
+
+            size_t inRecipe = 0;
+            for (size_t offset = 0; offset < version.size(); )
+            {
+                const auto len = cut(version.data() + offset, version.size() - offset);
+                const auto fingerprint = Common::Fingerprint::of(version.data() + offset, len);
+
+                if (inRecipe++ % RECIPE_CHUNKS == 0)
+                {
+                    // A Recipe goes out and a Want comes back.
+                    wire.deduplicated += 2 * HEADER_SIZE;
+                }
+
+                wire.deduplicated += RECIPE_ENTRY_SIZE;
+                if (held.insert(fingerprint).second)
+                {
+                    wire.deduplicated += sizeof(uint32_t) + dataFrames(len);
+                }
+
+                ++wire.chunks;
+                offset += len;
+            }
+        }
+
+        return wire;
+    }
+
+    void report(const std::string& label, const Wire& wire)
+    {
+        std::cout << std::left << std::setw(28) << label << std::right
+                  << std::setw(12) << wire.deduplicated << " bytes on the wire of " << wire.plain
+                  << " (" << 100.0 * (1.0 - static_cast<double>(wire.deduplicated) / static_cast<double>(wire.plain))
+                  << "% saved, average chunk " << wire.input / wire.chunks << " bytes)\n";
+    }
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+int main()
+{
+    std::cout << std::fixed << std::setprecision(2);
+
+    std::mt19937_64 random(2023);
+    std::vector<Version> corpus;
+    corpus.push_back(makeBase(random));
+    for (int version = 1; version < VERSIONS; ++version)
+    {
+        corpus.push_back(edit(corpus.back(), random));
+    }
+
+    const Chunker chunker;
+    const Cutter contentDefined = [&chunker](const char* data, size_t len){ return chunker.cut(data, len); };
+    const Cutter fixed = [](const char*, size_t len){ return std::min(len, Chunker::AVERAGE_SIZE); };
+
+    volatile uint64_t sink = 0;
+
+    auto chunking = rate(corpus, [&](const Version& version)
+    {
+        for (size_t offset = 0; offset < version.size(); )
+        {
+            offset += chunker.cut(version.data() + offset, version.size() - offset);
+            sink = sink + offset;
+        }
+    });
+
+    auto fingerprinting = rate(corpus, [&](const Version& version)
+    {
+        for (size_t offset = 0; offset < version.size(); offset += Chunker::AVERAGE_SIZE)
+        {
+            auto len = std::min(Chunker::AVERAGE_SIZE, version.size() - offset);
+            sink = sink + Common::Fingerprint::of(version.data() + offset, len).low;
+        }
+    });
+
+    auto both = rate(corpus, [&](const Version& version)
+    {
+        for (size_t offset = 0; offset < version.size(); )
+        {
+            auto len = chunker.cut(version.data() + offset, version.size() - offset);
+            sink = sink + Common::Fingerprint::of(version.data() + offset, len).low;
+            offset += len;
+        }
+    });
+
+    std::cout << "corpus: " << VERSIONS << " versions of a " << BASE_SIZE / (1024 * 1024) << " MiB file, "
+              << EDITS_PER_VERSION << " edits of up to " << MAX_EDIT << " bytes apart\n"
+              << std::left << std::setw(28) << "chunking (FastCDC)" << std::right << std::setw(8) << chunking << " GB/s\n"
+              << std::left << std::setw(28) << "fingerprinting" << std::right << std::setw(8) << fingerprinting << " GB/s\n"
+              << std::left << std::setw(28) << "chunking + fingerprinting" << std::right << std::setw(8) << both << " GB/s"
+              << " (the sender overlaps this with sending)\n";
+
+    report("content-defined chunks", simulate(corpus, contentDefined));
+    report("fixed-size chunks", simulate(corpus, fixed));
+
+    return 0;
+}
@@ -0,0 +1,165 @@
+/**
+ * @brief Benchmark of record filtering: literal search, and whole filters run over log lines
+ *
+ * @file FilterBench.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Project headers
+#include "Common/RecordFilter.h"
+#include "Sender/RecordSieve.h"
+
+// Standard headers
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    /// A buffer small enough to stay in cache, as the sender's reads are
+    constexpr size_t BUFFER_SIZE = 1024 * 1024;
+    constexpr auto PHASE_LIMIT = std::chrono::seconds(1);
+
+    /// The link rate the cost is judged against, in GB/s
+    constexpr double LINK_RATE = 10.0;
+
+    /// Log lines, about one in a thousand of them an error
+    std::vector<char> makeRecords()
+    {
+        static const char* const LEVELS[] = {"INFO", "DEBUG", "INFO", "TRACE"};
+        std::mt19937 random{42};
+        std::string text;
+
+        while (text.size() < BUFFER_SIZE)
+        {
+            const auto draw = random();
+            const char* level = (draw % 1000 == 0) ? "ERROR" : LEVELS[draw % 4];
+
+            text += "2023-05-01T12:00:00.000 ";
+            text += level;
+            text += " service=api user=" + std::to_string(random() % 100000)
+                + " latency=" + std::to_string(random() % 1000)
+                + " path=/v1/items/" + std::to_string(random() % 5000) + " status=200\n";
+        }
+
+        text.resize(text.rfind('\n', BUFFER_SIZE - 1) + 1);
+        return std::vector<char>(text.begin(), text.end());
+    }
+
+    /// GB/s of a function over the records, run repeatedly for the phase limit
+    template <typename Function>
+    double rate(const std::vector<char>& records, Function function)
+    {
+        const auto start = Clock::now();
+        uint64_t bytes = 0;
+        volatile size_t sink = 0;
+
+        while (Clock::now() - start < PHASE_LIMIT)
+        {
+            sink = sink + function(records.data(), records.size());
+            bytes += records.size();
+        }
+
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        return static_cast<double>(bytes) / elapsed.count() / 1e9;
+    }
+
+    void report(const std::string& name, double gbps, double kept = -1)
+    {
+        std::cout << std::left << std::setw(36) << name << std::right << std::setw(8) << gbps << " GB/s"
+                  << std::setw(8) << 100.0 * LINK_RATE / gbps << "% of a core at " << LINK_RATE << " GB/s";
+        if (kept >= 0)
+        {
+            std::cout << " (" << 100.0 * kept << "% kept)";
+        }
+        std::cout << "\n";
+    }
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+int main()
+{
+    std::cout << std::fixed << std::setprecision(2);
+
+    const auto records = makeRecords();
+
+    // Searches that scan to the end, since nothing matches
+    const std::string accelerated = Common::RecordFilter::isAccelerated() ? " (avx2)" : " (portable)";
+    report("find" + accelerated, rate(records, [](const char* data, size_t len)
+    {
+        return Common::RecordFilter::find(data, len, "FATAL", 5);
+    }));
+    report("find (portable)", rate(records, [](const char* data, size_t len)
+    {
+        return Common::RecordFilter::findPortable(data, len, "FATAL", 5);
+    }));
+    const std::vector<std::string> literals{"FATAL", "PANIC", "ALERT"};
+    report("findAny, 3 literals" + accelerated, rate(records, [&literals](const char* data, size_t len)
+    {
+        return Common::RecordFilter::findAny(data, len, literals);
+    }));
+    report("findAny, 3 literals (portable)", rate(records, [&literals](const char* data, size_t len)
+    {
+        return Common::RecordFilter::findAnyPortable(data, len, literals);
+    }));
+
+    std::vector<char> copy(records.size());
+    report("memcpy", rate(records, [&copy](const char* data, size_t len)
+    {
+        std::memcpy(copy.data(), data, len);
+        return static_cast<size_t>(copy[len / 2]);
+    }));
+
+    // Whole filters, judging every record and copying out those kept, as the sender does
+    const char* const FILTERS[] =
+    {
+        "contains:ERROR",
+        "any:ERROR|FATAL|PANIC",
+        "contains:INFO",
+        "field:2=INFO",
+        "!contains:TRACE",
+        "regex:latency=9[0-9][0-9] ",
+        "contains:INFO\nregex:user=[0-9]*7 ",
+        "sample:0.01",
+    };
+
+    for (auto spec : FILTERS)
+    {
+        auto filter = std::make_shared<const Common::RecordFilter>(spec);
+        RecordSieve sieve{{filter}, 1.0, 1};
+
+        uint64_t kept = 0;
+        uint64_t total = 0;
+        auto gbps = rate(records, [&](const char* data, size_t len)
+        {
+            size_t at = 0;
+            sieve.select(data, len, [&](const char* span, size_t size)
+            {
+                std::memcpy(copy.data() + at, span, size);
+                at += size;
+            });
+
+            kept += at;
+            total += len;
+            return at;
+        });
+
+        std::string name = spec;
+        std::replace(name.begin(), name.end(), '\n', ' ');
+        report(name, gbps, static_cast<double>(kept) / static_cast<double>(total));
+    }
+
+    std::cout.flush();
+    return 0;
+}
@@ -0,0 +1,202 @@
+/**
+ * @brief Benchmark of the latency from a message's arrival to its handler, with connection
+ *          threads that sleep for data and with ones that busy poll for it
+ *
+ * @file PingPongBench.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Project headers
+#include "Common/Affinity.h"
+#include "Common/Socket.h"
+#include "Common/CommonData.h"
+#include "Receiver/ReceiveLoop.h"
+
+// Standard headers
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+using namespace std::chrono_literals;
+
+namespace
+{
+    constexpr const char* const BENCH_ADDR = "127.0.0.1";
+    constexpr uint16_t BENCH_PORT_BASE = SERVER_PORT + 210;
+
+    /// A small message, as a request or a market data update would be
+    constexpr size_t MESSAGE_SIZE = 64;
+    constexpr size_t WARMUP = 1000;
+    constexpr size_t ROUND_TRIPS = 100000;
+
+    constexpr auto BUSY_POLL_BUDGET = 200us;
+
+    /// Where the two ends run, if the machine has the CPUs for it
+    struct Cpus
+    {
+        int     echo{-1};
+        int     client{-1};
+    };
+
+    /// Read exactly 'len' bytes through a transport
+    template <typename Transport>
+    bool recvAll(Transport& transport, char* buffer, size_t len)
+    {
+        for (size_t got = 0; got < len; )
+        {
+            auto received = transport.recv(buffer + got, len - got);
+            if (!received)
+            {
+                return false;
+            }
+            got += received.value();
+        }
+
+        return true;
+    }
+
+    void applyNoDelay(Common::Socket& socket)
+    {
+        Common::SocketOptions options;
+        options.noDelay = true;
+        socket.setOptions(options);
+    }
+
+    /**
+     * @brief Round trip times, in nanoseconds, of messages echoed over loopback
+     * @details The echoing end hands each message to a handler through the receive loop, as the
+     *          receiver does, and the handler sends it back. Both ends read with the transport
+     *          the factory makes, so a round trip is two arrivals and two handler calls.
+     */
+    template <typename MakeTransport>
+    std::vector<uint64_t> roundTrips(uint16_t port, const Cpus& cpus, MakeTransport makeTransport)
+    {
+        Common::Socket listenSocket(BENCH_ADDR, port);
+        listenSocket.bind();
+        listenSocket.listen();
+
+        std::thread echo([&]()
+        {
+            if (cpus.echo >= 0)
+            {
+                Common::Affinity::pin(cpus.echo);
+            }
+
+            auto conn = listenSocket.accept();
+            applyNoDelay(conn.value());
+
+            auto& socket = conn.value();
+            receiveAll(makeTransport(socket), [&socket](const void* buffer, size_t len)
+            {
+                socket.send(buffer, len);
+            });
+        });
+
+        std::vector<uint64_t> result;
+        result.reserve(ROUND_TRIPS);
+
+        std::thread client([&]()
+        {
+            if (cpus.client >= 0)
+            {
+                Common::Affinity::pin(cpus.client);
+            }
+
+            Common::Socket socket(BENCH_ADDR, port);
+            socket.connect();
+            applyNoDelay(socket);
+
+            auto transport = makeTransport(socket);
+            char message[MESSAGE_SIZE] = {};
+
+            for (size_t trip = 0; trip < WARMUP + ROUND_TRIPS; ++trip)
+            {
+                const auto start = Clock::now();
+                socket.send(message, sizeof(message));
+                if (!recvAll(transport, message, sizeof(message)))
+                {
+                    break;
+                }
+
+                if (trip >= WARMUP)
+                {
+                    result.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+                }
+            }
+        });
+
+        client.join();
+        echo.join();
+
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    void report(const std::string& label, const std::vector<uint64_t>& trips)
+    {
+        if (trips.empty())
+        {
+            std::cout << std::left << std::setw(28) << label << "no round trips completed\n";
+            return;
+        }
+
+        auto percentile = [&trips](double fraction)
+        {
+            return static_cast<double>(trips[static_cast<size_t>(fraction * (trips.size() - 1))]) / 1000.0;
+        };
+
+        std::cout << std::left << std::setw(28) << label << std::right
+                  << " round trip p50 " << std::setw(8) << percentile(0.5)
+                  << " us, p99 " << std::setw(8) << percentile(0.99)
+                  << " us, p99.9 " << std::setw(8) << percentile(0.999)
+                  << " us (one way p99 ~" << percentile(0.99) / 2 << " us)\n";
+    }
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+int main()
+{
+    std::cout << std::fixed << std::setprecision(2);
+
+    // Spinning ends must not share a CPU, or each spins away the time the other needs to answer.
+    Cpus cpus;
+    const auto local = Common::Affinity::cpusOf(0);
+    if (local.size() > 1)
+    {
+        cpus.echo = local[local.size() - 1];
+        cpus.client = local[local.size() - 2];
+    }
+    else
+    {
+        std::cout << "Only one CPU: both ends share it, so busy polling can only add latency here.\n";
+    }
+
+    try
+    {
+        report("blocking", roundTrips(BENCH_PORT_BASE, cpus, [](Common::Socket& socket)
+        {
+            return Transport::Tcp{socket};
+        }));
+
+        report("busy poll (200 us budget)", roundTrips(BENCH_PORT_BASE + 1, cpus, [](Common::Socket& socket)
+        {
+            return Transport::BusyPoll{socket, BUSY_POLL_BUDGET};
+        }));
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Loopback benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,165 @@
+/**
+ * @brief Benchmark of a stream's queue with its connection thread, handler thread and memory
+ *          placed near to or far from each other
+ *
+ * @file PlacementBench.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Project headers
+#include "Common/Affinity.h"
+#include "Receiver/DeliveryQueue.h"
+
+// Standard headers
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    /// The receiver's default window, and the bytes pushed through it in each phase
+    constexpr size_t QUEUE_BYTES = 4 * 1024 * 1024;
+    constexpr size_t PIECE_SIZE = 64 * 1024;
+    constexpr uint64_t PHASE_BYTES = 1024ull * 1024 * 1024;
+
+    constexpr size_t CACHE_LINE = 64;
+
+    /// Nodes looked at for one far from node 0
+    constexpr int MAX_NODES = 64;
+
+    /// Where the connection thread (pushing), the handler thread and the queue are put
+    struct Placement
+    {
+        std::string     label;
+        int             connectionCpu;
+        int             handlerCpu;
+        int             node;
+    };
+
+    /**
+     * @brief GB/s through a DeliveryQueue with the given placement
+     * @details The connection thread writes each piece into the queue, as Session does with
+     *          each Data frame; the handler reads every cache line of it, so the data has to
+     *          travel between the two.
+     */
+    double rate(const Placement& placement)
+    {
+        double result = 0;
+
+        std::thread([&]()
+        {
+            Common::Affinity::pin(placement.connectionCpu);
+
+            std::mutex mutex;
+            std::condition_variable granted;
+            uint64_t limit = 0;
+            volatile char sink = 0;
+
+            DeliveryQueue queue([&sink](const void* buffer, size_t len)
+            {
+                auto bytes = static_cast<const char*>(buffer);
+                char sum = 0;
+                for (size_t offset = 0; offset < len; offset += CACHE_LINE)
+                {
+                    sum += bytes[offset];
+                }
+                sink = sink + sum;
+            }, 0, QUEUE_BYTES, [&](uint64_t newLimit)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                limit = newLimit;
+                granted.notify_one();
+            }, placement.node, std::vector<int>{placement.handlerCpu});
+
+            limit = queue.limit();
+
+            const std::vector<char> piece(PIECE_SIZE, 'x');
+            const auto start = Clock::now();
+
+            for (uint64_t sent = 0; sent < PHASE_BYTES; sent += piece.size())
+            {
+                // Within credit, as a sender would be.
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    granted.wait(lock, [&]() { return sent + piece.size() <= limit; });
+                }
+
+                queue.push(piece.data(), piece.size());
+            }
+            queue.drain();
+
+            std::chrono::duration<double> elapsed = Clock::now() - start;
+            result = static_cast<double>(PHASE_BYTES) / elapsed.count() / 1e9;
+        }).join();
+
+        return result;
+    }
+
+    /// The placements this machine allows: on one CPU, across CPUs of a node, and across nodes
+    std::vector<Placement> placements()
+    {
+        std::vector<Placement> result;
+
+        const auto local = Common::Affinity::cpusOf(0);
+        const auto first = local.empty() ? 0 : local.front();
+        result.push_back(Placement{"one CPU", first, first, 0});
+
+        if (local.size() > 1)
+        {
+            result.push_back(Placement{"two CPUs, one node", first, local[1], 0});
+        }
+
+        int farNode = -1;
+        for (int node = 1; farNode < 0 && node < MAX_NODES; ++node)
+        {
+            if (!Common::Affinity::cpusOf(node).empty())
+            {
+                farNode = node;
+            }
+        }
+
+        if (farNode > 0)
+        {
+            const auto far = Common::Affinity::cpusOf(farNode).front();
+            result.push_back(Placement{"two nodes, queue local", first, far, 0});
+            result.push_back(Placement{"two nodes, queue remote", first, far, farNode});
+        }
+        else if (local.size() > 2)
+        {
+            // A single node: the farthest pair of CPUs stands in for two nodes. Only the threads
+            // can be moved apart; the memory is the same distance from both.
+            result.push_back(Placement{"far CPUs (simulated nodes)", local.front(), local.back(), 0});
+        }
+
+        return result;
+    }
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+int main()
+{
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << Common::Affinity::nodeCount() << " NUMA node(s), "
+              << Common::Affinity::cpusOf(0).size() << " CPU(s) on node 0\n";
+
+    for (const auto& placement : placements())
+    {
+        std::cout << std::left << std::setw(30) << placement.label << std::right
+                  << " (connection CPU " << placement.connectionCpu << ", handler CPU "
+                  << placement.handlerCpu << ", queue on node " << placement.node << "): "
+                  << std::setw(8) << rate(placement) << " GB/s\n";
+    }
+
+    return 0;
+}
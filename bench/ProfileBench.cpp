@@ -0,0 +1,188 @@
+/**
+ * @brief Benchmark of the effect of each socket tuning profile over loopback
+ *
+ * @file ProfileBench.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Project headers
+#include "Common/Socket.h"
+#include "Common/SocketOptions.h"
+#include "Common/CommonData.h"
+
+// Standard headers
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    constexpr const char* const BENCH_ADDR = "127.0.0.1";
+    constexpr uint16_t BENCH_PORT_BASE = SERVER_PORT + 100;
+
+    constexpr size_t BULK_BYTES = 256 * 1024 * 1024;
+    constexpr size_t PING_SIZE = 64;
+    constexpr int PING_COUNT = 20000;
+    constexpr auto PHASE_LIMIT = std::chrono::seconds(2);
+
+    /// Start a listener with the given options, returning it ready to accept.
+    Common::Socket listenOn(uint16_t port, const Common::SocketOptions& options)
+    {
+        Common::Socket listenSocket(BENCH_ADDR, port);
+        listenSocket.setOptions(options);
+        listenSocket.bind();
+        listenSocket.listen();
+        return listenSocket;
+    }
+
+    Common::Socket connectTo(uint16_t port, const Common::SocketOptions& options)
+    {
+        Common::Socket socket(BENCH_ADDR, port);
+        socket.setOptions(options);
+        socket.connect();
+        return socket;
+    }
+
+    /// Throughput, in MB/s, of one-way transfer in records of 'recordSize' bytes
+    double bulkThroughput(uint16_t port, const Common::SocketOptions& options, size_t recordSize)
+    {
+        auto listenSocket = listenOn(port, options);
+
+        std::thread drain([&listenSocket, &options]
+        {
+            auto conn = listenSocket.accept();
+            conn->setOptions(options);
+            std::vector<char> buffer(256 * 1024);
+            while (conn->recv(buffer.data(), buffer.size()))
+            {
+            }
+        });
+
+        std::vector<char> record(recordSize, 'x');
+        const auto start = Clock::now();
+        size_t sent = 0;
+        {
+            auto socket = connectTo(port, options);
+            while (sent < BULK_BYTES && Clock::now() - start < PHASE_LIMIT)
+            {
+                socket.send(record.data(), record.size());
+                sent += record.size();
+            }
+        }
+
+        drain.join();
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        return static_cast<double>(sent) / elapsed.count() / 1e6;
+    }
+
+    /// Round-trip times, in microseconds, of small messages echoed back
+    std::vector<double> pingPong(uint16_t port, const Common::SocketOptions& options)
+    {
+        auto listenSocket = listenOn(port, options);
+
+        std::thread echo([&listenSocket, &options]
+        {
+            auto conn = listenSocket.accept();
+            conn->setOptions(options);
+            char buffer[PING_SIZE];
+            for (;;)
+            {
+                size_t have = 0;
+                while (have < PING_SIZE)
+                {
+                    auto received = conn->recv(buffer + have, PING_SIZE - have);
+                    if (!received)
+                    {
+                        return;
+                    }
+                    have += received.value();
+                }
+                conn->send(buffer, PING_SIZE);
+            }
+        });
+
+        std::vector<double> samples;
+        {
+            auto socket = connectTo(port, options);
+            char buffer[PING_SIZE] = {};
+            const auto start = Clock::now();
+            for (int ping = 0; ping < PING_COUNT && Clock::now() - start < PHASE_LIMIT; ++ping)
+            {
+                const auto sendTime = Clock::now();
+                socket.send(buffer, PING_SIZE);
+
+                size_t have = 0;
+                while (have < PING_SIZE)
+                {
+                    have += socket.recv(buffer + have, PING_SIZE - have).value_or(PING_SIZE);
+                }
+
+                std::chrono::duration<double, std::micro> rtt = Clock::now() - sendTime;
+                samples.push_back(rtt.count());
+            }
+        }
+
+        echo.join();
+        std::sort(samples.begin(), samples.end());
+        return samples;
+    }
+
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+        if (sorted.empty())
+        {
+            return 0.0;
+        }
+
+        return sorted[static_cast<size_t>(p * static_cast<double>(sorted.size() - 1))];
+    }
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+int main()
+{
+    const char* profiles[] = {"default", "bulk", "low-latency"};
+
+    std::cout << std::left << std::setw(14) << "profile"
+              << std::right << std::setw(14) << "1K rec MB/s"
+              << std::setw(14) << "64K rec MB/s"
+              << std::setw(12) << "pings"
+              << std::setw(12) << "p50 us"
+              << std::setw(12) << "p99 us" << std::endl;
+
+    uint16_t port = BENCH_PORT_BASE;
+    for (const auto& name : profiles)
+    {
+        auto options = Common::SocketOptions::profile(name).value();
+
+        try
+        {
+            auto small = bulkThroughput(port++, options, 1024);
+            auto large = bulkThroughput(port++, options, 64 * 1024);
+            auto rtts = pingPong(port++, options);
+
+            std::cout << std::left << std::setw(14) << name << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(14) << small
+                      << std::setw(14) << large
+                      << std::setw(12) << rtts.size()
+                      << std::setw(12) << percentile(rtts, 0.50)
+                      << std::setw(12) << percentile(rtts, 0.99) << std::endl;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << name << ": " << e.what() << std::endl;
+        }
+    }
+
+    return 0;
+}
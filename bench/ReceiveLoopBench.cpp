@@ -0,0 +1,110 @@
+/**
+ * @brief Benchmark of the receive loop with its handler known at compile time, and through the
+ *          type-erased Receiver::Handler
+ *
+ * @file ReceiveLoopBench.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Project headers
+#include "Receiver/ReceiveLoop.h"
+
+// Standard headers
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <vector>
+#include <chrono>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    constexpr auto PHASE_LIMIT = std::chrono::seconds(1);
+
+    /// Pieces handed out per run of the loop, and the size of each for the call-overhead phase
+    constexpr uint64_t PIECES = 1000000;
+    constexpr size_t SMALL_PIECE = 16;
+
+    /// Data for the memory transport: small enough to stay in cache, in full-sized receives
+    constexpr uint64_t MEMORY_PIECES = 256;
+    constexpr size_t MEMORY_SIZE = MEMORY_PIECES * 1024;
+
+    /// A transport that hands out the same few bytes over and over, without copying, so that
+    /// only the cost of the calls is measured
+    struct Repeat
+    {
+        uint64_t    remaining{PIECES};
+
+        std::optional<size_t> recv(void* buffer, size_t)
+        {
+            if (remaining == 0)
+            {
+                return std::nullopt;
+            }
+
+            --remaining;
+            static_cast<char*>(buffer)[0] = static_cast<char>(remaining);
+            return SMALL_PIECE;
+        }
+    };
+
+    /// Handler calls per second of a loop, run repeatedly for the phase limit
+    template <typename Run>
+    double callRate(uint64_t piecesPerRun, Run run)
+    {
+        const auto start = Clock::now();
+        uint64_t calls = 0;
+        do
+        {
+            run();
+            calls += piecesPerRun;
+        } while (Clock::now() - start < PHASE_LIMIT);
+
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        return static_cast<double>(calls) / elapsed.count();
+    }
+
+    void report(const std::string& label, double inlined, double erased)
+    {
+        std::cout << std::left << std::setw(28) << label << std::right
+                  << std::setw(10) << inlined / 1e6 << " M calls/s inlined, "
+                  << std::setw(10) << erased / 1e6 << " M calls/s type-erased ("
+                  << inlined / erased << "x)\n";
+    }
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+int main()
+{
+    std::cout << std::fixed << std::setprecision(2);
+
+    // What a typical handler does with each piece: look at its bytes and count them.
+    uint64_t bytes = 0;
+    uint64_t checksum = 0;
+    auto handler = [&bytes, &checksum](const void* buffer, size_t len)
+    {
+        bytes += len;
+        checksum += static_cast<const unsigned char*>(buffer)[0];
+    };
+    const std::function<void(const void*, size_t)> erased = handler;
+
+    report("call overhead (16 B pieces)",
+        callRate(PIECES, [&]() { receiveAll(Repeat{}, handler); }),
+        callRate(PIECES, [&]() { receiveAll(Repeat{}, erased); }));
+
+    const std::vector<char> data(MEMORY_SIZE, 'x');
+    report("memory transport (1 KiB)",
+        callRate(MEMORY_PIECES, [&]() { receiveAll(Transport::Memory{data.data(), data.size()}, handler); }),
+        callRate(MEMORY_PIECES, [&]() { receiveAll(Transport::Memory{data.data(), data.size()}, erased); }));
+
+    // Keep the handlers' work from being optimized away.
+    std::cout << "(" << bytes << " bytes handled, checksum " << checksum << ")\n";
+
+    return 0;
+}
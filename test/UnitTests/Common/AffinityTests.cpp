@@ -0,0 +1,82 @@
+/**
+ * @brief Unit tests for the Affinity class
+ *
+ * @file AffinityTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Common/Affinity.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// System headers
+#include <sys/mman.h>
+
+// Standard headers
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+
+// Test that CPU lists are read as the kernel writes them.
+TEST(AffinityTests, TestParseCpuList)
+{
+    EXPECT_EQ((std::vector<int>{0}), Common::Affinity::parseCpuList("0"));
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 8, 10, 11}), Common::Affinity::parseCpuList("0-3,8,10-11"));
+    EXPECT_EQ((std::vector<int>{4, 5}), Common::Affinity::parseCpuList("4-5\n"));
+
+    EXPECT_FALSE(Common::Affinity::parseCpuList(""));
+    EXPECT_FALSE(Common::Affinity::parseCpuList("3-1"));
+    EXPECT_FALSE(Common::Affinity::parseCpuList("1,,2"));
+    EXPECT_FALSE(Common::Affinity::parseCpuList("a"));
+    EXPECT_FALSE(Common::Affinity::parseCpuList("-1"));
+}
+
+// Test that a thread pinned to a CPU runs there, and may be released again.
+TEST(AffinityTests, TestPin)
+{
+    std::thread([]()
+    {
+        const auto cpu = Common::Affinity::currentCpu();
+        ASSERT_GE(cpu, 0);
+
+        ASSERT_TRUE(Common::Affinity::pin(cpu));
+        std::this_thread::yield();
+        EXPECT_EQ(cpu, Common::Affinity::currentCpu());
+
+        EXPECT_TRUE(Common::Affinity::pin(std::vector<int>()));
+        EXPECT_FALSE(Common::Affinity::pin(-1));
+    }).join();
+}
+
+// Test that every CPU belongs to a node that lists it.
+TEST(AffinityTests, TestTopology)
+{
+    EXPECT_GE(Common::Affinity::nodeCount(), 1);
+
+    const auto cpu = Common::Affinity::currentCpu();
+    const auto cpus = Common::Affinity::cpusOf(Common::Affinity::nodeOf(cpu));
+    EXPECT_NE(cpus.end(), std::find(cpus.begin(), cpus.end(), cpu));
+
+    EXPECT_TRUE(Common::Affinity::cpusOf(-1).empty());
+}
+
+// Test that memory can be kept on the local node, including a region not aligned to pages.
+TEST(AffinityTests, TestBindMemory)
+{
+    constexpr size_t LEN = 1024 * 1024;
+    auto memory = static_cast<char*>(mmap(nullptr, LEN, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    ASSERT_NE(MAP_FAILED, memory);
+
+    const auto node = Common::Affinity::nodeOf(Common::Affinity::currentCpu());
+    EXPECT_TRUE(Common::Affinity::bindMemory(memory + 16, LEN - 16, node));
+    EXPECT_TRUE(Common::Affinity::bindMemory(memory + 16, 16, node));
+    EXPECT_FALSE(Common::Affinity::bindMemory(memory, LEN, -1));
+
+    std::fill(memory, memory + LEN, 'x');
+    munmap(memory, LEN);
+}
@@ -0,0 +1,154 @@
+/**
+ * @brief Unit tests for the BufferArena class
+ *
+ * @file BufferArenaTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Common/BufferArena.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// System headers
+#include <sys/mman.h>
+
+// Standard headers
+#include <memory>
+#include <vector>
+
+
+class BufferArenaTests : public testing::Test
+{
+protected: // Definitions
+    static constexpr size_t TEST_SIZE = 3 * 1024 * 1024;
+    static constexpr size_t TEST_PAGE = 4096;
+
+protected: // Methods
+    BufferArenaTests() = default;
+
+    virtual ~BufferArenaTests() = default;
+
+    /// The number of the arena's pages that are resident
+    static size_t residentPages(const Common::BufferArena::Buffer& buffer)
+    {
+        std::vector<unsigned char> pages(buffer.size() / TEST_PAGE);
+        EXPECT_EQ(0, mincore(buffer.get(), buffer.size(), pages.data()));
+
+        size_t resident = 0;
+        for (auto page : pages)
+        {
+            resident += page & 1;
+        }
+        return resident;
+    }
+
+protected: // Members
+    std::unique_ptr<Common::BufferArena>    mTestObj;
+};
+
+
+// Test that the arena is a whole number of huge pages, with its buffers page aligned within it.
+TEST_F(BufferArenaTests, TestTakeAndRelease)
+{
+    // Setup
+    mTestObj = std::make_unique<Common::BufferArena>(TEST_SIZE);
+    ASSERT_EQ(2 * Common::BufferArena::HUGE_PAGE_SIZE, mTestObj->size());
+
+    // Test
+    {
+        Common::BufferArena::Buffer first(mTestObj.get(), 10000);
+        Common::BufferArena::Buffer second(mTestObj.get(), 1);
+
+        // Verify
+        EXPECT_TRUE(first.isFromArena());
+        EXPECT_TRUE(second.isFromArena());
+        EXPECT_EQ(3 * TEST_PAGE, first.size());
+        EXPECT_EQ(TEST_PAGE, second.size());
+        EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(first.get()) % TEST_PAGE);
+        EXPECT_GE(second.get(), first.get() + first.size());
+        EXPECT_EQ(mTestObj->size() - 4 * TEST_PAGE, mTestObj->available());
+
+        first.get()[first.size() - 1] = 'x';
+        second.get()[0] = 'y';
+    }
+
+    EXPECT_EQ(mTestObj->size(), mTestObj->available());
+}
+
+// Test that freed buffers merge, so the whole arena can be taken again.
+TEST_F(BufferArenaTests, TestReleasedExtentsMerge)
+{
+    // Setup
+    mTestObj = std::make_unique<Common::BufferArena>(Common::BufferArena::HUGE_PAGE_SIZE);
+    const auto quarter = mTestObj->size() / 4;
+
+    std::vector<Common::BufferArena::Buffer> buffers;
+    for (int count = 0; count < 4; ++count)
+    {
+        buffers.emplace_back(mTestObj.get(), quarter);
+    }
+    EXPECT_EQ(0u, mTestObj->available());
+
+    // Test: release out of order
+    buffers[1] = Common::BufferArena::Buffer();
+    buffers[3] = Common::BufferArena::Buffer();
+    buffers[0] = Common::BufferArena::Buffer();
+    buffers[2] = Common::BufferArena::Buffer();
+
+    // Verify
+    Common::BufferArena::Buffer whole(mTestObj.get(), mTestObj->size());
+    EXPECT_TRUE(whole.isFromArena());
+}
+
+// Test that a buffer the arena cannot hold comes from the heap instead, and is counted.
+TEST_F(BufferArenaTests, TestFallback)
+{
+    // Setup
+    mTestObj = std::make_unique<Common::BufferArena>(Common::BufferArena::HUGE_PAGE_SIZE);
+
+    // Test
+    Common::BufferArena::Buffer tooLarge(mTestObj.get(), mTestObj->size() + 1);
+    Common::BufferArena::Buffer noArena(nullptr, 100);
+
+    // Verify
+    ASSERT_TRUE(tooLarge);
+    EXPECT_FALSE(tooLarge.isFromArena());
+    EXPECT_FALSE(noArena.isFromArena());
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(tooLarge.get()) % TEST_PAGE);
+    EXPECT_EQ(1u, mTestObj->fallbacks());
+    EXPECT_EQ(mTestObj->size(), mTestObj->available());
+}
+
+// Test that prefaulting leaves every page resident before any is used.
+TEST_F(BufferArenaTests, TestPrefault)
+{
+    // Setup
+    mTestObj = std::make_unique<Common::BufferArena>(TEST_SIZE, true);
+
+    // Test
+    Common::BufferArena::Buffer buffer(mTestObj.get(), mTestObj->size());
+
+    // Verify
+    EXPECT_EQ(buffer.size() / TEST_PAGE, residentPages(buffer));
+}
+
+// Test that without prefaulting, pages are left to be faulted in on use.
+TEST_F(BufferArenaTests, TestNoPrefault)
+{
+    // Setup
+    mTestObj = std::make_unique<Common::BufferArena>(TEST_SIZE, false);
+
+    // Test
+    Common::BufferArena::Buffer buffer(mTestObj.get(), mTestObj->size());
+
+    // Verify
+    if (mTestObj->backing() == Common::BufferArena::Backing::Transparent)
+    {
+        EXPECT_EQ(0u, residentPages(buffer));
+    }
+    EXPECT_NE(std::string::npos, mTestObj->describe().find("4 MiB"));
+}
@@ -0,0 +1,95 @@
+/**
+ * @brief Unit tests for the Crc32c class
+ *
+ * @file Crc32cTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Common/Crc32c.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <random>
+#include <string>
+#include <vector>
+
+using Common::Crc32c;
+
+
+class Crc32cTests : public testing::Test
+{
+protected: // Methods
+    Crc32cTests()
+    {
+        // Enough for every hardware path: three long lanes and more
+        std::minstd_rand random(42);
+        mData.resize(3 * 3 * 8192 + 1000);
+        for (auto& byte : mData)
+        {
+            byte = static_cast<char>(random());
+        }
+    }
+
+    virtual ~Crc32cTests() = default;
+
+protected: // Members
+    std::vector<char>   mData;
+};
+
+
+// Test against published check values (RFC 3720, B.4).
+TEST_F(Crc32cTests, TestKnownValues)
+{
+    const std::string check = "123456789";
+    const std::string zeros(32, '\0');
+    const std::string ones(32, '\xff');
+
+    for (auto extend : {&Crc32c::extend, &Crc32c::extendPortable})
+    {
+        EXPECT_EQ(0xe3069283u, extend(0, check.data(), check.size()));
+        EXPECT_EQ(0x8a9136aau, extend(0, zeros.data(), zeros.size()));
+        EXPECT_EQ(0x62a8ab43u, extend(0, ones.data(), ones.size()));
+        EXPECT_EQ(0u, extend(0, nullptr, 0));
+    }
+}
+
+// Test that the accelerated and portable versions agree at every length and alignment.
+TEST_F(Crc32cTests, TestImplementationsAgree)
+{
+    for (size_t start = 0; start < 8; ++start)
+    {
+        for (size_t len : {size_t{1}, size_t{7}, size_t{8}, size_t{255}, size_t{768}, size_t{769},
+                           size_t{3 * 8192}, size_t{3 * 8192 + 3 * 256 + 13}, mData.size() - 8})
+        {
+            EXPECT_EQ(Crc32c::extendPortable(0, mData.data() + start, len),
+                      Crc32c::extend(0, mData.data() + start, len)) << "start " << start << ", length " << len;
+        }
+    }
+}
+
+// Test that a checksum built up piece by piece matches one computed in one go.
+TEST_F(Crc32cTests, TestIncremental)
+{
+    // Setup
+    Crc32c crc;
+    std::minstd_rand random(7);
+
+    // Test
+    size_t position = 0;
+    while (position < mData.size())
+    {
+        auto len = std::min<size_t>(random() % 20000, mData.size() - position);
+        crc.update(mData.data() + position, len);
+        position += len;
+    }
+
+    // Verify
+    EXPECT_EQ(Crc32c::extend(0, mData.data(), mData.size()), crc.value());
+    crc.reset();
+    EXPECT_EQ(0u, crc.value());
+}
@@ -0,0 +1,89 @@
+/**
+ * @brief Unit tests for the Fingerprint struct
+ *
+ * @file FingerprintTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Common/Fingerprint.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using Common::Fingerprint;
+
+
+class FingerprintTests : public testing::Test
+{
+protected: // Methods
+    FingerprintTests()
+    {
+        // Long enough for several scrambles and a final stripe that overlaps the one before
+        std::minstd_rand random(42);
+        mData.resize(3 * 1024 + 37);
+        for (auto& byte : mData)
+        {
+            byte = static_cast<char>(random());
+        }
+    }
+
+    virtual ~FingerprintTests() = default;
+
+protected: // Members
+    std::vector<char>   mData;
+};
+
+
+// Test that equal bytes give equal fingerprints, wherever they are in memory.
+TEST_F(FingerprintTests, TestDeterministic)
+{
+    std::vector<char> copy(mData.size() + 1);
+    std::copy(mData.begin(), mData.end(), copy.begin() + 1);
+
+    EXPECT_EQ(Fingerprint::of(mData.data(), mData.size()), Fingerprint::of(mData.data(), mData.size()));
+    EXPECT_EQ(Fingerprint::of(mData.data(), mData.size()), Fingerprint::of(copy.data() + 1, mData.size()));
+}
+
+// Test that every length, and every single bit flipped, gives a fingerprint of its own.
+TEST_F(FingerprintTests, TestDistinct)
+{
+    std::unordered_set<Fingerprint, Fingerprint::Hash> seen;
+
+    // Zeros of every length too, which the padding of short input must not confuse
+    const std::vector<char> zeros(mData.size(), '\0');
+    for (size_t len = 0; len <= 300; ++len)
+    {
+        EXPECT_TRUE(seen.insert(Fingerprint::of(mData.data(), len)).second) << "length " << len;
+        EXPECT_TRUE(seen.insert(Fingerprint::of(zeros.data(), len)).second || len == 0) << "zeros " << len;
+    }
+
+    auto flipped = mData;
+    for (size_t bit = 0; bit < flipped.size() * 8; bit += 7)
+    {
+        flipped[bit / 8] ^= static_cast<char>(1 << (bit % 8));
+        EXPECT_TRUE(seen.insert(Fingerprint::of(flipped.data(), flipped.size())).second) << "bit " << bit;
+        flipped[bit / 8] ^= static_cast<char>(1 << (bit % 8));
+    }
+}
+
+// Test that the encoded form reads back as the same fingerprint.
+TEST_F(FingerprintTests, TestEncodeDecode)
+{
+    auto fingerprint = Fingerprint::of(mData.data(), mData.size());
+
+    uint8_t encoded[Fingerprint::SIZE];
+    fingerprint.encode(encoded);
+
+    EXPECT_EQ(fingerprint, Fingerprint::decode(encoded));
+    EXPECT_EQ(2 * Fingerprint::SIZE, fingerprint.toString().size());
+    EXPECT_EQ((Fingerprint{0x0123456789abcdefull, 0x1ull}.toString()), "0123456789abcdef0000000000000001");
+}
@@ -0,0 +1,108 @@
+/**
+ * @brief Unit tests for the LatencyHistogram class
+ *
+ * @file LatencyHistogramTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Common/LatencyHistogram.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <sstream>
+#include <string>
+
+
+class LatencyHistogramTests : public testing::Test
+{
+protected: // Methods
+    LatencyHistogramTests() = default;
+
+    virtual ~LatencyHistogramTests() = default;
+
+protected: // Members
+    Common::LatencyHistogram    mTestObj;
+};
+
+
+// Test that small values are counted exactly, and large ones to within the stated precision.
+TEST_F(LatencyHistogramTests, TestPrecision)
+{
+    // Setup
+    constexpr uint64_t SMALL = 100;
+    constexpr uint64_t LARGE = 123456789;
+
+    // Test/Verify
+    mTestObj.record(SMALL);
+    EXPECT_EQ(SMALL, mTestObj.percentile(100.0));
+
+    mTestObj.reset();
+    mTestObj.record(LARGE);
+    mTestObj.record(LARGE + 1);
+    const auto reported = mTestObj.percentile(50.0);
+    EXPECT_GE(reported, LARGE);
+    EXPECT_LE(reported, LARGE + LARGE / 64);
+
+    // The maximum is exact, and bounds what is reported.
+    EXPECT_EQ(LARGE + 1, mTestObj.max());
+    EXPECT_EQ(LARGE, mTestObj.min());
+    EXPECT_EQ(LARGE + 1, mTestObj.percentile(100.0));
+}
+
+// Test that percentiles come from the rank of the values counted.
+TEST_F(LatencyHistogramTests, TestPercentiles)
+{
+    // Setup: 1 to 1000 microseconds, once each.
+    for (uint64_t value = 1; value <= 1000; ++value)
+    {
+        mTestObj.record(value * 1000);
+    }
+
+    // Verify
+    EXPECT_EQ(1000u, mTestObj.count());
+    EXPECT_NEAR(500500.0, mTestObj.mean(), 1.0);
+
+    for (auto percentile : {50.0, 90.0, 99.0, 99.9})
+    {
+        const auto expected = percentile * 10.0 * 1000.0;
+        EXPECT_GE(static_cast<double>(mTestObj.percentile(percentile)), expected) << percentile;
+        EXPECT_LE(static_cast<double>(mTestObj.percentile(percentile)), expected * (1.0 + 1.0 / 64)) << percentile;
+    }
+
+    // Values too large are counted at the largest value, not dropped.
+    mTestObj.record(UINT64_MAX);
+    EXPECT_EQ(Common::LatencyHistogram::MAX_VALUE, mTestObj.max());
+}
+
+// Test that merged histograms report as one, and that the distribution ends at the maximum.
+TEST_F(LatencyHistogramTests, TestMergeAndDistribution)
+{
+    // Setup
+    Common::LatencyHistogram other;
+    mTestObj.record(1000);
+    other.record(3000);
+    other.record(5000);
+
+    // Test
+    mTestObj.merge(other);
+
+    std::ostringstream out;
+    mTestObj.writeDistribution(out, 1000.0);
+
+    // Verify
+    EXPECT_EQ(3u, mTestObj.count());
+    EXPECT_EQ(1000u, mTestObj.min());
+    EXPECT_EQ(5000u, mTestObj.max());
+    EXPECT_GE(mTestObj.percentile(50.0), 3000u);
+    EXPECT_LE(mTestObj.percentile(50.0), 3000u + 3000u / 64);
+
+    const auto text = out.str();
+    EXPECT_NE(std::string::npos, text.find("Percentile"));
+    EXPECT_NE(std::string::npos, text.find("1.000000000000          3\n"));
+    EXPECT_NE(std::string::npos, text.find("Total count =            3"));
+}
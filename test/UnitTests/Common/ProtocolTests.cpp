@@ -0,0 +1,240 @@
+/**
+ * @brief Unit tests for the framed protocol
+ *
+ * @file ProtocolTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Mocks
+#include "Common/Mocks/SocketMock.h"
+
+// Code under test
+#include "Common/Protocol.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+using testing::_;
+using testing::Return;
+
+using namespace Common::Protocol;
+
+
+class ProtocolTests : public testing::Test
+{
+protected: // Definitions
+    static constexpr const char* TEST_IP = "123.210.012.3";
+    static constexpr uint16_t TEST_PORT = 12345;
+
+protected: // Methods
+    ProtocolTests()
+    {
+        mSocketMock = std::make_shared<testing::NiceMock<Common::SocketMock>>();
+        mSocketMockVendor.queueMock(mSocketMock);
+
+        // Consume the queued socket mock
+        mSocket = std::make_unique<Common::Socket>(TEST_IP, TEST_PORT);
+    }
+
+    virtual ~ProtocolTests() = default;
+
+    /// Append an encoded frame to mWire
+    void addFrame(const FrameHeader& header, const std::string& payload = "")
+    {
+        uint8_t encoded[HEADER_SIZE];
+        encode(header, encoded);
+        mWire.insert(mWire.end(), encoded, encoded + HEADER_SIZE);
+        mWire.insert(mWire.end(), payload.begin(), payload.end());
+    }
+
+    /// Make recv() return mWire at most 'chunk' bytes at a time, then report a disconnect
+    void serveWire(size_t chunk)
+    {
+        ON_CALL(*mSocketMock, recv(_, _)).WillByDefault([this, chunk](void* buffer, size_t len)
+        {
+            std::optional<size_t> result;
+
+            auto count = std::min({chunk, len, mWire.size() - mRead});
+            if (count > 0)
+            {
+                std::memcpy(buffer, mWire.data() + mRead, count);
+                mRead += count;
+                result = count;
+            }
+
+            return result;
+        });
+    }
+
+protected: // Members
+    MockVendor<Common::SocketMock, Common::Socket>  mSocketMockVendor;
+    std::shared_ptr<Common::SocketMock>             mSocketMock;
+    std::unique_ptr<Common::Socket>                 mSocket;
+    std::vector<uint8_t>                            mWire;
+    size_t                                          mRead{0};
+};
+
+
+// Test that a header survives encoding and decoding, and is big-endian on the wire.
+TEST_F(ProtocolTests, TestEncodeDecode)
+{
+    // Setup
+    FrameHeader header;
+    header.type = FrameType::Resume;
+    header.flags = 7;
+    header.stream = 0x1234;
+    header.length = 0x00ABCDEF;
+    header.offset = 0x0102030405060708;
+
+    // Test
+    uint8_t encoded[HEADER_SIZE];
+    encode(header, encoded);
+    auto decoded = decode(encoded);
+
+    // Verify
+    EXPECT_EQ(3, encoded[0]);
+    EXPECT_EQ(0x12, encoded[2]);
+    EXPECT_EQ(0x01, encoded[8]);
+    EXPECT_EQ(0x08, encoded[15]);
+    EXPECT_EQ(header.type, decoded.type);
+    EXPECT_EQ(header.flags, decoded.flags);
+    EXPECT_EQ(header.stream, decoded.stream);
+    EXPECT_EQ(header.length, decoded.length);
+    EXPECT_EQ(header.offset, decoded.offset);
+}
+
+// Test that a connection is taken for framed only on a whole Hello header, and that raw data
+// starting with the Hello type is not.
+TEST_F(ProtocolTests, TestMatchHello)
+{
+    // Setup
+    FrameHeader hello;
+    hello.type = FrameType::Hello;
+    hello.flags = VERSION;
+    hello.length = sizeof(uint32_t);
+    hello.offset = MAGIC;
+
+    uint8_t encoded[HEADER_SIZE + 4] = {};
+    encode(hello, encoded);
+
+    // Test/Verify
+    EXPECT_EQ(HelloMatch::Match, matchHello(encoded, sizeof(encoded)));
+    EXPECT_EQ(HelloMatch::Match, matchHello(encoded, HEADER_SIZE));
+    for (size_t len = 1; len < HEADER_SIZE; ++len)
+    {
+        EXPECT_EQ(HelloMatch::Partial, matchHello(encoded, len)) << len;
+    }
+
+    for (size_t at = 0; at < HEADER_SIZE; ++at)
+    {
+        auto copy = std::vector<uint8_t>(encoded, encoded + HEADER_SIZE);
+        copy[at] ^= 0x40;
+        EXPECT_EQ(HelloMatch::Mismatch, matchHello(copy.data(), copy.size())) << at;
+    }
+
+    const char raw[] = "\x01" "binary record\n";
+    EXPECT_EQ(HelloMatch::Mismatch, matchHello(raw, sizeof(raw) - 1));
+}
+
+// Test that frames are reassembled no matter how the bytes are split across reads, and that
+// primed bytes are parsed first.
+TEST_F(ProtocolTests, TestFrameReaderFragmented)
+{
+    // Setup
+    FrameHeader first;
+    first.type = FrameType::Hello;
+    first.offset = MAGIC;
+    first.length = 4;
+    addFrame(first, "abcd");
+
+    FrameHeader second;
+    second.type = FrameType::Data;
+    second.stream = 3;
+    second.offset = 42;
+    second.length = 11;
+    addFrame(second, "hello world");
+
+    // The first 5 bytes were already read by whoever detected the protocol.
+    FrameReader reader(*mSocket);
+    reader.prime(mWire.data(), 5);
+    mRead = 5;
+    serveWire(3);
+
+    // Test
+    std::vector<char> payload;
+    auto header1 = reader.next(payload);
+    std::string payload1(payload.begin(), payload.end());
+    auto header2 = reader.next(payload);
+    std::string payload2(payload.begin(), payload.end());
+    auto header3 = reader.next(payload);
+
+    // Verify
+    ASSERT_TRUE(header1.has_value());
+    EXPECT_EQ(FrameType::Hello, header1->type);
+    EXPECT_EQ(MAGIC, header1->offset);
+    EXPECT_EQ("abcd", payload1);
+
+    ASSERT_TRUE(header2.has_value());
+    EXPECT_EQ(FrameType::Data, header2->type);
+    EXPECT_EQ(3, header2->stream);
+    EXPECT_EQ(42u, header2->offset);
+    EXPECT_EQ("hello world", payload2);
+
+    EXPECT_FALSE(header3.has_value());
+}
+
+// Test that an oversized frame is refused rather than allocated.
+TEST_F(ProtocolTests, TestFrameReaderTooLarge)
+{
+    // Setup
+    FrameHeader header;
+    header.length = MAX_PAYLOAD + 1;
+    addFrame(header);
+    serveWire(mWire.size());
+
+    FrameReader reader(*mSocket);
+    std::vector<char> payload;
+
+    // Test & Verify
+    EXPECT_THROW(reader.next(payload), Common::Socket::Exception);
+}
+
+// Test that a small frame is sent as a single write.
+TEST_F(ProtocolTests, TestSendFrameCoalesces)
+{
+    // Setup
+    const std::string payload = "payload";
+    FrameHeader header;
+    header.type = FrameType::Open;
+    header.length = static_cast<uint32_t>(payload.size());
+
+    EXPECT_CALL(*mSocketMock, send(_, HEADER_SIZE + payload.size()))
+        .WillOnce([&payload](const void* buffer, size_t len)
+        {
+            auto bytes = static_cast<const char*>(buffer);
+            EXPECT_EQ(static_cast<char>(FrameType::Open), bytes[0]);
+            EXPECT_EQ(payload, std::string(bytes + HEADER_SIZE, len - HEADER_SIZE));
+        });
+
+    // Test
+    sendFrame(*mSocket, header, payload.data());
+}
+
+// Test that a file id depends on every attribute of the file.
+TEST_F(ProtocolTests, TestFileId)
+{
+    auto id = fileId("data.bin", 100, 5);
+
+    EXPECT_EQ(id, fileId("data.bin", 100, 5));
+    EXPECT_NE(id, fileId("data.bim", 100, 5));
+    EXPECT_NE(id, fileId("data.bin", 101, 5));
+    EXPECT_NE(id, fileId("data.bin", 100, 6));
+}
@@ -0,0 +1,180 @@
+/**
+ * @brief Unit tests for the RecordFilter class
+ *
+ * @file RecordFilterTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Common/RecordFilter.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <random>
+#include <string>
+#include <vector>
+
+using Common::RecordFilter;
+
+
+class RecordFilterTests : public testing::Test
+{
+protected: // Methods
+    RecordFilterTests()
+    {
+        // Few distinct bytes, so that near misses are common
+        std::minstd_rand random(42);
+        mData.resize(4096);
+        for (auto& byte : mData)
+        {
+            byte = "abcd\n"[random() % 5];
+        }
+    }
+
+    virtual ~RecordFilterTests() = default;
+
+    static bool passes(const std::string& spec, const std::string& record)
+    {
+        return RecordFilter(spec).matches(record.data(), record.size());
+    }
+
+protected: // Members
+    std::string     mData;
+};
+
+
+// Test that the accelerated and portable searches agree at every length and alignment,
+// including matches that straddle the vector blocks.
+TEST_F(RecordFilterTests, TestFindImplementationsAgree)
+{
+    const std::vector<std::string> literals{"ab", "abc", "dcba", "aaaa", "cdcdc", "b\nb", "abcdabcdabcdabcdabcdabcdabcdabcdabcdx"};
+
+    for (size_t start = 0; start < 40; ++start)
+    {
+        for (size_t len : {size_t{0}, size_t{1}, size_t{31}, size_t{32}, size_t{33}, size_t{64}, size_t{100}, size_t{1000}})
+        {
+            const auto data = mData.data() + start;
+            for (const auto& literal : literals)
+            {
+                EXPECT_EQ(RecordFilter::findPortable(data, len, literal.data(), literal.size()),
+                          RecordFilter::find(data, len, literal.data(), literal.size()))
+                    << "'" << literal << "' from " << start << ", length " << len;
+            }
+
+            EXPECT_EQ(RecordFilter::findAnyPortable(data, len, literals), RecordFilter::findAny(data, len, literals))
+                << "from " << start << ", length " << len;
+        }
+    }
+
+    // The same, at a match placed just past each block boundary
+    std::string text(200, 'a');
+    for (size_t at = 28; at < 72; ++at)
+    {
+        auto copy = text;
+        copy.replace(at, 3, "xyz");
+        EXPECT_EQ(at, RecordFilter::find(copy.data(), copy.size(), "xyz", 3));
+        EXPECT_EQ(at, RecordFilter::findAny(copy.data(), copy.size(), {"qq", "yz", "xy"}));
+    }
+}
+
+// Test each kind of clause, negation, and that every clause must pass.
+TEST_F(RecordFilterTests, TestClauses)
+{
+    EXPECT_TRUE(passes("contains:ERROR", "12:00 ERROR disk full"));
+    EXPECT_FALSE(passes("contains:ERROR", "12:00 INFO all well"));
+    EXPECT_TRUE(passes("!contains:DEBUG", "12:00 INFO all well"));
+    EXPECT_FALSE(passes("!contains:DEBUG", "12:00 DEBUG noise"));
+
+    EXPECT_TRUE(passes("any:WARN|ERROR", "12:00 WARN low disk"));
+    EXPECT_FALSE(passes("any:WARN|ERROR", "12:00 INFO all well"));
+
+    EXPECT_TRUE(passes("field:2=ERROR", "12:00   ERROR disk full"));
+    EXPECT_FALSE(passes("field:2=ERROR", "12:00 INFO ERROR"));
+    EXPECT_TRUE(passes("field:3>=500", "GET /items 503 12ms"));
+    EXPECT_FALSE(passes("field:3>=500", "GET /items 200 12ms"));
+    EXPECT_FALSE(passes("field:4<100", "GET /items 200 12ms"));     // Not a number
+    EXPECT_FALSE(passes("field:9!=x", "GET /items"));               // No such field
+    EXPECT_TRUE(passes("csv:2<1.5", "a,1.25,c"));
+    EXPECT_TRUE(passes("csv:3=", "a,b,,d"));
+    EXPECT_TRUE(passes("csv:2!=b", "a,bb,c"));
+
+    // Every clause must pass; sampling is left to the user of the filter.
+    EXPECT_TRUE(passes("contains:ERROR\nfield:1=web", "web ERROR timeout"));
+    EXPECT_FALSE(passes("contains:ERROR\nfield:1=web", "db ERROR timeout"));
+
+    RecordFilter sampled{"sample:0.5\ncontains:x\nsample:0.5"};
+    EXPECT_DOUBLE_EQ(0.25, sampled.sampleRate());
+    EXPECT_FALSE(sampled.passesAll());
+    EXPECT_TRUE(RecordFilter("sample:0.1\n\n").passesAll());
+    EXPECT_TRUE(RecordFilter("").passesAll());
+}
+
+// Test patterns, including the cases where quantifiers must not give up too early.
+TEST_F(RecordFilterTests, TestPatterns)
+{
+    EXPECT_TRUE(passes("regex:latency=9[0-9][0-9]ms", "GET latency=950ms"));
+    EXPECT_FALSE(passes("regex:latency=9[0-9][0-9]ms", "GET latency=95ms"));
+    EXPECT_TRUE(passes("regex:^GET /", "GET /items"));
+    EXPECT_FALSE(passes("regex:^GET /", "POST /GET /"));
+    EXPECT_TRUE(passes("regex:ms$", "took 12ms"));
+    EXPECT_FALSE(passes("regex:ms$", "12ms taken"));
+    EXPECT_TRUE(passes("regex:a.*b.*c", "xxaxxbxxcxx"));
+    EXPECT_FALSE(passes("regex:a.*b.*c", "xxcxxbxxaxx"));
+    EXPECT_TRUE(passes("regex:ab+c", "aabbbc"));
+    EXPECT_FALSE(passes("regex:ab+c", "aac"));
+    EXPECT_TRUE(passes("regex:colou?r", "color"));
+    EXPECT_TRUE(passes("regex:colou?r", "colour"));
+    EXPECT_TRUE(passes("regex:\\d+\\s\\w+", "at 42 items"));
+    EXPECT_TRUE(passes("regex:[^a-z]z", "az 9z"));
+    EXPECT_FALSE(passes("regex:[^a-z]z", "az bz"));
+    EXPECT_TRUE(passes("regex:a\\.b", "a.b"));
+    EXPECT_FALSE(passes("regex:a\\.b", "axb"));
+
+    // A match that starts inside a failed attempt at its lead
+    EXPECT_TRUE(passes("regex:user=7", "user=user=7"));
+    EXPECT_TRUE(passes("regex:aab", "aaab"));
+    EXPECT_TRUE(passes("!regex:^$", "not empty"));
+    EXPECT_TRUE(passes("regex:^$", ""));
+}
+
+// Test that seek() skips the records that cannot pass, and only those.
+TEST_F(RecordFilterTests, TestSeek)
+{
+    const std::string records = "a INFO\nb DEBUG\nc ERROR\nd INFO\n";
+
+    RecordFilter errors{"contains:ERROR"};
+    EXPECT_TRUE(errors.seekDecides());
+    auto hit = errors.seek(records.data(), records.size());
+    ASSERT_NE(RecordFilter::NOT_FOUND, hit);
+    EXPECT_EQ(records.find("c ERROR"), records.rfind('\n', hit) + 1);
+
+    // A field's value must appear in its record.
+    RecordFilter debug{"field:2=DEBUG\ncontains:b"};
+    EXPECT_FALSE(debug.seekDecides());
+    EXPECT_EQ(records.find("DEBUG"), debug.seek(records.data(), records.size()));
+
+    EXPECT_EQ(RecordFilter::NOT_FOUND, RecordFilter("any:FATAL|PANIC").seek(records.data(), records.size()));
+
+    // Negated clauses and open patterns rule nothing out.
+    EXPECT_EQ(0u, RecordFilter("!contains:INFO").seek(records.data(), records.size()));
+    EXPECT_EQ(0u, RecordFilter("regex:[A-Z]+").seek(records.data(), records.size()));
+}
+
+// Test that a filter that cannot be understood is refused, saying why.
+TEST_F(RecordFilterTests, TestInvalidSpecs)
+{
+    for (auto spec : {"ERROR", "contains:", "any:a||b", "regex:(a|b)", "regex:*a", "regex:[a-", "regex:a$b",
+                      "regex:\\", "field:0=x", "field:x=1", "field:1~x", "csv:2<abc", "sample:0", "sample:2",
+                      "!sample:0.5", "grep:x"})
+    {
+        EXPECT_THROW(RecordFilter{spec}, RecordFilter::Exception) << spec;
+    }
+
+    EXPECT_THROW(RecordFilter{"regex:" + std::string(RecordFilter::MAX_PATTERN_TOKENS + 1, 'a')},
+                 RecordFilter::Exception);
+    EXPECT_NO_THROW(RecordFilter{"regex:" + std::string(RecordFilter::MAX_PATTERN_TOKENS, 'a')});
+}
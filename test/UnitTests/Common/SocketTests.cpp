@@ -110,3 +110,28 @@ TEST_F(SocketTests, TestListen)
     // Verify
     EXPECT_GT(listen_fake.call_count, 0);
 }
+
+// Test that TCP_NODELAY and TCP_CORK cannot be requested together.
+TEST_F(SocketTests, TestSetOptionsNoDelayAndCork)
+{
+    // Setup
+    Common::SocketOptions options;
+    options.noDelay = true;
+    options.cork = true;
+
+    // Test/Verify
+    EXPECT_THROW(mTestObj->setOptions(options), Common::Socket::Exception);
+}
+
+// Test that each named profile can be applied to an unconnected socket.
+TEST_F(SocketTests, TestSetOptionsProfiles)
+{
+    for (const auto& name : {"default", "bulk", "low-latency"})
+    {
+        auto options = Common::SocketOptions::profile(name);
+        ASSERT_TRUE(options.has_value()) << name;
+        EXPECT_NO_THROW(mTestObj->setOptions(options.value())) << name;
+    }
+
+    EXPECT_FALSE(Common::SocketOptions::profile("no-such-profile").has_value());
+}
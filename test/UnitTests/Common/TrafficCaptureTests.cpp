@@ -0,0 +1,212 @@
+/**
+ * @brief Unit tests for the TrafficCapture class
+ *
+ * @file TrafficCaptureTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Common/TrafficCapture.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+
+
+class TrafficCaptureTests : public testing::Test
+{
+protected: // Methods
+    TrafficCaptureTests()
+    {
+        char path[] = "/tmp/TrafficCaptureTests.XXXXXX";
+        auto fd = mkstemp(path);
+        ::close(fd);
+        mPath = path;
+    }
+
+    virtual ~TrafficCaptureTests()
+    {
+        unlink(mPath.c_str());
+    }
+
+    static std::string text(const Common::TrafficCapture::Record& record)
+    {
+        return std::string(record.data, record.len);
+    }
+
+protected: // Members
+    std::string     mPath;
+};
+
+
+// Test that records read back as written: in order, on their connections, with their times.
+TEST_F(TrafficCaptureTests, TestRoundTrip)
+{
+    // Setup
+    const auto before = std::chrono::system_clock::now();
+    {
+        Common::TrafficCapture capture(mPath);
+
+        auto first = capture.open();
+        auto second = capture.open();
+        EXPECT_NE(first, second);
+
+        capture.append(first, "one\n", 4);
+        std::this_thread::sleep_for(20ms);
+        capture.append(second, "two\n", 4);
+        capture.append(first, "", 0);
+        capture.close(first);
+        capture.append(second, "three\n", 6);
+
+        const auto stats = capture.stats();
+        EXPECT_EQ(2u, stats.connections);
+        EXPECT_EQ(3u, stats.records);
+        EXPECT_EQ(14u, stats.bytes);
+    }
+
+    // Test
+    Common::TrafficCapture::Reader reader(mPath);
+
+    std::vector<Common::TrafficCapture::Record> records;
+    std::vector<std::string> texts;
+    while (auto record = reader.next())
+    {
+        records.push_back(record.value());
+        texts.push_back(text(record.value()));
+    }
+
+    // Verify
+    EXPECT_GE(reader.started(), before - 1s);
+    EXPECT_LE(reader.started(), std::chrono::system_clock::now());
+
+    ASSERT_EQ(4u, records.size());
+    EXPECT_EQ((std::vector<std::string>{"one\n", "two\n", "", "three\n"}), texts);
+    EXPECT_EQ(records[0].connection, records[2].connection);
+    EXPECT_EQ(records[1].connection, records[3].connection);
+    EXPECT_NE(records[0].connection, records[1].connection);
+
+    // The end of the first connection, and times that follow the writes.
+    EXPECT_EQ(0u, records[2].len);
+    EXPECT_GE(records[1].time - records[0].time, 20ms);
+    for (size_t index = 1; index < records.size(); ++index)
+    {
+        EXPECT_GE(records[index].time, records[index - 1].time);
+    }
+}
+
+// Test that records larger than the buffer are kept whole, and that a capture cut short ends at
+// its last whole record.
+TEST_F(TrafficCaptureTests, TestLargeRecordsAndTruncation)
+{
+    // Setup
+    const std::string large(Common::TrafficCapture::BUFFER_SIZE * 2 + 123, 'x');
+    {
+        Common::TrafficCapture capture(mPath);
+        auto connection = capture.open();
+        capture.append(connection, "small", 5);
+        capture.append(connection, large.data(), large.size());
+        capture.append(connection, "cut", 3);
+    }
+
+    // Test: lose the last byte, as a receiver killed mid-write would.
+    ASSERT_EQ(0, truncate(mPath.c_str(), static_cast<off_t>(Common::TrafficCapture::HEADER_SIZE
+        + 3 * Common::TrafficCapture::RECORD_HEADER_SIZE + 5 + large.size() + 3 - 1)));
+
+    Common::TrafficCapture::Reader reader(mPath);
+
+    // Verify
+    auto small = reader.next();
+    ASSERT_TRUE(small.has_value());
+    EXPECT_EQ("small", text(small.value()));
+
+    auto whole = reader.next();
+    ASSERT_TRUE(whole.has_value());
+    EXPECT_TRUE(text(whole.value()) == large);
+
+    EXPECT_FALSE(reader.next().has_value());
+}
+
+// Test that connections appending at once, while full buffers are written behind them, each read
+// back whole and in order, and that flush() returns with everything on disk.
+TEST_F(TrafficCaptureTests, TestConcurrentAppends)
+{
+    // Setup
+    constexpr int THREADS = 4;
+    constexpr int RECORDS = 3000;
+
+    Common::TrafficCapture capture(mPath);
+    std::vector<std::string> sent(THREADS);
+    std::vector<uint32_t> connections(THREADS);
+
+    // Test: now and then a record larger than the buffer, so that one spans several
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < THREADS; ++thread)
+    {
+        connections[thread] = capture.open();
+        threads.emplace_back([&, thread]()
+        {
+            for (int count = 0; count < RECORDS; ++count)
+            {
+                const auto record = (count % 1000 == 999)
+                    ? std::string(Common::TrafficCapture::BUFFER_SIZE + 7, static_cast<char>('a' + thread))
+                    : std::to_string(thread) + ":" + std::to_string(count) + std::string(count % 300, '.') + "\n";
+                capture.append(connections[thread], record.data(), record.size());
+                sent[thread] += record;
+            }
+            capture.close(connections[thread]);
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    capture.flush();
+
+    // Verify, while the capture is still open
+    std::vector<std::string> received(THREADS);
+    std::vector<bool> ended(THREADS, false);
+    Common::TrafficCapture::Reader reader(mPath);
+    while (auto record = reader.next())
+    {
+        auto thread = std::find(connections.begin(), connections.end(), record->connection) - connections.begin();
+        ASSERT_LT(thread, THREADS);
+        EXPECT_FALSE(ended[thread]);
+        ended[thread] = ended[thread] || (record->len == 0);
+        received[thread] += text(record.value());
+    }
+
+    for (int thread = 0; thread < THREADS; ++thread)
+    {
+        EXPECT_TRUE(ended[thread]) << thread;
+        EXPECT_TRUE(sent[thread] == received[thread]) << thread;
+    }
+    EXPECT_EQ(static_cast<uint64_t>(THREADS * RECORDS), capture.stats().records);
+}
+
+// Test that a file that is not a capture is refused.
+TEST_F(TrafficCaptureTests, TestNotACapture)
+{
+    // Setup
+    {
+        Common::TrafficCapture capture(mPath);
+    }
+    EXPECT_NO_THROW(Common::TrafficCapture::Reader{mPath});
+
+    ASSERT_EQ(0, truncate(mPath.c_str(), 4));
+
+    // Test/Verify
+    EXPECT_THROW(Common::TrafficCapture::Reader{mPath}, Common::TrafficCapture::Exception);
+    EXPECT_THROW(Common::TrafficCapture::Reader{mPath + ".missing"}, Common::TrafficCapture::Exception);
+}
@@ -0,0 +1,170 @@
+/**
+ * @brief Unit tests for the LoadGen class
+ *
+ * @file LoadGenTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "LoadGen/LoadGen.cpp"
+#include "Receiver/Receiver.h"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <random>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+
+class LoadGenTests : public testing::Test
+{
+protected: // Definitions
+    static constexpr const char* TEST_IP = "127.0.0.1";
+    static constexpr uint16_t TEST_PORT = SERVER_PORT + 400;
+
+protected: // Methods
+    LoadGenTests() = default;
+
+    virtual ~LoadGenTests() = default;
+};
+
+
+// Test that each form of record size is parsed, and that drawn sizes stay within it.
+TEST_F(LoadGenTests, TestRecordSizes)
+{
+    // Setup
+    std::mt19937_64 random(1);
+
+    // Test/Verify
+    auto fixed = LoadGen::RecordSizes::parse("250");
+    ASSERT_TRUE(fixed.has_value());
+    EXPECT_EQ(250u, fixed->draw(random));
+
+    auto uniform = LoadGen::RecordSizes::parse("10-20");
+    ASSERT_TRUE(uniform.has_value());
+    for (int draw = 0; draw < 1000; ++draw)
+    {
+        auto size = uniform->draw(random);
+        EXPECT_GE(size, 10u);
+        EXPECT_LE(size, 20u);
+    }
+
+    auto exponential = LoadGen::RecordSizes::parse("exp:500");
+    ASSERT_TRUE(exponential.has_value());
+    double total = 0;
+    for (int draw = 0; draw < 10000; ++draw)
+    {
+        auto size = exponential->draw(random);
+        EXPECT_GE(size, 1u);
+        EXPECT_LE(size, LoadGen::MAX_RECORD_SIZE);
+        total += static_cast<double>(size);
+    }
+    EXPECT_NEAR(500.0, total / 10000, 25.0);
+
+    for (auto invalid : {"", "0", "20-10", "exp:", "10-", "abc", "2000000"})
+    {
+        EXPECT_FALSE(LoadGen::RecordSizes::parse(invalid).has_value()) << invalid;
+    }
+}
+
+// Test that every option is parsed, and that bad values are refused.
+TEST_F(LoadGenTests, ParseCommandLine)
+{
+    // Setup
+    const char* argv[] = {"loadgen", "--receiver", "10.1.2.3:4000", "--connections", "5000", "--threads", "4",
+                          "--rate", "2.5", "--record-size", "exp:300", "--churn-rate", "100", "--churn-burst", "50",
+                          "--duration-ms", "1500", "--connect-timeout-ms", "250", "--echo"};
+
+    // Test
+    auto data = LoadGen::parseCommandLine(std::size(argv), argv);
+
+    // Verify
+    EXPECT_EQ("10.1.2.3", data.config.target.addr);
+    EXPECT_EQ(4000, data.config.target.port);
+    EXPECT_EQ(5000u, data.config.connections);
+    EXPECT_EQ(4u, data.config.threads);
+    EXPECT_DOUBLE_EQ(2.5, data.config.rate);
+    EXPECT_EQ(LoadGen::RecordSizes::Kind::Exponential, data.config.sizes.kind);
+    EXPECT_EQ(300u, data.config.sizes.first);
+    EXPECT_DOUBLE_EQ(100.0, data.config.churnRate);
+    EXPECT_EQ(50u, data.config.churnBurst);
+    EXPECT_EQ(1500ms, data.config.duration);
+    EXPECT_EQ(250ms, data.config.connectTimeout);
+    EXPECT_TRUE(data.config.echo);
+
+    // The defaults target the usual receiver.
+    const char* none[] = {"loadgen"};
+    EXPECT_EQ(SERVER_PORT, LoadGen::parseCommandLine(1, none).config.target.port);
+
+    const char* badNumber[] = {"loadgen", "--connections", "many"};
+    EXPECT_THROW(LoadGen::parseCommandLine(3, badNumber), LoadGen::Exception);
+
+    const char* badRate[] = {"loadgen", "--rate", "-1"};
+    EXPECT_THROW(LoadGen::parseCommandLine(3, badRate), LoadGen::Exception);
+
+    const char* badSize[] = {"loadgen", "--record-size", "0"};
+    EXPECT_THROW(LoadGen::parseCommandLine(3, badSize), LoadGen::Exception);
+
+    const char* missing[] = {"loadgen", "--threads"};
+    EXPECT_THROW(LoadGen::parseCommandLine(2, missing), LoadGen::Exception);
+
+    LoadGen::Config noConnections;
+    noConnections.target = Common::Endpoint{TEST_IP, TEST_PORT};
+    noConnections.connections = 0;
+    EXPECT_THROW(LoadGen loadGen(noConnections), LoadGen::Exception);
+}
+
+// Test a run against an echoing receiver: every connection is served, records come back, and
+// churned connections are replaced.
+TEST_F(LoadGenTests, TestRunAgainstEchoReceiver)
+{
+    // Setup
+    Receiver::Config receiverConfig;
+    receiverConfig.echo = true;
+    Receiver receiver(receiverConfig);
+
+    std::thread receiving([&]()
+    {
+        EXPECT_NO_THROW(receiver.execute(TEST_IP, TEST_PORT, [](const void*, size_t) {}));
+    });
+    std::this_thread::sleep_for(200ms);
+
+    // Fewer connections than the receiver's listen backlog, so that none wait on a retransmit.
+    LoadGen::Config config;
+    config.target = Common::Endpoint{TEST_IP, TEST_PORT};
+    config.connections = 8;
+    config.threads = 2;
+    config.rate = 200;
+    config.sizes = LoadGen::RecordSizes::parse("20-200").value();
+    config.churnRate = 10;
+    config.duration = 1000ms;
+    config.echo = true;
+
+    // Test
+    LoadGen loadGen(config);
+    auto report = loadGen.run();
+
+    receiver.stop();
+    receiving.join();
+
+    // Verify
+    EXPECT_GE(report.elapsed, 1000ms);
+    EXPECT_GT(report.records, 0u);
+    EXPECT_GT(report.bytesEchoed, 0u);
+    EXPECT_LE(report.bytesEchoed, report.bytesSent);
+    EXPECT_GT(report.churned, 0u);
+    EXPECT_GE(report.connects, config.connections);
+    EXPECT_EQ(report.connects, report.acceptLatency.count());
+    EXPECT_EQ(0u, report.connectFailures);
+    EXPECT_EQ(0u, report.connectTimeouts);
+    EXPECT_EQ(0u, report.disconnects);
+
+    // No more than the configured rate, give or take the first record of each connection.
+    const auto limit = config.rate * static_cast<double>(config.connections) * report.elapsed.count();
+    EXPECT_LE(static_cast<double>(report.records), limit + static_cast<double>(report.connects));
+}
@@ -0,0 +1,142 @@
+/**
+ * @brief Unit tests for the CheckpointStore class
+ *
+ * @file CheckpointStoreTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Receiver/CheckpointStore.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <memory>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+
+
+class CheckpointStoreTests : public testing::Test
+{
+protected: // Definitions
+    static constexpr uint64_t TEST_ID = 0x1234;
+    static constexpr const char* TEST_NAME = "some/dir/data.bin";
+
+protected: // Methods
+    CheckpointStoreTests()
+    {
+        char directory[] = "/tmp/CheckpointStoreTests.XXXXXX";
+        mDirectory = mkdtemp(directory);
+        mTestObj = std::make_unique<CheckpointStore>(mDirectory);
+    }
+
+    virtual ~CheckpointStoreTests()
+    {
+        mTestObj.reset();
+        std::filesystem::remove_all(mDirectory);
+    }
+
+    std::string contents(const std::string& name)
+    {
+        std::ifstream file(mDirectory + "/" + name);
+        std::ostringstream str;
+        str << file.rdbuf();
+        return str.str();
+    }
+
+protected: // Members
+    std::string                         mDirectory;
+    std::unique_ptr<CheckpointStore>    mTestObj;
+};
+
+
+// Test that a new file starts at zero.
+TEST_F(CheckpointStoreTests, TestOpenNew)
+{
+    CheckpointStore::Owner owner;
+    EXPECT_EQ(0u, mTestObj->open(TEST_ID, TEST_NAME, owner));
+}
+
+// Test that only synced data is reported to a resuming sender.
+TEST_F(CheckpointStoreTests, TestResumeFromCheckpoint)
+{
+    // Setup
+    CheckpointStore::Owner owner;
+    mTestObj->open(TEST_ID, TEST_NAME, owner);
+    mTestObj->write(TEST_ID, owner, 0, "0123456789", 10);
+    EXPECT_EQ(10u, mTestObj->sync(TEST_ID, owner, 10));
+    mTestObj->write(TEST_ID, owner, 10, "abcde", 5);
+    mTestObj->release(TEST_ID, owner);
+
+    // Test (as after a restart)
+    mTestObj = std::make_unique<CheckpointStore>(mDirectory);
+    auto resumed = mTestObj->open(TEST_ID, TEST_NAME, owner);
+
+    // Verify
+    EXPECT_EQ(10u, resumed);
+}
+
+// Test that a completed file takes its own name, stripped of any directory, and leaves no
+// working files behind.
+TEST_F(CheckpointStoreTests, TestComplete)
+{
+    // Setup
+    CheckpointStore::Owner owner;
+    mTestObj->open(TEST_ID, TEST_NAME, owner);
+    mTestObj->write(TEST_ID, owner, 0, "0123456789", 10);
+    mTestObj->sync(TEST_ID, owner, 10);
+    mTestObj->write(TEST_ID, owner, 10, "abcde", 5);
+
+    // Test
+    mTestObj->complete(TEST_ID, owner, 15);
+
+    // Verify
+    EXPECT_EQ("0123456789abcde", contents("data.bin"));
+    EXPECT_EQ(1, std::distance(std::filesystem::directory_iterator(mDirectory),
+                               std::filesystem::directory_iterator()));
+    EXPECT_THROW(mTestObj->write(TEST_ID, owner, 0, "x", 1), CheckpointStore::Exception);
+}
+
+// Test that a sender resuming while its dropped connection still holds the file takes the file
+// over, and that the old connection winding down afterwards does not disturb it.
+TEST_F(CheckpointStoreTests, TestResumeTakesOverFromDroppedConnection)
+{
+    // Setup: the first connection gets part way, then drops without releasing the file.
+    CheckpointStore::Owner dropped;
+    mTestObj->open(TEST_ID, TEST_NAME, dropped);
+    mTestObj->write(TEST_ID, dropped, 0, "0123456789", 10);
+    mTestObj->sync(TEST_ID, dropped, 10);
+    mTestObj->write(TEST_ID, dropped, 10, "abcde", 5);
+
+    // Test: the sender resumes on a new connection before the old one has finished.
+    CheckpointStore::Owner resumed;
+    EXPECT_EQ(10u, mTestObj->open(TEST_ID, TEST_NAME, resumed));
+    mTestObj->write(TEST_ID, resumed, 10, "ABCDE", 5);
+
+    // The old connection winds down: its checkpoint and release are ignored, and it can no
+    // longer write.
+    EXPECT_EQ(10u, mTestObj->sync(TEST_ID, dropped, 15));
+    mTestObj->release(TEST_ID, dropped);
+    EXPECT_THROW(mTestObj->write(TEST_ID, dropped, 10, "abcde", 5), CheckpointStore::Exception);
+    EXPECT_THROW(mTestObj->complete(TEST_ID, dropped, 15), CheckpointStore::Exception);
+
+    mTestObj->write(TEST_ID, resumed, 15, "fghij", 5);
+    EXPECT_EQ(20u, mTestObj->sync(TEST_ID, resumed, 20));
+    mTestObj->complete(TEST_ID, resumed, 20);
+
+    // Verify
+    EXPECT_EQ("0123456789ABCDEfghij", contents("data.bin"));
+}
+
+// Test that names which would leave the directory are refused.
+TEST_F(CheckpointStoreTests, TestInvalidName)
+{
+    CheckpointStore::Owner owner;
+    EXPECT_THROW(mTestObj->open(TEST_ID, "dir/..", owner), CheckpointStore::Exception);
+    EXPECT_THROW(mTestObj->open(TEST_ID, "dir/", owner), CheckpointStore::Exception);
+}
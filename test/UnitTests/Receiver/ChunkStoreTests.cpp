@@ -0,0 +1,139 @@
+/**
+ * @brief Unit tests for the ChunkStore class
+ *
+ * @file ChunkStoreTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Receiver/ChunkStore.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <string>
+#include <vector>
+#include <filesystem>
+
+
+class ChunkStoreTests : public testing::Test
+{
+protected: // Methods
+    ChunkStoreTests()
+    {
+        char directory[] = "/tmp/ChunkStoreTests.XXXXXX";
+        mDirectory = mkdtemp(directory);
+    }
+
+    virtual ~ChunkStoreTests()
+    {
+        std::filesystem::remove_all(mDirectory);
+    }
+
+    void put(ChunkStore& store, const std::string& chunk)
+    {
+        store.put(Common::Fingerprint::of(chunk.data(), chunk.size()), chunk.data(), chunk.size());
+    }
+
+    std::string get(const ChunkStore& store, const std::string& chunk)
+    {
+        std::vector<char> data;
+        if (!store.get(Common::Fingerprint::of(chunk.data(), chunk.size()), data))
+        {
+            return "<missing>";
+        }
+        return std::string(data.begin(), data.end());
+    }
+
+protected: // Members
+    std::string     mDirectory;
+};
+
+
+// Test that stored chunks are found again, and only stored once.
+TEST_F(ChunkStoreTests, TestPutAndGet)
+{
+    // Setup
+    ChunkStore testObj(mDirectory);
+    const std::string first(5000, 'a');
+    const std::string second = "second chunk";
+
+    // Test
+    put(testObj, first);
+    put(testObj, second);
+    put(testObj, first);
+
+    // Verify
+    EXPECT_TRUE(testObj.contains(Common::Fingerprint::of(first.data(), first.size())));
+    EXPECT_FALSE(testObj.contains(Common::Fingerprint::of("other", 5)));
+    EXPECT_EQ(first, get(testObj, first));
+    EXPECT_EQ(second, get(testObj, second));
+    EXPECT_EQ("<missing>", get(testObj, "other"));
+    EXPECT_EQ(2u, testObj.stats().chunks);
+    EXPECT_EQ(first.size() + second.size(), testObj.stats().bytes);
+}
+
+// Test that chunks outlive the store that received them.
+TEST_F(ChunkStoreTests, TestReopen)
+{
+    // Setup
+    {
+        ChunkStore testObj(mDirectory);
+        put(testObj, "kept across restarts");
+    }
+
+    // Test
+    ChunkStore testObj(mDirectory);
+
+    // Verify
+    EXPECT_EQ("kept across restarts", get(testObj, "kept across restarts"));
+    EXPECT_EQ(1u, testObj.stats().chunks);
+}
+
+// Test that a record cut short, or whose data never reached the disk, is dropped on reopening.
+TEST_F(ChunkStoreTests, TestTornTail)
+{
+    // Setup
+    const auto pack = mDirectory + "/chunks.pack";
+    {
+        ChunkStore testObj(mDirectory);
+        put(testObj, "whole");
+        put(testObj, "torn record");
+    }
+
+    const auto whole = std::filesystem::file_size(pack);
+    {
+        // A header whose data is zeros, as a crash can leave behind
+        ChunkStore testObj(mDirectory);
+        put(testObj, "never written");
+    }
+    {
+        auto fd = ::open(pack.c_str(), O_RDWR);
+        ASSERT_GE(fd, 0);
+        const std::string zeros(std::string("never written").size(), '\0');
+        ASSERT_EQ(static_cast<ssize_t>(zeros.size()),
+                  pwrite(fd, zeros.data(), zeros.size(), static_cast<off_t>(whole + 20)));
+        close(fd);
+    }
+
+    // Test
+    {
+        ChunkStore testObj(mDirectory);
+
+        // Verify
+        EXPECT_EQ("<missing>", get(testObj, "never written"));
+        EXPECT_EQ(whole, std::filesystem::file_size(pack));
+        put(testObj, "after");
+    }
+
+    std::filesystem::resize_file(pack, std::filesystem::file_size(pack) - 1);
+    ChunkStore testObj(mDirectory);
+
+    EXPECT_EQ("whole", get(testObj, "whole"));
+    EXPECT_EQ("torn record", get(testObj, "torn record"));
+    EXPECT_EQ("<missing>", get(testObj, "after"));
+    EXPECT_EQ(whole, std::filesystem::file_size(pack));
+}
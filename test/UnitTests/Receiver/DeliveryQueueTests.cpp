@@ -0,0 +1,161 @@
+/**
+ * @brief Unit tests for the DeliveryQueue class
+ *
+ * @file DeliveryQueueTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Receiver/DeliveryQueue.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <memory>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+using namespace std::chrono_literals;
+
+
+class DeliveryQueueTests : public testing::Test
+{
+protected: // Definitions
+    static constexpr uint64_t TEST_START = 1000;
+    static constexpr size_t TEST_CAPACITY = 40;
+
+protected: // Methods
+    DeliveryQueueTests() = default;
+
+    virtual ~DeliveryQueueTests() = default;
+
+    void create()
+    {
+        mTestObj = std::make_unique<DeliveryQueue>([this](const void* buffer, size_t len)
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this]{ return !mBlocked; });
+            mDelivered.append(static_cast<const char*>(buffer), len);
+        }, TEST_START, TEST_CAPACITY, [this](uint64_t limit)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mGrants.push_back(limit);
+        });
+    }
+
+    void push(const std::string& data)
+    {
+        mTestObj->push(data.data(), data.size());
+    }
+
+    void unblock()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mBlocked = false;
+        }
+        mCondition.notify_all();
+    }
+
+protected: // Members
+    std::mutex                      mMutex;
+    std::condition_variable         mCondition;
+    bool                            mBlocked{false};
+    std::string                     mDelivered;
+    std::vector<uint64_t>           mGrants;
+    std::unique_ptr<DeliveryQueue>  mTestObj;
+};
+
+
+// Test that data is delivered in order and credit is extended as it is consumed.
+TEST_F(DeliveryQueueTests, TestDeliverAndGrant)
+{
+    // Setup
+    create();
+    EXPECT_EQ(TEST_START + TEST_CAPACITY, mTestObj->limit());
+
+    // Test
+    push("0123456789");
+    push("abcdefghij");
+    mTestObj->drain();
+
+    // Verify
+    EXPECT_EQ("0123456789abcdefghij", mDelivered);
+    ASSERT_FALSE(mGrants.empty());
+    EXPECT_EQ(TEST_START + 20 + TEST_CAPACITY, mGrants.back());
+    EXPECT_EQ(mGrants.back(), mTestObj->limit());
+}
+
+// Test that a sender going past its credit is refused, so memory stays bounded.
+TEST_F(DeliveryQueueTests, TestCreditExceeded)
+{
+    // Setup
+    mBlocked = true;
+    create();
+    push(std::string(TEST_CAPACITY, 'x'));
+
+    // Test & Verify
+    EXPECT_THROW(push("y"), DeliveryQueue::Exception);
+
+    unblock();
+}
+
+// Test that time spent with the window full is reported as stall time.
+TEST_F(DeliveryQueueTests, TestStallTime)
+{
+    // Setup
+    mBlocked = true;
+    create();
+
+    // Test
+    push(std::string(TEST_CAPACITY, 'x'));
+    std::this_thread::sleep_for(20ms);
+    unblock();
+    mTestObj->drain();
+
+    // Verify
+    EXPECT_GE(mTestObj->stallTime(), 20ms);
+}
+
+// Test that a handler failure is reported to the connection.
+TEST_F(DeliveryQueueTests, TestHandlerFailure)
+{
+    // Setup
+    mTestObj = std::make_unique<DeliveryQueue>([](const void*, size_t)
+    {
+        throw std::runtime_error("handler failed");
+    }, 0, TEST_CAPACITY, [](uint64_t){});
+
+    // Test
+    push("data");
+
+    // Verify
+    EXPECT_THROW(mTestObj->drain(), std::runtime_error);
+}
+
+// Test that the handler runs on the CPUs given, with the queue kept on their node.
+TEST_F(DeliveryQueueTests, TestPlacement)
+{
+    // Setup
+    const auto cpu = Common::Affinity::currentCpu();
+    ASSERT_GE(cpu, 0);
+    int handledOn = -1;
+
+    mTestObj = std::make_unique<DeliveryQueue>([&handledOn](const void*, size_t)
+    {
+        handledOn = Common::Affinity::currentCpu();
+    }, 0, TEST_CAPACITY, [](uint64_t){}, Common::Affinity::nodeOf(cpu), std::vector<int>{cpu});
+
+    // Test
+    push("data");
+    mTestObj->drain();
+
+    // Verify
+    EXPECT_EQ(cpu, handledOn);
+}
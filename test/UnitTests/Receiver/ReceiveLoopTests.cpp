@@ -0,0 +1,84 @@
+/**
+ * @brief Unit tests for the ReceiveLoop class template
+ *
+ * @file ReceiveLoopTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Receiver/ReceiveLoop.h"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <functional>
+#include <string>
+#include <vector>
+
+
+// Test that everything the transport holds reaches the handler in order, in receive-sized pieces,
+// after what was received first.
+TEST(ReceiveLoopTests, TestHandsOverEverythingInOrder)
+{
+    // Setup
+    std::string data;
+    for (int line = 0; line < 300; ++line)
+    {
+        data += "line " + std::to_string(line) + "\n";
+    }
+
+    std::string output;
+    std::vector<size_t> pieces;
+    auto handler = [&](const void* buffer, size_t len)
+    {
+        output.append(static_cast<const char*>(buffer), len);
+        pieces.push_back(len);
+    };
+
+    // Test
+    auto total = receiveAll(Transport::Memory{data.data() + 6, data.size() - 6}, handler, data.data(), 6);
+
+    // Verify
+    EXPECT_EQ(data.size(), total);
+    EXPECT_EQ(data, output);
+    ASSERT_GE(pieces.size(), 3u);
+    EXPECT_EQ(6u, pieces[0]);
+    EXPECT_EQ((ReceiveLoop<Transport::Memory, decltype(handler)>::BUFFER_SIZE), pieces[1]);
+}
+
+// Test that the type-erased handler Receiver uses goes through the same loop.
+TEST(ReceiveLoopTests, TestTypeErasedHandler)
+{
+    // Setup
+    const std::string data(5000, 'x');
+    size_t received = 0;
+    const std::function<void(const void*, size_t)> handler = [&received](const void*, size_t len)
+    {
+        received += len;
+    };
+
+    // Test
+    auto total = receiveAll(Transport::Memory{data.data(), data.size()}, handler);
+
+    // Verify
+    EXPECT_EQ(data.size(), total);
+    EXPECT_EQ(data.size(), received);
+}
+
+// Test that a handler can be held by the loop itself, and that an empty transport ends at once.
+TEST(ReceiveLoopTests, TestEmptyTransport)
+{
+    // Setup
+    int calls = 0;
+    ReceiveLoop loop(Transport::Memory{nullptr, 0}, [&calls](const void*, size_t) { ++calls; });
+
+    // Test
+    auto total = loop.run();
+
+    // Verify
+    EXPECT_EQ(0u, total);
+    EXPECT_EQ(0, calls);
+}
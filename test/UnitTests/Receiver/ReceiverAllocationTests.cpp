@@ -0,0 +1,240 @@
+/**
+ * @brief Tests that a sustained transfer allocates nothing once warmed up, from the sender's
+ *          read of each line to the receiver's handler
+ *
+ * @file ReceiverAllocationTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Receiver/Receiver.cpp"
+#include "Sender/Sender.h"
+#include "Common/CommonData.h"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <sys/mman.h>
+
+using namespace std::chrono_literals;
+
+
+//-----------------------------------------------------------------------------
+// Every allocation in the process goes through here, and is counted while sCounting is set.
+
+static std::atomic<bool> sCounting{false};
+static std::atomic<uint64_t> sAllocations{0};
+static std::atomic<uint64_t> sAllocatedBytes{0};
+
+static void* allocate(size_t size, size_t alignment = 0)
+{
+    if (sCounting.load(std::memory_order_relaxed))
+    {
+        ++sAllocations;
+        sAllocatedBytes += size;
+    }
+
+    void* memory = nullptr;
+    if (alignment > alignof(std::max_align_t))
+    {
+        if (posix_memalign(&memory, alignment, size ? size : 1) != 0)
+        {
+            memory = nullptr;
+        }
+    }
+    else
+    {
+        memory = std::malloc(size ? size : 1);
+    }
+
+    if (!memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void* operator new(size_t size, std::align_val_t alignment) { return allocate(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return allocate(size, static_cast<size_t>(alignment)); }
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { std::free(memory); }
+
+
+class ReceiverAllocationTests : public testing::Test
+{
+protected: // Definitions
+    static constexpr const char* TEST_IP = "127.0.0.1";
+
+    /// How the input is sent
+    enum class Via
+    {
+        Stream,         ///< Line by line, unframed
+        Framed,         ///< As one framed stream
+        Deduplicated,   ///< As a file, by a Recipe of chunks
+    };
+
+    /// Lines sent in all; allocations are counted between the first and last WINDOW_MARGIN bytes
+    static constexpr size_t LINES = 200000;
+    static constexpr size_t WINDOW_MARGIN = 256 * 1024;
+
+protected: // Methods
+    ReceiverAllocationTests()
+    {
+        for (size_t line = 0; line < LINES; ++line)
+        {
+            mInput += "record " + std::to_string(line) + " of a sustained transfer\n";
+        }
+    }
+
+    virtual ~ReceiverAllocationTests()
+    {
+        sCounting = false;
+    }
+
+    /**
+     * @brief Send the input through a receiver on loopback
+     * @return The allocations made in the steady state, anywhere in the process (their total size
+     *          is left in sAllocatedBytes)
+     */
+    uint64_t transfer(uint16_t port, size_t batchBytes, Via via = Via::Stream, const Receiver::Config& config = {})
+    {
+        sAllocations = 0;
+        sAllocatedBytes = 0;
+        uint64_t received = 0;
+
+        Receiver receiver(config);
+        std::thread receiving([&]()
+        {
+            EXPECT_NO_THROW(receiver.execute(TEST_IP, port, [&](const void*, size_t len)
+            {
+                if (received == 0)
+                {
+                    // Hold the first piece until the sender has filled the receiver's queue, so
+                    // that every buffer the transfer needs is allocated before the count starts.
+                    std::this_thread::sleep_for(200ms);
+                }
+
+                received += len;
+
+                // Only this thread starts and stops the count, so the window is the same each run.
+                sCounting = received >= WINDOW_MARGIN && received < mInput.size() - WINDOW_MARGIN;
+
+                if (received == mInput.size())
+                {
+                    std::lock_guard<std::mutex> lock(mMutex);
+                    mDone = true;
+                    mChanged.notify_all();
+                }
+            }));
+        });
+
+        {
+            Sender sender(TEST_IP, port);
+            sender.connect();
+            if (batchBytes > 0)
+            {
+                sender.setBatching(batchBytes);
+            }
+
+            if (via != Via::Stream)
+            {
+                auto fd = memfd_create("input", MFD_CLOEXEC);
+                EXPECT_EQ(static_cast<ssize_t>(mInput.size()), write(fd, mInput.data(), mInput.size()));
+                lseek(fd, 0, SEEK_SET);
+                if (via == Via::Framed)
+                {
+                    sender.sendFramed(fd, "input");
+                }
+                else
+                {
+                    sender.sendDeduplicated(fd, "input");
+                }
+                close(fd);
+            }
+            else
+            {
+                std::istringstream input(mInput);
+                sender.sendStream(input);
+            }
+
+            std::unique_lock<std::mutex> lock(mMutex);
+            EXPECT_TRUE(mChanged.wait_for(lock, 30s, [this]() { return mDone; }));
+        }
+
+        receiver.stop();
+        receiving.join();
+
+        EXPECT_EQ(mInput.size(), received);
+        return sAllocations;
+    }
+
+protected: // Members
+    std::string                 mInput;
+    std::mutex                  mMutex;
+    std::condition_variable     mChanged;
+    bool                        mDone{false};
+};
+
+
+// Test that sending line by line allocates nothing once the transfer is under way.
+TEST_F(ReceiverAllocationTests, TestLinesAllocationFree)
+{
+    EXPECT_EQ(0u, transfer(SERVER_PORT + 300, 0));
+}
+
+// Test that batched sending allocates nothing once the transfer is under way.
+TEST_F(ReceiverAllocationTests, TestBatchedLinesAllocationFree)
+{
+    EXPECT_EQ(0u, transfer(SERVER_PORT + 301, 16 * 1024));
+}
+
+// Test that a framed transfer, under the receiver's flow control, allocates nothing once under way.
+TEST_F(ReceiverAllocationTests, TestFramedAllocationFree)
+{
+    EXPECT_EQ(0u, transfer(SERVER_PORT + 302, 0, Via::Framed));
+}
+
+// Test that a connection thread spinning for data, rather than sleeping, allocates nothing either.
+TEST_F(ReceiverAllocationTests, TestBusyPollAllocationFree)
+{
+    Receiver::Config config;
+    config.busyPollBudget = 50us;
+
+    EXPECT_EQ(0u, transfer(SERVER_PORT + 303, 0, Via::Stream, config));
+}
+
+// Test that a deduplicated transfer collects its chunks without a buffer per chunk. Recipes and
+// the chunk store's index take a little for each chunk, but nothing the size of its data.
+TEST_F(ReceiverAllocationTests, TestDeduplicatedChunksReuseBuffers)
+{
+    char directory[] = "/tmp/ReceiverAllocationTests.XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(directory));
+
+    Receiver::Config config;
+    config.chunkDirectory = directory;
+
+    transfer(SERVER_PORT + 304, 0, Via::Deduplicated, config);
+    std::filesystem::remove_all(directory);
+
+    EXPECT_LT(sAllocatedBytes, mInput.size() / 16);
+}
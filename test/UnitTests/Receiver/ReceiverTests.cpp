@@ -9,6 +9,7 @@
 
 // Mocks
 #include "Common/Mocks/SocketMock.h"
+#include "Common/SocketException.h"
 
 // Code under test
 #include "Receiver/Receiver.cpp"
@@ -26,6 +27,10 @@
 #include <cmath>
 #include <cstring>
 #include <atomic>
+#include <thread>
+#include <string>
+#include <vector>
+#include <poll.h>
 
 using namespace std::chrono_literals;
 
@@ -85,6 +90,11 @@ TEST_F(ReceiverTests, TestReceiveConnection)
                 return std::optional<Common::Socket>();
             });
 
+    EXPECT_CALL(*mSocketMock, waitAcceptable(_))
+        .WillOnce(Return(true))
+        .WillOnce(Return(true))
+        .WillRepeatedly(Return(false));
+
     // mSocketMock is consumed by execute
     mSocketMockVendor.queueMock(mSocketMock);
 
@@ -125,3 +135,243 @@ TEST_F(ReceiverTests, TestReceiveConnection)
     // Verify
     EXPECT_STREQ(testMessage.c_str(), output.str().c_str());
 }
+
+// Test that raw data is delivered even when its first byte is that of a Hello frame, and arrives
+// on its own.
+TEST_F(ReceiverTests, TestReceiveRawStartingLikeHello)
+{
+    auto connSocketMock = std::make_shared<NiceMock<Common::SocketMock>>();
+    mSocketMockVendor.queueMock(connSocketMock);
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::string output;
+    const std::vector<std::string> pieces{"\x01", "binary record\n", "and another\n"};
+    const std::string expected = pieces[0] + pieces[1] + pieces[2];
+
+    EXPECT_CALL(*mSocketMock, accept())
+        .WillOnce(Return(std::optional<Common::Socket>(Common::Socket(TEST_IP, TEST_PORT))))
+        .WillOnce([&]()
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait_for(lock, 10s, [&]{ return output.size() >= expected.size(); });
+                return std::optional<Common::Socket>();
+            });
+
+    EXPECT_CALL(*mSocketMock, waitAcceptable(_))
+        .WillOnce(Return(true))
+        .WillOnce(Return(true))
+        .WillRepeatedly(Return(false));
+
+    mSocketMockVendor.queueMock(mSocketMock);
+
+    size_t recvs = 0;
+    ON_CALL(*connSocketMock, recv(_, _)).WillByDefault([&](void* buffer, size_t len)
+        {
+            if (recvs == pieces.size())
+            {
+                return std::optional<size_t>();
+            }
+
+            const auto& piece = pieces[recvs++];
+            EXPECT_LE(piece.size(), len);
+            std::memcpy(buffer, piece.data(), piece.size());
+            return std::optional<size_t>(piece.size());
+        });
+
+    // Test
+    EXPECT_NO_THROW(mTestObj->execute(TEST_IP, TEST_PORT, [&](const void* buffer, size_t len)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            output.append(static_cast<const char*>(buffer), len);
+            changed.notify_all();
+        }));
+
+    // Verify
+    EXPECT_EQ(expected, output);
+}
+
+// Test that stop() waits out the drain timeout for open connections, then cuts them off and drops
+// (and counts) whatever they still deliver, reading out what they hold rather than discarding it.
+TEST_F(ReceiverTests, TestStopCutsOffConnectionsAfterDrainTimeout)
+{
+    // Setup
+    Receiver::Config config;
+    config.drainTimeout = 50ms;
+    mTestObj = std::make_unique<Receiver>(config);
+
+    auto connSocketMock = std::make_shared<NiceMock<Common::SocketMock>>();
+    mSocketMockVendor.queueMock(connSocketMock);
+
+    EXPECT_CALL(*mSocketMock, accept())
+        .WillOnce(Return(std::optional<Common::Socket>(Common::Socket(TEST_IP, TEST_PORT))));
+
+    // Wait as the real socket would, for a connection (only the first) or the stop
+    int waits = 0;
+    EXPECT_CALL(*mSocketMock, waitAcceptable(_)).WillRepeatedly([&waits](int wakeFd)
+        {
+            if (waits++ == 0)
+            {
+                return true;
+            }
+
+            pollfd wake{wakeFd, POLLIN, 0};
+            return poll(&wake, 1, 10000) != 1;
+        });
+
+    mSocketMockVendor.queueMock(mSocketMock);
+
+    // The sender holds the connection open until it is shut down; two more pieces are still held.
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool shutDown = false;
+    std::string output;
+
+    EXPECT_CALL(*connSocketMock, shutdownRead()).WillOnce([&]()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            shutDown = true;
+            changed.notify_all();
+        });
+    EXPECT_CALL(*connSocketMock, shutdown()).Times(0);
+
+    int recvs = 0;
+    EXPECT_CALL(*connSocketMock, recv(_, _)).WillRepeatedly([&](void* buffer, size_t len)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            switch (recvs++)
+            {
+            case 0:
+                std::memcpy(buffer, "held\n", 5);
+                return std::optional<size_t>(5);
+            case 1:
+                changed.wait_for(lock, 10s, [&shutDown]{ return shutDown; });
+                std::memcpy(buffer, "late\n", 5);
+                return std::optional<size_t>(5);
+            case 2:
+                std::memcpy(buffer, "rest\n", 5);
+                return std::optional<size_t>(5);
+            default:
+                return std::optional<size_t>();
+            }
+        });
+
+    std::thread receiver([&]()
+    {
+        EXPECT_NO_THROW(mTestObj->execute(TEST_IP, TEST_PORT, [&](const void* buffer, size_t len)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                output.append(static_cast<const char*>(buffer), len);
+                changed.notify_all();
+            }));
+    });
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        EXPECT_TRUE(changed.wait_for(lock, 10s, [&output]{ return !output.empty(); }));
+    }
+
+    // Test
+    mTestObj->stop();
+    receiver.join();
+
+    // Verify
+    EXPECT_EQ("held\n", output);
+
+    const auto& report = mTestObj->shutdownReport();
+    EXPECT_EQ(0u, report.connectionsFinished);
+    EXPECT_EQ(1u, report.connectionsCutOff);
+    EXPECT_EQ(10u, report.bytesDropped);
+    EXPECT_FALSE(report.handedOff);
+}
+
+// Test that a stop() already taken does not end a later execute().
+TEST_F(ReceiverTests, TestExecuteAgainAfterStop)
+{
+    // Setup: wait as the real socket would, for the stop
+    EXPECT_CALL(*mSocketMock, waitAcceptable(_)).WillOnce([](int wakeFd)
+        {
+            pollfd wake{wakeFd, POLLIN, 0};
+            return poll(&wake, 1, 10000) != 1;
+        });
+    mSocketMockVendor.queueMock(mSocketMock);
+
+    auto againSocketMock = std::make_shared<NiceMock<Common::SocketMock>>();
+    bool stopPending = true;
+    EXPECT_CALL(*againSocketMock, waitAcceptable(_)).WillOnce([&stopPending](int wakeFd)
+        {
+            pollfd wake{wakeFd, POLLIN, 0};
+            stopPending = (poll(&wake, 1, 0) == 1);
+            return false;
+        });
+    mSocketMockVendor.queueMock(againSocketMock);
+
+    mTestObj->stop();
+    mTestObj->execute(TEST_IP, TEST_PORT, [](const void*, size_t) {});
+
+    // Test
+    mTestObj->execute(TEST_IP, TEST_PORT, [](const void*, size_t) {});
+
+    // Verify
+    EXPECT_FALSE(stopPending);
+}
+
+// Test that a connection whose options cannot be set is dropped, and the next still served.
+TEST_F(ReceiverTests, TestDropConnectionRefusingOptions)
+{
+    // Setup
+    auto refusingSocketMock = std::make_shared<NiceMock<Common::SocketMock>>();
+    EXPECT_CALL(*refusingSocketMock, setOptions(_))
+        .WillOnce([](const Common::SocketOptions&) -> std::vector<std::string>
+            {
+                throw Common::Socket::Exception(TEST_IP, TEST_PORT, "Cannot set option: Bad file descriptor");
+            });
+    EXPECT_CALL(*refusingSocketMock, recv(_, _)).Times(0);
+    mSocketMockVendor.queueMock(refusingSocketMock);
+
+    auto connSocketMock = std::make_shared<NiceMock<Common::SocketMock>>();
+    mSocketMockVendor.queueMock(connSocketMock);
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::string output;
+
+    EXPECT_CALL(*mSocketMock, accept())
+        .WillOnce(Return(std::optional<Common::Socket>(Common::Socket(TEST_IP, TEST_PORT))))
+        .WillOnce(Return(std::optional<Common::Socket>(Common::Socket(TEST_IP, TEST_PORT))))
+        .WillOnce([&]()
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait_for(lock, 10s, [&output]{ return !output.empty(); });
+                return std::optional<Common::Socket>();
+            });
+
+    EXPECT_CALL(*mSocketMock, waitAcceptable(_))
+        .WillOnce(Return(true))
+        .WillOnce(Return(true))
+        .WillOnce(Return(true))
+        .WillRepeatedly(Return(false));
+    mSocketMockVendor.queueMock(mSocketMock);
+
+    int recvs = 0;
+    EXPECT_CALL(*connSocketMock, recv(_, _)).WillRepeatedly([&recvs](void* buffer, size_t)
+        {
+            if (recvs++ == 0)
+            {
+                std::memcpy(buffer, "served\n", 7);
+                return std::optional<size_t>(7);
+            }
+            return std::optional<size_t>();
+        });
+
+    // Test
+    EXPECT_NO_THROW(mTestObj->execute(TEST_IP, TEST_PORT, [&](const void* buffer, size_t len)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            output.append(static_cast<const char*>(buffer), len);
+            changed.notify_all();
+        }));
+
+    // Verify
+    EXPECT_EQ("served\n", output);
+}
@@ -0,0 +1,208 @@
+/**
+ * @brief Unit tests for the Relay class
+ *
+ * @file RelayTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Mocks
+#include "Common/Mocks/SocketMock.h"
+
+// Code under test
+#include "Receiver/Relay.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <memory>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <unistd.h>
+
+using testing::NiceMock;
+using testing::_;
+using testing::Return;
+
+
+class RelayTests : public testing::Test
+{
+protected: // Definitions
+    static constexpr const char* TEST_IP = "123.210.012.3";
+    static constexpr uint16_t TEST_PORT = 12345;
+
+    /// The smallest queue the kernel allows: one page
+    static constexpr size_t SMALL_QUEUE = 4096;
+
+    static constexpr std::chrono::milliseconds STALL_TIMEOUT{50};
+
+    /// A downstream receiver whose socket takes what its queue holds
+    struct Downstream
+    {
+        std::shared_ptr<NiceMock<Common::SocketMock>>   mock{std::make_shared<NiceMock<Common::SocketMock>>()};
+        std::mutex                                      mutex;
+        std::condition_variable                         condition;
+        bool                                            stalled{false};
+        std::string                                     received;
+    };
+
+protected: // Methods
+    RelayTests()
+    {
+        // The incoming connection: each spliceTo() moves the next chunk into the pipe.
+        ON_CALL(*mUpstreamMock, spliceTo(_, _)).WillByDefault([this](int pipe, size_t)
+        {
+            if (mBeforeChunk)
+            {
+                mBeforeChunk();
+            }
+
+            std::optional<size_t> result;
+            if (!mChunks.empty())
+            {
+                auto chunk = mChunks.front();
+                mChunks.pop_front();
+                EXPECT_EQ(static_cast<ssize_t>(chunk.size()), write(pipe, chunk.data(), chunk.size()));
+                result = chunk.size();
+            }
+            return result;
+        });
+
+        mSocketMockVendor.queueMock(mUpstreamMock);
+        mUpstream = std::make_unique<Common::Socket>(TEST_IP, TEST_PORT);
+    }
+
+    virtual ~RelayTests() = default;
+
+    std::unique_ptr<Downstream> downstream()
+    {
+        auto result = std::make_unique<Downstream>();
+        auto raw = result.get();
+
+        // Made non-blocking once, when the hop is set up, rather than around each splice
+        EXPECT_CALL(*raw->mock, setNonBlocking());
+
+        ON_CALL(*raw->mock, spliceFrom(_, _)).WillByDefault([raw](int pipe, size_t count)
+        {
+            {
+                std::unique_lock<std::mutex> lock(raw->mutex);
+                raw->condition.wait(lock, [raw]{ return !raw->stalled; });
+            }
+
+            std::vector<char> buffer(count);
+            auto got = read(pipe, buffer.data(), buffer.size());
+
+            std::lock_guard<std::mutex> lock(raw->mutex);
+            if (got > 0)
+            {
+                raw->received.append(buffer.data(), static_cast<size_t>(got));
+            }
+            raw->condition.notify_all();
+            return static_cast<size_t>(std::max<ssize_t>(got, 0));
+        });
+
+        mSocketMockVendor.queueMock(raw->mock);
+        return result;
+    }
+
+    /// Wait until a downstream receiver has taken 'bytes' in all (so its small queue has room)
+    static void waitFor(Downstream& downstream, size_t bytes)
+    {
+        std::unique_lock<std::mutex> lock(downstream.mutex);
+        downstream.condition.wait(lock, [&]{ return downstream.received.size() >= bytes; });
+    }
+
+protected: // Members
+    std::function<void()>                           mBeforeChunk;
+    Common::SocketMockVendor                        mSocketMockVendor;
+    std::shared_ptr<NiceMock<Common::SocketMock>>   mUpstreamMock{std::make_shared<NiceMock<Common::SocketMock>>()};
+    std::unique_ptr<Common::Socket>                 mUpstream;
+    std::deque<std::string>                         mChunks;
+};
+
+
+// Test that every downstream receiver and the local handler get the whole connection, in order.
+TEST_F(RelayTests, TestForwardsToAll)
+{
+    // Setup
+    auto first = downstream();
+    auto second = downstream();
+    std::vector<Common::Endpoint> endpoints{{TEST_IP, 1}, {TEST_IP, 2}};
+
+    mChunks = {"two\n", "three\nfour\n"};
+    std::string handled;
+    size_t sent = 4;
+    mBeforeChunk = [&]()
+    {
+        waitFor(*first, sent);
+        waitFor(*second, sent);
+        sent += mChunks.empty() ? 0 : mChunks.front().size();
+    };
+
+    // Test
+    Relay testObj(endpoints, SMALL_QUEUE, STALL_TIMEOUT, {});
+    testObj.forward("one\n", 4);
+    testObj.run(*mUpstream, [&handled](const void* buffer, size_t len)
+    {
+        handled.append(static_cast<const char*>(buffer), len);
+    });
+    auto hops = testObj.finish();
+
+    // Verify
+    const std::string expected = "one\ntwo\nthree\nfour\n";
+    EXPECT_EQ("two\nthree\nfour\n", handled);
+    EXPECT_EQ(expected, first->received);
+    EXPECT_EQ(expected, second->received);
+    ASSERT_EQ(2u, hops.size());
+    for (const auto& hop : hops)
+    {
+        EXPECT_EQ(expected.size(), hop.bytesForwarded);
+        EXPECT_FALSE(hop.cutOff);
+        EXPECT_LE(hop.averageLatency, hop.maxLatency);
+    }
+}
+
+// Test that a downstream receiver that stops taking data is cut off, and the rest carry on.
+TEST_F(RelayTests, TestSlowReceiverIsCutOff)
+{
+    // Setup
+    auto slow = downstream();
+    auto fast = downstream();
+    slow->stalled = true;
+    std::vector<Common::Endpoint> endpoints{{TEST_IP, 1}, {TEST_IP, 2}};
+
+    const std::string chunk(SMALL_QUEUE, 'x');
+    mChunks = {chunk, chunk, chunk};
+    size_t handled = 0;
+    size_t sent = 0;
+    mBeforeChunk = [&]()
+    {
+        waitFor(*fast, sent);
+        sent += mChunks.empty() ? 0 : mChunks.front().size();
+    };
+
+    // Test
+    Relay testObj(endpoints, SMALL_QUEUE, STALL_TIMEOUT, {});
+    testObj.run(*mUpstream, [&handled](const void*, size_t len){ handled += len; });
+
+    {
+        std::lock_guard<std::mutex> lock(slow->mutex);
+        slow->stalled = false;
+    }
+    slow->condition.notify_all();
+    auto hops = testObj.finish();
+
+    // Verify
+    EXPECT_EQ(3 * chunk.size(), handled);
+    EXPECT_EQ(3 * chunk.size(), fast->received.size());
+    EXPECT_LT(slow->received.size(), 3 * chunk.size());
+    ASSERT_EQ(2u, hops.size());
+    EXPECT_TRUE(hops[0].cutOff);
+    EXPECT_FALSE(hops[1].cutOff);
+}
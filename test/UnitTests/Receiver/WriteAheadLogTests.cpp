@@ -0,0 +1,197 @@
+/**
+ * @brief Unit tests for the WriteAheadLog class
+ *
+ * @file WriteAheadLogTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Receiver/WriteAheadLog.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include <filesystem>
+
+
+class WriteAheadLogTests : public testing::Test
+{
+protected: // Definitions
+    static constexpr uint64_t SEGMENT_BYTES = 1024 * 1024;
+    static constexpr std::chrono::microseconds SHORT_DELAY{1000};
+
+    using Record = std::tuple<uint64_t, uint64_t, std::string>;
+
+protected: // Methods
+    WriteAheadLogTests()
+    {
+        char directory[] = "/tmp/WriteAheadLogTests.XXXXXX";
+        mDirectory = mkdtemp(directory);
+    }
+
+    virtual ~WriteAheadLogTests()
+    {
+        std::filesystem::remove_all(mDirectory);
+    }
+
+    std::vector<Record> replay()
+    {
+        std::vector<Record> result;
+        WriteAheadLog::replay(mDirectory, [&result](uint64_t source, uint64_t offset, const char* data, size_t len)
+        {
+            result.emplace_back(source, offset, std::string(data, len));
+        });
+        return result;
+    }
+
+protected: // Members
+    std::string     mDirectory;
+};
+
+
+// Test that appended records are read back as they were written.
+TEST_F(WriteAheadLogTests, TestAppendAndReplay)
+{
+    // Setup
+    uint64_t position = 0;
+    {
+        WriteAheadLog testObj(mDirectory, SEGMENT_BYTES, SEGMENT_BYTES, SHORT_DELAY);
+
+        // Test
+        testObj.append(7, 0, "hello ", 6);
+        testObj.append(7, 6, "world", 5);
+        position = testObj.append(9, 100, "", 0);
+        testObj.waitDurable(position);
+        EXPECT_EQ(position, testObj.durable());
+    }
+
+    // Verify
+    EXPECT_EQ(3 * WriteAheadLog::HEADER_SIZE + 11, position);
+    EXPECT_EQ((std::vector<Record>{{7, 0, "hello "}, {7, 6, "world"}, {9, 100, ""}}), replay());
+}
+
+// Test that writers on several threads share commits, and that subscribers hear of each commit
+// and how far it reaches.
+TEST_F(WriteAheadLogTests, TestGroupCommit)
+{
+    // Setup
+    constexpr size_t THREADS = 4;
+    constexpr size_t RECORDS = 50;
+    WriteAheadLog testObj(mDirectory, SEGMENT_BYTES, SEGMENT_BYTES, std::chrono::milliseconds(20));
+    std::atomic<size_t> commits{0};
+    std::atomic<uint64_t> reached{0};
+    auto subscription = testObj.subscribe([&commits, &reached](uint64_t durable)
+    {
+        ++commits;
+        reached = durable;
+    });
+
+    // Test
+    std::vector<std::thread> writers;
+    for (size_t thread = 0; thread < THREADS; ++thread)
+    {
+        writers.emplace_back([&testObj, thread]()
+        {
+            uint64_t position = 0;
+            for (size_t record = 0; record < RECORDS; ++record)
+            {
+                position = testObj.append(thread, record, "data", 4);
+            }
+            testObj.waitDurable(position);
+        });
+    }
+
+    for (auto& writer : writers)
+    {
+        writer.join();
+    }
+
+    // Verify
+    auto stats = testObj.stats();
+    EXPECT_EQ(stats.commits, commits.load());
+    EXPECT_EQ(testObj.durable(), reached.load());
+    EXPECT_EQ(THREADS * RECORDS, stats.records);
+    EXPECT_LT(stats.commits, 10u);
+
+    // No more is heard once unsubscribed.
+    testObj.unsubscribe(subscription);
+    testObj.waitDurable(testObj.append(1, 0, "more", 4));
+    EXPECT_EQ(stats.commits, commits.load());
+}
+
+// Test that enough pending data starts a commit without waiting out the delay.
+TEST_F(WriteAheadLogTests, TestCommitBytesCutsDelayShort)
+{
+    // Setup
+    WriteAheadLog testObj(mDirectory, SEGMENT_BYTES, 64, std::chrono::seconds(30));
+    const std::string record(100, 'x');
+    const auto start = std::chrono::steady_clock::now();
+
+    // Test
+    testObj.waitDurable(testObj.append(1, 0, record.data(), record.size()));
+
+    // Verify
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
+// Test that a record that does not fit starts a new segment, and replay crosses segments in order.
+TEST_F(WriteAheadLogTests, TestSegmentRoll)
+{
+    // Setup
+    constexpr size_t RECORDS = 5;
+    const std::string payload(40, 'p');
+    {
+        // Room for one record per segment
+        WriteAheadLog testObj(mDirectory, WriteAheadLog::HEADER_SIZE + payload.size(), 1, SHORT_DELAY);
+
+        // Test
+        for (size_t record = 0; record < RECORDS; ++record)
+        {
+            testObj.append(1, record * payload.size(), payload.data(), payload.size());
+        }
+
+        EXPECT_EQ(RECORDS, testObj.stats().segments);
+        EXPECT_THROW(testObj.append(1, 0, payload.data(), payload.size() + 1), WriteAheadLog::Exception);
+    }
+
+    // Verify
+    auto records = replay();
+    ASSERT_EQ(RECORDS, records.size());
+    for (size_t record = 0; record < RECORDS; ++record)
+    {
+        EXPECT_EQ(record * payload.size(), std::get<1>(records[record]));
+    }
+}
+
+// Test that a reopened log continues after what is already there, and replay stops at the
+// preallocated end of a segment.
+TEST_F(WriteAheadLogTests, TestReopen)
+{
+    // Setup
+    {
+        WriteAheadLog first(mDirectory, SEGMENT_BYTES, SEGMENT_BYTES, SHORT_DELAY);
+        first.append(1, 0, "before", 6);
+    }
+
+    // Test
+    {
+        WriteAheadLog second(mDirectory, SEGMENT_BYTES, SEGMENT_BYTES, SHORT_DELAY);
+        second.append(2, 0, "after", 5);
+
+        // The open segment is still preallocated, with zeros past its one record.
+        EXPECT_EQ(2u, replay().size());
+        second.append(2, 5, "!", 1);
+    }
+
+    // Verify
+    EXPECT_EQ((std::vector<Record>{{1, 0, "before"}, {2, 0, "after"}, {2, 5, "!"}}), replay());
+}
@@ -0,0 +1,150 @@
+/**
+ * @brief Unit tests for the Batcher class
+ *
+ * @file BatcherTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Sender/Batcher.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <memory>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+using namespace std::chrono_literals;
+
+
+class BatcherTests : public testing::Test
+{
+protected: // Definitions
+    static constexpr size_t TEST_THRESHOLD = 16;
+
+protected: // Methods
+    BatcherTests() = default;
+
+    virtual ~BatcherTests() = default;
+
+    void create(std::chrono::microseconds maxDelay)
+    {
+        mTestObj = std::make_unique<Batcher>([this](const void* buffer, size_t len)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mFlushed.emplace_back(static_cast<const char*>(buffer), len);
+            mFlushedCondition.notify_all();
+        }, TEST_THRESHOLD, maxDelay);
+    }
+
+    std::vector<std::string> flushed()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mFlushed;
+    }
+
+protected: // Members
+    std::mutex                  mMutex;
+    std::condition_variable     mFlushedCondition;
+    std::vector<std::string>    mFlushed;
+    std::unique_ptr<Batcher>    mTestObj;
+};
+
+
+// Test that records are held until the threshold would be exceeded.
+TEST_F(BatcherTests, TestThreshold)
+{
+    // Setup
+    create(10s);
+
+    // Test
+    mTestObj->add("12345", 5);
+    mTestObj->add("67890", 5);
+    auto beforeThreshold = flushed();
+    mTestObj->add("abcdefgh", 8);
+
+    // Verify
+    EXPECT_TRUE(beforeThreshold.empty());
+    EXPECT_EQ(std::vector<std::string>{"1234567890"}, flushed());
+    EXPECT_EQ(1u, mTestObj->batches());
+}
+
+// Test that a record larger than the threshold is passed on by itself, after what was pending.
+TEST_F(BatcherTests, TestLargeRecord)
+{
+    // Setup
+    create(10s);
+    const std::string large(TEST_THRESHOLD * 2, 'x');
+
+    // Test
+    mTestObj->add("small", 5);
+    mTestObj->add(large.data(), large.size());
+
+    // Verify
+    EXPECT_EQ((std::vector<std::string>{"small", large}), flushed());
+}
+
+// Test that a pending record is flushed by the timer without further input.
+TEST_F(BatcherTests, TestMaxDelay)
+{
+    // Setup
+    create(1ms);
+
+    // Test
+    mTestObj->add("line\n", 5);
+
+    // Verify
+    std::unique_lock<std::mutex> lock(mMutex);
+    EXPECT_TRUE(mFlushedCondition.wait_for(lock, 5s, [this]{ return !mFlushed.empty(); }));
+    EXPECT_EQ(std::vector<std::string>{"line\n"}, mFlushed);
+}
+
+// Test that flush() passes on what is pending, and nothing if nothing is.
+TEST_F(BatcherTests, TestFlush)
+{
+    // Setup
+    create(10s);
+
+    // Test
+    mTestObj->flush();
+    mTestObj->add("abc", 3);
+    mTestObj->flush();
+
+    // Verify
+    EXPECT_EQ(std::vector<std::string>{"abc"}, flushed());
+}
+
+// Test that a failure on the timer thread is reported to the producer.
+TEST_F(BatcherTests, TestTimerFailure)
+{
+    // Setup
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool failed = false;
+
+    mTestObj = std::make_unique<Batcher>([&](const void*, size_t)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            failed = true;
+        }
+        condition.notify_all();
+        throw std::runtime_error("send failed");
+    }, TEST_THRESHOLD, 1ms);
+
+    mTestObj->add("abc", 3);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(condition.wait_for(lock, 5s, [&]{ return failed; }));
+    }
+
+    // Test & Verify
+    EXPECT_THROW(mTestObj->add("def", 3), std::runtime_error);
+}
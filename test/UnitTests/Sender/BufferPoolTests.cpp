@@ -0,0 +1,128 @@
+/**
+ * @brief Unit tests for the BufferPool class
+ *
+ * @file BufferPoolTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Sender/BufferPool.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <memory>
+#include <set>
+
+
+class BufferPoolTests : public testing::Test
+{
+protected: // Definitions
+    static constexpr size_t TEST_COUNT = 4;
+    static constexpr size_t TEST_SIZE = 10000;
+
+protected: // Methods
+    BufferPoolTests()
+    {
+        mTestObj = std::make_unique<BufferPool>(TEST_COUNT, TEST_SIZE);
+    }
+
+    virtual ~BufferPoolTests() = default;
+
+protected: // Members
+    std::unique_ptr<BufferPool>     mTestObj;
+};
+
+
+// Test that every buffer can be acquired once, and that they do not overlap.
+TEST_F(BufferPoolTests, TestAcquireAll)
+{
+    // Setup
+    std::set<char*> buffers;
+
+    // Test
+    for (size_t count = 0; count < TEST_COUNT; ++count)
+    {
+        auto index = mTestObj->tryAcquire();
+        ASSERT_TRUE(index.has_value());
+        buffers.insert(mTestObj->data(index.value()));
+    }
+
+    // Verify
+    EXPECT_FALSE(mTestObj->tryAcquire().has_value());
+    EXPECT_EQ(TEST_COUNT, buffers.size());
+    EXPECT_GE(mTestObj->bufferSize(), TEST_SIZE);
+    for (auto buffer = std::next(buffers.begin()); buffer != buffers.end(); ++buffer)
+    {
+        EXPECT_GE(static_cast<size_t>(*buffer - *std::prev(buffer)), mTestObj->bufferSize());
+    }
+}
+
+// Test that a released buffer is immediately available again.
+TEST_F(BufferPoolTests, TestRelease)
+{
+    // Setup
+    for (size_t count = 0; count < TEST_COUNT; ++count)
+    {
+        mTestObj->tryAcquire();
+    }
+
+    // Test
+    mTestObj->release(2);
+
+    // Verify
+    auto index = mTestObj->tryAcquire();
+    ASSERT_TRUE(index.has_value());
+    EXPECT_EQ(2, index.value());
+}
+
+// Test that an in-flight buffer is not handed out until its ticket completes, and that
+// buffers come back in ticket order.
+TEST_F(BufferPoolTests, TestInFlightNotReused)
+{
+    // Setup
+    for (size_t count = 0; count < TEST_COUNT; ++count)
+    {
+        mTestObj->tryAcquire();
+    }
+
+    mTestObj->releaseInFlight(1, 10);
+    mTestObj->releaseInFlight(3, 11);
+
+    // Test/Verify
+    EXPECT_EQ(2, mTestObj->inFlight());
+    EXPECT_FALSE(mTestObj->tryAcquire().has_value());
+
+    EXPECT_EQ(0, mTestObj->reclaim([](BufferPool::Ticket){ return false; }));
+    EXPECT_FALSE(mTestObj->tryAcquire().has_value());
+
+    EXPECT_EQ(1, mTestObj->reclaim([](BufferPool::Ticket ticket){ return ticket <= 10; }));
+    EXPECT_EQ(1, mTestObj->inFlight());
+
+    auto index = mTestObj->tryAcquire();
+    ASSERT_TRUE(index.has_value());
+    EXPECT_EQ(1, index.value());
+    EXPECT_FALSE(mTestObj->tryAcquire().has_value());
+}
+
+// Test that the buffers can be taken from an arena.
+TEST_F(BufferPoolTests, TestFromArena)
+{
+    // Setup
+    Common::BufferArena arena(Common::BufferArena::HUGE_PAGE_SIZE);
+
+    // Test
+    mTestObj = std::make_unique<BufferPool>(TEST_COUNT, TEST_SIZE, &arena);
+
+    // Verify
+    EXPECT_EQ(arena.size() - TEST_COUNT * mTestObj->bufferSize(), arena.available());
+    auto index = mTestObj->tryAcquire();
+    ASSERT_TRUE(index.has_value());
+    mTestObj->data(index.value())[mTestObj->bufferSize() - 1] = 'x';
+
+    mTestObj.reset();
+    EXPECT_EQ(arena.size(), arena.available());
+}
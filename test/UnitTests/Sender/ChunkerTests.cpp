@@ -0,0 +1,118 @@
+/**
+ * @brief Unit tests for the Chunker class
+ *
+ * @file ChunkerTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Sender/Chunker.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+
+class ChunkerTests : public testing::Test
+{
+protected: // Methods
+    ChunkerTests()
+    {
+        std::minstd_rand random(42);
+        mData.resize(4 * 1024 * 1024);
+        for (auto& byte : mData)
+        {
+            byte = static_cast<char>(random());
+        }
+    }
+
+    virtual ~ChunkerTests() = default;
+
+    /// The chunks of some data, as the strings they hold
+    std::vector<std::string> chunks(const std::vector<char>& data) const
+    {
+        std::vector<std::string> result;
+        for (size_t offset = 0; offset < data.size(); )
+        {
+            auto len = mTestObj.cut(data.data() + offset, data.size() - offset);
+            result.emplace_back(data.data() + offset, len);
+            offset += len;
+        }
+        return result;
+    }
+
+protected: // Members
+    Chunker             mTestObj;
+    std::vector<char>   mData;
+};
+
+
+// Test that chunks stay within their bounds and gather around the average size.
+TEST_F(ChunkerTests, TestChunkSizes)
+{
+    // Test
+    auto result = chunks(mData);
+
+    // Verify
+    size_t total = 0;
+    for (size_t index = 0; index < result.size(); ++index)
+    {
+        const auto len = result[index].size();
+        if (index + 1 < result.size())
+        {
+            EXPECT_GE(len, Chunker::MIN_SIZE);
+        }
+        EXPECT_LE(len, Chunker::MAX_SIZE);
+        total += len;
+    }
+
+    EXPECT_EQ(mData.size(), total);
+
+    const auto average = total / result.size();
+    EXPECT_GE(average, Chunker::AVERAGE_SIZE / 2);
+    EXPECT_LE(average, Chunker::AVERAGE_SIZE * 2);
+
+    // Short data is one chunk, and uniform data is cut at the largest size.
+    EXPECT_EQ(100u, mTestObj.cut(mData.data(), 100));
+    const std::vector<char> zeros(3 * Chunker::MAX_SIZE, '\0');
+    EXPECT_EQ(Chunker::MAX_SIZE, mTestObj.cut(zeros.data(), zeros.size()));
+}
+
+// Test that an insertion changes only the chunks around it, not every chunk after it.
+TEST_F(ChunkerTests, TestBoundariesFollowContent)
+{
+    // Setup
+    auto edited = mData;
+    const std::string inserted = "a few bytes that were not there before";
+    edited.insert(edited.begin() + 100000, inserted.begin(), inserted.end());
+
+    // Test
+    auto before = chunks(mData);
+    auto after = chunks(edited);
+
+    // Verify
+    std::set<std::string> original(before.begin(), before.end());
+    size_t changed = 0;
+    for (const auto& chunk : after)
+    {
+        changed += original.count(chunk) ? 0 : 1;
+    }
+
+    EXPECT_LE(changed, 3u);
+}
+
+// Test that impossible sizes are refused.
+TEST_F(ChunkerTests, TestInvalidSizes)
+{
+    EXPECT_THROW(Chunker(8192, 4096, 65536), Chunker::Exception);
+    EXPECT_THROW(Chunker(2048, 8192, 4096), Chunker::Exception);
+    EXPECT_THROW(Chunker(2048, 6000, 65536), Chunker::Exception);
+    EXPECT_NO_THROW(Chunker(64, 256, 1024));
+}
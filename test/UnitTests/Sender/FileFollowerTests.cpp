@@ -0,0 +1,223 @@
+/**
+ * @brief Unit tests for the FileFollower class
+ *
+ * @file FileFollowerTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Sender/FileFollower.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <memory>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <filesystem>
+
+using namespace std::chrono_literals;
+
+
+class FileFollowerTests : public testing::Test
+{
+protected: // Methods
+    FileFollowerTests()
+    {
+        char directory[] = "/tmp/FileFollowerTests.XXXXXX";
+        mDirectory = mkdtemp(directory);
+    }
+
+    virtual ~FileFollowerTests()
+    {
+        stop();
+        std::filesystem::remove_all(mDirectory);
+    }
+
+    std::string path(const std::string& name) const
+    {
+        return mDirectory + "/" + name;
+    }
+
+    /// Append to a file through a descriptor of its own, as a writer would
+    void append(const std::string& file, const std::string& data)
+    {
+        auto fd = ::open(file.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        ASSERT_GE(fd, 0);
+        ASSERT_EQ(static_cast<ssize_t>(data.size()), write(fd, data.data(), data.size()));
+        close(fd);
+    }
+
+    void start(const std::vector<std::string>& paths, bool fromStart = false)
+    {
+        mTestObj = std::make_unique<FileFollower>(paths, fromStart);
+        mOutput.resize(paths.size());
+
+        mThread = std::thread([this]()
+        {
+            mTestObj->run([this](size_t file, const char* data, size_t len)
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+
+                // Only ever whole lines
+                EXPECT_GT(len, 0u);
+                EXPECT_EQ('\n', data[len - 1]);
+
+                mOutput[file].append(data, len);
+                mChanged.notify_all();
+            });
+        });
+    }
+
+    void stop()
+    {
+        if (mThread.joinable())
+        {
+            mTestObj->stop();
+            mThread.join();
+        }
+    }
+
+    /// Wait until a file's output is as expected, then report what it is
+    std::string waitFor(size_t file, const std::string& expected)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mChanged.wait_for(lock, 5s, [&]() { return mOutput[file] == expected; });
+        return mOutput[file];
+    }
+
+protected: // Members
+    std::string                     mDirectory;
+    std::unique_ptr<FileFollower>   mTestObj;
+    std::thread                     mThread;
+    std::mutex                      mMutex;
+    std::condition_variable         mChanged;
+    std::vector<std::string>        mOutput;    ///< By file
+};
+
+
+// Test that only appends are passed on, a whole line at a time.
+TEST_F(FileFollowerTests, TestAppendsPassedOnAsWholeLines)
+{
+    // Setup
+    const auto file = path("app.log");
+    append(file, "before\n");
+    start({file});
+
+    // Test
+    append(file, "one\ntw");
+    EXPECT_EQ("one\n", waitFor(0, "one\n"));
+    append(file, "o\n");
+
+    // Verify
+    EXPECT_EQ("one\ntwo\n", waitFor(0, "one\ntwo\n"));
+}
+
+// Test that a file truncated in place is read again from its start.
+TEST_F(FileFollowerTests, TestTruncation)
+{
+    // Setup
+    const auto file = path("app.log");
+    append(file, "first line\nsecond line\n");
+    start({file}, true);
+    ASSERT_EQ("first line\nsecond line\n", waitFor(0, "first line\nsecond line\n"));
+
+    // Test
+    ASSERT_EQ(0, truncate(file.c_str(), 0));
+    append(file, "third\n");
+
+    // Verify
+    EXPECT_EQ("first line\nsecond line\nthird\n", waitFor(0, "first line\nsecond line\nthird\n"));
+    stop();
+    EXPECT_EQ(1u, mTestObj->stats().truncations);
+}
+
+// Test that a file renamed away is followed at its path anew, and that what its writer adds to
+// the old file meanwhile comes first.
+TEST_F(FileFollowerTests, TestRenameRotation)
+{
+    // Setup
+    const auto file = path("app.log");
+    append(file, "a\n");
+    start({file}, true);
+    ASSERT_EQ("a\n", waitFor(0, "a\n"));
+
+    // Test
+    ASSERT_EQ(0, rename(file.c_str(), path("app.log.1").c_str()));
+    append(file, "");
+    append(path("app.log.1"), "b\n");
+    append(file, "c\n");
+
+    // Verify
+    EXPECT_EQ("a\nb\nc\n", waitFor(0, "a\nb\nc\n"));
+    append(file, "d\n");
+    EXPECT_EQ("a\nb\nc\nd\n", waitFor(0, "a\nb\nc\nd\n"));
+    stop();
+    EXPECT_EQ(1u, mTestObj->stats().rotations);
+}
+
+// Test that a file that does not exist yet is followed once it appears.
+TEST_F(FileFollowerTests, TestFileCreatedLater)
+{
+    // Setup
+    const auto file = path("later.log");
+    start({file});
+
+    // Test
+    append(file, "hello\n");
+
+    // Verify
+    EXPECT_EQ("hello\n", waitFor(0, "hello\n"));
+}
+
+// Test that stopping passes on a line still in progress.
+TEST_F(FileFollowerTests, TestStopCompletesPartialLine)
+{
+    // Setup
+    const auto file = path("app.log");
+    append(file, "");
+    start({file});
+    append(file, "whole\npartial");
+    ASSERT_EQ("whole\n", waitFor(0, "whole\n"));
+
+    // Test
+    stop();
+
+    // Verify
+    EXPECT_EQ("whole\npartial\n", mOutput[0]);
+    EXPECT_EQ(14u, mTestObj->stats().bytes);
+}
+
+// Test that many files are followed at once, each to its own output.
+TEST_F(FileFollowerTests, TestManyFiles)
+{
+    // Setup
+    constexpr size_t FILES = 500;
+    std::vector<std::string> files;
+    for (size_t index = 0; index < FILES; ++index)
+    {
+        files.push_back(path("file" + std::to_string(index) + ".log"));
+        append(files.back(), "");
+    }
+    start(files);
+
+    // Test
+    for (size_t index = 0; index < FILES; ++index)
+    {
+        append(files[index], "line " + std::to_string(index) + "\n");
+    }
+
+    // Verify
+    for (size_t index = 0; index < FILES; ++index)
+    {
+        const auto expected = "line " + std::to_string(index) + "\n";
+        EXPECT_EQ(expected, waitFor(index, expected));
+    }
+}
@@ -0,0 +1,201 @@
+/**
+ * @brief Unit tests for the ReceiverSet class
+ *
+ * @file ReceiverSetTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Mocks
+#include "Common/Mocks/SocketMock.h"
+
+// Code under test
+#include "Sender/ReceiverSet.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+
+class ReceiverSetTests : public testing::Test
+{
+protected: // Definitions
+    static constexpr const char* TEST_IP = "127.0.0.1";
+    static constexpr uint16_t TEST_PORT = 20000;
+    static constexpr size_t TEST_KEYS = 10000;
+
+protected: // Methods
+    ReceiverSetTests() = default;
+
+    virtual ~ReceiverSetTests() = default;
+
+    static std::vector<ReceiverSet::Member> members(const std::vector<unsigned>& weights)
+    {
+        std::vector<ReceiverSet::Member> result;
+        for (size_t index = 0; index < weights.size(); ++index)
+        {
+            result.push_back(ReceiverSet::Member{
+                Common::Endpoint{TEST_IP, static_cast<uint16_t>(TEST_PORT + index)}, weights[index]});
+        }
+        return result;
+    }
+
+    /// Connections to ports in mDown fail; others succeed with a mock socket.
+    ReceiverSet::Connect connect()
+    {
+        return [this](const Common::Endpoint& endpoint)
+        {
+            mConnects.push_back(endpoint.port);
+            if (mDown.count(endpoint.port))
+            {
+                throw Sender::Exception("unreachable");
+            }
+
+            mSocketMockVendor.queueMock(std::make_shared<testing::NiceMock<Common::SocketMock>>());
+            return std::make_unique<Sender>(endpoint.addr, endpoint.port);
+        };
+    }
+
+protected: // Members
+    MockVendor<Common::SocketMock, Common::Socket>  mSocketMockVendor;
+    std::set<uint16_t>                              mDown;
+    std::vector<uint16_t>                           mConnects;
+};
+
+
+// Test that a key always ranks the receivers the same way, and ranks all of them.
+TEST_F(ReceiverSetTests, TestRankIsStable)
+{
+    // Setup
+    ReceiverSet testObj{members({1, 1, 1, 1}), 4, connect()};
+
+    // Test
+    auto first = testObj.rank("app.log");
+    auto second = testObj.rank("app.log");
+
+    // Verify
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(4u, std::set<size_t>(first.begin(), first.end()).size());
+}
+
+// Test that keys are shared in proportion to weight.
+TEST_F(ReceiverSetTests, TestWeightedShares)
+{
+    // Setup
+    ReceiverSet testObj{members({1, 1, 2}), 4, connect()};
+    std::vector<size_t> counts(3);
+
+    // Test
+    for (size_t key = 0; key < TEST_KEYS; ++key)
+    {
+        ++counts[testObj.rank("key-" + std::to_string(key)).front()];
+    }
+
+    // Verify
+    EXPECT_NEAR(0.25, static_cast<double>(counts[0]) / TEST_KEYS, 0.03);
+    EXPECT_NEAR(0.25, static_cast<double>(counts[1]) / TEST_KEYS, 0.03);
+    EXPECT_NEAR(0.50, static_cast<double>(counts[2]) / TEST_KEYS, 0.03);
+}
+
+// Test that adding a receiver only moves keys onto it, and about its share of them.
+TEST_F(ReceiverSetTests, TestAddingReceiverMovesFewKeys)
+{
+    // Setup
+    ReceiverSet before{members({1, 1, 1, 1}), 4, connect()};
+    ReceiverSet after{members({1, 1, 1, 1, 1}), 4, connect()};
+    size_t moved = 0;
+
+    // Test
+    for (size_t key = 0; key < TEST_KEYS; ++key)
+    {
+        auto name = "key-" + std::to_string(key);
+        auto was = before.rank(name).front();
+        auto now = after.rank(name).front();
+        if (was != now)
+        {
+            ++moved;
+            EXPECT_EQ(4u, now);
+        }
+    }
+
+    // Verify
+    EXPECT_NEAR(0.2, static_cast<double>(moved) / TEST_KEYS, 0.03);
+}
+
+// Test that a key whose receiver cannot be reached goes to its next-ranked receiver.
+TEST_F(ReceiverSetTests, TestFailover)
+{
+    // Setup
+    ReceiverSet testObj{members({1, 1, 1}), 4, connect()};
+    auto order = testObj.rank("app.log");
+    mDown.insert(static_cast<uint16_t>(TEST_PORT + order[0]));
+
+    // Test
+    testObj.sender("app.log");
+    testObj.sender("app.log");
+
+    // Verify
+    EXPECT_FALSE(testObj.isUp(order[0]));
+    EXPECT_TRUE(testObj.isUp(order[1]));
+    // The receiver that is down is not tried again before its retry delay.
+    EXPECT_EQ((std::vector<uint16_t>{static_cast<uint16_t>(TEST_PORT + order[0]),
+                                     static_cast<uint16_t>(TEST_PORT + order[1])}), mConnects);
+    EXPECT_EQ(1u, testObj.openConnections());
+}
+
+// Test that reporting a failure moves the key on, and that nothing reachable is an error.
+TEST_F(ReceiverSetTests, TestFailedAndNoneReachable)
+{
+    // Setup
+    ReceiverSet testObj{members({1, 1}), 4, connect()};
+    auto order = testObj.rank("app.log");
+
+    // Test
+    testObj.sender("app.log");
+    testObj.failed("app.log");
+    mDown.insert(static_cast<uint16_t>(TEST_PORT + order[1]));
+
+    // Verify
+    EXPECT_FALSE(testObj.isUp(order[0]));
+    EXPECT_EQ(0u, testObj.openConnections());
+    EXPECT_THROW(testObj.sender("app.log"), ReceiverSet::Exception);
+}
+
+// Test that no more than the limit of connections is held, dropping the least recently used.
+TEST_F(ReceiverSetTests, TestConnectionLimit)
+{
+    // Setup
+    ReceiverSet testObj{members({1, 1, 1, 1}), 2, connect()};
+
+    // Find keys that land on three different receivers.
+    std::vector<std::string> keys;
+    std::set<size_t> used;
+    for (size_t key = 0; keys.size() < 3; ++key)
+    {
+        auto name = "key-" + std::to_string(key);
+        if (used.insert(testObj.rank(name).front()).second)
+        {
+            keys.push_back(name);
+        }
+    }
+
+    // Test
+    testObj.sender(keys[0]);
+    testObj.sender(keys[1]);
+    testObj.sender(keys[0]);
+    testObj.sender(keys[2]);    // Closes keys[1]'s connection, the least recently used
+    testObj.sender(keys[0]);
+    auto connectsBefore = mConnects.size();
+    testObj.sender(keys[1]);
+
+    // Verify
+    EXPECT_EQ(2u, testObj.openConnections());
+    EXPECT_EQ(3u, connectsBefore);
+    EXPECT_EQ(4u, mConnects.size());
+}
@@ -0,0 +1,201 @@
+/**
+ * @brief Unit tests for the RecordSieve class
+ *
+ * @file RecordSieveTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Sender/RecordSieve.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+
+class RecordSieveTests : public testing::Test
+{
+protected: // Methods
+    RecordSieveTests() = default;
+    virtual ~RecordSieveTests() = default;
+
+    static std::shared_ptr<const Common::RecordFilter> filter(const std::string& spec)
+    {
+        return std::make_shared<const Common::RecordFilter>(spec);
+    }
+
+    /// Everything read() gives for 'input', handed over in pieces of at most 'chunk' bytes
+    static std::string readAll(RecordSieve& sieve, const std::string& input, size_t chunk, size_t outLen = 4096)
+    {
+        size_t offered = 0;
+        const RecordSieve::Source source = [&](char* buffer, size_t len)
+        {
+            auto count = std::min({len, chunk, input.size() - offered});
+            std::memcpy(buffer, input.data() + offered, count);
+            offered += count;
+            return count;
+        };
+
+        std::string output;
+        std::vector<char> out(outLen);
+        while (!sieve.ended())
+        {
+            auto len = sieve.read(source, out.data(), out.size());
+            output.append(out.data(), len);
+        }
+
+        return output;
+    }
+
+    /// The lines of 'input' that contain 'text', the last whole even without a newline
+    static std::string expectedLines(const std::string& input, const std::string& text)
+    {
+        std::string expected;
+        size_t start = 0;
+        while (start < input.size())
+        {
+            auto end = input.find('\n', start);
+            end = (end == std::string::npos) ? input.size() : end + 1;
+            auto line = input.substr(start, end - start);
+            if (line.find(text) != std::string::npos)
+            {
+                expected += line;
+            }
+            start = end;
+        }
+
+        return expected;
+    }
+};
+
+
+// Test that records come out whole and in order however the input arrives, and that what is
+// left out is counted.
+TEST_F(RecordSieveTests, TestReadKeepsWholeRecords)
+{
+    // Setup
+    std::minstd_rand random(42);
+    std::string input;
+    for (int count = 0; count < 5000; ++count)
+    {
+        input += "record " + std::to_string(count) + ((random() % 7 == 0) ? " ERROR" : " INFO")
+            + std::string(random() % 50, '.') + "\n";
+    }
+    input += "last ERROR, without a newline";
+
+    const auto expected = expectedLines(input, "ERROR");
+
+    for (size_t chunk : {size_t{1}, size_t{7}, size_t{4096}, input.size()})
+    {
+        for (size_t outLen : {size_t{3}, size_t{4096}})
+        {
+            RecordSieve sieve{{filter("contains:ERROR")}, 1.0, 1};
+
+            // Test
+            auto output = readAll(sieve, input, chunk, outLen);
+
+            // Verify
+            EXPECT_EQ(expected, output) << "chunk " << chunk << ", out " << outLen;
+            EXPECT_EQ(input.size() - expected.size(), sieve.bytesDropped());
+        }
+    }
+}
+
+// Test that a record longer than the sieve's buffer is judged rather than stalling it, and that
+// filters without a literal to seek with still apply.
+TEST_F(RecordSieveTests, TestLongRecordsAndUnseekableFilters)
+{
+    // Setup
+    const std::string longRecord = std::string(RecordSieve::BUFFER_SIZE + 100, 'x') + "\n";
+    const std::string input = "a 1\n" + longRecord + "b 22\nc 333\n";
+
+    RecordSieve sieve{{filter("!contains:b"), filter("regex:^[a-z] \\d+$")}, 1.0, 1};
+
+    // Test
+    auto output = readAll(sieve, input, 64 * 1024);
+
+    // Verify: the long record fails on its first piece, and goes with it
+    EXPECT_EQ("a 1\nc 333\n", output);
+    EXPECT_EQ(input.size() - output.size(), sieve.bytesDropped());
+
+    // Every record passes nothing; empty input ends at once.
+    RecordSieve none{{filter("contains:zzz")}, 1.0, 1};
+    EXPECT_EQ("", readAll(none, input, 1000));
+    RecordSieve empty{{filter("contains:a")}, 1.0, 1};
+    EXPECT_EQ("", readAll(empty, "", 1000));
+}
+
+// Test that a record longer than the buffer is kept or left out whole, as its first piece decides,
+// and that the records after it are judged as usual.
+TEST_F(RecordSieveTests, TestLongRecordsGoWhole)
+{
+    // Setup: one long record that passes only on its first piece, and one only on its last
+    const std::string passesFirst = "ERROR " + std::string(RecordSieve::BUFFER_SIZE * 2, 'x') + " INFO\n";
+    const std::string passesLast = "INFO " + std::string(RecordSieve::BUFFER_SIZE + 10, 'x') + " ERROR\n";
+    const std::string input = "a ERROR\n" + passesFirst + "b INFO\n" + passesLast + "c ERROR\nd ERROR";
+    const std::string expected = "a ERROR\n" + passesFirst + "c ERROR\nd ERROR";
+
+    for (size_t chunk : {size_t{1000}, size_t{64 * 1024}, input.size()})
+    {
+        RecordSieve sieve{{filter("contains:ERROR")}, 1.0, 1};
+
+        // Test
+        auto output = readAll(sieve, input, chunk, 64 * 1024);
+
+        // Verify
+        EXPECT_EQ(expected.size(), output.size()) << "chunk " << chunk;
+        EXPECT_TRUE(expected == output) << "chunk " << chunk;
+        EXPECT_EQ(input.size() - expected.size(), sieve.bytesDropped());
+    }
+
+    // A long record cut off by the end of the input
+    RecordSieve sieve{{filter("contains:ERROR")}, 1.0, 1};
+    const std::string cutOff = "ERROR " + std::string(RecordSieve::BUFFER_SIZE, 'x');
+    EXPECT_TRUE(cutOff == readAll(sieve, "a INFO\n" + cutOff, 4096));
+}
+
+// Test that sampling keeps close to its rate of the records that pass, spread over the input,
+// and that select() hands over runs of kept records in one piece.
+TEST_F(RecordSieveTests, TestSamplingAndSpans)
+{
+    // Setup
+    std::string input;
+    for (int count = 0; count < 20000; ++count)
+    {
+        input += ((count % 2) ? "odd " : "even ") + std::to_string(count) + "\n";
+    }
+
+    // Test: a quarter of the odd records, from the filter's rate and the sieve's together
+    RecordSieve sieve{{filter("contains:odd\nsample:0.5"), nullptr}, 0.5, 7};
+
+    size_t kept = 0;
+    size_t firstHalf = 0;
+    sieve.select(input.data(), input.size(), [&](const char* data, size_t len)
+    {
+        for (auto line = data; line < data + len; line = static_cast<const char*>(std::memchr(line, '\n', data + len - line)) + 1)
+        {
+            EXPECT_EQ(0, std::strncmp(line, "odd ", 4));
+            ++kept;
+            firstHalf += (static_cast<size_t>(line - input.data()) < input.size() / 2) ? 1 : 0;
+        }
+    });
+
+    // Verify (well within chance: the standard deviation is about 60)
+    EXPECT_NEAR(2500.0, static_cast<double>(kept), 300.0);
+    EXPECT_NEAR(static_cast<double>(kept) / 2, static_cast<double>(firstHalf), 300.0);
+
+    // Adjacent kept records go out together.
+    RecordSieve all{{filter("contains:e")}, 1.0, 1};
+    std::vector<std::string> spans;
+    all.select("one\ntwo\nthree\nfour\nfive", 23, [&](const char* data, size_t len){ spans.emplace_back(data, len); });
+    EXPECT_EQ((std::vector<std::string>{"one\n", "three\n", "five"}), spans);
+}
@@ -0,0 +1,302 @@
+/**
+ * @brief Unit tests for the Replay class, against receivers capturing on loopback
+ *
+ * @file ReplayTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Sender/Replay.cpp"
+#include "Sender/Sender.h"
+#include "Receiver/Receiver.h"
+#include "Common/CommonData.h"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+using namespace std::chrono_literals;
+
+
+class ReplayTests : public testing::Test
+{
+protected: // Definitions
+    static constexpr const char* TEST_IP = "127.0.0.1";
+
+    /// A receiver on its own thread, capturing what it is sent if given a path, and with a handler
+    /// made for each stream if asked to
+    class Running
+    {
+    public:
+        Running(uint16_t port, const std::string& capturePath = "", bool streamHandlers = false)
+            : mReceiver(config(capturePath))
+        {
+            if (streamHandlers)
+            {
+                mReceiver.setStreamHandlers([this](uint16_t, const std::string&) -> Receiver::Handler
+                {
+                    return [this](const void*, size_t len) { mReceived += len; };
+                });
+            }
+
+            mThread = std::thread([this, port]()
+            {
+                EXPECT_NO_THROW(mReceiver.execute(TEST_IP, port, [this](const void*, size_t len)
+                {
+                    mReceived += len;
+                }));
+            });
+            std::this_thread::sleep_for(200ms);
+        }
+
+        ~Running()
+        {
+            stop();
+        }
+
+        /// Wait for 'bytes' to arrive, then stop the receiver
+        void stop(uint64_t bytes = 0)
+        {
+            for (auto waited = 0ms; mReceived < bytes && waited < 10s; waited += 10ms)
+            {
+                std::this_thread::sleep_for(10ms);
+            }
+
+            if (mThread.joinable())
+            {
+                mReceiver.stop();
+                mThread.join();
+            }
+        }
+
+        uint64_t received() const { return mReceived; }
+
+        const Receiver::ShutdownReport& report() const { return mReceiver.shutdownReport(); }
+
+    private:
+        static Receiver::Config config(const std::string& capturePath)
+        {
+            Receiver::Config result;
+            result.capturePath = capturePath;
+            return result;
+        }
+
+        Receiver                mReceiver;
+        std::thread             mThread;
+        std::atomic<uint64_t>   mReceived{0};
+    };
+
+protected: // Methods
+    ReplayTests()
+    {
+        mFirst = temporary();
+        mSecond = temporary();
+    }
+
+    virtual ~ReplayTests()
+    {
+        unlink(mFirst.c_str());
+        unlink(mSecond.c_str());
+    }
+
+    static std::string temporary()
+    {
+        char path[] = "/tmp/ReplayTests.XXXXXX";
+        auto fd = mkstemp(path);
+        ::close(fd);
+        return path;
+    }
+
+    /// The data of each connection in a capture, in the order the connections were opened
+    static std::vector<std::string> streams(const std::string& path)
+    {
+        std::map<uint32_t, std::string> byConnection;
+
+        Common::TrafficCapture::Reader reader(path);
+        while (auto record = reader.next())
+        {
+            byConnection[record->connection].append(record->data, record->len);
+        }
+
+        std::vector<std::string> result;
+        for (auto& [connection, data] : byConnection)
+        {
+            result.push_back(data);
+        }
+        return result;
+    }
+
+protected: // Members
+    std::string     mFirst;
+    std::string     mSecond;
+};
+
+
+// Test that what one receiver captured reaches another, connection for connection, when replayed.
+TEST_F(ReplayTests, TestCaptureAndReplay)
+{
+    // Setup: two connections, interleaved, captured by a receiver.
+    uint64_t sent = 0;
+    {
+        Running capturing(SERVER_PORT + 401, mFirst);
+
+        Common::Socket first(TEST_IP, SERVER_PORT + 401);
+        first.connect();
+        Common::Socket second(TEST_IP, SERVER_PORT + 401);
+        second.connect();
+
+        for (int line = 0; line < 100; ++line)
+        {
+            auto& socket = line % 3 ? first : second;
+            const auto text = (line % 3 ? "first " : "second ") + std::to_string(line) + "\n";
+            socket.send(text.data(), text.size());
+            sent += text.size();
+        }
+
+        capturing.stop(sent);
+        EXPECT_EQ(2u, capturing.report().captured.connections);
+        EXPECT_EQ(sent, capturing.report().captured.bytes);
+    }
+
+    // Test
+    Running replayed(SERVER_PORT + 402, mSecond);
+
+    Replay::Config config;
+    config.target = Common::Endpoint{TEST_IP, SERVER_PORT + 402};
+    config.speed = 0;
+    auto report = Replay(config).run(mFirst);
+
+    replayed.stop(sent);
+
+    // Verify
+    EXPECT_EQ(2u, report.connections);
+    EXPECT_EQ(sent, report.bytes);
+    EXPECT_EQ(sent, replayed.received());
+
+    // The receivers may number the connections differently, so compare them as a set.
+    auto original = streams(mFirst);
+    auto copy = streams(mSecond);
+    std::sort(original.begin(), original.end());
+    std::sort(copy.begin(), copy.end());
+    ASSERT_EQ(2u, original.size());
+    EXPECT_EQ(original, copy);
+}
+
+// Test that each stream of a framed connection is captured as a connection of its own, whole
+// rather than interleaved with the others, whether or not the receiver makes a handler per stream.
+TEST_F(ReplayTests, TestCaptureFramedStreams)
+{
+    // Setup: two inputs, each large enough to be sent in several interleaved frames
+    std::vector<std::string> inputs{"", ""};
+    for (int line = 0; line < 20000; ++line)
+    {
+        inputs[0] += "first " + std::to_string(line) + "\n";
+        inputs[1] += "second " + std::to_string(line) + "\n";
+    }
+    const uint64_t total = inputs[0].size() + inputs[1].size();
+
+    std::vector<int> fds;
+    std::vector<Sender::StreamSource> sources;
+    for (const auto& input : inputs)
+    {
+        auto fd = memfd_create("input", MFD_CLOEXEC);
+        ASSERT_EQ(static_cast<ssize_t>(input.size()), write(fd, input.data(), input.size()));
+        fds.push_back(fd);
+    }
+
+    for (bool streamHandlers : {false, true})
+    {
+        const uint16_t port = SERVER_PORT + (streamHandlers ? 405 : 404);
+        sources.clear();
+        for (auto fd : fds)
+        {
+            lseek(fd, 0, SEEK_SET);
+            sources.push_back({fd, "input", Sender::StreamSettings{}});
+        }
+
+        // Test
+        {
+            Running capturing(port, mFirst, streamHandlers);
+
+            Sender sender(TEST_IP, port);
+            sender.connect();
+            EXPECT_EQ(total, sender.sendStreams(sources));
+
+            capturing.stop(total);
+            EXPECT_EQ(total, capturing.received());
+            EXPECT_EQ(2u, capturing.report().captured.connections);
+            EXPECT_EQ(total, capturing.report().captured.bytes);
+        }
+
+        // Verify
+        auto captured = streams(mFirst);
+        std::sort(captured.begin(), captured.end());
+        ASSERT_EQ(2u, captured.size()) << "stream handlers " << streamHandlers;
+        EXPECT_TRUE(inputs == captured) << "stream handlers " << streamHandlers;
+    }
+
+    for (auto fd : fds)
+    {
+        close(fd);
+    }
+}
+
+// Test that a replay keeps the captured timing at speed 1, and compresses it faster.
+TEST_F(ReplayTests, TestReplaySpeed)
+{
+    // Setup: records 100ms apart, on one connection.
+    {
+        Common::TrafficCapture capture(mFirst);
+        auto connection = capture.open();
+        for (int record = 0; record < 4; ++record)
+        {
+            if (record > 0)
+            {
+                std::this_thread::sleep_for(100ms);
+            }
+            capture.append(connection, "record\n", 7);
+        }
+        capture.close(connection);
+    }
+
+    Running receiving(SERVER_PORT + 403);
+
+    auto replay = [&](double speed)
+    {
+        Replay::Config config;
+        config.target = Common::Endpoint{TEST_IP, SERVER_PORT + 403};
+        config.speed = speed;
+        return Replay(config).run(mFirst);
+    };
+
+    // Test
+    auto original = replay(1.0);
+    auto faster = replay(3.0);
+    auto fastest = replay(0);
+
+    receiving.stop(3 * 28);
+
+    // Verify
+    EXPECT_GE(original.captured, 300ms);
+    EXPECT_EQ(4u, original.records);
+    EXPECT_EQ(1u, original.connections);
+    EXPECT_GE(original.elapsed, original.captured * 0.95);
+
+    EXPECT_LT(faster.elapsed, original.elapsed * 0.6);
+    EXPECT_GE(faster.elapsed, faster.captured / 3 * 0.95);
+
+    EXPECT_LT(fastest.elapsed, 100ms);
+    EXPECT_EQ(3u * 28, receiving.received());
+}
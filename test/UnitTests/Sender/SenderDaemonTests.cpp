@@ -0,0 +1,184 @@
+/**
+ * @brief Unit tests for the SenderDaemon class
+ *
+ * @file SenderDaemonTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Mocks
+#include "Common/Mocks/SocketMock.h"
+
+// Code under test
+#include "Sender/SenderDaemon.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// System headers
+#include <unistd.h>
+
+// Standard headers
+#include <memory>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+
+using namespace std::chrono_literals;
+
+using testing::_;
+using testing::Return;
+
+
+class SenderDaemonTests : public testing::Test
+{
+protected: // Definitions
+    static constexpr const char* TEST_IP = "123.210.012.3";
+    static constexpr uint16_t TEST_PORT = 12345;
+
+protected: // Methods
+    SenderDaemonTests()
+        : mPath("/tmp/SenderDaemonTests." + std::to_string(getpid()) + ".sock")
+    {
+        ON_CALL(*mSocketMock, connectAsync()).WillByDefault(Return(true));
+        ON_CALL(*mSocketMock, isConnected()).WillByDefault(Return(true));
+        mSocketMockVendor.queueMock(mSocketMock);
+
+        mTestObj = std::make_unique<SenderDaemon>(mPath, std::vector<Common::Endpoint>{{TEST_IP, TEST_PORT}});
+        mThread = std::thread([this]{ mTestObj->execute(); });
+    }
+
+    virtual ~SenderDaemonTests()
+    {
+        mTestObj->stop();
+        mThread.join();
+    }
+
+    /// Connect a client, waiting for the daemon to start listening
+    std::unique_ptr<SenderDaemon::Client> connectClient()
+    {
+        for (int attempt = 0; attempt < 100; ++attempt)
+        {
+            try
+            {
+                return std::make_unique<SenderDaemon::Client>(mPath);
+            }
+            catch (const Common::Socket::Exception&)
+            {
+                std::this_thread::sleep_for(10ms);
+            }
+        }
+
+        return nullptr;
+    }
+
+    /// Read what is left of a descriptor
+    static std::string drain(int fd)
+    {
+        std::string result;
+        char buffer[256];
+        ssize_t len;
+        while ((len = read(fd, buffer, sizeof(buffer))) > 0)
+        {
+            result.append(buffer, static_cast<size_t>(len));
+        }
+
+        return result;
+    }
+
+protected: // Members
+    std::string                             mPath;
+    Common::SocketMockVendor                mSocketMockVendor;
+    std::shared_ptr<Common::SocketMock>     mSocketMock{ std::make_shared<testing::NiceMock<Common::SocketMock>>() };
+    std::unique_ptr<SenderDaemon>           mTestObj;
+    std::thread                             mThread;
+};
+
+
+// Test that a regular file is handed over by descriptor and sent without copying.
+TEST_F(SenderDaemonTests, TestSubmitFile)
+{
+    // Setup
+    const std::string content = "first line\nsecond line\n";
+
+    FILE* file = std::tmpfile();
+    ASSERT_NE(nullptr, file);
+    std::fputs(content.c_str(), file);
+    std::fflush(file);
+
+    std::string sent;
+    EXPECT_CALL(*mSocketMock, sendFile(_, 0, content.size()))
+        .WillOnce([&sent](int fd, off_t offset, size_t count)
+        {
+            // The daemon's descriptor shares the file, so read it from the start.
+            lseek(fd, offset, SEEK_SET);
+            sent = drain(fd);
+            return sent.size();
+        });
+
+    auto client = connectClient();
+    ASSERT_NE(nullptr, client);
+
+    // Test
+    auto bytes = client->submit(fileno(file));
+
+    // Verify
+    EXPECT_EQ(content.size(), bytes);
+    EXPECT_EQ(content, sent);
+
+    std::fclose(file);
+}
+
+// Test that a pipe (e.g. stdin) is read by the daemon and sent.
+TEST_F(SenderDaemonTests, TestSubmitPipe)
+{
+    // Setup
+    const std::string content = "streamed input\n";
+
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    ASSERT_EQ(static_cast<ssize_t>(content.size()), write(fds[1], content.data(), content.size()));
+    close(fds[1]);
+
+    std::string sent;
+    EXPECT_CALL(*mSocketMock, send(_, _))
+        .WillRepeatedly([&sent](const void* buffer, size_t len)
+        {
+            sent.append(static_cast<const char*>(buffer), len);
+        });
+
+    auto client = connectClient();
+    ASSERT_NE(nullptr, client);
+
+    // Test
+    auto bytes = client->submit(fds[0]);
+
+    // Verify
+    EXPECT_EQ(content.size(), bytes);
+    EXPECT_EQ(content, sent);
+
+    close(fds[0]);
+}
+
+// Test that a failure to send is reported to the client rather than ending the daemon.
+TEST_F(SenderDaemonTests, TestSubmitFailure)
+{
+    // Setup
+    FILE* file = std::tmpfile();
+    ASSERT_NE(nullptr, file);
+    std::fputs("data\n", file);
+    std::fflush(file);
+
+    EXPECT_CALL(*mSocketMock, sendFile(_, _, _))
+        .WillOnce([](int, off_t, size_t) -> size_t { throw Common::Socket::Exception(TEST_IP, "Broken"); });
+
+    auto client = connectClient();
+    ASSERT_NE(nullptr, client);
+
+    // Test/Verify
+    EXPECT_THROW(client->submit(fileno(file)), Sender::Exception);
+
+    std::fclose(file);
+}
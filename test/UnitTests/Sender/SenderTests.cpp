@@ -18,6 +18,11 @@
 
 // Standard headers
 #include <memory>
+#include <set>
+#include <random>
+#include <sstream>
+#include <sys/mman.h>
+#include <poll.h>
 
 using testing::_;
 using testing::Return;
@@ -51,15 +56,29 @@ protected: // Members
 };
 
 
-// Test that we actually call the Socket::connect method
+// Test that we actually start a connection on the socket
 TEST_F(SenderTests, TestConnect)
 {
     // Setup
-    EXPECT_CALL(*mSocketMock, connect());
+    EXPECT_CALL(*mSocketMock, connectAsync()).WillOnce(Return(true));
     ON_CALL(*mSocketMock, isConnected()).WillByDefault(Return(true));
 
     // Test
     EXPECT_NO_THROW(mTestObj->connect());
+
+    // Verify
+    EXPECT_EQ(1, mTestObj->stats().connectAttempts);
+}
+
+// Test that a connection left in progress by connectAsync() is completed by waiting on it.
+TEST_F(SenderTests, TestConnectInProgress)
+{
+    // Setup
+    EXPECT_CALL(*mSocketMock, connectAsync()).WillOnce(Return(false));
+    EXPECT_CALL(*mSocketMock, waitConnected(_)).WillOnce(Return(true));
+
+    // Test
+    EXPECT_NO_THROW(mTestObj->connect());
 }
 
 // Test that the connect() method correctly calls the conect for the expected number of times
@@ -68,12 +87,87 @@ TEST_F(SenderTests, TestConnectFail)
 {
     // Setup
     constexpr int RETRIES = 1;
-    EXPECT_CALL(*mSocketMock, connect())
+    EXPECT_CALL(*mSocketMock, connectAsync())
         .Times(RETRIES + 1)
-        .WillRepeatedly([]{ throw Common::Socket::ConnectionRefusalException(TEST_IP, TEST_PORT); });
+        .WillRepeatedly([]() -> bool { throw Common::Socket::ConnectionRefusalException(TEST_IP, TEST_PORT); });
 
     // Test
     EXPECT_THROW(mTestObj->connect(RETRIES), Sender::Exception);
+    EXPECT_EQ(RETRIES + 1, mTestObj->stats().connectAttempts);
+}
+
+// Test that with several candidates, all are attempted and the first to connect is used.
+TEST_F(SenderTests, TestConnectCandidates)
+{
+    // Setup
+    auto primaryMock = std::make_shared<testing::NiceMock<Common::SocketMock>>();
+    auto alternateMock = std::make_shared<testing::NiceMock<Common::SocketMock>>();
+    mSocketMockVendor.queueMock(primaryMock);
+    mSocketMockVendor.queueMock(alternateMock);
+
+    Sender sender({{TEST_IP, TEST_PORT}, {TEST_IP, TEST_PORT + 1}});
+
+    EXPECT_CALL(*primaryMock, connectAsync()).WillOnce(Return(false));
+    EXPECT_CALL(*alternateMock, connectAsync()).WillOnce(Return(false));
+    ON_CALL(*primaryMock, waitConnected(_)).WillByDefault(Return(false));
+    ON_CALL(*alternateMock, waitConnected(_)).WillByDefault(Return(true));
+
+    // Test
+    EXPECT_NO_THROW(sender.connect(0));
+
+    // Verify
+    EXPECT_EQ(std::string(TEST_IP) + ":" + std::to_string(TEST_PORT + 1), sender.stats().connectedTo);
+}
+
+// Test that a candidate that cannot be reached at all does not stop the others being tried.
+TEST_F(SenderTests, TestConnectCandidatesSkipsUnreachable)
+{
+    // Setup
+    auto primaryMock = std::make_shared<testing::NiceMock<Common::SocketMock>>();
+    auto alternateMock = std::make_shared<testing::NiceMock<Common::SocketMock>>();
+    mSocketMockVendor.queueMock(primaryMock);
+    mSocketMockVendor.queueMock(alternateMock);
+
+    Sender sender({{TEST_IP, TEST_PORT}, {TEST_IP, TEST_PORT + 1}});
+
+    EXPECT_CALL(*primaryMock, connectAsync()).WillOnce([]() -> bool
+    {
+        throw Common::Socket::Exception(TEST_IP, TEST_PORT, "Failure to connect: Network is unreachable");
+    });
+    EXPECT_CALL(*alternateMock, connectAsync()).WillOnce(Return(false));
+    ON_CALL(*alternateMock, waitConnected(_)).WillByDefault(Return(true));
+
+    // Test
+    EXPECT_NO_THROW(sender.connect(0));
+
+    // Verify
+    EXPECT_EQ(std::string(TEST_IP) + ":" + std::to_string(TEST_PORT + 1), sender.stats().connectedTo);
+}
+
+// Test that the parseCommandLine() method collects receiver candidates.
+TEST_F(SenderTests, ParseCommandLineReceivers)
+{
+    // Setup
+    const char* argv[] =
+    {
+        "AppName",
+        "--receiver",
+        "10.0.0.1:4000",
+        "--receiver",
+        "10.0.0.2",
+        "File1",
+    };
+
+    // Test
+    auto data = Sender::parseCommandLine(sizeof(argv)/sizeof(argv[0]), argv);
+
+    // Verify
+    ASSERT_EQ(2, data.receivers.size());
+    EXPECT_EQ("10.0.0.1", data.receivers[0].addr);
+    EXPECT_EQ(4000, data.receivers[0].port);
+    EXPECT_EQ("10.0.0.2", data.receivers[1].addr);
+    EXPECT_EQ(SERVER_PORT, data.receivers[1].port);
+    EXPECT_EQ(1, data.filesToSend.size());
 }
 
 // Test that the parseCommandLine() method indicates no files an no stdin when no args.
@@ -240,3 +334,1120 @@ TEST_F(SenderTests, TestSendStreamMultiLineInput)
 
     EXPECT_NO_THROW(mTestObj->sendStream(istr));
 }
+
+// Test that block mode sends large blocks with zero-copy when the socket permits it.
+TEST_F(SenderTests, TestSendStreamBlockZeroCopy)
+{
+    // Setup
+    Common::SocketOptions options;
+    options.zeroCopy = true;
+    mTestObj->setSocketOptions(options);
+    mTestObj->setMode(Sender::Mode::Block);
+
+    const std::string input(Sender::BLOCK_SIZE + Sender::ZEROCOPY_THRESHOLD / 2, 'x');
+    std::istringstream istr(input);
+
+    ON_CALL(*mSocketMock, isConnected()).WillByDefault(Return(true));
+    EXPECT_CALL(*mSocketMock, sendZeroCopy(_, Sender::BLOCK_SIZE)).WillOnce(Return(std::optional<uint32_t>(0)));
+
+    // The short tail is below the threshold and is copied.
+    EXPECT_CALL(*mSocketMock, send(_, Sender::ZEROCOPY_THRESHOLD / 2));
+
+    // Test
+    EXPECT_NO_THROW(mTestObj->sendStream(istr));
+
+    // Verify
+    EXPECT_EQ(input.size(), mTestObj->stats().bytesSent);
+    EXPECT_EQ(1, mTestObj->stats().zeroCopySends);
+}
+
+// Test that a block the kernel is still reading is not overwritten: once all blocks are in
+// flight, the sender waits for completions before reusing one.
+TEST_F(SenderTests, TestSendStreamBlockWaitsForCompletion)
+{
+    // Setup
+    Common::SocketOptions options;
+    options.zeroCopy = true;
+    mTestObj->setSocketOptions(options);
+    mTestObj->setMode(Sender::Mode::Block);
+
+    constexpr size_t BLOCKS = Sender::BLOCK_COUNT + 1;
+    const std::string input(Sender::BLOCK_SIZE * BLOCKS, 'x');
+    std::istringstream istr(input);
+
+    bool completed = false;
+    uint32_t nextTicket = 0;
+    std::vector<const void*> sentBlocks;
+
+    ON_CALL(*mSocketMock, isConnected()).WillByDefault(Return(true));
+    ON_CALL(*mSocketMock, isSendComplete(_)).WillByDefault([&completed](uint32_t){ return completed; });
+    EXPECT_CALL(*mSocketMock, sendZeroCopy(_, _))
+        .Times(BLOCKS)
+        .WillRepeatedly([&](const void* buffer, size_t)
+        {
+            sentBlocks.push_back(buffer);
+            return std::optional<uint32_t>(nextTicket++);
+        });
+    EXPECT_CALL(*mSocketMock, waitSendCompletions(_))
+        .Times(testing::AtLeast(1))
+        .WillRepeatedly([&completed](std::chrono::milliseconds){ completed = true; });
+
+    // Test
+    EXPECT_NO_THROW(mTestObj->sendStream(istr));
+
+    // Verify
+    ASSERT_EQ(BLOCKS, sentBlocks.size());
+    std::set<const void*> distinct(sentBlocks.begin(), sentBlocks.begin() + Sender::BLOCK_COUNT);
+    EXPECT_EQ(Sender::BLOCK_COUNT, distinct.size());
+}
+
+// Test that a resumable transfer starts from the offset the receiver already holds.
+TEST_F(SenderTests, TestSendFileResumableSkipsHeldBytes)
+{
+    // Setup
+    char path[] = "/tmp/SenderTests.XXXXXX";
+    auto fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    const std::string contents(1000, 'x');
+    ASSERT_EQ(static_cast<ssize_t>(contents.size()), write(fd, contents.data(), contents.size()));
+    close(fd);
+
+    constexpr uint64_t HELD = 600;
+
+    // The receiver's side of the conversation: Hello, Resume, then the final Ack.
+    std::vector<uint8_t> wire;
+    auto addFrame = [&wire](Common::Protocol::FrameType type, uint64_t offset)
+    {
+        Common::Protocol::FrameHeader header;
+        header.type = type;
+        header.offset = offset;
+        uint8_t encoded[Common::Protocol::HEADER_SIZE];
+        Common::Protocol::encode(header, encoded);
+        wire.insert(wire.end(), encoded, encoded + sizeof(encoded));
+    };
+    addFrame(Common::Protocol::FrameType::Hello, Common::Protocol::MAGIC);
+    addFrame(Common::Protocol::FrameType::Resume, HELD);
+    addFrame(Common::Protocol::FrameType::Ack, contents.size());
+
+    ON_CALL(*mSocketMock, isConnected()).WillByDefault(Return(true));
+    ON_CALL(*mSocketMock, recv(_, _)).WillByDefault([&wire](void* buffer, size_t len)
+    {
+        std::optional<size_t> result;
+        if (!wire.empty())
+        {
+            auto count = std::min(len, wire.size());
+            std::memcpy(buffer, wire.data(), count);
+            wire.erase(wire.begin(), wire.begin() + count);
+            result = count;
+        }
+        return result;
+    });
+    EXPECT_CALL(*mSocketMock, sendFile(_, HELD, contents.size() - HELD))
+        .WillOnce(Return(contents.size() - HELD));
+
+    // Test
+    auto sent = mTestObj->sendFileResumable(path);
+    unlink(path);
+
+    // Verify
+    EXPECT_EQ(contents.size() - HELD, sent);
+    EXPECT_EQ(HELD, mTestObj->stats().bytesResumed);
+    EXPECT_EQ(0, mTestObj->stats().reconnects);
+}
+
+// Test that batching coalesces lines into fewer sends without losing or reordering any.
+TEST_F(SenderTests, TestSendStreamBatched)
+{
+    // Setup
+    std::istringstream istr("one\ntwo\nthree\n");
+    std::string sent;
+
+    ON_CALL(*mSocketMock, isConnected()).WillByDefault(Return(true));
+    EXPECT_CALL(*mSocketMock, send(_, _)).WillRepeatedly([&sent](const void* buffer, size_t len)
+    {
+        sent.append(static_cast<const char*>(buffer), len);
+    });
+
+    mTestObj->setBatching(Sender::BATCH_BYTES, std::chrono::seconds(10));
+
+    // Test
+    EXPECT_NO_THROW(mTestObj->sendStream(istr));
+
+    // Verify
+    EXPECT_EQ("one\ntwo\nthree\n", sent);
+    EXPECT_EQ(1u, mTestObj->stats().lineSends);
+}
+
+// Test that a flow-controlled transfer sends no further than the receiver's credit, and
+// continues when more is granted.
+TEST_F(SenderTests, TestSendFileResumableWaitsForCredit)
+{
+    // Setup
+    char path[] = "/tmp/SenderTests.XXXXXX";
+    auto fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    const std::string contents(1000, 'x');
+    ASSERT_EQ(static_cast<ssize_t>(contents.size()), write(fd, contents.data(), contents.size()));
+    close(fd);
+
+    constexpr uint64_t FIRST_CREDIT = 400;
+
+    std::vector<uint8_t> wire;
+    auto addFrame = [&wire](Common::Protocol::FrameType type, uint64_t offset, uint32_t features = 0)
+    {
+        Common::Protocol::FrameHeader header;
+        header.type = type;
+        header.offset = offset;
+        header.length = (type == Common::Protocol::FrameType::Hello) ? sizeof(features) : 0;
+        uint8_t encoded[Common::Protocol::HEADER_SIZE + sizeof(features)];
+        Common::Protocol::encode(header, encoded);
+        Common::Protocol::putU32(encoded + Common::Protocol::HEADER_SIZE, features);
+        wire.insert(wire.end(), encoded, encoded + Common::Protocol::HEADER_SIZE + header.length);
+    };
+    addFrame(Common::Protocol::FrameType::Hello, Common::Protocol::MAGIC, Common::Protocol::FEATURE_CREDIT);
+    addFrame(Common::Protocol::FrameType::Resume, 0);
+    addFrame(Common::Protocol::FrameType::Credit, FIRST_CREDIT);
+    addFrame(Common::Protocol::FrameType::Credit, contents.size() + 100);
+    addFrame(Common::Protocol::FrameType::Ack, contents.size());
+
+    ON_CALL(*mSocketMock, isConnected()).WillByDefault(Return(true));
+    ON_CALL(*mSocketMock, recv(_, _)).WillByDefault([&wire](void* buffer, size_t len)
+    {
+        // One frame per read, so credit arrives only as the sender asks for it
+        std::optional<size_t> result;
+        if (!wire.empty())
+        {
+            auto frame = Common::Protocol::HEADER_SIZE
+                + Common::Protocol::decode(wire.data()).length;
+            auto count = std::min(len, frame);
+            std::memcpy(buffer, wire.data(), count);
+            wire.erase(wire.begin(), wire.begin() + count);
+            result = count;
+        }
+        return result;
+    });
+
+    testing::InSequence sequence;
+    EXPECT_CALL(*mSocketMock, sendFile(_, 0, FIRST_CREDIT)).WillOnce(Return(FIRST_CREDIT));
+    EXPECT_CALL(*mSocketMock, sendFile(_, FIRST_CREDIT, contents.size() - FIRST_CREDIT))
+        .WillOnce(Return(contents.size() - FIRST_CREDIT));
+
+    // Test
+    auto sent = mTestObj->sendFileResumable(path);
+    unlink(path);
+
+    // Verify
+    EXPECT_EQ(contents.size(), sent);
+}
+
+// Test that each file sent on a framed connection waits for credit of its own, rather than
+// spending what was granted to the file before it.
+TEST_F(SenderTests, TestSendFileResumableTwiceOnOneConnection)
+{
+    // Setup
+    char path[] = "/tmp/SenderTests.XXXXXX";
+    auto fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    const std::string contents(1000, 'x');
+    ASSERT_EQ(static_cast<ssize_t>(contents.size()), write(fd, contents.data(), contents.size()));
+    close(fd);
+
+    constexpr uint64_t SECOND_CREDIT = 400;
+
+    std::vector<uint8_t> wire;
+    auto addFrame = [&wire](Common::Protocol::FrameType type, uint16_t stream, uint64_t offset, uint32_t features = 0)
+    {
+        Common::Protocol::FrameHeader header;
+        header.type = type;
+        header.stream = stream;
+        header.offset = offset;
+        header.length = (type == Common::Protocol::FrameType::Hello) ? sizeof(features) : 0;
+        uint8_t encoded[Common::Protocol::HEADER_SIZE + sizeof(features)];
+        Common::Protocol::encode(header, encoded);
+        Common::Protocol::putU32(encoded + Common::Protocol::HEADER_SIZE, features);
+        wire.insert(wire.end(), encoded, encoded + Common::Protocol::HEADER_SIZE + header.length);
+    };
+    addFrame(Common::Protocol::FrameType::Hello, 0, Common::Protocol::MAGIC, Common::Protocol::FEATURE_CREDIT);
+    addFrame(Common::Protocol::FrameType::Resume, 0, 0);
+    addFrame(Common::Protocol::FrameType::Credit, 0, contents.size() + 100);
+    addFrame(Common::Protocol::FrameType::Ack, 0, contents.size());
+    addFrame(Common::Protocol::FrameType::Resume, 1, 0);
+    addFrame(Common::Protocol::FrameType::Credit, 1, SECOND_CREDIT);
+    addFrame(Common::Protocol::FrameType::Credit, 1, contents.size() + 100);
+    addFrame(Common::Protocol::FrameType::Ack, 1, contents.size());
+
+    ON_CALL(*mSocketMock, isConnected()).WillByDefault(Return(true));
+    ON_CALL(*mSocketMock, recv(_, _)).WillByDefault([&wire](void* buffer, size_t len)
+    {
+        // One frame per read, so credit arrives only as the sender asks for it
+        std::optional<size_t> result;
+        if (!wire.empty())
+        {
+            auto frame = Common::Protocol::HEADER_SIZE
+                + Common::Protocol::decode(wire.data()).length;
+            auto count = std::min(len, frame);
+            std::memcpy(buffer, wire.data(), count);
+            wire.erase(wire.begin(), wire.begin() + count);
+            result = count;
+        }
+        return result;
+    });
+
+    testing::InSequence sequence;
+    EXPECT_CALL(*mSocketMock, sendFile(_, 0, contents.size())).WillOnce(Return(contents.size()));
+    EXPECT_CALL(*mSocketMock, sendFile(_, 0, SECOND_CREDIT)).WillOnce(Return(SECOND_CREDIT));
+    EXPECT_CALL(*mSocketMock, sendFile(_, SECOND_CREDIT, contents.size() - SECOND_CREDIT))
+        .WillOnce(Return(contents.size() - SECOND_CREDIT));
+
+    // Test
+    auto first = mTestObj->sendFileResumable(path);
+    auto second = mTestObj->sendFileResumable(path);
+    unlink(path);
+
+    // Verify
+    EXPECT_EQ(contents.size(), first);
+    EXPECT_EQ(contents.size(), second);
+}
+
+// Test that Data frames carry a CRC of their bytes when asked for and the receiver checks it, and
+// none otherwise.
+TEST_F(SenderTests, TestSendFileResumableSendsCrc)
+{
+    // Setup
+    char path[] = "/tmp/SenderTests.XXXXXX";
+    auto fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    const std::string contents(1000, 'y');
+    ASSERT_EQ(static_cast<ssize_t>(contents.size()), write(fd, contents.data(), contents.size()));
+    close(fd);
+
+    std::vector<uint8_t> wire;
+    uint16_t stream = 0;
+    auto addFrame = [&wire, &stream](Common::Protocol::FrameType type, uint64_t offset, uint32_t features = 0)
+    {
+        Common::Protocol::FrameHeader header;
+        header.type = type;
+        header.stream = stream;
+        header.offset = offset;
+        header.length = (type == Common::Protocol::FrameType::Hello) ? sizeof(features) : 0;
+        uint8_t encoded[Common::Protocol::HEADER_SIZE + sizeof(features)];
+        Common::Protocol::encode(header, encoded);
+        Common::Protocol::putU32(encoded + Common::Protocol::HEADER_SIZE, features);
+        wire.insert(wire.end(), encoded, encoded + Common::Protocol::HEADER_SIZE + header.length);
+    };
+    auto prime = [&](bool hello)
+    {
+        if (hello)
+        {
+            addFrame(Common::Protocol::FrameType::Hello, Common::Protocol::MAGIC, Common::Protocol::FEATURE_CRC);
+        }
+        addFrame(Common::Protocol::FrameType::Resume, 0);
+        addFrame(Common::Protocol::FrameType::Ack, contents.size());
+    };
+
+    ON_CALL(*mSocketMock, isConnected()).WillByDefault(Return(true));
+    ON_CALL(*mSocketMock, recv(_, _)).WillByDefault([&wire](void* buffer, size_t len)
+    {
+        std::optional<size_t> result;
+        if (!wire.empty())
+        {
+            auto count = std::min(len, wire.size());
+            std::memcpy(buffer, wire.data(), count);
+            wire.erase(wire.begin(), wire.begin() + count);
+            result = count;
+        }
+        return result;
+    });
+
+    std::vector<std::string> sends;
+    ON_CALL(*mSocketMock, send(_, _)).WillByDefault([&sends](const void* buffer, size_t len)
+    {
+        sends.emplace_back(static_cast<const char*>(buffer), len);
+    });
+    ON_CALL(*mSocketMock, sendFile(_, _, _)).WillByDefault([](int, off_t, size_t count){ return count; });
+
+    auto findData = [&sends]()
+    {
+        return std::find_if(sends.begin(), sends.end(), [](const std::string& sent)
+        {
+            return sent.size() == Common::Protocol::HEADER_SIZE
+                && Common::Protocol::decode(reinterpret_cast<const uint8_t*>(sent.data())).type
+                    == Common::Protocol::FrameType::Data;
+        });
+    };
+
+    // Test
+    prime(true);
+    mTestObj->sendFileResumable(path);
+    auto plain = findData();
+    ASSERT_NE(sends.end(), plain);
+    auto plainHeader = Common::Protocol::decode(reinterpret_cast<const uint8_t*>(plain->data()));
+
+    sends.clear();
+    stream = 1;
+    prime(false);
+    mTestObj->setChecksums(true);
+    mTestObj->sendFileResumable(path);
+    unlink(path);
+
+    // Verify
+    EXPECT_EQ(0, plainHeader.flags);
+    EXPECT_EQ(contents.size(), plainHeader.length);
+
+    auto data = findData();
+    ASSERT_NE(sends.end(), data);
+    ASSERT_NE(sends.end(), data + 1);
+
+    auto header = Common::Protocol::decode(reinterpret_cast<const uint8_t*>(data->data()));
+    EXPECT_EQ(Common::Protocol::DATA_CRC, header.flags);
+    EXPECT_EQ(contents.size() + Common::Protocol::CRC_SIZE, header.length);
+
+    const auto& crc = *(data + 1);
+    ASSERT_EQ(Common::Protocol::CRC_SIZE, crc.size());
+    EXPECT_EQ(Common::Crc32c::extend(0, contents.data(), contents.size()),
+              Common::Protocol::getU32(reinterpret_cast<const uint8_t*>(crc.data())));
+}
+
+// Test that a file truncated while it is checksummed is reported as having shrunk, rather than
+// faulting on the bytes that are gone.
+TEST_F(SenderTests, TestSendFileResumableReportsTruncation)
+{
+    // Setup
+    char path[] = "/tmp/SenderTests.XXXXXX";
+    auto fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    const std::string contents(100000, 'y');
+    ASSERT_EQ(static_cast<ssize_t>(contents.size()), write(fd, contents.data(), contents.size()));
+    close(fd);
+
+    std::vector<uint8_t> wire;
+    auto addFrame = [&wire](Common::Protocol::FrameType type, uint64_t offset, uint32_t features = 0)
+    {
+        Common::Protocol::FrameHeader header;
+        header.type = type;
+        header.offset = offset;
+        header.length = (type == Common::Protocol::FrameType::Hello) ? sizeof(features) : 0;
+        uint8_t encoded[Common::Protocol::HEADER_SIZE + sizeof(features)];
+        Common::Protocol::encode(header, encoded);
+        Common::Protocol::putU32(encoded + Common::Protocol::HEADER_SIZE, features);
+        wire.insert(wire.end(), encoded, encoded + Common::Protocol::HEADER_SIZE + header.length);
+    };
+    addFrame(Common::Protocol::FrameType::Hello, Common::Protocol::MAGIC, Common::Protocol::FEATURE_CRC);
+    addFrame(Common::Protocol::FrameType::Resume, 0);
+
+    ON_CALL(*mSocketMock, isConnected()).WillByDefault(Return(true));
+    ON_CALL(*mSocketMock, recv(_, _)).WillByDefault([&wire](void* buffer, size_t len)
+    {
+        std::optional<size_t> result;
+        if (!wire.empty())
+        {
+            auto count = std::min(len, wire.size());
+            std::memcpy(buffer, wire.data(), count);
+            wire.erase(wire.begin(), wire.begin() + count);
+            result = count;
+        }
+        return result;
+    });
+
+    // The file is cut short once it has been opened and its size taken.
+    ON_CALL(*mSocketMock, send(_, _)).WillByDefault([&path](const void* buffer, size_t)
+    {
+        auto header = Common::Protocol::decode(static_cast<const uint8_t*>(buffer));
+        if (header.type == Common::Protocol::FrameType::Open)
+        {
+            ASSERT_EQ(0, truncate(path, 10));
+        }
+    });
+    EXPECT_CALL(*mSocketMock, sendFile(_, _, _)).Times(0);
+
+    mTestObj->setChecksums(true);
+
+    // Test
+    EXPECT_THROW(mTestObj->sendFileResumable(path), Sender::Exception);
+    unlink(path);
+}
+
+// Test that multiplexed streams are served by priority, and each is closed and acknowledged.
+TEST_F(SenderTests, TestSendStreamsByPriority)
+{
+    // Setup
+    constexpr size_t SIZE = 100;
+    const std::string contents(SIZE, 'x');
+
+    std::vector<int> fds;
+    for (int count = 0; count < 2; ++count)
+    {
+        char path[] = "/tmp/SenderTests.XXXXXX";
+        auto fd = mkstemp(path);
+        ASSERT_GE(fd, 0);
+        unlink(path);
+        ASSERT_EQ(static_cast<ssize_t>(SIZE), write(fd, contents.data(), contents.size()));
+        fds.push_back(fd);
+    }
+
+    std::vector<Sender::StreamSource> sources{
+        {fds[0], "bulk", Sender::StreamSettings{0, 1}},
+        {fds[1], "urgent", Sender::StreamSettings{5, 1}},
+    };
+
+    std::vector<uint8_t> wire;
+    auto addFrame = [&wire](Common::Protocol::FrameType type, uint16_t stream, uint64_t offset)
+    {
+        Common::Protocol::FrameHeader header;
+        header.type = type;
+        header.stream = stream;
+        header.offset = offset;
+        header.length = (type == Common::Protocol::FrameType::Hello) ? sizeof(uint32_t) : 0;
+        uint8_t encoded[Common::Protocol::HEADER_SIZE + sizeof(uint32_t)];
+        Common::Protocol::encode(header, encoded);
+        Common::Protocol::putU32(encoded + Common::Protocol::HEADER_SIZE, Common::Protocol::FEATURE_CREDIT);
+        wire.insert(wire.end(), encoded, encoded + Common::Protocol::HEADER_SIZE + header.length);
+    };
+    addFrame(Common::Protocol::FrameType::Hello, 0, Common::Protocol::MAGIC);
+    addFrame(Common::Protocol::FrameType::Resume, 0, 0);
+    addFrame(Common::Protocol::FrameType::Resume, 1, 0);
+    addFrame(Common::Protocol::FrameType::Credit, 0, SIZE);
+    addFrame(Common::Protocol::FrameType::Credit, 1, SIZE);
+    addFrame(Common::Protocol::FrameType::Ack, 0, SIZE);
+    addFrame(Common::Protocol::FrameType::Ack, 1, SIZE);
+
+    ON_CALL(*mSocketMock, isConnected()).WillByDefault(Return(true));
+    ON_CALL(*mSocketMock, recv(_, _)).WillByDefault([&wire](void* buffer, size_t len)
+    {
+        std::optional<size_t> result;
+        if (!wire.empty())
+        {
+            auto count = std::min(len, wire.size());
+            std::memcpy(buffer, wire.data(), count);
+            wire.erase(wire.begin(), wire.begin() + count);
+            result = count;
+        }
+        return result;
+    });
+    ON_CALL(*mSocketMock, waitReadable(_)).WillByDefault([&wire](std::chrono::milliseconds)
+    {
+        return !wire.empty();
+    });
+
+    testing::InSequence sequence;
+    EXPECT_CALL(*mSocketMock, sendFile(fds[1], 0, SIZE)).WillOnce(Return(SIZE));
+    EXPECT_CALL(*mSocketMock, sendFile(fds[0], 0, SIZE)).WillOnce(Return(SIZE));
+
+    // Test
+    auto sent = mTestObj->sendStreams(sources);
+
+    // Verify
+    EXPECT_EQ(2 * SIZE, sent);
+    EXPECT_TRUE(wire.empty());
+
+    for (auto fd : fds)
+    {
+        close(fd);
+    }
+}
+
+// Test that a stream waiting for input sleeps until it arrives, rather than polling for it.
+TEST_F(SenderTests, TestSendStreamsWaitsForInput)
+{
+    // Setup
+    int input[2];
+    ASSERT_EQ(0, pipe(input));
+    const std::string contents = "late input\n";
+
+    std::vector<Sender::StreamSource> sources{
+        {input[0], "piped", Sender::StreamSettings{0, 1}},
+    };
+
+    std::vector<uint8_t> wire;
+    auto addFrame = [&wire](Common::Protocol::FrameType type, uint16_t stream, uint64_t offset)
+    {
+        Common::Protocol::FrameHeader header;
+        header.type = type;
+        header.stream = stream;
+        header.offset = offset;
+        header.length = (type == Common::Protocol::FrameType::Hello) ? sizeof(uint32_t) : 0;
+        uint8_t encoded[Common::Protocol::HEADER_SIZE + sizeof(uint32_t)];
+        Common::Protocol::encode(header, encoded);
+        Common::Protocol::putU32(encoded + Common::Protocol::HEADER_SIZE, Common::Protocol::FEATURE_CREDIT);
+        wire.insert(wire.end(), encoded, encoded + Common::Protocol::HEADER_SIZE + header.length);
+    };
+    addFrame(Common::Protocol::FrameType::Hello, 0, Common::Protocol::MAGIC);
+    addFrame(Common::Protocol::FrameType::Resume, 0, 0);
+    addFrame(Common::Protocol::FrameType::Credit, 0, contents.size());
+    addFrame(Common::Protocol::FrameType::Ack, 0, contents.size());
+
+    ON_CALL(*mSocketMock, isConnected()).WillByDefault(Return(true));
+    ON_CALL(*mSocketMock, recv(_, _)).WillByDefault([&wire](void* buffer, size_t len)
+    {
+        std::optional<size_t> result;
+        if (!wire.empty())
+        {
+            auto count = std::min(len, wire.size());
+            std::memcpy(buffer, wire.data(), count);
+            wire.erase(wire.begin(), wire.begin() + count);
+            result = count;
+        }
+        return result;
+    });
+    ON_CALL(*mSocketMock, waitReadable(_)).WillByDefault([&wire](std::chrono::milliseconds)
+    {
+        return !wire.empty();
+    });
+
+    // Wait as the real socket would: the receiver has nothing more to say, so only the wake ends it.
+    int waits = 0;
+    ON_CALL(*mSocketMock, waitReadable(_, _)).WillByDefault([&](std::chrono::milliseconds timeout, int wakeFd)
+    {
+        ++waits;
+        EXPECT_LT(timeout.count(), 0);
+        if (!wire.empty())
+        {
+            return true;
+        }
+
+        pollfd wake{wakeFd, POLLIN, 0};
+        poll(&wake, 1, 10000);
+        return false;
+    });
+
+    std::string sends;
+    ON_CALL(*mSocketMock, send(_, _)).WillByDefault([&sends](const void* buffer, size_t len)
+    {
+        sends.append(static_cast<const char*>(buffer), len);
+    });
+
+    std::thread writer([&]()
+    {
+        std::this_thread::sleep_for(100ms);
+        EXPECT_EQ(static_cast<ssize_t>(contents.size()), write(input[1], contents.data(), contents.size()));
+        close(input[1]);
+    });
+
+    // Test
+    auto sent = mTestObj->sendStreams(sources);
+    writer.join();
+    close(input[0]);
+
+    // Verify
+    EXPECT_EQ(contents.size(), sent);
+    EXPECT_NE(std::string::npos, sends.find(contents));
+    EXPECT_GE(waits, 1);
+    EXPECT_LE(waits, 4);
+}
+
+// Test that a deduplicated transfer offers its chunks first and sends only those the receiver wants.
+TEST_F(SenderTests, TestSendDeduplicatedSendsOnlyWantedChunks)
+{
+    // Setup: a file small enough to be a single chunk, sent twice
+    char path[] = "/tmp/SenderTests.XXXXXX";
+    auto fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    unlink(path);
+    std::string contents(1000, 'z');
+    contents[500] = 'a';
+    ASSERT_EQ(static_cast<ssize_t>(contents.size()), write(fd, contents.data(), contents.size()));
+
+    std::vector<uint8_t> wire;
+    auto addFrame = [&wire](Common::Protocol::FrameType type, uint16_t stream, uint64_t offset,
+                            const std::vector<uint32_t>& values = {})
+    {
+        Common::Protocol::FrameHeader header;
+        header.type = type;
+        header.stream = stream;
+        header.offset = offset;
+        header.length = static_cast<uint32_t>(values.size() * sizeof(uint32_t));
+        std::vector<uint8_t> encoded(Common::Protocol::HEADER_SIZE + header.length);
+        Common::Protocol::encode(header, encoded.data());
+        for (size_t index = 0; index < values.size(); ++index)
+        {
+            Common::Protocol::putU32(encoded.data() + Common::Protocol::HEADER_SIZE + index * sizeof(uint32_t), values[index]);
+        }
+        wire.insert(wire.end(), encoded.begin(), encoded.end());
+    };
+    addFrame(Common::Protocol::FrameType::Hello, 0, Common::Protocol::MAGIC,
+             {Common::Protocol::FEATURE_CREDIT | Common::Protocol::FEATURE_DEDUP});
+
+    // The first time, the receiver holds the chunk; the second, it asks for it.
+    addFrame(Common::Protocol::FrameType::Resume, 0, 0);
+    addFrame(Common::Protocol::FrameType::Credit, 0, 64 * 1024);
+    addFrame(Common::Protocol::FrameType::Want, 0, 0);
+    addFrame(Common::Protocol::FrameType::Ack, 0, contents.size());
+    addFrame(Common::Protocol::FrameType::Resume, 1, 0);
+    addFrame(Common::Protocol::FrameType::Credit, 1, 64 * 1024);
+    addFrame(Common::Protocol::FrameType::Want, 1, 0, {0});
+    addFrame(Common::Protocol::FrameType::Ack, 1, contents.size());
+
+    ON_CALL(*mSocketMock, isConnected()).WillByDefault(Return(true));
+    ON_CALL(*mSocketMock, recv(_, _)).WillByDefault([&wire](void* buffer, size_t len)
+    {
+        std::optional<size_t> result;
+        if (!wire.empty())
+        {
+            auto count = std::min(len, wire.size());
+            std::memcpy(buffer, wire.data(), count);
+            wire.erase(wire.begin(), wire.begin() + count);
+            result = count;
+        }
+        return result;
+    });
+
+    std::vector<std::string> sends;
+    ON_CALL(*mSocketMock, send(_, _)).WillByDefault([&sends](const void* buffer, size_t len)
+    {
+        sends.emplace_back(static_cast<const char*>(buffer), len);
+    });
+
+    // Test
+    auto firstSent = mTestObj->sendDeduplicated(fd, "first");
+    auto secondSent = mTestObj->sendDeduplicated(fd, "second");
+    close(fd);
+
+    // Verify
+    EXPECT_EQ(0u, firstSent);
+    EXPECT_EQ(contents.size(), secondSent);
+    EXPECT_EQ(contents.size(), mTestObj->stats().bytesDeduplicated);
+    EXPECT_TRUE(wire.empty());
+
+    std::map<uint16_t, std::vector<std::string>> recipes;
+    std::map<uint16_t, std::string> data;
+    for (const auto& sent : sends)
+    {
+        if (sent.size() < Common::Protocol::HEADER_SIZE)
+        {
+            continue;
+        }
+
+        auto header = Common::Protocol::decode(reinterpret_cast<const uint8_t*>(sent.data()));
+        if (header.type == Common::Protocol::FrameType::Recipe)
+        {
+            recipes[header.stream].push_back(sent.substr(Common::Protocol::HEADER_SIZE));
+        }
+        else if (header.type == Common::Protocol::FrameType::Data)
+        {
+            EXPECT_EQ(data[header.stream].size(), header.offset);
+            data[header.stream] += sent.substr(Common::Protocol::HEADER_SIZE);
+        }
+    }
+
+    uint8_t entry[Common::Protocol::RECIPE_ENTRY_SIZE];
+    Common::Protocol::putU32(entry, static_cast<uint32_t>(contents.size()));
+    Common::Fingerprint::of(contents.data(), contents.size()).encode(entry + sizeof(uint32_t));
+    const std::string expected(reinterpret_cast<const char*>(entry), sizeof(entry));
+
+    EXPECT_EQ((std::vector<std::string>{expected}), recipes[0]);
+    EXPECT_EQ((std::vector<std::string>{expected}), recipes[1]);
+    EXPECT_EQ(0u, data.count(0));
+    EXPECT_EQ(contents, data[1]);
+}
+
+// Test that a file read a window at a time is chunked as it would be whole.
+TEST_F(SenderTests, TestChunkFeedMatchesChunker)
+{
+    // Setup: several read windows' worth, ending mid-window
+    std::minstd_rand random(7);
+    std::string contents(3 * CHUNK_READ_SIZE + 12345, '\0');
+    for (auto& byte : contents)
+    {
+        byte = static_cast<char>(random());
+    }
+
+    auto fd = memfd_create("contents", MFD_CLOEXEC);
+    ASSERT_EQ(static_cast<ssize_t>(contents.size()), write(fd, contents.data(), contents.size()));
+
+    // Test
+    std::vector<FileChunk> chunks;
+    {
+        ChunkFeed feed(fd, contents.size());
+        FileChunk chunk;
+        while (feed.next(chunk))
+        {
+            chunks.push_back(chunk);
+        }
+    }
+    close(fd);
+
+    // Verify
+    Chunker chunker;
+    uint64_t offset = 0;
+    for (const auto& chunk : chunks)
+    {
+        ASSERT_EQ(offset, chunk.offset);
+        ASSERT_EQ(chunker.cut(contents.data() + offset, contents.size() - offset), chunk.length);
+        EXPECT_EQ(Common::Fingerprint::of(contents.data() + offset, chunk.length), chunk.fingerprint);
+        offset += chunk.length;
+    }
+    EXPECT_EQ(contents.size(), offset);
+}
+
+// Test that a file cut short during a deduplicated transfer is reported, rather than read past its
+// end.
+TEST_F(SenderTests, TestSendDeduplicatedReportsTruncation)
+{
+    // Setup: a file of one chunk, which the receiver asks for
+    char path[] = "/tmp/SenderTests.XXXXXX";
+    auto fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    const std::string contents(20000, 'w');
+    ASSERT_EQ(static_cast<ssize_t>(contents.size()), write(fd, contents.data(), contents.size()));
+
+    std::vector<uint8_t> wire;
+    auto addFrame = [&wire](Common::Protocol::FrameType type, uint64_t offset, std::optional<uint32_t> value = {})
+    {
+        Common::Protocol::FrameHeader header;
+        header.type = type;
+        header.offset = offset;
+        header.length = value ? sizeof(uint32_t) : 0;
+        uint8_t encoded[Common::Protocol::HEADER_SIZE + sizeof(uint32_t)];
+        Common::Protocol::encode(header, encoded);
+        Common::Protocol::putU32(encoded + Common::Protocol::HEADER_SIZE, value.value_or(0));
+        wire.insert(wire.end(), encoded, encoded + Common::Protocol::HEADER_SIZE + header.length);
+    };
+    addFrame(Common::Protocol::FrameType::Hello, Common::Protocol::MAGIC,
+             Common::Protocol::FEATURE_CREDIT | Common::Protocol::FEATURE_DEDUP);
+    addFrame(Common::Protocol::FrameType::Resume, 0);
+    addFrame(Common::Protocol::FrameType::Credit, 64 * 1024);
+    addFrame(Common::Protocol::FrameType::Want, 0, 0);
+
+    ON_CALL(*mSocketMock, isConnected()).WillByDefault(Return(true));
+    ON_CALL(*mSocketMock, recv(_, _)).WillByDefault([&wire](void* buffer, size_t len)
+    {
+        std::optional<size_t> result;
+        if (!wire.empty())
+        {
+            auto count = std::min(len, wire.size());
+            std::memcpy(buffer, wire.data(), count);
+            wire.erase(wire.begin(), wire.begin() + count);
+            result = count;
+        }
+        return result;
+    });
+
+    // The file is cut short once its chunk has been offered.
+    ON_CALL(*mSocketMock, send(_, _)).WillByDefault([&path](const void* buffer, size_t)
+    {
+        auto header = Common::Protocol::decode(static_cast<const uint8_t*>(buffer));
+        if (header.type == Common::Protocol::FrameType::Recipe)
+        {
+            ASSERT_EQ(0, truncate(path, 10));
+        }
+        EXPECT_NE(Common::Protocol::FrameType::Data, header.type);
+    });
+
+    // Test
+    EXPECT_THROW(mTestObj->sendDeduplicated(fd, "cut"), Sender::Exception);
+    close(fd);
+    unlink(path);
+}
+
+// Test that followed files are sent a run of whole lines at a time, until the follower stops.
+TEST_F(SenderTests, TestSendFollowedSendsWholeLines)
+{
+    // Setup
+    char path[] = "/tmp/SenderTests.XXXXXX";
+    auto fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    const std::string contents = "first\nsecond\nthird";
+    ASSERT_EQ(static_cast<ssize_t>(contents.size()), write(fd, contents.data(), contents.size()));
+    close(fd);
+
+    FileFollower follower({path}, true);
+    std::string sent;
+
+    ON_CALL(*mSocketMock, isConnected()).WillByDefault(Return(true));
+    EXPECT_CALL(*mSocketMock, send(_, _)).WillRepeatedly([&](const void* buffer, size_t len)
+    {
+        sent.append(static_cast<const char*>(buffer), len);
+        follower.stop();
+    });
+
+    // Test
+    uint64_t result = 0;
+    EXPECT_NO_THROW(result = mTestObj->sendFollowed(follower));
+
+    // Verify: the lines read together go in one send, and the line in progress when stopped in another.
+    EXPECT_EQ("first\nsecond\nthird\n", sent);
+    EXPECT_EQ(sent.size(), result);
+    EXPECT_EQ(2u, mTestObj->stats().lineSends);
+    unlink(path);
+}
+
+// Test that pingPong() sends each request in pieces, takes its echo back whole, and times every
+// round trip, both as measured and from when each was due.
+TEST_F(SenderTests, TestPingPongRoundTrips)
+{
+    // Setup
+    constexpr size_t MESSAGE_SIZE = Sender::PING_PIECE_SIZE + 1000;
+    constexpr uint64_t COUNT = 5;
+    constexpr uint64_t RATE = 1000;
+
+    std::string pending;
+    size_t sends = 0;
+
+    ON_CALL(*mSocketMock, isConnected()).WillByDefault(Return(true));
+    ON_CALL(*mSocketMock, send(_, _)).WillByDefault([&](const void* buffer, size_t len)
+    {
+        EXPECT_LE(len, Sender::PING_PIECE_SIZE);
+        EXPECT_NE(static_cast<char>(Common::Protocol::FrameType::Hello), static_cast<const char*>(buffer)[0]);
+        pending.append(static_cast<const char*>(buffer), len);
+        ++sends;
+    });
+
+    // The echo comes back as it is available, and nothing is waited for that was never sent.
+    auto echo = [&pending](void* buffer, size_t len) -> std::optional<size_t>
+    {
+        const auto taken = std::min(len, pending.size());
+        std::memcpy(buffer, pending.data(), taken);
+        pending.erase(0, taken);
+        return taken;
+    };
+    ON_CALL(*mSocketMock, tryRecv(_, _)).WillByDefault(echo);
+    ON_CALL(*mSocketMock, recv(_, _)).WillByDefault([&](void* buffer, size_t len)
+    {
+        EXPECT_FALSE(pending.empty());
+        return echo(buffer, len);
+    });
+
+    // Test
+    auto trips = mTestObj->pingPong(MESSAGE_SIZE, COUNT, RATE);
+
+    // Verify
+    EXPECT_EQ(MESSAGE_SIZE, trips.messageSize);
+    EXPECT_EQ(RATE, trips.rate);
+    EXPECT_EQ(COUNT * 2, sends);
+    EXPECT_TRUE(pending.empty());
+    EXPECT_EQ(COUNT * MESSAGE_SIZE, mTestObj->stats().bytesSent);
+    EXPECT_EQ(COUNT, trips.measured.count());
+    EXPECT_EQ(COUNT, trips.corrected.count());
+    EXPECT_GE(trips.corrected.max(), trips.measured.max());
+}
+
+// Test that pingPong() reports a receiver that disconnects rather than echoing.
+TEST_F(SenderTests, TestPingPongWithoutEcho)
+{
+    // Setup
+    ON_CALL(*mSocketMock, isConnected()).WillByDefault(Return(true));
+    ON_CALL(*mSocketMock, tryRecv(_, _)).WillByDefault(Return(std::optional<size_t>(0)));
+    ON_CALL(*mSocketMock, recv(_, _)).WillByDefault(Return(std::nullopt));
+
+    // Test/Verify
+    EXPECT_THROW(mTestObj->pingPong(Sender::PING_MIN_SIZE, 1), Sender::Exception);
+}
+
+// Test that the parseCommandLine() method collects the ping-pong settings, and keeps the mode
+// apart from inputs.
+TEST_F(SenderTests, ParseCommandLinePingPong)
+{
+    // Setup
+    const char* argv[] =
+    {
+        "AppName",
+        "--ping-pong",
+        "--ping-count", "50",
+        "--ping-rates", "0,1000,20000",
+        "--profile", "low-latency",
+    };
+
+    // Test
+    auto data = mTestObj->parseCommandLine(sizeof(argv)/sizeof(argv[0]), argv);
+
+    // Verify
+    EXPECT_TRUE(data.pingPong);
+    EXPECT_EQ(50u, data.pingCount);
+    EXPECT_EQ((std::vector<uint64_t>{0, 1000, 20000}), data.pingRates);
+    EXPECT_EQ("low-latency", data.profile);
+
+    const char* withInput[] = {"AppName", "--ping-pong", "File1"};
+    EXPECT_THROW(mTestObj->parseCommandLine(3, withInput), Sender::Exception);
+
+    const char* badRates[] = {"AppName", "--ping-pong", "--ping-rates", "10,,20"};
+    EXPECT_THROW(mTestObj->parseCommandLine(4, badRates), Sender::Exception);
+}
+
+// Test that a replay takes its capture and speed, and no other inputs.
+TEST_F(SenderTests, ParseCommandLineReplay)
+{
+    // Setup
+    const char* argv[] = {"AppName", "--replay", "traffic.cap", "--replay-speed", "2.5"};
+
+    // Test
+    auto data = mTestObj->parseCommandLine(sizeof(argv)/sizeof(argv[0]), argv);
+
+    // Verify
+    EXPECT_EQ("traffic.cap", data.replayFile);
+    EXPECT_DOUBLE_EQ(2.5, data.replaySpeed);
+
+    const char* max[] = {"AppName", "--replay", "traffic.cap", "--replay-speed", "max"};
+    EXPECT_DOUBLE_EQ(0.0, mTestObj->parseCommandLine(5, max).replaySpeed);
+
+    const char* original[] = {"AppName", "--replay", "traffic.cap"};
+    EXPECT_DOUBLE_EQ(1.0, mTestObj->parseCommandLine(3, original).replaySpeed);
+
+    const char* badSpeed[] = {"AppName", "--replay", "traffic.cap", "--replay-speed", "0"};
+    EXPECT_THROW(mTestObj->parseCommandLine(5, badSpeed), Sender::Exception);
+
+    const char* withInput[] = {"AppName", "--replay", "traffic.cap", "File1"};
+    EXPECT_THROW(mTestObj->parseCommandLine(4, withInput), Sender::Exception);
+}
+
+// Test that framed Data frames are checksummed only when --crc asks for it.
+TEST_F(SenderTests, ParseCommandLineCrc)
+{
+    // Setup
+    const char* argv[] = {"AppName", "--resume", "--crc", "File1"};
+    const char* plain[] = {"AppName", "--resume", "File1"};
+
+    // Test
+    auto data = mTestObj->parseCommandLine(sizeof(argv)/sizeof(argv[0]), argv);
+
+    // Verify
+    EXPECT_TRUE(data.checksums);
+    EXPECT_FALSE(mTestObj->parseCommandLine(3, plain).checksums);
+}
+
+// Test that --filter clauses collect and are checked, that --sample applies to the inputs after
+// it, and that neither goes with modes that send inputs whole.
+TEST_F(SenderTests, ParseCommandLineFilter)
+{
+    // Setup
+    const char* argv[] =
+    {
+        "AppName",
+        "--filter", "contains:ERROR",
+        "--filter", "!field:1=test",
+        "File1",
+        "--sample", "0.25",
+        "File2",
+    };
+
+    // Test
+    auto data = mTestObj->parseCommandLine(sizeof(argv)/sizeof(argv[0]), argv);
+
+    // Verify
+    EXPECT_EQ("contains:ERROR\n!field:1=test\n", data.filter);
+    ASSERT_EQ(2u, data.fileSettings.size());
+    EXPECT_DOUBLE_EQ(1.0, data.fileSettings[0].sample);
+    EXPECT_DOUBLE_EQ(0.25, data.fileSettings[1].sample);
+
+    const char* badClause[] = {"AppName", "--filter", "regex:(a|b)", "File1"};
+    EXPECT_THROW(mTestObj->parseCommandLine(4, badClause), Sender::Exception);
+
+    const char* badRate[] = {"AppName", "--sample", "1.5", "File1"};
+    EXPECT_THROW(mTestObj->parseCommandLine(4, badRate), Sender::Exception);
+
+    const char* withResume[] = {"AppName", "--filter", "contains:x", "--resume", "File1"};
+    EXPECT_THROW(mTestObj->parseCommandLine(5, withResume), Sender::Exception);
+
+    const char* withDedup[] = {"AppName", "--sample", "0.5", "--dedup", "File1"};
+    EXPECT_THROW(mTestObj->parseCommandLine(5, withDedup), Sender::Exception);
+}
+
+// Test that lines sent one at a time are left out unless they pass the filter.
+TEST_F(SenderTests, TestSendStreamFiltersLines)
+{
+    // Setup
+    std::istringstream input("a INFO\nb ERROR\nc INFO\nd ERROR\n");
+    mTestObj->setFilter(std::make_shared<const Common::RecordFilter>("contains:ERROR"));
+
+    std::string sent;
+    ON_CALL(*mSocketMock, isConnected()).WillByDefault(Return(true));
+    EXPECT_CALL(*mSocketMock, send(_, _)).Times(2).WillRepeatedly([&sent](const void* buffer, size_t len)
+    {
+        sent.append(static_cast<const char*>(buffer), len);
+    });
+
+    // Test
+    EXPECT_NO_THROW(mTestObj->sendStream(input));
+
+    // Verify
+    EXPECT_EQ("b ERROR\nd ERROR\n", sent);
+    EXPECT_EQ(sent.size(), mTestObj->stats().bytesSent);
+    EXPECT_EQ(14u, mTestObj->stats().bytesFiltered);
+}
+
+// Test that a framed stream carries only the records that pass both the sender's filter and
+// the one the receiver asks for, and that the sender says it understands such requests.
+TEST_F(SenderTests, TestSendFramedAppliesPushedFilter)
+{
+    // Setup
+    char path[] = "/tmp/SenderTests.XXXXXX";
+    auto fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    unlink(path);
+    const std::string contents = "web ERROR one\nweb INFO two\ndb ERROR three\nweb ERROR four";
+    ASSERT_EQ(static_cast<ssize_t>(contents.size()), write(fd, contents.data(), contents.size()));
+    lseek(fd, 0, SEEK_SET);
+
+    const std::string expected = "web ERROR one\nweb ERROR four";
+    const std::string pushed = "field:1=web\n";
+
+    std::vector<uint8_t> wire;
+    auto addFrame = [&wire](Common::Protocol::FrameType type, uint64_t offset, const std::string& payload = "")
+    {
+        Common::Protocol::FrameHeader header;
+        header.type = type;
+        header.offset = offset;
+        header.length = static_cast<uint32_t>(payload.size());
+        uint8_t encoded[Common::Protocol::HEADER_SIZE];
+        Common::Protocol::encode(header, encoded);
+        wire.insert(wire.end(), encoded, encoded + sizeof(encoded));
+        wire.insert(wire.end(), payload.begin(), payload.end());
+    };
+    uint8_t features[sizeof(uint32_t)];
+    Common::Protocol::putU32(features, Common::Protocol::FEATURE_CREDIT);
+    addFrame(Common::Protocol::FrameType::Hello, Common::Protocol::MAGIC, std::string(features, features + sizeof(features)));
+    addFrame(Common::Protocol::FrameType::Filter, 0, pushed);
+    addFrame(Common::Protocol::FrameType::Resume, 0);
+    addFrame(Common::Protocol::FrameType::Credit, 1000);
+    addFrame(Common::Protocol::FrameType::Ack, expected.size());
+
+    ON_CALL(*mSocketMock, isConnected()).WillByDefault(Return(true));
+    ON_CALL(*mSocketMock, recv(_, _)).WillByDefault([&wire](void* buffer, size_t len)
+    {
+        std::optional<size_t> result;
+        if (!wire.empty())
+        {
+            auto count = std::min(len, wire.size());
+            std::memcpy(buffer, wire.data(), count);
+            wire.erase(wire.begin(), wire.begin() + count);
+            result = count;
+        }
+        return result;
+    });
+
+    std::vector<uint8_t> sent;
+    EXPECT_CALL(*mSocketMock, send(_, _)).WillRepeatedly([&sent](const void* buffer, size_t len)
+    {
+        auto bytes = static_cast<const uint8_t*>(buffer);
+        sent.insert(sent.end(), bytes, bytes + len);
+    });
+
+    mTestObj->setFilter(std::make_shared<const Common::RecordFilter>("contains:ERROR"));
+
+    // Test
+    auto position = mTestObj->sendFramed(fd, "log");
+    close(fd);
+
+    // Verify
+    EXPECT_EQ(expected.size(), position);
+    EXPECT_EQ(contents.size() - expected.size(), mTestObj->stats().bytesFiltered);
+
+    std::string data;
+    uint32_t advertised = 0;
+    for (size_t at = 0; at + Common::Protocol::HEADER_SIZE <= sent.size(); )
+    {
+        auto header = Common::Protocol::decode(sent.data() + at);
+        at += Common::Protocol::HEADER_SIZE;
+        if (header.type == Common::Protocol::FrameType::Hello)
+        {
+            advertised = Common::Protocol::getU32(sent.data() + at);
+        }
+        else if (header.type == Common::Protocol::FrameType::Data)
+        {
+            data.append(reinterpret_cast<const char*>(sent.data() + at), header.length);
+        }
+        at += header.length;
+    }
+
+    EXPECT_EQ(expected, data);
+    EXPECT_TRUE(advertised & Common::Protocol::FEATURE_FILTER);
+}
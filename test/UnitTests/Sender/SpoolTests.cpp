@@ -0,0 +1,130 @@
+/**
+ * @brief Unit tests for the Spool class
+ *
+ * @file SpoolTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Sender/Spool.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <memory>
+#include <string>
+#include <thread>
+#include <chrono>
+
+using namespace std::chrono_literals;
+
+
+class SpoolTests : public testing::Test
+{
+protected: // Definitions
+    static constexpr size_t TEST_MEMORY_LIMIT = 64 * 1024;
+
+protected: // Methods
+    SpoolTests()
+    {
+        EXPECT_EQ(0, pipe(mPipe));
+    }
+
+    virtual ~SpoolTests()
+    {
+        mTestObj.reset();
+        close(mPipe[0]);
+        if (mPipe[1] >= 0)
+        {
+            close(mPipe[1]);
+        }
+    }
+
+    void produce(const std::string& data)
+    {
+        size_t written = 0;
+        while (written < data.size())
+        {
+            auto result = write(mPipe[1], data.data() + written, data.size() - written);
+            ASSERT_GT(result, 0);
+            written += static_cast<size_t>(result);
+        }
+    }
+
+    void endInput()
+    {
+        close(mPipe[1]);
+        mPipe[1] = -1;
+    }
+
+    std::string consumeAll()
+    {
+        std::string result;
+        char buffer[10000];
+        while (auto len = mTestObj->read(buffer, sizeof(buffer)))
+        {
+            result.append(buffer, len);
+        }
+        return result;
+    }
+
+protected: // Members
+    int                     mPipe[2]{-1, -1};
+    std::unique_ptr<Spool>  mTestObj;
+};
+
+
+// Test that input passes through in order when the consumer keeps up.
+TEST_F(SpoolTests, TestPassThrough)
+{
+    // Setup
+    mTestObj = std::make_unique<Spool>(mPipe[0], TEST_MEMORY_LIMIT);
+
+    // Test
+    produce("hello ");
+    produce("world");
+    endInput();
+
+    // Verify
+    EXPECT_EQ("hello world", consumeAll());
+    EXPECT_EQ(0u, mTestObj->spooledBytes());
+}
+
+// Test that input beyond the memory limit overflows to disk while the consumer is stalled,
+// without blocking the producer, and still comes out in order.
+TEST_F(SpoolTests, TestOverflowToDisk)
+{
+    // Setup
+    mTestObj = std::make_unique<Spool>(mPipe[0], TEST_MEMORY_LIMIT);
+
+    std::string input;
+    for (size_t index = 0; input.size() < TEST_MEMORY_LIMIT * 8; ++index)
+    {
+        input += std::to_string(index) + "\n";
+    }
+
+    // Test: the producer finishes before anything is consumed.
+    std::thread producer([this, &input]{ produce(input); endInput(); });
+    producer.join();
+
+    // Verify
+    EXPECT_EQ(input, consumeAll());
+    EXPECT_GT(mTestObj->spooledBytes(), 0u);
+}
+
+// Test that destroying a Spool does not wait for the input to end.
+TEST_F(SpoolTests, TestStopWithInputOpen)
+{
+    // Setup
+    mTestObj = std::make_unique<Spool>(mPipe[0], TEST_MEMORY_LIMIT);
+    produce("partial");
+
+    char buffer[16];
+    EXPECT_EQ(7u, mTestObj->read(buffer, sizeof(buffer)));
+
+    // Test & Verify (would hang if the reader could not be stopped)
+    mTestObj.reset();
+}
@@ -0,0 +1,121 @@
+/**
+ * @brief Unit tests for the StreamScheduler class
+ *
+ * @file StreamSchedulerTests.cpp
+ *
+ * @author Deon McClung
+ * @copyright 2023, Deon McClung, All rights reserved. See LICENSE in the repository root.
+ */
+
+// Code under test
+#include "Sender/StreamScheduler.cpp"
+
+// Library headers
+#include <gtest/gtest.h>
+
+// Standard headers
+#include <map>
+#include <set>
+
+
+class StreamSchedulerTests : public testing::Test
+{
+protected: // Methods
+    StreamSchedulerTests() = default;
+
+    virtual ~StreamSchedulerTests() = default;
+
+    /// Run 'turns' turns, each sending a whole allowance, and total the bytes sent per stream.
+    std::map<uint16_t, size_t> run(size_t turns, const std::set<uint16_t>& idle = {})
+    {
+        std::map<uint16_t, size_t> sent;
+
+        for (size_t turn = 0; turn < turns; ++turn)
+        {
+            auto chosen = mTestObj.next([&idle](uint16_t stream){ return idle.count(stream) == 0; });
+            if (!chosen)
+            {
+                break;
+            }
+
+            sent[chosen->stream] += chosen->allowance;
+            mTestObj.charge(chosen->stream, chosen->allowance);
+        }
+
+        return sent;
+    }
+
+protected: // Members
+    StreamScheduler     mTestObj;
+};
+
+
+// Test that a ready stream of a higher priority is always served first.
+TEST_F(StreamSchedulerTests, TestPriorityPreempts)
+{
+    // Setup
+    mTestObj.add(1, 0, 1);
+    mTestObj.add(2, 5, 1);
+
+    // Test
+    auto sent = run(10);
+
+    // Verify
+    EXPECT_EQ(10 * StreamScheduler::QUANTUM, sent[2]);
+    EXPECT_EQ(0u, sent[1]);
+}
+
+// Test that streams of equal priority share in proportion to their weights.
+TEST_F(StreamSchedulerTests, TestWeightedShares)
+{
+    // Setup
+    mTestObj.add(1, 0, 1);
+    mTestObj.add(2, 0, 3);
+
+    // Test
+    auto sent = run(100);
+
+    // Verify
+    EXPECT_EQ(3 * sent[1], sent[2]);
+}
+
+// Test that a stream that is not ready gives up its turn to the next, including a lower level.
+TEST_F(StreamSchedulerTests, TestNotReadyForfeits)
+{
+    // Setup
+    mTestObj.add(1, 0, 1);
+    mTestObj.add(2, 0, 1);
+    mTestObj.add(3, 5, 1);
+
+    // Test
+    auto sent = run(4, {1, 3});
+
+    // Verify
+    EXPECT_EQ(4 * StreamScheduler::QUANTUM, sent[2]);
+    EXPECT_EQ(1u, sent.size());
+}
+
+// Test that a partly used allowance keeps the turn, and that nothing is chosen once all are gone.
+TEST_F(StreamSchedulerTests, TestPartialTurnAndRemove)
+{
+    // Setup
+    mTestObj.add(1, 0, 2);
+    mTestObj.add(2, 0, 1);
+    auto always = [](uint16_t){ return true; };
+
+    // Test
+    auto first = mTestObj.next(always);
+    mTestObj.charge(first->stream, 1000);
+    auto second = mTestObj.next(always);
+
+    mTestObj.remove(1);
+    mTestObj.remove(2);
+
+    // Verify
+    EXPECT_EQ(1u, first->stream);
+    EXPECT_EQ(2 * StreamScheduler::QUANTUM, first->allowance);
+    EXPECT_EQ(1u, second->stream);
+    EXPECT_EQ(2 * StreamScheduler::QUANTUM - 1000, second->allowance);
+    EXPECT_TRUE(mTestObj.empty());
+    EXPECT_FALSE(mTestObj.next(always));
+}